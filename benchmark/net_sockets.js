@@ -0,0 +1,62 @@
+// Socket count/latency benchmark for the Linux build. Run with:
+//   time ./espruino benchmark/net_sockets.js
+// Opens lots of sockets to a local echo server, then times one socket
+// pinging while the rest are idle, and then every socket at once.
+// 'user'+'sys' time shows how much CPU the idle loop used while waiting.
+
+var CLIENTS = 500;
+var PINGS = 200;
+var PORT = 4446;
+var net = require("net");
+
+var server = net.createServer(function(c) {
+  c.on('data', function(data) { c.write(data); });
+});
+server.listen(PORT);
+
+var clients = [];
+var connected = 0;
+var t = getTime();
+for (var i=0;i<CLIENTS;i++) (function(n) {
+  var client = net.connect({port: PORT}, function() {
+    clients[n] = client;
+    if (++connected == CLIENTS) {
+      console.log(CLIENTS+" sockets connected in "+((getTime()-t)*1000).toFixed(1)+"ms");
+      pingOne();
+    }
+  });
+})(i);
+
+// ping on one socket with all the others idle
+function pingOne() {
+  var client = clients[0], count = 0, total = 0, max = 0, sent;
+  client.on('data', function() {
+    var l = getTime()-sent;
+    total += l;
+    if (l>max) max = l;
+    if (++count < PINGS) setTimeout(ping, 5);
+    else {
+      client.removeAllListeners('data');
+      console.log("1 socket ping: avg "+(total*1000/PINGS).toFixed(2)+"ms, max "+(max*1000).toFixed(2)+"ms");
+      pingAll();
+    }
+  });
+  function ping() { sent = getTime(); client.write("x"); }
+  ping();
+}
+
+// ping on every socket at once
+function pingAll() {
+  var count = 0, sent = getTime();
+  clients.forEach(function(client) {
+    client.on('data', function() {
+      if (++count == CLIENTS) {
+        console.log(CLIENTS+" socket ping: "+((getTime()-sent)*1000).toFixed(1)+"ms");
+        clients.forEach(function(client) { client.end(); });
+        server.close();
+        setTimeout(quit, 100);
+      }
+    });
+    client.write("x");
+  });
+}
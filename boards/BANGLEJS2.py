@@ -36,6 +36,7 @@ info = {
      'GRAPHICS',
      'CRYPTO','SHA256','SHA512',
      'LCD_MEMLCD',
+     'VMATH',
 #     'TENSORFLOW',
      'JIT' # JIT compiler enabled
    ],
@@ -57,6 +58,8 @@ info = {
      'DEFINES+=-DESPR_GRAPHICS_INTERNAL=1',
      'DEFINES+=-DESPR_BATTERY_FULL_VOLTAGE=0.3144',
      'DEFINES+=-DUSE_FONT_6X8 -DGRAPHICS_PALETTED_IMAGES -DGRAPHICS_ANTIALIAS',
+     'DEFINES+=-DESPR_GRAPHICS_DIRTY_TILES', # Track modified areas of the screen in tiles so flip only sends what changed
+     'DEFINES+=-DESPR_GRAPHICS_GLYPH_CACHE=2048', # Cache rendered vector font characters (and widths) in a 2048 byte flat string
      'DEFINES+=-DNO_DUMP_HARDWARE_INITIALISATION', # don't dump hardware init - not used and saves 1k of flash
      'DEFINES += -DESPR_NO_LINE_NUMBERS=1', # we execute mainly from flash, so line numbers can be worked out
      'INCLUDE += -I$(ROOT)/libs/banglejs -I$(ROOT)/libs/misc',
@@ -26,6 +26,7 @@ info = {
      'TERMINAL',
      'GRAPHICS',
      'LCD_ST7789_8BIT',
+     'VMATH',
 #     'FILESYSTEM',
 #     'CRYPTO','SHA256','SHA512',
 #     'TLS',
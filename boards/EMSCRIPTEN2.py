@@ -26,6 +26,7 @@ info = {
      'TERMINAL',
      'GRAPHICS',
      'LCD_MEMLCD',
+     'VMATH',
 #     'FILESYSTEM',
      'CRYPTO','SHA256','SHA512',
 #     'TLS',
@@ -39,6 +39,7 @@ info = {
      'DEFINES+=-DESP_PLATFORM -DESP32=1',
      'DEFINES+=-DESP_STACK_SIZE=25000',
      'DEFINES+=-DJSVAR_MALLOC', # Allocate space for variables at jsvInit time
+     'DEFINES+=-DESPR_INLINE_CACHE', # Remember where `a.b` lookups found things in prototypes/built-ins (see jspeFactorMember)
      'DEFINES+=-DUSE_FONT_6X8',
      'ESP32_FLASH_MAX=1572864'
    ]
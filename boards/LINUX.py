@@ -28,11 +28,15 @@ info = {
      'CRYPTO','SHA256','SHA512',
      'TLS',
      'TELNET',
+     'VMATH',
    ],
    'makefile' : [
 #     'DEFINES+=-DFLASH_64BITS_ALIGNMENT=1', # For testing 64 bit flash writes
 #     'CFLAGS+=-m32', 'LDFLAGS+=-m32', 'DEFINES+=-DUSE_CALLFUNCTION_HACK', # For testing 32 bit builds
      'DEFINES+=-DUSE_FONT_6X8 -DGRAPHICS_PALETTED_IMAGES -DGRAPHICS_ANTIALIAS',
+     'DEFINES+=-DESPR_GRAPHICS_DIRTY_TILES', # Track modified areas of the screen in tiles so flip only sends what changed
+     'DEFINES+=-DESPR_GRAPHICS_GLYPH_CACHE=4096', # Cache rendered vector font characters (and widths) in a 4096 byte flat string
+     'DEFINES+=-DESPR_INLINE_CACHE', # Remember where `a.b` lookups found things in prototypes/built-ins (see jspeFactorMember)
      'DEFINES+=-DSPIFLASH_BASE=0 -DSPIFLASH_LENGTH=FLASH_SAVED_CODE_LENGTH', # For Testing Flash Strings
      'LINUX=1',
    ]
@@ -1003,10 +1003,7 @@ void graphicsInternalFlip() {
 void lcd_flip(JsVar *parent, bool all) {
 #ifdef LCD_WIDTH
   if (all) {
-    graphicsInternal.data.modMinX = 0;
-    graphicsInternal.data.modMinY = 0;
-    graphicsInternal.data.modMaxX = LCD_WIDTH-1;
-    graphicsInternal.data.modMaxY = LCD_HEIGHT-1;
+    graphicsSetModified(&graphicsInternal, 0, 0, LCD_WIDTH-1, LCD_HEIGHT-1);
   }
   graphicsInternalFlip();
 #endif
@@ -2098,10 +2095,7 @@ void jswrap_banglejs_setLCDOverlay(JsVar *imgVar, int x, int y) {
 #ifdef LCD_CONTROLLER_LPM013M126
   lcdMemLCD_setOverlay(imgVar, x, y);
   // set all as modified
-  graphicsInternal.data.modMinX = 0;
-  graphicsInternal.data.modMinY = 0;
-  graphicsInternal.data.modMaxX = LCD_WIDTH-1;
-  graphicsInternal.data.modMaxY = LCD_HEIGHT-1;
+  graphicsSetModified(&graphicsInternal, 0, 0, LCD_WIDTH-1, LCD_HEIGHT-1);
 #endif
 }
 
@@ -3245,8 +3239,9 @@ NO_INLINE void jswrap_banglejs_init() {
   beepFreq = 0;
   // Read settings and change beep/buzz behaviour...
   JsVar *settingsFN = jsvNewFromString("setting.json");
-  JsVar *settings = jswrap_storage_readJSON(settingsFN,true);
-  jsvUnLock(settingsFN);
+  JsVar *noExceptions = jsvNewFromBool(true);
+  JsVar *settings = jswrap_storage_readJSON(settingsFN,noExceptions);
+  jsvUnLock2(settingsFN,noExceptions);
   JsVar *v;
   v = jsvIsObject(settings) ? jsvObjectGetChild(settings,"beep",0) : 0;
   if (v && jsvGetBool(v)==false) {
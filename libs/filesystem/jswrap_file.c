@@ -409,6 +409,31 @@ disable this behaviour and really speed up writes - but then you must be sure to
 close all files you are writing before power is lost or you will cause damage to
 your SD card's filesystem.
 */
+/// Write n bytes to an open file. Sets res on failure
+static size_t fileWriteBuf(JsFile *file, const char *buf, size_t n, FRESULT *res) {
+  size_t written = 0;
+#ifndef LINUX
+  *res = f_write(&file->data->handle, buf, n, &written);
+#else
+  written = fwrite(buf, 1, n, file->data->handle);
+#endif
+  if (written == 0)
+    *res = FR_DISK_ERR;
+  return written;
+}
+
+/// Sync a file after writing, unless we've been asked not to
+static void fileSyncIfNeeded(JsFile *file) {
+  // finally, sync - just in case there's a reset or something
+  if (!jsfGetFlag(JSF_UNSYNC_FILES)) {
+#ifndef LINUX
+    f_sync(&file->data->handle);
+#else
+    fflush(file->data->handle);
+#endif
+  }
+}
+
 size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
   if (!buffer) return 0;
   FRESULT res = 0;
@@ -429,26 +454,11 @@ size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
             jsvIteratorNext(&it);
           }
           // write it out
-          size_t written = 0;
-#ifndef LINUX
-          res = f_write(&file.data->handle, &buf, n, &written);
-#else
-          written = fwrite(&buf, 1, n, file.data->handle);
-#endif
-          bytesWritten += written;
-          if(written == 0)
-            res = FR_DISK_ERR;
+          bytesWritten += fileWriteBuf(&file, buf, n, &res);
           if (res) break;
         }
         jsvIteratorFree(&it);
-        // finally, sync - just in case there's a reset or something
-        if (!jsfGetFlag(JSF_UNSYNC_FILES)) {
-#ifndef LINUX
-          f_sync(&file.data->handle);
-#else
-          fflush(file.data->handle);
-#endif
-        }
+        fileSyncIfNeeded(&file);
       }
     }
   }
@@ -459,6 +469,29 @@ size_t jswrap_file_write(JsVar* parent, JsVar* buffer) {
   return bytesWritten;
 }
 
+size_t jswrap_file_writeBytes(JsVar* parent, const char *buf, size_t len) {
+  FRESULT res = 0;
+  size_t bytesWritten = 0;
+  if (jsfsInit()) {
+    JsFile file;
+    if (fileGetFromVar(&file, parent) &&
+        (file.data->mode == FM_WRITE || file.data->mode == FM_READ_WRITE)) {
+      bytesWritten = fileWriteBuf(&file, buf, len, &res);
+    }
+  }
+  if (res) jsfsReportError("Unable to write file", res);
+  return bytesWritten;
+}
+
+void jswrap_file_sync(JsVar* parent) {
+  if (jsfsInit()) {
+    JsFile file;
+    if (fileGetFromVar(&file, parent) &&
+        (file.data->mode == FM_WRITE || file.data->mode == FM_READ_WRITE))
+      fileSyncIfNeeded(&file);
+  }
+}
+
 /*JSON{
   "type" : "method",
   "class" : "File",
@@ -533,6 +566,24 @@ JsVar *jswrap_file_read(JsVar* parent, int length) {
   return buffer;
 }
 
+size_t jswrap_file_readBytes(JsVar* parent, char *buf, size_t len) {
+  FRESULT res = 0;
+  size_t actual = 0;
+  if (jsfsInit()) {
+    JsFile file;
+    if (fileGetFromVar(&file, parent) &&
+        (file.data->mode == FM_READ || file.data->mode == FM_READ_WRITE)) {
+#ifndef LINUX
+      res = f_read(&file.data->handle, buf, len, &actual);
+#else
+      actual = fread(buf, 1, len, file.data->handle);
+#endif
+    }
+  }
+  if (res) jsfsReportError("Unable to read file", res);
+  return actual;
+}
+
 /*JSON{
   "type" : "method",
   "class" : "File",
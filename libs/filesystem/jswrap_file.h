@@ -71,6 +71,12 @@ void jswrap_E_unmountSD();
 
 size_t jswrap_file_write(JsVar* parent, JsVar* buffer);
 JsVar *jswrap_file_read(JsVar* parent, int length);
+/// Write len bytes from buf to the file (for pipes) without syncing. Returns the number of bytes written
+size_t jswrap_file_writeBytes(JsVar* parent, const char *buf, size_t len);
+/// Sync the file after jswrap_file_writeBytes (unless JSF_UNSYNC_FILES is set)
+void jswrap_file_sync(JsVar* parent);
+/// Read up to len bytes from the file into buf (for pipes). Returns the number of bytes read, or 0 at the end of the file
+size_t jswrap_file_readBytes(JsVar* parent, char *buf, size_t len);
 void jswrap_file_skip_or_seek(JsVar* parent, int length, bool is_skip);
 void jswrap_file_close(JsVar* parent);
 #ifdef USE_FLASHFS
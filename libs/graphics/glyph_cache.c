@@ -0,0 +1,260 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2013 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Cache of rendered vector font glyphs and character widths
+ *
+ * Filling the polygons for a vector font character is slow, so the first
+ * time a character is drawn at a size it is rendered into a 1 bit bitmap
+ * and after that it is drawn from the bitmap. Everything is kept in one
+ * flat string in hiddenRoot: a header with tables of character widths for
+ * the most recently used sizes, followed by glyph bitmaps. When there's no
+ * space the least recently drawn glyphs are removed.
+ * ----------------------------------------------------------------------------
+ */
+#include "glyph_cache.h"
+#include "vector_font.h"
+#include "jsparse.h"
+
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+
+#define GLYPH_CACHE_WIDTH_TABLES 2 ///< How many font sizes we remember character widths for
+#define GLYPH_CACHE_WIDTH_UNKNOWN 255 ///< Width table entry for characters not measured yet (or too wide to store)
+#define GLYPH_CACHE_MAX_SIZE 255 ///< Biggest font size (and glyph width/height) that we cache
+
+typedef struct {
+  uint16_t tick; ///< incremented each time the cache is used, for finding the least recently used glyph
+  uint16_t used; ///< bytes of glyph entries after this header
+  uint16_t widthSize[GLYPH_CACHE_WIDTH_TABLES]; ///< the sizex each width table is for (0 = unused)
+  uint16_t widthTick[GLYPH_CACHE_WIDTH_TABLES]; ///< when each width table was last used
+  uint8_t widths[GLYPH_CACHE_WIDTH_TABLES][256]; ///< width of each character in pixels
+} GlyphCacheHeader;
+
+typedef struct {
+  uint16_t length; ///< length of this entry including the bitmap (a multiple of 4)
+  uint16_t tick; ///< when this glyph was last drawn
+  uint8_t sizex, sizey; ///< font size
+  uint8_t ch; ///< the character
+  uint8_t bpp; ///< bits per pixel of the bitmap (always 1 at the moment)
+  int16_t x, y; ///< offset of the bitmap from the position the character was drawn at
+  uint8_t width, height; ///< size of the bitmap
+  uint8_t pad[2];
+} GlyphCacheEntry; // followed by the bitmap, MSB first, each row starting on a byte boundary
+
+JsVar *graphicsGlyphCacheGet(bool create) {
+  JsVar *cache = jsvObjectGetChild(execInfo.hiddenRoot, JS_GRAPHICS_GLYPH_CACHE_VAR, 0);
+  if (cache || !create) return cache;
+  cache = jsvNewFlatStringOfLength(ESPR_GRAPHICS_GLYPH_CACHE);
+  if (!cache) return 0;
+  GlyphCacheHeader *h = (GlyphCacheHeader*)jsvGetFlatStringPointer(cache);
+  memset(h, 0, sizeof(GlyphCacheHeader));
+  memset(h->widths, GLYPH_CACHE_WIDTH_UNKNOWN, sizeof(h->widths));
+  jsvObjectSetChild(execInfo.hiddenRoot, JS_GRAPHICS_GLYPH_CACHE_VAR, cache);
+  return cache;
+}
+
+unsigned int graphicsGlyphCacheVectorCharWidth(JsVar *cache, JsGraphics *gfx, unsigned int sizex, char ch) {
+  GlyphCacheHeader *h = (GlyphCacheHeader*)jsvGetFlatStringPointer(cache);
+  h->tick++;
+  int i, t = 0;
+  for (i=0;i<GLYPH_CACHE_WIDTH_TABLES;i++) {
+    if (h->widthSize[i]==sizex) break;
+    // otherwise keep track of the least recently used table
+    if ((uint16_t)(h->tick-h->widthTick[i]) > (uint16_t)(h->tick-h->widthTick[t])) t = i;
+  }
+  if (i==GLYPH_CACHE_WIDTH_TABLES) { // not found - reuse the oldest table
+    i = t;
+    h->widthSize[i] = (uint16_t)sizex;
+    memset(h->widths[i], GLYPH_CACHE_WIDTH_UNKNOWN, sizeof(h->widths[i]));
+  }
+  h->widthTick[i] = h->tick;
+  unsigned int w = h->widths[i][(unsigned char)ch];
+  if (w==GLYPH_CACHE_WIDTH_UNKNOWN) {
+    w = graphicsVectorCharWidth(gfx, sizex, ch);
+    if (w<GLYPH_CACHE_WIDTH_UNKNOWN) h->widths[i][(unsigned char)ch] = (uint8_t)w;
+  }
+  return w;
+}
+
+// ----------------------------------------------------------------------------
+// Rendering glyphs. We draw the character into a JsGraphics that's just on the stack, with
+// setPixel/fillRect that either record the bounds of what was drawn or write to the bitmap
+
+typedef struct {
+  int x1,y1,x2,y2;
+} GlyphCacheBounds;
+
+static void glyphCacheBoundsFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
+  NOT_USED(col);
+  GlyphCacheBounds *b = (GlyphCacheBounds*)gfx->backendData;
+  if (x1<b->x1) b->x1=x1;
+  if (y1<b->y1) b->y1=y1;
+  if (x2>b->x2) b->x2=x2;
+  if (y2>b->y2) b->y2=y2;
+}
+
+static void glyphCacheBoundsSetPixel(JsGraphics *gfx, int x, int y, unsigned int col) {
+  glyphCacheBoundsFillRect(gfx, x, y, x, y, col);
+}
+
+static void glyphCacheBitmapFillRect(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
+  NOT_USED(col);
+  int stride = (gfx->data.width+7)>>3;
+  for (int y=y1;y<=y2;y++) {
+    uint8_t *row = (uint8_t*)gfx->backendData + y*stride;
+    for (int x=x1;x<=x2;x++)
+      row[x>>3] |= (uint8_t)(0x80 >> (x&7));
+  }
+}
+
+static void glyphCacheBitmapSetPixel(JsGraphics *gfx, int x, int y, unsigned int col) {
+  glyphCacheBitmapFillRect(gfx, x, y, x, y, col);
+}
+
+/// Set up a JsGraphics for drawing a glyph into
+static void glyphCacheInitGraphics(JsGraphics *g, int width, int height, void *data) {
+  memset(g, 0, sizeof(JsGraphics));
+  g->data.type = JSGRAPHICSTYPE_ARRAYBUFFER;
+  g->data.width = (unsigned short)width;
+  g->data.height = (unsigned short)height;
+  g->data.bpp = 1;
+  g->data.fgColor = 1;
+  g->data.clipRect.x2 = (unsigned short)(width-1);
+  g->data.clipRect.y2 = (unsigned short)(height-1);
+  g->backendData = data;
+}
+
+/// Remove the least recently used glyph
+static void glyphCacheRemoveOldest(GlyphCacheHeader *h) {
+  uint8_t *start = (uint8_t*)&h[1];
+  GlyphCacheEntry *oldest = 0;
+  unsigned int offset = 0;
+  while (offset < h->used) {
+    GlyphCacheEntry *e = (GlyphCacheEntry*)&start[offset];
+    if (!oldest || (uint16_t)(h->tick-e->tick) > (uint16_t)(h->tick-oldest->tick))
+      oldest = e;
+    offset += e->length;
+  }
+  if (!oldest) return;
+  uint8_t *end = (uint8_t*)oldest + oldest->length;
+  memmove(oldest, end, (size_t)(&start[h->used] - end));
+  h->used = (uint16_t)(h->used - ((uint8_t*)end - (uint8_t*)oldest));
+}
+
+/// Render a glyph and add it to the cache, or return 0 if it's too big
+static GlyphCacheEntry *glyphCacheAdd(GlyphCacheHeader *h, int sizex, int sizey, char ch) {
+  // Draw the glyph once to find out how big it is. Put it in the middle of a big area so we catch anything off the edges
+  JsGraphics g;
+  GlyphCacheBounds b = { .x1=0x7FFF, .y1=0x7FFF, .x2=-1, .y2=-1 };
+  glyphCacheInitGraphics(&g, sizex*4, sizey*4, &b);
+  g.setPixel = glyphCacheBoundsSetPixel;
+  g.fillRect = glyphCacheBoundsFillRect;
+  graphicsFillVectorChar(&g, sizex, sizey, sizex, sizey, ch);
+  int width = 0, height = 0;
+  if (b.x2>=b.x1) {
+    width = 1+b.x2-b.x1;
+    height = 1+b.y2-b.y1;
+  }
+  if (width>GLYPH_CACHE_MAX_SIZE || height>GLYPH_CACHE_MAX_SIZE) return 0;
+  unsigned int length = (unsigned int)(sizeof(GlyphCacheEntry) + (size_t)(((width+7)>>3)*height) + 3) & ~3U;
+  unsigned int capacity = ESPR_GRAPHICS_GLYPH_CACHE - sizeof(GlyphCacheHeader);
+  if (length > capacity/2) return 0; // it'd push too much else out of the cache
+  while (h->used + length > capacity)
+    glyphCacheRemoveOldest(h);
+  // Now add it on the end and draw into it
+  GlyphCacheEntry *e = (GlyphCacheEntry*)((uint8_t*)&h[1] + h->used);
+  memset(e, 0, length);
+  e->length = (uint16_t)length;
+  e->sizex = (uint8_t)sizex;
+  e->sizey = (uint8_t)sizey;
+  e->ch = (uint8_t)ch;
+  e->bpp = 1;
+  e->x = (int16_t)(b.x1 - sizex);
+  e->y = (int16_t)(b.y1 - sizey);
+  e->width = (uint8_t)width;
+  e->height = (uint8_t)height;
+  h->used = (uint16_t)(h->used + length);
+  if (width) {
+    glyphCacheInitGraphics(&g, width, height, &e[1]);
+    g.setPixel = glyphCacheBitmapSetPixel;
+    g.fillRect = glyphCacheBitmapFillRect;
+    graphicsFillVectorChar(&g, -e->x, -e->y, sizex, sizey, ch);
+  }
+  return e;
+}
+
+bool graphicsGlyphCacheFillVectorChar(JsVar *cache, JsGraphics *gfx, int x, int y, int sizex, int sizey, char ch) {
+  /* Polygons are filled in device coordinates, so if the coordinates are
+  mapped the pixels can come out slightly differently. Only cache unmapped glyphs. */
+  if (gfx->data.flags & JSGRAPHICSFLAGS_MAPPEDXY) return false;
+  if (sizex<=0 || sizey<=0 || sizex>GLYPH_CACHE_MAX_SIZE || sizey>GLYPH_CACHE_MAX_SIZE) return false;
+  GlyphCacheHeader *h = (GlyphCacheHeader*)jsvGetFlatStringPointer(cache);
+  h->tick++;
+  // Look for the glyph
+  uint8_t *start = (uint8_t*)&h[1];
+  GlyphCacheEntry *e = 0;
+  unsigned int offset = 0;
+  while (offset < h->used) {
+    GlyphCacheEntry *c = (GlyphCacheEntry*)&start[offset];
+    if (c->ch==(uint8_t)ch && c->sizex==sizex && c->sizey==sizey) {
+      e = c;
+      break;
+    }
+    offset += c->length;
+  }
+  if (!e) e = glyphCacheAdd(h, sizex, sizey, ch);
+  if (!e) return false;
+  e->tick = h->tick;
+  x += e->x;
+  y += e->y;
+  if (!e->width) return true;
+  /* If it's all on screen we can mark the area as modified once and then call
+  the fillRect/setPixel functions directly, otherwise let graphicsFillRectDevice clip */
+  bool onScreen = x>=gfx->data.clipRect.x1 && y>=gfx->data.clipRect.y1 &&
+                  x+e->width-1<=gfx->data.clipRect.x2 && y+e->height-1<=gfx->data.clipRect.y2;
+  if (onScreen) graphicsSetModified(gfx, x, y, x+e->width-1, y+e->height-1);
+  unsigned int col = gfx->data.fgColor;
+  // Draw each run of set pixels in the bitmap
+  int stride = (e->width+7)>>3;
+  const uint8_t *row = (const uint8_t*)&e[1];
+  for (int cy=0;cy<e->height;cy++,row+=stride) {
+    int runStart = -1;
+    for (int cx=0;cx<=e->width;cx++) {
+      bool set;
+      if (cx==e->width) set = false; // end any run at the end of the row
+      else if (!(cx&7) && (row[cx>>3]==0 || row[cx>>3]==0xFF) && cx+8<=e->width) {
+        // whole bytes that are all clear or all set
+        set = row[cx>>3]!=0;
+        if (set != (runStart>=0)) {
+          if (set) runStart = cx;
+          else {
+            if (onScreen) {
+              if (cx-1==runStart) gfx->setPixel(gfx, x+runStart, y+cy, col);
+              else gfx->fillRect(gfx, x+runStart, y+cy, x+cx-1, y+cy, col);
+            } else graphicsFillRectDevice(gfx, x+runStart, y+cy, x+cx-1, y+cy, col);
+            runStart = -1;
+          }
+        }
+        cx += 7;
+        continue;
+      } else set = (row[cx>>3] & (0x80>>(cx&7)))!=0;
+      if (set && runStart<0) runStart = cx;
+      else if (!set && runStart>=0) {
+        if (onScreen) {
+          if (cx-1==runStart) gfx->setPixel(gfx, x+runStart, y+cy, col);
+          else gfx->fillRect(gfx, x+runStart, y+cy, x+cx-1, y+cy, col);
+        } else graphicsFillRectDevice(gfx, x+runStart, y+cy, x+cx-1, y+cy, col);
+        runStart = -1;
+      }
+    }
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,24 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2013 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Cache of rendered vector font glyphs and character widths
+ * ----------------------------------------------------------------------------
+ */
+#include "graphics.h"
+
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+/// Get the glyph cache (a flat string of ESPR_GRAPHICS_GLYPH_CACHE bytes), creating it if needed and create=true. Returns 0 if there isn't one/not enough memory
+JsVar *graphicsGlyphCacheGet(bool create);
+/// Like graphicsVectorCharWidth, but remembers widths in the cache
+unsigned int graphicsGlyphCacheVectorCharWidth(JsVar *cache, JsGraphics *gfx, unsigned int sizex, char ch);
+/** Draw a vector font character from the cache (rendering and adding it if it isn't there).
+Returns false if it couldn't be cached (eg. it's too big), in which case use graphicsFillVectorChar */
+bool graphicsGlyphCacheFillVectorChar(JsVar *cache, JsGraphics *gfx, int x, int y, int sizex, int sizey, char ch);
+#endif
@@ -149,12 +149,7 @@ void graphicsStructInit(JsGraphics *gfx, int width, int height, int bpp) {
   gfx->data.height = (unsigned short)height;
   gfx->data.bpp = (unsigned char)bpp;
   graphicsStructResetState(gfx);
-#ifndef NO_MODIFIED_AREA
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
-#endif
+  graphicsResetModified(gfx);
 }
 
 /// Set up the callbacks for this graphics instance (usually done by graphicsGetFromVar)
@@ -164,6 +159,9 @@ bool graphicsSetCallbacks(JsGraphics *gfx) {
   gfx->fillRect = graphicsFallbackFillRect;
   gfx->blit = graphicsFallbackBlit;
   gfx->scroll = graphicsFallbackScroll;
+#ifndef SAVE_ON_FLASH
+  gfx->setPixelRow = 0; // only some backends can do this
+#endif
 #ifdef USE_LCD_SDL
   if (gfx->data.type == JSGRAPHICSTYPE_SDL) {
     lcdSetCallbacks_SDL(gfx);
@@ -300,6 +298,30 @@ unsigned short graphicsGetHeight(const JsGraphics *gfx) {
   return (gfx->data.flags & JSGRAPHICSFLAGS_SWAP_XY) ? gfx->data.width : gfx->data.height;
 }
 
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+/// Get how far to shift a device coordinate right to get a tile index
+static int graphicsGetTileShift(unsigned short size) {
+  int shift = GRAPHICS_DIRTY_TILE_SHIFT;
+  while (((size-1)>>shift) >= GRAPHICS_DIRTY_TILES) shift++;
+  return shift;
+}
+
+/// Mark the tiles covering this area (inclusive) as modified
+static void graphicsSetModifiedTiles(JsGraphics *gfx, int x1, int y1, int x2, int y2) {
+  if (x1>x2 || y1>y2) return;
+  int sx = graphicsGetTileShift(gfx->data.width);
+  int sy = graphicsGetTileShift(gfx->data.height);
+  int tx1 = x1<0 ? 0 : x1>>sx, tx2 = x2<0 ? -1 : x2>>sx;
+  int ty1 = y1<0 ? 0 : y1>>sy, ty2 = y2<0 ? -1 : y2>>sy;
+  if (tx2 >= GRAPHICS_DIRTY_TILES) tx2 = GRAPHICS_DIRTY_TILES-1;
+  if (ty2 >= GRAPHICS_DIRTY_TILES) ty2 = GRAPHICS_DIRTY_TILES-1;
+  if (tx1>tx2) return;
+  unsigned short mask = (unsigned short)((2U<<tx2) - (1U<<tx1));
+  for (int ty=ty1;ty<=ty2;ty++)
+    gfx->data.modTiles[ty] |= mask;
+}
+#endif
+
 // Set the area modified by a draw command and also clip to the screen/clipping bounds
 bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int *y2) {
   bool modified = false;
@@ -312,6 +334,9 @@ bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int
   if (*x2 > gfx->data.modMaxX) { gfx->data.modMaxX=(short)*x2; modified = true; }
   if (*y1 < gfx->data.modMinY) { gfx->data.modMinY=(short)*y1; modified = true; }
   if (*y2 > gfx->data.modMaxY) { gfx->data.modMaxY=(short)*y2; modified = true; }
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  graphicsSetModifiedTiles(gfx, *x1, *y1, *x2, *y2);
+#endif
 #else
   if (*x1<0) { *x1 = 0; modified = true; }
   if (*y1<0) { *y1 = 0; modified = true; }
@@ -328,6 +353,81 @@ void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2) {
   if (x2 > gfx->data.modMaxX) { gfx->data.modMaxX=(short)x2; }
   if (y1 < gfx->data.modMinY) { gfx->data.modMinY=(short)y1; }
   if (y2 > gfx->data.modMaxY) { gfx->data.modMaxY=(short)y2; }
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  graphicsSetModifiedTiles(gfx, x1, y1, x2, y2);
+#endif
+#endif
+}
+
+/// Mark nothing as modified (eg. after the screen has been updated)
+void graphicsResetModified(JsGraphics *gfx) {
+#ifndef NO_MODIFIED_AREA
+  gfx->data.modMaxX = -32768;
+  gfx->data.modMaxY = -32768;
+  gfx->data.modMinX = 32767;
+  gfx->data.modMinY = 32767;
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  memset(gfx->data.modTiles, 0, sizeof(gfx->data.modTiles));
+#endif
+#endif
+}
+
+/// Call fn for non-overlapping rectangles that cover everything that has been modified
+void graphicsForEachModifiedRect(JsGraphics *gfx, bool fullRows, JsGraphicsModifiedRectFn fn, void *userData) {
+#ifndef NO_MODIFIED_AREA
+  if (gfx->data.modMinX > gfx->data.modMaxX || gfx->data.modMinY > gfx->data.modMaxY)
+    return; // nothing modified
+  int minX = fullRows ? 0 : gfx->data.modMinX;
+  int maxX = fullRows ? gfx->data.width-1 : gfx->data.modMaxX;
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  int sx = graphicsGetTileShift(gfx->data.width);
+  int sy = graphicsGetTileShift(gfx->data.height);
+  int ty = 0;
+  while (ty < GRAPHICS_DIRTY_TILES) {
+    unsigned int mask = gfx->data.modTiles[ty];
+    if (!mask) {
+      ty++;
+      continue;
+    }
+    // Merge following rows of tiles if they're the same (or for fullRows, if they're modified at all)
+    int ty2 = ty;
+    while (ty2+1 < GRAPHICS_DIRTY_TILES &&
+           (fullRows ? gfx->data.modTiles[ty2+1]!=0 : gfx->data.modTiles[ty2+1]==mask))
+      ty2++;
+    int y1 = ty << sy, y2 = ((ty2+1) << sy) - 1;
+    if (y1 < gfx->data.modMinY) y1 = gfx->data.modMinY;
+    if (y2 > gfx->data.modMaxY) y2 = gfx->data.modMaxY;
+    if (fullRows) {
+      fn(gfx, minX, y1, maxX, y2, userData);
+    } else {
+      // one rectangle for each horizontal run of modified tiles
+      int tx = 0;
+      while (mask) {
+        if (!(mask&1)) {
+          mask >>= 1;
+          tx++;
+          continue;
+        }
+        int tx2 = tx;
+        while (mask&2) {
+          mask >>= 1;
+          tx2++;
+        }
+        mask >>= 1;
+        int x1 = tx << sx, x2 = ((tx2+1) << sx) - 1;
+        if (x1 < minX) x1 = minX;
+        if (x2 > maxX) x2 = maxX;
+        if (x1<=x2 && y1<=y2) fn(gfx, x1, y1, x2, y2, userData);
+        tx = tx2+1;
+      }
+    }
+    ty = ty2+1;
+  }
+#else
+  fn(gfx, minX, gfx->data.modMinY, maxX, gfx->data.modMaxY, userData);
+#endif
+#else
+  fn(gfx, 0, 0, gfx->data.width-1, gfx->data.height-1, userData);
 #endif
 }
 
@@ -418,6 +518,9 @@ static void graphicsSetPixelDevice(JsGraphics *gfx, int x, int y, unsigned int c
   if (x > gfx->data.modMaxX) gfx->data.modMaxX=(short)x;
   if (y < gfx->data.modMinY) gfx->data.modMinY=(short)y;
   if (y > gfx->data.modMaxY) gfx->data.modMaxY=(short)y;
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  graphicsSetModifiedTiles(gfx, x, y, x, y);
+#endif
 #else
   if (x<0 || y<0 || x>=gfx->data.width || y>=gfx->data.height) return;
 #endif
@@ -464,6 +567,9 @@ void graphicsFillRectDevice(JsGraphics *gfx, int x1, int y1, int x2, int y2, uns
   if (x2 > gfx->data.modMaxX) gfx->data.modMaxX=(short)x2;
   if (y1 < gfx->data.modMinY) gfx->data.modMinY=(short)y1;
   if (y2 > gfx->data.modMaxY) gfx->data.modMaxY=(short)y2;
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  graphicsSetModifiedTiles(gfx, x1, y1, x2, y2);
+#endif
 #endif
   if (x1==x2 && y1==y2) {
     gfx->setPixel(gfx,(int)x1,(int)y1,col);
@@ -103,6 +103,13 @@ typedef struct {
   unsigned short x2,y2;
 } PACKED_FLAGS JsGraphicsClipRect;
 
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+/* As well as the modified bounding box, keep a bitmap of which tiles of the
+ screen have been modified so flip() only needs to send those. */
+#define GRAPHICS_DIRTY_TILES 16 ///< Max number of tiles in X and Y (one bit per tile in an unsigned short)
+#define GRAPHICS_DIRTY_TILE_SHIFT 4 ///< Tiles are 16x16 (1<<4), but get bigger if the display is more than 256px
+#endif
+
 typedef struct {
   JsGraphicsType type;
   JsGraphicsFlags flags;
@@ -119,6 +126,9 @@ typedef struct {
 #ifndef NO_MODIFIED_AREA
   JsGraphicsClipRect clipRect;
   short modMinX, modMinY, modMaxX, modMaxY; ///< area that has been modified
+#ifdef ESPR_GRAPHICS_DIRTY_TILES
+  unsigned short modTiles[GRAPHICS_DIRTY_TILES]; ///< bitmap of modified tiles, one element per row of tiles
+#endif
 #endif
 } PACKED_FLAGS JsGraphicsData;
 
@@ -132,9 +142,16 @@ typedef struct JsGraphics {
   unsigned int (*getPixel)(struct JsGraphics *gfx, int x, int y); ///< x/y guaranteed to be in range
   void (*blit)(struct JsGraphics *gfx, int x1, int y1, int w, int h, int x2, int y2); ///< blit a WxH area of x1y1 to x2y2 - all guaranteed to be in range
   void (*scroll)(struct JsGraphics *gfx, int xdir, int ydir,  int x1, int y1, int x2, int y2); ///< scroll - leave unscrolled area undefined (all values guaranteed to be in range)
+#ifndef SAVE_ON_FLASH
+  void (*setPixelRow)(struct JsGraphics *gfx, int x, int y, int count, const unsigned int *cols); ///< optional - set count pixels left to right from x,y (all guaranteed to be in range). GRAPHICS_SKIP_PIXEL pixels are left alone
+#endif
 } PACKED_FLAGS JsGraphics;
 typedef void (*JsGraphicsSetPixelFn)(struct JsGraphics *gfx, int x, int y, unsigned int col);
 
+#ifndef SAVE_ON_FLASH
+#define GRAPHICS_SKIP_PIXEL 0xFFFFFFFF ///< For JsGraphics.setPixelRow, don't write this pixel
+#endif
+
 #ifdef GRAPHICS_THEME
 #if LCD_BPP && LCD_BPP<=16
 typedef unsigned short JsGraphicsThemeColor;
@@ -194,6 +211,14 @@ unsigned short graphicsGetHeight(const JsGraphics *gfx);
 bool graphicsSetModifiedAndClip(JsGraphics *gfx, int *x1, int *y1, int *x2, int *y2);
 // Set the area modified by a draw command
 void graphicsSetModified(JsGraphics *gfx, int x1, int y1, int x2, int y2);
+/// Mark nothing as modified (eg. after the screen has been updated)
+void graphicsResetModified(JsGraphics *gfx);
+/// Called with each modified rectangle (inclusive device coordinates) from graphicsForEachModifiedRect
+typedef void (*JsGraphicsModifiedRectFn)(JsGraphics *gfx, int x1, int y1, int x2, int y2, void *userData);
+/** Call fn for non-overlapping rectangles that cover everything that has been modified (top to bottom).
+With ESPR_GRAPHICS_DIRTY_TILES only modified tiles are covered, otherwise it's just the modified area.
+If fullRows is set, the rectangles cover the whole width of the display */
+void graphicsForEachModifiedRect(JsGraphics *gfx, bool fullRows, JsGraphicsModifiedRectFn fn, void *userData);
 /// Get a setPixel function (assuming coordinates already clipped with graphicsSetModifiedAndClip) - if all is ok it can choose a faster draw function
 JsGraphicsSetPixelFn graphicsGetSetPixelFn(JsGraphics *gfx);
 /// Get a setPixel function and set modified area (assuming no clipping) (inclusive of x2,y2) - if all is ok it can choose a faster draw function
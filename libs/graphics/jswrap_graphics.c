@@ -35,6 +35,7 @@
 #include "bitmap_font_4x6.h"
 #include "bitmap_font_6x8.h"
 #include "vector_font.h"
+#include "glyph_cache.h"
 
 #ifdef GRAPHICS_PALETTED_IMAGES
 #if defined(ESPR_GRAPHICS_12BIT)
@@ -349,9 +350,95 @@ NO_INLINE void _jswrap_drawImageLayerNextY(GfxDrawImageLayer *l) {
   }
 }
 
+void _jswrap_graphics_rowBufferInit(GfxRowBuffer *r, JsGraphics *gfx, JsGraphicsSetPixelFn setPixel) {
+  r->gfx = gfx;
+  r->setPixel = setPixel;
+#ifndef SAVE_ON_FLASH
+  // we can only write rows if setPixel wasn't going to remap coordinates
+  r->rows = setPixel==gfx->setPixel && gfx->setPixelRow;
+#endif
+  r->x = r->y = r->count = 0;
+}
+
+void _jswrap_graphics_rowBufferFlush(GfxRowBuffer *r) {
+#ifndef SAVE_ON_FLASH
+  if (r->count)
+    r->gfx->setPixelRow(r->gfx, r->x, r->y, r->count, r->cols);
+  r->x += r->count;
+  r->count = 0;
+#endif
+}
+
+void _jswrap_graphics_rowBufferStart(GfxRowBuffer *r, int x, int y) {
+  r->x = x;
+  r->y = y;
+  r->count = 0;
+}
+
+void _jswrap_graphics_rowBufferPush(GfxRowBuffer *r, unsigned int col) {
+#ifndef SAVE_ON_FLASH
+  if (r->rows) {
+    // setPixelRow converts the color (<=16 bits), we just make sure it can't look like a skipped pixel
+    r->cols[r->count++] = (col==GRAPHICS_SKIP_PIXEL) ? (col & 0xFFFF) : col;
+    if (r->count==GFX_ROW_BUFFER_SIZE) _jswrap_graphics_rowBufferFlush(r);
+    return;
+  }
+#endif
+  r->setPixel(r->gfx, r->x++, r->y, col);
+}
+
+void _jswrap_graphics_rowBufferSkip(GfxRowBuffer *r) {
+#ifndef SAVE_ON_FLASH
+  if (r->rows) {
+    r->cols[r->count++] = GRAPHICS_SKIP_PIXEL;
+    if (r->count==GFX_ROW_BUFFER_SIZE) _jswrap_graphics_rowBufferFlush(r);
+    return;
+  }
+#endif
+  r->x++;
+}
+
+#ifndef SAVE_ON_FLASH
+/// jsvStringIteratorGetCharAndNext, but inline while we're not going to move to the next block
+static ALWAYS_INLINE unsigned char _jswrap_drawImageGetByte(JsvStringIterator *it) {
+  if (it->charIdx+1 < it->charsInVar)
+    return (unsigned char)READ_FLASH_UINT8(&it->ptr[it->charIdx++]);
+  return (unsigned char)jsvStringIteratorGetCharAndNext(it);
+}
+#endif
+
 NO_INLINE void _jswrap_drawImageSimple(JsGraphics *gfx, int xPos, int yPos, GfxDrawImageInfo *img, JsvStringIterator *it) {
   int bits=0, colData=0;
   JsGraphicsSetPixelFn setPixel = graphicsGetSetPixelUnclippedFn(gfx, xPos, yPos, xPos+img->width-1, yPos+img->height-1);
+#ifndef SAVE_ON_FLASH
+  if (setPixel==gfx->setPixel && gfx->setPixelRow) {
+    // All on screen and the backend can write rows - decode a chunk of each row at a time and write it directly
+    unsigned int cols[GFX_ROW_BUFFER_SIZE];
+    for (int y=yPos;y<yPos+img->height;y++) {
+      for (int x=0;x<img->width;) {
+        int count = img->width-x;
+        if (count>GFX_ROW_BUFFER_SIZE) count=GFX_ROW_BUFFER_SIZE;
+        for (int i=0;i<count;i++) {
+          while (bits < img->bpp) {
+            colData = (colData<<8) | _jswrap_drawImageGetByte(it);
+            bits += 8;
+          }
+          unsigned int col = (colData>>(bits-img->bpp))&img->bitMask;
+          bits -= img->bpp;
+          if (img->transparentCol!=col) {
+            if (img->palettePtr) col = img->palettePtr[col&img->paletteMask];
+            else if (col==GRAPHICS_SKIP_PIXEL) col &= 0xFFFF; // 32 bit images - the row is <=16 bits anyway
+          } else
+            col = GRAPHICS_SKIP_PIXEL;
+          cols[i] = col;
+        }
+        gfx->setPixelRow(gfx, xPos+x, y, count, cols);
+        x += count;
+      }
+    }
+    return;
+  }
+#endif
   for (int y=yPos;y<yPos+img->height;y++) {
     for (int x=xPos;x<xPos+img->width;x++) {
       // Get the data we need...
@@ -1948,8 +2035,18 @@ typedef struct {
   unsigned short scale;
   unsigned short scalex, scaley;
   unsigned char customFirstChar;
+#ifndef SAVE_ON_FLASH
+  JsVar *customWidth; ///< Custom fonts: locked width of every char (int) or string of widths
+  const unsigned char *customWidthPtr; ///< If customWidth is a string we can access directly, this points to it
+  size_t customWidthLen; ///< Number of widths at customWidthPtr
+#endif
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+  JsVar *glyphCache; ///< Vector font: locked glyph cache (0 if it hasn't been created yet, or there wasn't enough memory)
+  bool glyphCacheChecked; ///< Have we tried to create glyphCache? (see _jswrap_graphics_getGlyphCache)
+#endif
 } JsGraphicsFontInfo;
 
+/// Get info on the current font. Call _jswrap_graphics_freeFontInfo when done
 static void _jswrap_graphics_getFontInfo(JsGraphics *gfx, JsGraphicsFontInfo *info) {
   info->font = gfx->data.fontSize & JSGRAPHICS_FONTSIZE_FONT_MASK;
   info->scale = gfx->data.fontSize & JSGRAPHICS_FONTSIZE_SCALE_MASK;
@@ -1959,17 +2056,64 @@ static void _jswrap_graphics_getFontInfo(JsGraphics *gfx, JsGraphicsFontInfo *in
     info->scalex = info->scale & JSGRAPHICS_FONTSIZE_SCALE_X_MASK;
     info->scaley = (info->scale & JSGRAPHICS_FONTSIZE_SCALE_Y_MASK) >> JSGRAPHICS_FONTSIZE_SCALE_Y_SHIFT;
   }
+#ifndef SAVE_ON_FLASH
+  info->customWidth = 0;
+  info->customWidthPtr = 0;
+  info->customWidthLen = 0;
+#endif
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+  // Only use the cache if it exists - it's created when a glyph is first drawn
+  info->glyphCache = (info->font == JSGRAPHICS_FONTSIZE_VECTOR) ? graphicsGlyphCacheGet(false) : 0;
+  info->glyphCacheChecked = info->glyphCache!=0;
+#endif
 #ifndef SAVE_ON_FLASH
   if (info->font & JSGRAPHICS_FONTSIZE_CUSTOM_BIT) {
     info->customFirstChar = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(gfx->graphicsVar, JSGRAPHICS_CUSTOMFONT_FIRSTCHAR, 0));
+    // keep hold of the widths so we don't have to look them up for every character
+    info->customWidth = jsvObjectGetChild(gfx->graphicsVar, JSGRAPHICS_CUSTOMFONT_WIDTH, 0);
+    if (jsvIsString(info->customWidth))
+      info->customWidthPtr = (const unsigned char *)jsvGetDataPointer(info->customWidth, &info->customWidthLen);
   } else
 #endif
     info->customFirstChar = 0;
 }
 
+static void _jswrap_graphics_freeFontInfo(JsGraphicsFontInfo *info) {
+#ifndef SAVE_ON_FLASH
+  jsvUnLock(info->customWidth);
+#endif
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+  jsvUnLock(info->glyphCache);
+#endif
+}
+
+#if defined(ESPR_GRAPHICS_GLYPH_CACHE) && !defined(NO_VECTOR_FONT)
+/// Vector font: get the glyph cache for drawing, creating it the first time (may return 0 if not enough memory)
+static JsVar *_jswrap_graphics_getGlyphCache(JsGraphicsFontInfo *info) {
+  if (!info->glyphCacheChecked) {
+    info->glyphCache = graphicsGlyphCacheGet(true);
+    info->glyphCacheChecked = true;
+  }
+  return info->glyphCache;
+}
+#endif
+
+#ifndef SAVE_ON_FLASH
+/// Custom fonts: get the (unscaled) width of a character. info->customWidth must be a string
+static int _jswrap_graphics_getCustomCharWidth(JsGraphicsFontInfo *info, size_t idx) {
+  if (info->customWidthPtr)
+    return (idx < info->customWidthLen) ? info->customWidthPtr[idx] : 0;
+  return (unsigned char)jsvGetCharInString(info->customWidth, idx);
+}
+#endif
+
 static int _jswrap_graphics_getCharWidth(JsGraphics *gfx, JsGraphicsFontInfo *info, char ch) {
   if (info->font == JSGRAPHICS_FONTSIZE_VECTOR) {
 #ifndef NO_VECTOR_FONT
+#ifdef ESPR_GRAPHICS_GLYPH_CACHE
+    if (info->glyphCache)
+      return (int)graphicsGlyphCacheVectorCharWidth(info->glyphCache, gfx, info->scalex, ch);
+#endif
     return (int)graphicsVectorCharWidth(gfx, info->scalex, ch);
 #endif
   } else if (info->font == JSGRAPHICS_FONTSIZE_4X6) {
@@ -1981,15 +2125,11 @@ static int _jswrap_graphics_getCharWidth(JsGraphics *gfx, JsGraphicsFontInfo *in
 #ifndef SAVE_ON_FLASH
   } else if (info->font & JSGRAPHICS_FONTSIZE_CUSTOM_BIT) {
     int w = 0;
-    // FIXME: is getCharWidth is called a lot (eg for metrics), we do getChild for each
-    // character - maybe we should store this in JsGraphicsFontInfo (but then we have to unlock it)
-    JsVar *customWidth = jsvObjectGetChild(gfx->graphicsVar, JSGRAPHICS_CUSTOMFONT_WIDTH, 0);
-    if (jsvIsString(customWidth)) {
+    if (jsvIsString(info->customWidth)) {
       if (ch>=info->customFirstChar)
-        w = info->scalex*(unsigned char)jsvGetCharInString(customWidth, (size_t)(ch-info->customFirstChar));
+        w = info->scalex*_jswrap_graphics_getCustomCharWidth(info, (size_t)(ch-info->customFirstChar));
     } else
-      w = info->scalex*(int)jsvGetInteger(customWidth);
-    jsvUnLock(customWidth);
+      w = info->scalex*(int)jsvGetInteger(info->customWidth);
     return w;
 #endif
   }
@@ -2027,7 +2167,9 @@ int jswrap_graphics_getFontHeight(JsVar *parent) {
   JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return 0;
   JsGraphicsFontInfo info;
   _jswrap_graphics_getFontInfo(&gfx, &info);
-  return _jswrap_graphics_getFontHeightInternal(&gfx, &info);
+  int h = _jswrap_graphics_getFontHeightInternal(&gfx, &info);
+  _jswrap_graphics_freeFontInfo(&info);
+  return h;
 #else
   return 0;
 #endif
@@ -2073,6 +2215,7 @@ void _jswrap_graphics_stringMetrics(JsGraphics *gfx, JsVar *var, int lineStartIn
   }
   jsvStringIteratorFree(&it);
   jsvUnLock(str);
+  _jswrap_graphics_freeFontInfo(&info);
   if (stringWidth) *stringWidth = width>maxWidth ? width : maxWidth;
   if (stringHeight) *stringHeight = height;
 }
@@ -2229,6 +2372,7 @@ JsVar *jswrap_graphics_wrapString(JsVar *parent, JsVar *str, int maxWidth) {
   if (jsvGetStringLength(currentLine))
     jsvArrayPush(lines, currentLine);
   jsvUnLock2(str,currentLine);
+  _jswrap_graphics_freeFontInfo(&info);
   return lines;
 }
 
@@ -2275,14 +2419,13 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
   int fontHeight = _jswrap_graphics_getFontHeightInternal(&gfx, &info);
 
 #ifndef SAVE_ON_FLASH
-  JsVar *customBitmap = 0, *customWidth = 0;
+  JsVar *customBitmap = 0;
   int customBPP = 1;
 
   if (info.font & JSGRAPHICS_FONTSIZE_CUSTOM_BIT) {
     if (info.font==JSGRAPHICS_FONTSIZE_CUSTOM_2BPP) customBPP = 2;
     if (info.font==JSGRAPHICS_FONTSIZE_CUSTOM_4BPP) customBPP = 4;
     customBitmap = jsvObjectGetChild(parent, JSGRAPHICS_CUSTOMFONT_BMP, 0);
-    customWidth = jsvObjectGetChild(parent, JSGRAPHICS_CUSTOMFONT_WIDTH, 0);
   }
 #endif
 #ifndef SAVE_ON_FLASH
@@ -2366,11 +2509,15 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
 #endif
     if (info.font == JSGRAPHICS_FONTSIZE_VECTOR) {
 #ifndef NO_VECTOR_FONT
-      int w = (int)graphicsVectorCharWidth(&gfx, info.scalex, ch);
+      int w = _jswrap_graphics_getCharWidth(&gfx, &info, ch);
       if (x>minX-w && x<maxX  && y>minY-fontHeight && y<=maxY) {
         if (solidBackground)
           graphicsFillRect(&gfx,x,y,x+w-1,y+fontHeight-1, gfx.data.bgColor);
-        graphicsFillVectorChar(&gfx, x, y, info.scalex, info.scaley, ch);
+#ifdef ESPR_GRAPHICS_GLYPH_CACHE
+        JsVar *glyphCache = _jswrap_graphics_getGlyphCache(&info);
+        if (!glyphCache || !graphicsGlyphCacheFillVectorChar(glyphCache, &gfx, x, y, info.scalex, info.scaley, ch))
+#endif
+          graphicsFillVectorChar(&gfx, x, y, info.scalex, info.scaley, ch);
       }
       x+=w;
 #endif
@@ -2389,18 +2536,25 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
       int customBPPRange = (1<<customBPP)-1;
       // get char width and offset in string
       int width = 0, bmpOffset = 0;
-      if (jsvIsString(customWidth)) {
+      if (jsvIsString(info.customWidth)) {
         if (ch>=info.customFirstChar) {
-          JsvStringIterator wit;
-          jsvStringIteratorNew(&wit, customWidth, 0);
-          while (jsvStringIteratorHasChar(&wit) && (int)jsvStringIteratorGetIndex(&wit)<(ch-info.customFirstChar)) {
-            bmpOffset += (unsigned char)jsvStringIteratorGetCharAndNext(&wit);
+          size_t idx = (size_t)(ch-info.customFirstChar);
+          if (info.customWidthPtr) { // fast path if we can access the widths directly
+            if (idx > info.customWidthLen) idx = info.customWidthLen;
+            for (size_t i=0;i<idx;i++)
+              bmpOffset += info.customWidthPtr[i];
+          } else {
+            JsvStringIterator wit;
+            jsvStringIteratorNew(&wit, info.customWidth, 0);
+            while (jsvStringIteratorHasChar(&wit) && jsvStringIteratorGetIndex(&wit)<idx) {
+              bmpOffset += (unsigned char)jsvStringIteratorGetCharAndNext(&wit);
+            }
+            jsvStringIteratorFree(&wit);
           }
-          width = (unsigned char)jsvStringIteratorGetChar(&wit);
-          jsvStringIteratorFree(&wit);
+          width = _jswrap_graphics_getCustomCharWidth(&info, idx);
         }
       } else {
-        width = (int)jsvGetInteger(customWidth);
+        width = (int)jsvGetInteger(info.customWidth);
         bmpOffset = width*(ch-info.customFirstChar);
       }
       if (ch>=info.customFirstChar && (x>minX-width*info.scalex) && (x<maxX) && (y>minY-fontHeight) && y<=maxY) {
@@ -2442,8 +2596,9 @@ JsVar *jswrap_graphics_drawString(JsVar *parent, JsVar *var, int x, int y, bool
   jsvStringIteratorFree(&it);
   jsvUnLock(str);
 #ifndef SAVE_ON_FLASH
-  jsvUnLock2(customBitmap, customWidth);
+  jsvUnLock(customBitmap);
 #endif
+  _jswrap_graphics_freeFontInfo(&info);
 #ifndef SAVE_ON_FLASH
   gfx.data.flags = oldFlags; // restore flags because of text rotation
   graphicsSetVar(&gfx); // gfx data changed because modified area
@@ -3032,17 +3187,21 @@ JsVar *jswrap_graphics_drawImage(JsVar *parent, JsVar *image, int xPos, int yPos
       int x1=l.x1, y1=l.y1, x2=l.x2-1, y2=l.y2-1;
       graphicsSetModifiedAndClip(&gfx, &x1, &y1, &x2, &y2);
       _jswrap_drawImageLayerSetStart(&l, x1, y1);
-      JsGraphicsSetPixelFn setPixel = graphicsGetSetPixelFn(&gfx);
+      GfxRowBuffer row;
+      _jswrap_graphics_rowBufferInit(&row, &gfx, graphicsGetSetPixelFn(&gfx));
 
       // scan across image
       for (y = y1; y <= y2; y++) {
         _jswrap_drawImageLayerStartX(&l);
+        _jswrap_graphics_rowBufferStart(&row, x1, y);
         for (x = x1; x <= x2 ; x++) {
           if (_jswrap_drawImageLayerGetPixel(&l, &colData)) {
-            setPixel(&gfx, x, y, colData);
-          }
+            _jswrap_graphics_rowBufferPush(&row, colData);
+          } else
+            _jswrap_graphics_rowBufferSkip(&row);
           _jswrap_drawImageLayerNextX(&l);
         }
+        _jswrap_graphics_rowBufferFlush(&row);
         _jswrap_drawImageLayerNextY(&l);
       }
       it = l.it; // make sure it gets freed properly
@@ -3147,7 +3306,8 @@ JsVar *jswrap_graphics_drawImages(JsVar *parent, JsVar *layersVar, JsVar *option
     ok =  false;
   int x2 = x+width-1, y2 = y+height-1;
   graphicsSetModifiedAndClip(&gfx, &x, &y, &x2, &y2);
-  JsGraphicsSetPixelFn setPixel = graphicsGetSetPixelFn(&gfx);
+  GfxRowBuffer row;
+  _jswrap_graphics_rowBufferInit(&row, &gfx, graphicsGetSetPixelFn(&gfx));
 
   // If all good, start rendering!
   if (ok) {
@@ -3159,6 +3319,7 @@ JsVar *jswrap_graphics_drawImages(JsVar *parent, JsVar *layersVar, JsVar *option
     for (int yi = y; yi <= y2; yi++) {
       for (i=0;i<layerCount;i++)
         _jswrap_drawImageLayerStartX(&layers[i]);
+      _jswrap_graphics_rowBufferStart(&row, x, yi);
       for (int xi = x; xi <= x2 ; xi++) {
         // scan backwards until we hit a 'solid' pixel
         bool solid = false;
@@ -3171,13 +3332,16 @@ JsVar *jswrap_graphics_drawImages(JsVar *parent, JsVar *layersVar, JsVar *option
         }
         // if nontransparent, draw it!
         if (solid)
-          setPixel(&gfx, xi, yi, colData);
+          _jswrap_graphics_rowBufferPush(&row, colData);
+        else
+          _jswrap_graphics_rowBufferSkip(&row);
         // next in layers!
         for (i=0;i<layerCount;i++) {
           _jswrap_drawImageLayerNextX(&layers[i]);
           _jswrap_drawImageLayerNextXRepeat(&layers[i]);
         }
       }
+      _jswrap_graphics_rowBufferFlush(&row);
       for (i=0;i<layerCount;i++)
         _jswrap_drawImageLayerNextY(&layers[i]);
     }
@@ -3336,10 +3500,7 @@ JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset) {
     }
   }
   if (reset) {
-    gfx.data.modMaxX = -32768;
-    gfx.data.modMaxY = -32768;
-    gfx.data.modMinX = 32767;
-    gfx.data.modMinY = 32767;
+    graphicsResetModified(&gfx);
     graphicsSetVar(&gfx);
   }
   return obj;
@@ -3348,6 +3509,54 @@ JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset) {
 #endif
 }
 
+#ifndef NO_MODIFIED_AREA
+static void _jswrap_graphics_getModifiedRects_cb(JsGraphics *gfx, int x1, int y1, int x2, int y2, void *userData) {
+  NOT_USED(gfx);
+  JsVar *obj = jsvNewObject();
+  if (!obj) return;
+  jsvObjectSetChildAndUnLock(obj, "x1", jsvNewFromInteger(x1));
+  jsvObjectSetChildAndUnLock(obj, "y1", jsvNewFromInteger(y1));
+  jsvObjectSetChildAndUnLock(obj, "x2", jsvNewFromInteger(x2));
+  jsvObjectSetChildAndUnLock(obj, "y2", jsvNewFromInteger(y2));
+  jsvArrayPushAndUnLock((JsVar*)userData, obj);
+}
+#endif
+
+/*JSON{
+  "type" : "method",
+  "class" : "Graphics",
+  "name" : "getModifiedRects",
+  "ifndef" : "SAVE_ON_FLASH",
+  "generate" : "jswrap_graphics_getModifiedRects",
+  "params" : [
+    ["reset","bool","Whether to reset the modified area or not"]
+  ],
+  "return" : ["JsVar","An array of `{x1,y1,x2,y2}` rectangles covering the modified area (empty if not modified)"],
+  "typescript" : "getModifiedRects(reset?: boolean): { x1: number, y1: number, x2: number, y2: number }[];"
+}
+Like `Graphics.getModified` but returns a list of rectangles, from top to bottom,
+that together cover everything that has been modified. If two small areas in
+opposite corners of the screen are modified, this will return two small
+rectangles rather than one that covers nearly the whole screen - so if you're
+sending graphics data to a display yourself you only have to send what's needed.
+
+On builds without tile-based modified area tracking this returns the same
+rectangle as `Graphics.getModified`.
+*/
+JsVar *jswrap_graphics_getModifiedRects(JsVar *parent, bool reset) {
+  JsGraphics gfx; if (!graphicsGetFromVar(&gfx, parent)) return 0;
+  JsVar *arr = jsvNewEmptyArray();
+  if (!arr) return 0;
+#ifndef NO_MODIFIED_AREA
+  graphicsForEachModifiedRect(&gfx, false, _jswrap_graphics_getModifiedRects_cb, arr);
+  if (reset) {
+    graphicsResetModified(&gfx);
+    graphicsSetVar(&gfx);
+  }
+#endif
+  return arr;
+}
+
 /*JSON{
   "type" : "method",
   "class" : "Graphics",
@@ -78,6 +78,7 @@ JsVar *jswrap_graphics_drawImage(JsVar *parent, JsVar *image, int xPos, int yPos
 JsVar *jswrap_graphics_drawImages(JsVar *parent, JsVar *layersVar, JsVar *options);
 JsVar *jswrap_graphics_asImage(JsVar *parent, JsVar *imgType);
 JsVar *jswrap_graphics_getModified(JsVar *parent, bool reset);
+JsVar *jswrap_graphics_getModifiedRects(JsVar *parent, bool reset);
 JsVar *jswrap_graphics_scroll(JsVar *parent, int x, int y);
 JsVar *jswrap_graphics_blit(JsVar *parent, JsVar *options);
 JsVar *jswrap_graphics_asBMP(JsVar *parent);
@@ -139,3 +140,26 @@ void _jswrap_drawImageLayerNextX(GfxDrawImageLayer *l);
 void _jswrap_drawImageLayerNextXRepeat(GfxDrawImageLayer *l);
 void _jswrap_drawImageLayerNextY(GfxDrawImageLayer *l);
 void _jswrap_drawImageSimple(JsGraphics *gfx, int xPos, int yPos, GfxDrawImageInfo *img, JsvStringIterator *it);
+
+#ifndef SAVE_ON_FLASH
+#define GFX_ROW_BUFFER_SIZE 32 ///< How many pixels GfxRowBuffer stores before writing them out
+#endif
+
+/** For drawing a row of pixels left to right. If the backend has setPixelRow the pixels
+are buffered and written a chunk at a time, otherwise they're sent straight to setPixel */
+typedef struct {
+  JsGraphics *gfx;
+  JsGraphicsSetPixelFn setPixel;
+  int x,y; ///< position of the first buffered pixel (or the next pixel if not buffering)
+  int count; ///< number of pixels in cols
+#ifndef SAVE_ON_FLASH
+  bool rows; ///< are we writing rows with gfx->setPixelRow?
+  unsigned int cols[GFX_ROW_BUFFER_SIZE];
+#endif
+} GfxRowBuffer;
+
+void _jswrap_graphics_rowBufferInit(GfxRowBuffer *r, JsGraphics *gfx, JsGraphicsSetPixelFn setPixel);
+void _jswrap_graphics_rowBufferStart(GfxRowBuffer *r, int x, int y);
+void _jswrap_graphics_rowBufferPush(GfxRowBuffer *r, unsigned int col);
+void _jswrap_graphics_rowBufferSkip(GfxRowBuffer *r);
+void _jswrap_graphics_rowBufferFlush(GfxRowBuffer *r);
@@ -17,13 +17,6 @@
 #include "jsvar.h"
 #include "jsvariterator.h"
 
-#ifndef SAVE_ON_FLASH
-#ifndef ESPRUINOBOARD
-// If an arraybuffer is flat, swap to faster arraybuffer ops
-#define GRAPHICS_ARRAYBUFFER_OPTIMISATIONS
-#endif
-#endif
-
 // returns the BIT index, so the bottom 3 bits specify the bit in the byte
 unsigned int lcdGetPixelIndex_ArrayBuffer(JsGraphics *gfx, int x, int y, int pixelCount) {
   if (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_ZIGZAG) {
@@ -231,11 +224,99 @@ void lcdSetPixel_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, unsigned int co
   lcdSetPixels_ArrayBuffer_flat(gfx, x, y, 1, col);
 }
 
+/* Fill count pixels starting at x,y. Only for linear layouts (not JSGRAPHICSFLAGS_NONLINEAR)
+where the pixels follow each other in memory, so count can go past the end of the row. */
+static void lcdFillSpan_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, int count, unsigned int col) {
+  int bpp = gfx->data.bpp;
+  unsigned int idx = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,count);
+  // write single pixels until we're at the start of a byte
+  int n = 0;
+  while (n<count && ((idx+(unsigned int)(n*bpp))&7)) n++;
+  if (n) lcdSetPixels_ArrayBuffer_flat(gfx, x, y, n, col);
+  idx += (unsigned int)(n*bpp);
+  x += n;
+  count -= n;
+  // 8 pixels always fill a whole number of bytes, so draw 8 and then copy those bytes to fill the span
+  int groups = count>>3;
+  if (groups) {
+    unsigned char *ptr = (unsigned char*)gfx->backendData + (idx>>3);
+    size_t total = (size_t)(groups*bpp), done = (size_t)bpp;
+    lcdSetPixels_ArrayBuffer_flat(gfx, x, y, 8, col);
+    while (done < total) {
+      size_t l = (total-done < done) ? total-done : done;
+      memcpy(&ptr[done], ptr, l);
+      done += l;
+    }
+    x += groups*8;
+    count -= groups*8;
+  }
+  // and any pixels left over
+  if (count) lcdSetPixels_ArrayBuffer_flat(gfx, x, y, count, col);
+}
+
 // Faster implementation for where we have a flat memory area
 void  lcdFillRect_ArrayBuffer_flat(struct JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
   int y;
-  for (y=y1;y<=y2;y++)
-    lcdSetPixels_ArrayBuffer_flat(gfx, x1, y, 1+x2-x1, col);
+  if (gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR) {
+    for (y=y1;y<=y2;y++)
+      lcdSetPixels_ArrayBuffer_flat(gfx, x1, y, 1+x2-x1, col);
+  } else if (x1==0 && x2==gfx->data.width-1) {
+    // full rows follow each other in memory so we can fill them all at once
+    lcdFillSpan_ArrayBuffer_flat(gfx, 0, y1, gfx->data.width*(1+y2-y1), col);
+  } else {
+    for (y=y1;y<=y2;y++)
+      lcdFillSpan_ArrayBuffer_flat(gfx, x1, y, 1+x2-x1, col);
+  }
+}
+
+/** Write count pixels from cols (already in the Graphics' bpp) to the row starting at x,y
+(which must all be on screen). Colors are converted the same way setPixel would, and pixels set
+to GRAPHICS_SKIP_PIXEL are left as they are. Only for linear buffers of <=16bpp. */
+static void lcdSetPixelRow_ArrayBuffer_flat(JsGraphics *gfx, int x, int y, int count, const unsigned int *cols) {
+  int bpp = gfx->data.bpp;
+  unsigned int idx = lcdGetPixelIndex_ArrayBuffer(gfx,x,y,count);
+  unsigned char *ptr = (unsigned char*)gfx->backendData + (idx>>3);
+  bool msb = (gfx->data.flags & JSGRAPHICSFLAGS_ARRAYBUFFER_MSB)!=0;
+  int i;
+  if (bpp<8) {
+    // work on one byte at a time, and only write it back when we're done
+    unsigned int mask = (1U<<bpp)-1;
+    unsigned int bit = idx&7;
+    unsigned int b = *ptr;
+#ifdef GRAPHICS_FAST_PATHS
+    bool nonZeroIsSet = bpp==1 && msb; // match lcdSetPixel_ArrayBuffer_flat1
+#endif
+    for (i=0;i<count;i++) {
+      unsigned int c = cols[i];
+      if (c!=GRAPHICS_SKIP_PIXEL) {
+#ifdef GRAPHICS_FAST_PATHS
+        if (nonZeroIsSet && c) c = 1;
+#endif
+        unsigned int shift = msb ? 8-(bit+(unsigned int)bpp) : bit;
+        b = (b & ~(mask<<shift)) | ((c&mask)<<shift);
+      }
+      bit += (unsigned int)bpp;
+      if (bit>=8) {
+        *(ptr++) = (unsigned char)b;
+        bit = 0;
+        if (i+1<count) b = *ptr;
+      }
+    }
+    if (bit) *ptr = (unsigned char)b;
+  } else if (bpp==8) {
+    for (i=0;i<count;i++)
+      if (cols[i]!=GRAPHICS_SKIP_PIXEL)
+        ptr[i] = (unsigned char)cols[i];
+  } else { // 16 bit
+    for (i=0;i<count;i++) {
+      unsigned int c = cols[i];
+      if (c!=GRAPHICS_SKIP_PIXEL) {
+        ptr[msb?0:1] = (unsigned char)(c>>8);
+        ptr[msb?1:0] = (unsigned char)c;
+      }
+      ptr += 2;
+    }
+  }
 }
 
 #ifdef GRAPHICS_FAST_PATHS
@@ -245,31 +326,25 @@ void lcdSetPixel_ArrayBuffer_flat1(JsGraphics *gfx, int x, int y, unsigned int c
   else ((uint8_t*)gfx->backendData)[p>>3] &= (uint8_t)(0xFF7F >> (p&7));
 }
 
-void lcdFillRect_ArrayBuffer_flat1(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
-  for (int y=y1;y<=y2;y++) {
-    int p = x1 + y*gfx->data.width;
-    for (int x=x1;x<=x2;x++) {
-      if (col) ((uint8_t*)gfx->backendData)[p>>3] |= (uint8_t)(0x80 >> (p&7));
-      else ((uint8_t*)gfx->backendData)[p>>3] &= (uint8_t)(0xFF7F >> (p&7));
-      p++;
-    }
-  }
-}
-
 void lcdSetPixel_ArrayBuffer_flat8(JsGraphics *gfx, int x, int y, unsigned int col) {
   ((uint8_t*)gfx->backendData)[x + y*gfx->data.width] = (uint8_t)col;
 }
 
+void lcdFillRect_ArrayBuffer_flat1(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
+  lcdFillRect_ArrayBuffer_flat(gfx, x1, y1, x2, y2, col?1:0); // match lcdSetPixel_ArrayBuffer_flat1
+}
+
 unsigned int lcdGetPixel_ArrayBuffer_flat8(struct JsGraphics *gfx, int x, int y) {
   return ((uint8_t*)gfx->backendData)[x + y*gfx->data.width];
 }
 
 void lcdFillRect_ArrayBuffer_flat8(JsGraphics *gfx, int x1, int y1, int x2, int y2, unsigned int col) {
-  for (int y=y1;y<=y2;y++) {
-    uint8_t *p = &((uint8_t*)gfx->backendData)[x1 + y*gfx->data.width];
-    for (int x=x1;x<=x2;x++)
-      *(p++) = (uint8_t)col;
+  if (x1==0 && x2==gfx->data.width-1) { // full rows, so fill in one go
+    memset(&((uint8_t*)gfx->backendData)[y1*gfx->data.width], (uint8_t)col, (size_t)(gfx->data.width*(1+y2-y1)));
+    return;
   }
+  for (int y=y1;y<=y2;y++)
+    memset(&((uint8_t*)gfx->backendData)[x1 + y*gfx->data.width], (uint8_t)col, (size_t)(1+x2-x1));
 }
 
 void lcdScroll_ArrayBuffer_flat8(JsGraphics *gfx, int xdir, int ydir, int x1, int y1, int x2, int y2) {
@@ -332,6 +407,8 @@ void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx) {
       gfx->getPixel = lcdGetPixel_ArrayBuffer_flat;
       gfx->fillRect = lcdFillRect_ArrayBuffer_flat;
     }
+    if (!(gfx->data.flags & JSGRAPHICSFLAGS_NONLINEAR) && gfx->data.bpp<=16)
+      gfx->setPixelRow = lcdSetPixelRow_ArrayBuffer_flat;
 #else
   if (false) {
 #endif
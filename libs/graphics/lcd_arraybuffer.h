@@ -13,6 +13,13 @@
  */
 #include "graphics.h"
 
+#ifndef SAVE_ON_FLASH
+#ifndef ESPRUINOBOARD
+// If an arraybuffer is flat, swap to faster arraybuffer ops
+#define GRAPHICS_ARRAYBUFFER_OPTIMISATIONS
+#endif
+#endif
+
 void lcdInit_ArrayBuffer(JsGraphics *gfx);
 void lcdSetCallbacks_ArrayBuffer(JsGraphics *gfx);
 
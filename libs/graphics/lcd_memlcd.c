@@ -116,6 +116,43 @@ void lcdMemLCD_fillRect(struct JsGraphics *gfx, int x1, int y1, int x2, int y2,
 }
 #endif
 
+#ifndef SAVE_ON_FLASH
+/// Write count pixels (16 bit) to the row starting at x,y. Pixels set to GRAPHICS_SKIP_PIXEL are left as they are
+void lcdMemLCD_setPixelRow(struct JsGraphics *gfx, int x, int y, int count, const unsigned int *cols) {
+#if LCD_BPP==3
+  // Pixels straddle bytes, so keep the two bytes we're writing to in 'w' and only write each byte back once
+  int bitaddr = LCD_ROWHEADER*8 + (x*3) + (y*LCD_STRIDE*8);
+  unsigned char *ptr = &lcdBuffer[bitaddr>>3];
+  int bit = bitaddr&7;
+  unsigned int w = (ptr[0]<<8) | ptr[1]; // MSB first
+  for (int i=0;i<count;i++,x++) {
+    unsigned int c = cols[i];
+    if (c!=GRAPHICS_SKIP_PIXEL) {
+      c = lcdMemLCD_convert16to3(c,x,y);
+      w = (w & (0xFF1FFF>>bit)) | (c<<(13-bit));
+    }
+    bit += 3;
+    if (bit>=8) {
+      *(ptr++) = (unsigned char)(w>>8);
+      w = ((w<<8)&0xFF00) | ptr[1];
+      bit -= 8;
+    }
+  }
+  ptr[0] = (unsigned char)(w>>8);
+  ptr[1] = (unsigned char)w;
+#endif
+#if LCD_BPP==4
+  for (int i=0;i<count;i++,x++) {
+    if (cols[i]==GRAPHICS_SKIP_PIXEL) continue;
+    unsigned int c = lcdMemLCD_convert16to3(cols[i],x,y);
+    int addr = LCD_ROWHEADER + (x>>1) + (y*LCD_STRIDE);
+    if (x&1) lcdBuffer[addr] = (lcdBuffer[addr] & 0xF0) | (c<<1);
+    else lcdBuffer[addr] = (lcdBuffer[addr] & 0x0F) | (c << 5);
+  }
+#endif
+}
+#endif
+
 void lcdMemLCD_scrollX(struct JsGraphics *gfx, unsigned char *dst, unsigned char *src, int xdir) {
   uint32_t *dw = (uint32_t*)&dst[LCD_ROWHEADER];
   uint32_t *sw = (uint32_t*)&src[LCD_ROWHEADER];
@@ -164,6 +201,17 @@ void lcdMemLCD_scroll(struct JsGraphics *gfx, int xdir, int ydir, int x1, int y1
 // used to allow SPI send to work async (we don't care when it finishes)
 void lcdMemLCD_flip_spi_callback() {}
 
+#ifndef EMULATED
+/// Send the lines y1..y2 (inclusive) to the screen (called from graphicsForEachModifiedRect)
+static void lcdMemLCD_flip_lines(JsGraphics *gfx, int x1, int y1, int x2, int y2, void *userData) {
+  NOT_USED(gfx);
+  NOT_USED(x1);
+  NOT_USED(x2);
+  NOT_USED(userData);
+  jshSPISendMany(LCD_SPI, &lcdBuffer[LCD_STRIDE*y1], NULL, (1+y2-y1)*LCD_STRIDE, NULL);
+}
+#endif
+
 // send the data to the screen
 void lcdMemLCD_flip(JsGraphics *gfx) {
   if (gfx->data.modMinY > gfx->data.modMaxY) return; // nothing to do!
@@ -173,7 +221,6 @@ void lcdMemLCD_flip(JsGraphics *gfx) {
 
   int y1 = gfx->data.modMinY;
   int y2 = gfx->data.modMaxY;
-  int l = 1+y2-y1;
 
   bool hasOverlay = false;
   GfxDrawImageInfo overlayImg;
@@ -239,15 +286,16 @@ void lcdMemLCD_flip(JsGraphics *gfx) {
 #ifdef EMULATED
     memcpy(fakeLCDBuffer, lcdBuffer, LCD_HEIGHT*LCD_STRIDE);
 #else
-    jshSPISendMany(LCD_SPI, &lcdBuffer[LCD_STRIDE*y1], NULL, (l*LCD_STRIDE)+2, NULL);
+    /* Each line contains its own address, so we can skip any lines that
+     haven't been modified and just send the others one after the other */
+    graphicsForEachModifiedRect(gfx, true, lcdMemLCD_flip_lines, NULL);
+    // any 2 final bytes to finish the transfer
+    jshSPISendMany(LCD_SPI, lcdBuffer, NULL, 2, NULL);
 #endif
   }
   jshPinSetValue(LCD_SPI_CS, 0);
   // Reset modified-ness
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
+  graphicsResetModified(gfx);
 }
 
 void lcdMemLCD_init(JsGraphics *gfx) {
@@ -321,5 +369,8 @@ void lcdMemLCD_setCallbacks(JsGraphics *gfx) {
 #endif
   gfx->getPixel = lcdMemLCD_getPixel;
   gfx->scroll = lcdMemLCD_scroll;
+#ifndef SAVE_ON_FLASH
+  gfx->setPixelRow = lcdMemLCD_setPixelRow;
+#endif
 }
 
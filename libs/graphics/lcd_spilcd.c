@@ -176,76 +176,79 @@ void lcdFlip_SPILCD_callback() {
   // just an empty stub for SPIsend - we'll just push data as fast as we can
 }
 
-void lcdFlip_SPILCD(JsGraphics *gfx) {
-  if (gfx->data.modMinX > gfx->data.modMaxX) return; // nothing to do!
-
-  // use nearest 2 pixels as we're sending 12 bits
-  gfx->data.modMinX = (gfx->data.modMinX)&~1;
-  gfx->data.modMaxX = (gfx->data.modMaxX+2)&~1;
-#if LCD_BPP==12 || LCD_BPP==16
-  // Just send full rows as this allows us to issue a single SPI
-  // transfer.
-  // TODO: could swap to a transfer per row if we're filling less than half a row
-  gfx->data.modMinX = 0;
-  gfx->data.modMaxX = LCD_WIDTH-1;
-#else
-  int xlen = gfx->data.modMaxX - gfx->data.modMinX;
-  int xstart = gfx->data.modMinX;
-#endif
-  unsigned char buffer1[LCD_STRIDE];
-
-#ifdef ESPR_USE_SPI3
-  // anomaly 195 workaround - enable SPI before use
-  *(volatile uint32_t *)0x4002F500 = 7;
-#endif
-
-  jshPinSetValue(LCD_SPI_CS, 0);
+/// Set the window on the LCD that data will be written into (inclusive), and get ready to send data
+static void lcdSetWindow_SPILCD(int x1, int y1, int x2, int y2) {
+  unsigned char buffer[4];
   jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_WINDOW_X;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
+  buffer[0] = SPILCD_CMD_WINDOW_X;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
   jshPinSetValue(LCD_SPI_DC, 1); // data
-  buffer1[0] = 0;
-  buffer1[1] = gfx->data.modMinX;
-  buffer1[2] = 0;
-  buffer1[3] = gfx->data.modMaxX;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 4, NULL);
+  buffer[0] = 0;
+  buffer[1] = x1;
+  buffer[2] = 0;
+  buffer[3] = x2;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 4, NULL);
   jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_WINDOW_Y;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
+  buffer[0] = SPILCD_CMD_WINDOW_Y;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
   jshPinSetValue(LCD_SPI_DC, 1); // data
-  buffer1[0] = 0;
-  buffer1[1] = gfx->data.modMinY;
-  buffer1[2] = 0;
-  buffer1[3] = gfx->data.modMaxY;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 4, NULL);
+  buffer[0] = 0;
+  buffer[1] = y1;
+  buffer[2] = 0;
+  buffer[3] = y2;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 4, NULL);
   jshPinSetValue(LCD_SPI_DC, 0); // command
-  buffer1[0] = SPILCD_CMD_DATA;
-  jshSPISendMany(LCD_SPI, buffer1, NULL, 1, NULL);
+  buffer[0] = SPILCD_CMD_DATA;
+  jshSPISendMany(LCD_SPI, buffer, NULL, 1, NULL);
   jshPinSetValue(LCD_SPI_DC, 1); // data
+}
 
+/// Send one modified rectangle of the offscreen buffer to the screen (called from graphicsForEachModifiedRect)
+static void lcdFlipRect_SPILCD(JsGraphics *gfx, int x1, int y1, int x2, int y2, void *userData) {
+  NOT_USED(gfx);
+  NOT_USED(userData);
+  if (jspIsInterrupted()) return;
+  // use nearest 2 pixels as we're sending 12 bits
+  x1 &= ~1;
+  x2 |= 1;
+  if (x2 >= LCD_WIDTH) x2 = LCD_WIDTH-1;
+  lcdSetWindow_SPILCD(x1, y1, x2, y2);
 #if LCD_BPP==12 || LCD_BPP==16
-  // FIXME: hack because SPI send on NRF52 fails for >65k transfers
-  // we should fix this in jshardware.c
-  unsigned char *p = &lcdBuffer[LCD_STRIDE*gfx->data.modMinY];
-  int c = (gfx->data.modMaxY+1-gfx->data.modMinY)*LCD_STRIDE;
-  while (c) {
-    int n = c;
-    if (n>65535) n=65535;
-    jshSPISendMany(
-        LCD_SPI,
-        p,
-        0,
-        n,
-        NULL);
-    if (jspIsInterrupted()) break;
-    p+=n;
-    c-=n;
+  if (x1==0 && x2==LCD_WIDTH-1) {
+    // Full rows, so we can just send them all in one go
+    // FIXME: hack because SPI send on NRF52 fails for >65k transfers
+    // we should fix this in jshardware.c
+    unsigned char *p = &lcdBuffer[LCD_STRIDE*y1];
+    int c = (y2+1-y1)*LCD_STRIDE;
+    while (c) {
+      int n = c;
+      if (n>65535) n=65535;
+      jshSPISendMany(
+          LCD_SPI,
+          p,
+          0,
+          n,
+          NULL);
+      if (jspIsInterrupted()) break;
+      p+=n;
+      c-=n;
+    }
+  } else {
+    // Part of each row - send a row at a time
+    int xstart = (x1*LCD_BPP)>>3;
+    int xlen = ((x2+1-x1)*LCD_BPP)>>3;
+    for (int y=y1;y<=y2;y++) {
+      jshSPISendMany(LCD_SPI, &lcdBuffer[y*LCD_STRIDE + xstart], 0, xlen, NULL);
+      if (jspIsInterrupted()) break;
+    }
   }
 #else
+  int xlen = x2+1-x1;
+  int xstart = x1;
+  unsigned char buffer1[LCD_STRIDE];
   unsigned char buffer2[LCD_STRIDE];
-  for (int y=gfx->data.modMinY;y<=gfx->data.modMaxY;y++) {
+  for (int y=y1;y<=y2;y++) {
     unsigned char *buffer = (y&1)?buffer1:buffer2;
-    // skip any lines that don't need updating
 #if LCD_BPP==4
     unsigned char *px = &lcdBuffer[y*LCD_STRIDE + (xstart>>1)];
 #endif
@@ -272,6 +275,24 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
     if (jspIsInterrupted()) break;
   }
   jshSPIWait(LCD_SPI);
+#endif
+}
+
+void lcdFlip_SPILCD(JsGraphics *gfx) {
+  if (gfx->data.modMinX > gfx->data.modMaxX) return; // nothing to do!
+
+#ifdef ESPR_USE_SPI3
+  // anomaly 195 workaround - enable SPI before use
+  *(volatile uint32_t *)0x4002F500 = 7;
+#endif
+
+  jshPinSetValue(LCD_SPI_CS, 0);
+#if (LCD_BPP==12 || LCD_BPP==16) && !defined(ESPR_GRAPHICS_DIRTY_TILES)
+  // Just send full rows as this allows us to issue a single SPI transfer
+  graphicsForEachModifiedRect(gfx, true, lcdFlipRect_SPILCD, NULL);
+#else
+  // Only send the rectangles that have been modified
+  graphicsForEachModifiedRect(gfx, false, lcdFlipRect_SPILCD, NULL);
 #endif
   jshPinSetValue(LCD_SPI_CS,1);
 #ifdef ESPR_USE_SPI3
@@ -281,10 +302,7 @@ void lcdFlip_SPILCD(JsGraphics *gfx) {
 #endif
 
   // Reset modified-ness
-  gfx->data.modMaxX = -32768;
-  gfx->data.modMaxY = -32768;
-  gfx->data.modMinX = 32767;
-  gfx->data.modMinY = 32767;
+  graphicsResetModified(gfx);
 }
 
 
@@ -1354,7 +1354,9 @@ void jswrap_wifi_restore(void) {
   jsDebug(DBG_INFO, "jswrap_wifi_restore");
   
   JsVar *name = jsvNewFromString(WIFI_CONFIG_STORAGE_NAME);
-  JsVar *o = jswrap_storage_readJSON(name, true);
+  JsVar *noExceptions = jsvNewFromBool(true);
+  JsVar *o = jswrap_storage_readJSON(name, noExceptions);
+  jsvUnLock(noExceptions);
   if (!o) { // no data 
     jsDebug(DBG_INFO, "jswrap_wifi_restore: No data - Starting default AP");
     esp_wifi_start();
@@ -905,7 +905,9 @@ void jswrap_wifi_save(JsVar *what) {
 void jswrap_wifi_restore(void) {
   DBG("Wifi.restore\n");
   JsVar *name = jsvNewFromString(WIFI_CONFIG_STORAGE_NAME);
-  JsVar *o = jswrap_storage_readJSON(name, true);
+  JsVar *noExceptions = jsvNewFromBool(true);
+  JsVar *o = jswrap_storage_readJSON(name, noExceptions);
+  jsvUnLock(noExceptions);
   if (!o) { // no data 
     jsvUnLock2(name,o);
     return; 
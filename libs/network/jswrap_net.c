@@ -29,6 +29,9 @@ bool jswrap_net_idle() {
   if (!networkGetFromVar(&net)) return false;
   net.idle(&net);
   bool b = socketIdle(&net);
+  /* If the network will wake us when a socket is ready, we only need to go
+   * around the idle loop again if something happened - otherwise we can sleep */
+  if (b && net.canSleep) b = netHadActivity();
   networkFree(&net);
   return b;
 }
@@ -42,6 +42,27 @@
 
 #define closesocket(SOCK) close(SOCK)
 
+#if defined(__linux__) && !defined(ESP_PLATFORM)
+/* On Linux we use epoll rather than calling select() for every socket on every
+ * call. All sockets are registered (edge-triggered) with one epoll instance, which
+ * we check once per idle loop (or sleep on in jshSleep), and we remember which
+ * sockets are ready. Sockets that aren't ready can then be skipped without a syscall. */
+#define USE_EPOLL
+#include <sys/epoll.h>
+#include <stdlib.h>
+
+#define NET_READY_RECV 1 ///< socket may have data to read (or a connection to accept)
+#define NET_READY_SEND 2 ///< socket may have space to write
+#define NET_READY_HUP  4 ///< other end has closed (or error) - keep reading until recv says so
+#define NET_REGISTERED 8 ///< socket is registered with epoll
+#define NET_EPOLL_EVENTS 64 ///< how many events to handle per call to epoll_wait
+
+static int epollFd = -1; ///< epoll instance all our sockets are registered with
+static unsigned char *sockReady = 0; ///< NET_READY_* flags, indexed by socket
+static int sockReadySize = 0; ///< number of items in sockReady
+static int sockCount = 0; ///< number of sockets registered with epoll
+#endif
+
 #if NET_DBG > 0
  #include "jsinteractive.h"
  #define DBG(format, ...) jsiConsolePrintf(format, ## __VA_ARGS__)
@@ -50,6 +71,95 @@
 #endif
 
 
+#ifdef USE_EPOLL
+/// Add a socket to our epoll instance. It starts off assumed ready - recv/send will find out if it isn't
+static void net_linux_register(int sckt) {
+  if (epollFd < 0) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+      jsWarn("epoll_create1 failed (err %d)\n", errno);
+      return;
+    }
+  }
+  if (sckt >= sockReadySize) {
+    int newSize = sockReadySize ? sockReadySize : 64;
+    while (newSize <= sckt) newSize *= 2;
+    unsigned char *newReady = realloc(sockReady, (size_t)newSize);
+    if (!newReady) return;
+    memset(&newReady[sockReadySize], 0, (size_t)(newSize-sockReadySize));
+    sockReady = newReady;
+    sockReadySize = newSize;
+  }
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = sckt;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, sckt, &ev) < 0) return;
+  sockReady[sckt] = NET_REGISTERED | NET_READY_RECV | NET_READY_SEND;
+  sockCount++;
+}
+
+/// Remove a socket from our epoll instance
+static void net_linux_unregister(int sckt) {
+  if (sckt < 0 || sckt >= sockReadySize || !(sockReady[sckt] & NET_REGISTERED)) return;
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, sckt, NULL);
+  sockReady[sckt] = 0;
+  sockCount--;
+}
+
+/// Is the given socket (possibly) ready? If it's not registered with epoll we just have to try
+static bool net_linux_isReady(int sckt, unsigned char flag) {
+  if (sckt < 0 || sckt >= sockReadySize || !(sockReady[sckt] & NET_REGISTERED)) return true;
+  if (flag & NET_READY_RECV) flag |= NET_READY_HUP;
+  return (sockReady[sckt] & flag) != 0;
+}
+
+/// We tried to read/write and couldn't, so wait until epoll tells us the socket is ready
+static void net_linux_notReady(int sckt, unsigned char flag) {
+  if (sckt >= 0 && sckt < sockReadySize)
+    sockReady[sckt] &= (unsigned char)~flag;
+}
+
+/// Wait up to timeoutMs for sockets to become ready, and mark them as ready
+static void net_linux_poll(int timeoutMs) {
+  struct epoll_event events[NET_EPOLL_EVENTS];
+  int n;
+  do {
+    n = epoll_wait(epollFd, events, NET_EPOLL_EVENTS, timeoutMs);
+    int i;
+    for (i=0;i<n;i++) {
+      int sckt = events[i].data.fd;
+      uint32_t e = events[i].events;
+      if (sckt < 0 || sckt >= sockReadySize || !(sockReady[sckt] & NET_REGISTERED)) continue;
+      if (e & EPOLLIN) sockReady[sckt] |= NET_READY_RECV;
+      if (e & EPOLLOUT) sockReady[sckt] |= NET_READY_SEND;
+      if (e & (EPOLLRDHUP|EPOLLHUP|EPOLLERR)) sockReady[sckt] |= NET_READY_HUP;
+      if (e & (EPOLLHUP|EPOLLERR)) sockReady[sckt] |= NET_READY_SEND; // so send reports the error
+    }
+    timeoutMs = 0; // if there were more events, just get them - don't wait again
+  } while (n == NET_EPOLL_EVENTS);
+}
+#endif
+
+bool net_linux_wait(int microseconds) {
+#ifdef USE_EPOLL
+  if (epollFd < 0 || !sockCount) return false;
+  net_linux_poll(microseconds / 1000);
+  return true;
+#else
+  NOT_USED(microseconds);
+  return false;
+#endif
+}
+
+bool net_linux_hasSockets() {
+#ifdef USE_EPOLL
+  return sockCount > 0;
+#else
+  return false;
+#endif
+}
+
 /// Get an IP address from a name. Sets out_ip_addr to 0 on failure
 void net_linux_gethostbyname(JsNetwork *net, char * hostName, uint32_t* out_ip_addr) {
   NOT_USED(net);
@@ -61,6 +171,11 @@ void net_linux_gethostbyname(JsNetwork *net, char * hostName, uint32_t* out_ip_a
 /// Called on idle. Do any checks required for this device
 void net_linux_idle(JsNetwork *net) {
   NOT_USED(net);
+#ifdef USE_EPOLL
+  // find out which sockets are ready (once for all sockets)
+  if (epollFd >= 0 && sockCount)
+    net_linux_poll(0);
+#endif
 }
 
 /// Call just before returning to idle loop. This checks for errors and tries to recover. Returns true if no errors.
@@ -176,12 +291,20 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
 
     if (scktType == SOCK_STREAM) { // only for TCP
       // Make the socket listen
+#ifdef USE_EPOLL
+      nret = listen(sckt, SOMAXCONN); // we can handle lots of clients
+#else
       nret = listen(sckt, 10); // 10 connections (but this ignored on CC30000)
+#endif
       if (nret == SOCKET_ERROR) {
         jsError("Socket listen failed");
         closesocket(sckt);
         return -1;
       }
+#ifdef USE_EPOLL
+      // we accept until there's nobody waiting, so accept mustn't block
+      fcntl(sckt, F_SETFL, fcntl(sckt, F_GETFL, 0) | O_NONBLOCK);
+#endif
     }
   }
 
@@ -198,6 +321,9 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
   if (setsockopt(sckt,SOL_SOCKET,SO_NOSIGPIPE,(const char *)&optval,sizeof(optval))<0)
     jsWarn("setsockopt(SO_NOSIGPIPE) failed\n");
 #endif
+#ifdef USE_EPOLL
+  net_linux_register(sckt);
+#endif
 
   return sckt;
 }
@@ -205,6 +331,9 @@ int net_linux_createsocket(JsNetwork *net, SocketType socketType, uint32_t host,
 /// destroys the given socket
 void net_linux_closesocket(JsNetwork *net, int sckt) {
   NOT_USED(net);
+#ifdef USE_EPOLL
+  net_linux_unregister(sckt);
+#endif
   closesocket(sckt);
 }
 
@@ -212,6 +341,17 @@ void net_linux_closesocket(JsNetwork *net, int sckt) {
 int net_linux_accept(JsNetwork *net, int sckt) {
   NOT_USED(net);
   // TODO: look for unreffed servers?
+#ifdef USE_EPOLL
+  if (!net_linux_isReady(sckt, NET_READY_RECV)) return -1;
+  int theClient = accept(sckt,0,0);
+  if (theClient < 0) {
+    if (errno==EAGAIN || errno==EWOULDBLOCK) // nobody else waiting
+      net_linux_notReady(sckt, NET_READY_RECV);
+    return -1;
+  }
+  net_linux_register(theClient);
+  return theClient;
+#else
   fd_set s;
   FD_ZERO(&s);
   FD_SET(sckt,&s);
@@ -226,6 +366,7 @@ int net_linux_accept(JsNetwork *net, int sckt) {
     return theClient;
   }
   return -1;
+#endif
 }
 
 /// Receive data if possible. returns nBytes on success, 0 on no data, or -1 on failure
@@ -234,6 +375,12 @@ int net_linux_recv(JsNetwork *net, SocketType socketType, int sckt, void *buf, s
   struct sockaddr_in fromAddr;
   int fromAddrLen = sizeof(fromAddr);
   int num = 0;
+  int flags = 0;
+#ifdef USE_EPOLL
+  // epoll tells us if there's data, so if not we don't have to ask
+  int n = net_linux_isReady(sckt, NET_READY_RECV) ? 1 : 0;
+  flags |= MSG_DONTWAIT;
+#else
   fd_set s;
   FD_ZERO(&s);
   FD_SET(sckt,&s);
@@ -242,6 +389,7 @@ int net_linux_recv(JsNetwork *net, SocketType socketType, int sckt, void *buf, s
   timeout.tv_sec = 0;
   timeout.tv_usec = 0;
   int n = select(sckt+1,&s,NULL,NULL,&timeout);
+#endif
   if (n==SOCKET_ERROR) {
     // we probably disconnected
     return -1;
@@ -249,7 +397,13 @@ int net_linux_recv(JsNetwork *net, SocketType socketType, int sckt, void *buf, s
     // receive data
     if (socketType & ST_UDP) {
       JsNetUDPPacketHeader *header = (JsNetUDPPacketHeader*)buf;
-      num = (int)recvfrom(sckt,buf+sizeof(JsNetUDPPacketHeader),len-sizeof(JsNetUDPPacketHeader),0,(struct sockaddr *)&fromAddr,(socklen_t*)&fromAddrLen);
+      num = (int)recvfrom(sckt,buf+sizeof(JsNetUDPPacketHeader),len-sizeof(JsNetUDPPacketHeader),flags,(struct sockaddr *)&fromAddr,(socklen_t*)&fromAddrLen);
+#ifdef USE_EPOLL
+      if (num<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) { // no more packets
+        net_linux_notReady(sckt, NET_READY_RECV);
+        return 0;
+      }
+#endif
       *(in_addr_t*)&header->host = fromAddr.sin_addr.s_addr;
       header->port = ntohs(fromAddr.sin_port);
       header->length = (uint16_t)num;
@@ -258,7 +412,16 @@ int net_linux_recv(JsNetwork *net, SocketType socketType, int sckt, void *buf, s
       if (num==0) return -1; // select says data, but recv says 0 means connection is closed
       num += sizeof(JsNetUDPPacketHeader);
     } else {
-      num = (int)recvfrom(sckt,buf,len,0,(struct sockaddr *)&fromAddr,(socklen_t*)&fromAddrLen);
+      num = (int)recvfrom(sckt,buf,len,flags,(struct sockaddr *)&fromAddr,(socklen_t*)&fromAddrLen);
+#ifdef USE_EPOLL
+      if (num<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) { // no more data
+        net_linux_notReady(sckt, NET_READY_RECV);
+        return 0;
+      }
+      // we got less than we asked for so there's nothing left - epoll will tell us when there's more
+      if (num>0 && (size_t)num<len)
+        net_linux_notReady(sckt, NET_READY_RECV);
+#endif
       if (num==0) return -1; // select says data, but recv says 0 means connection is closed
     }
   }
@@ -269,6 +432,13 @@ int net_linux_recv(JsNetwork *net, SocketType socketType, int sckt, void *buf, s
 /// Send data if possible. returns nBytes on success, 0 on no data, or -1 on failure
 int net_linux_send(JsNetwork *net, SocketType socketType, int sckt, const void *buf, size_t len) {
   NOT_USED(net);
+  int flags = 0;
+#ifdef USE_EPOLL
+  // epoll tells us if there's space, so if not we don't have to ask
+  int n = 0;
+  bool canSend = net_linux_isReady(sckt, NET_READY_SEND);
+  flags |= MSG_DONTWAIT;
+#else
   fd_set writefds;
   FD_ZERO(&writefds);
   FD_SET(sckt, &writefds);
@@ -276,11 +446,12 @@ int net_linux_send(JsNetwork *net, SocketType socketType, int sckt, const void *
   time.tv_sec = 0;
   time.tv_usec = 0;
   int n = select(sckt+1, 0, &writefds, 0, &time);
+  bool canSend = n!=SOCKET_ERROR && FD_ISSET(sckt, &writefds);
+#endif
   if (n==SOCKET_ERROR ) {
      // we probably disconnected so just get rid of this
     return -1;
-  } else if (FD_ISSET(sckt, &writefds)) {
-    int flags = 0;
+  } else if (canSend) {
 #if !defined(SO_NOSIGPIPE) && defined(MSG_NOSIGNAL)
     flags |= MSG_NOSIGNAL;
 #endif
@@ -293,9 +464,24 @@ int net_linux_send(JsNetwork *net, SocketType socketType, int sckt, const void *
 
       DBG("Send %d %x:%d", len - sizeof(JsNetUDPPacketHeader), header->host, header->port);
       n = (int)sendto(sckt, buf + sizeof(JsNetUDPPacketHeader), header->length, flags, (struct sockaddr *)&sin, sizeof(sockaddr_in));
+#ifdef USE_EPOLL
+      if (n<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) {
+        net_linux_notReady(sckt, NET_READY_SEND);
+        return 0;
+      }
+#endif
       n += sizeof(JsNetUDPPacketHeader);
     } else {
       n = (int)send(sckt, buf, len, flags);
+#ifdef USE_EPOLL
+      if (n<0 && (errno==EAGAIN || errno==EWOULDBLOCK)) {
+        net_linux_notReady(sckt, NET_READY_SEND);
+        return 0;
+      }
+      // we couldn't send everything, so the buffer is full - epoll will tell us when there's space
+      if (n>=0 && (size_t)n<len)
+        net_linux_notReady(sckt, NET_READY_SEND);
+#endif
     }
     return n;
   } else
@@ -312,4 +498,7 @@ void netSetCallbacks_linux(JsNetwork *net) {
   net->recv = net_linux_recv;
   net->send = net_linux_send;
   net->chunkSize = 536;
+#ifdef USE_EPOLL
+  net->canSleep = true;
+#endif
 }
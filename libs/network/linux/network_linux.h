@@ -14,3 +14,10 @@
 #include "network.h"
 
 void netSetCallbacks_linux(JsNetwork *net);
+
+/** Sleep for up to the given number of microseconds, but wake as soon as any socket
+ * is ready. Returns false (without sleeping) if there are no sockets to wait for */
+bool net_linux_wait(int microseconds);
+
+/// Are there any open sockets?
+bool net_linux_hasSockets();
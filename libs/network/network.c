@@ -52,6 +52,7 @@ JsNetworkState networkState =
     ;
 
 JsNetwork *networkCurrentStruct = 0;
+static bool netActivity = false; ///< Have we sent/received anything since netHadActivity was last called?
 
 uint32_t networkParseIPAddress(const char *ip) {
   if (!strcmp(ip,"localhost"))
@@ -234,6 +235,7 @@ bool networkGetFromVar(JsNetwork *net) {
 
   // Now we know which kind of network we are working with, invoke the corresponding initialization
   // function to set the callbacks for this network tyoe.
+  net->canSleep = false;
   switch (net->data.type) {
 #if defined(USE_CC3000)
   case JSNETWORKTYPE_CC3000 : netSetCallbacks_cc3000(net); break;
@@ -701,7 +703,9 @@ void netCloseSocket(JsNetwork *net, SocketType socketType, int sckt) {
 }
 
 int netAccept(JsNetwork *net, int sckt) {
-  return net->accept(net, sckt);
+  int theClient = net->accept(net, sckt);
+  if (theClient >= 0) netActivity = true;
+  return theClient;
 }
 
 void netGetHostByName(JsNetwork *net, char * hostName, uint32_t* out_ip_addr) {
@@ -718,11 +722,14 @@ int netRecv(JsNetwork *net, SocketType socketType, int sckt, void *buf, size_t l
     int ret = mbedtls_ssl_read( &sd->ssl, buf, len );
     if( ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE )
       return 0;
+    if (ret) netActivity = true;
     return ret;
   } else
 #endif
   {
-    return net->recv(net, socketType, sckt, buf, len);
+    int num = net->recv(net, socketType, sckt, buf, len);
+    if (num) netActivity = true;
+    return num;
   }
 }
 
@@ -736,10 +743,19 @@ int netSend(JsNetwork *net, SocketType socketType, int sckt, const void *buf, si
     int ret = mbedtls_ssl_write( &sd->ssl, buf, len );
     if( ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE )
       return 0;
+    if (ret) netActivity = true;
     return ret;
   } else
 #endif
   {
-    return net->send(net, socketType, sckt, buf, len);
+    int num = net->send(net, socketType, sckt, buf, len);
+    if (num) netActivity = true;
+    return num;
   }
 }
+
+bool netHadActivity() {
+  bool hadActivity = netActivity;
+  netActivity = false;
+  return hadActivity;
+}
@@ -66,6 +66,7 @@ typedef struct JsNetwork {
   unsigned char _blank; ///< this is needed as jsvGetString for 'data' wants to add a trailing zero  
 
   int chunkSize; ///< Amount of memory to allocate for chunks of data when using send/recv
+  bool canSleep; ///< If true, jshSleep wakes as soon as a socket is ready, so we can sleep while sockets are open
 
   /// Called on idle. Do any checks required for this device
   void (*idle)(struct JsNetwork *net);
@@ -136,4 +137,8 @@ void netGetHostByName(JsNetwork *net, char * hostName, uint32_t* out_ip_addr);
 int netRecv(JsNetwork *net, SocketType socketType, int sckt, void *buf, size_t len);
 int netSend(JsNetwork *net, SocketType socketType, int sckt, const void *buf, size_t len);
 
+/** Returns true if netAccept/netRecv/netSend have done anything (or failed) since this was last called.
+ * If JsNetwork.canSleep, this is used to decide if we need to go around the idle loop again */
+bool netHadActivity();
+
 #endif // _NETWORK_H
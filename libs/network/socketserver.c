@@ -18,8 +18,6 @@
 #include "jshardware.h"
 #include "jswrap_net.h"
 #include "jswrap_stream.h"
-#include "jswrap_string.h"
-#include "jswrap_functions.h"
 
 #define HTTP_NAME_SOCKETTYPE "type" // normal socket or HTTP
 #define HTTP_NAME_PORT "port"
@@ -33,6 +31,9 @@
 #define HTTP_NAME_OPTIONS_VAR "opt"
 #define HTTP_NAME_SERVER_VAR "svr"
 #define HTTP_NAME_CHUNKED "chunked"
+#define HTTP_NAME_CHUNK_STATE "cSt" // HttpChunkState - how far through decoding chunked data we are
+#define HTTP_NAME_CHUNK_LEN "cLen" // length of the current chunk (or bytes left of it in HTTP_CHUNK_DATA)
+#define HTTP_NAME_HEADER_SCAN "hScn" // how far we've searched for the end of the headers
 #define HTTP_NAME_HEADERS "headers"
 #define HTTP_NAME_CLOSENOW "clsNow"  // boolean: gotta close
 #define HTTP_NAME_CONNECTED "conn"     // boolean: we are connected
@@ -64,6 +65,17 @@ static char DBG_LIB[] = "socketserver"; // library name
 #define DBG(format, ...) do { } while(0)
 #endif
 
+/// States for decoding 'Transfer-Encoding: chunked' data as it arrives
+typedef enum {
+  HTTP_CHUNK_SIZE,          ///< reading the chunk size (hex)
+  HTTP_CHUNK_EXT,           ///< skipping chunk extensions up to the end of the size line
+  HTTP_CHUNK_DATA,          ///< reading chunk data
+  HTTP_CHUNK_DATA_END,      ///< skipping the CRLF after chunk data
+  HTTP_CHUNK_TRAILER_START, ///< had the last chunk - at the start of a trailer line (empty line = end)
+  HTTP_CHUNK_TRAILER,       ///< skipping a trailer line
+  HTTP_CHUNK_DONE,          ///< finished
+} HttpChunkState;
+
 // -----------------------------
 
 static ALWAYS_INLINE bool compareTransferEncodingAndUnlock(JsVar *encoding, char *value) {
@@ -93,12 +105,14 @@ static void httpAppendHeaders(JsVar *string, JsVar *headerObject) {
 // httpParseHeaders(&receiveData, reqVar, true) // server
 // httpParseHeaders(&receiveData, resVar, false) // client
 bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer) {
-  // find /r/n/r/n
+  // find /r/n/r/n - carrying on from where we got to last time (minus 3 in case it was only partly received)
   int newlineIdx = 0;
-  int strIdx = 0;
+  int strIdx = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(objectForData, HTTP_NAME_HEADER_SCAN, 0));
+  if (strIdx > 3) strIdx -= 3;
+  else strIdx = 0;
   int headerEnd = -1;
   JsvStringIterator it;
-  jsvStringIteratorNew(&it, *receiveData, 0);
+  jsvStringIteratorNew(&it, *receiveData, (size_t)strIdx);
   while (jsvStringIteratorHasChar(&it)) {
     char ch = jsvStringIteratorGetCharAndNext(&it);
     if (ch == '\r') {
@@ -115,7 +129,11 @@ bool httpParseHeaders(JsVar **receiveData, JsVar *objectForData, bool isServer)
   }
   jsvStringIteratorFree(&it);
   // skip if we have no header
-  if (headerEnd<0) return false;
+  if (headerEnd<0) {
+    jsvObjectSetChildAndUnLock(objectForData, HTTP_NAME_HEADER_SCAN, jsvNewFromInteger(strIdx));
+    return false;
+  }
+  jsvObjectRemoveChild(objectForData, HTTP_NAME_HEADER_SCAN);
   // Now parse the header
   JsVar *vHeaders = jsvNewObject();
   if (!vHeaders) return true;
@@ -301,63 +319,92 @@ int socketSendData(JsNetwork *net, JsVar *connection, int sckt, JsVar **sendData
   return 0;
 }
 
+/** Decode as much 'Transfer-Encoding: chunked' data as we can, carrying on from where we left off
+ * (state/chunkLen). All of receiveData is used. Returns the data from inside the chunks, or 0 if
+ * there was none. If receiveData is all chunk data, it is returned as-is rather than copied. */
+static JsVar *httpChunkedDecode(JsVar *receiveData, HttpChunkState *state, JsVarInt *chunkLen) {
+  JsVar *data = 0;
+  size_t len = jsvGetStringLength(receiveData);
+  size_t idx = 0;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, receiveData, 0);
+  while (idx<len && *state!=HTTP_CHUNK_DONE) {
+    if (*state==HTTP_CHUNK_DATA) {
+      size_t n = len-idx;
+      if ((JsVarInt)n > *chunkLen) n = (size_t)*chunkLen;
+      if (!data && idx==0 && n==len) {
+        data = jsvLockAgain(receiveData);
+      } else {
+        if (!data) data = jsvNewFromEmptyString();
+        if (data) jsvAppendStringVar(data, receiveData, idx, n);
+      }
+      idx += n;
+      *chunkLen -= (JsVarInt)n;
+      if (!*chunkLen) *state = HTTP_CHUNK_DATA_END;
+      jsvStringIteratorGoto(&it, receiveData, idx);
+      continue;
+    }
+    char ch = jsvStringIteratorGetCharAndNext(&it);
+    idx++;
+    switch (*state) {
+      case HTTP_CHUNK_SIZE:
+      case HTTP_CHUNK_EXT:
+        if (ch=='\n') { // end of the size line
+          *state = *chunkLen ? HTTP_CHUNK_DATA : HTTP_CHUNK_TRAILER_START;
+        } else if (*state==HTTP_CHUNK_SIZE) {
+          int digit = chtod(ch);
+          if (digit>=0 && digit<16 && *chunkLen<0x8000000)
+            *chunkLen = (*chunkLen<<4) | digit;
+          else // CR, ';' for extensions, or something we don't understand
+            *state = HTTP_CHUNK_EXT;
+        }
+        break;
+      case HTTP_CHUNK_DATA_END:
+        if (ch=='\n') *state = HTTP_CHUNK_SIZE; // chunkLen is already 0
+        break;
+      case HTTP_CHUNK_TRAILER_START:
+        if (ch=='\n') *state = HTTP_CHUNK_DONE;
+        else if (ch!='\r') *state = HTTP_CHUNK_TRAILER;
+        break;
+      case HTTP_CHUNK_TRAILER:
+        if (ch=='\n') *state = HTTP_CHUNK_TRAILER_START;
+        break;
+      default: break;
+    }
+  }
+  jsvStringIteratorFree(&it);
+  return data;
+}
+
 void socketPushReceiveData(JsVar *reader, JsVar **receiveData, bool isHttp, bool force) {
   if (!*receiveData || jsvIsEmptyString(*receiveData)) {
     // no data available (after headers)
     return;
   }
 
-  JsVar *nextChunk = 0;
-  JsVar *partialChunk = 0;
-
   // Keep track of how much we received (so we can close once we have it)
   if (isHttp) {
-    size_t len = (size_t)jsvGetStringLength(*receiveData);
     if (jsvGetBoolAndUnLock(jsvObjectGetChild(reader, HTTP_NAME_CHUNKED, 0))) {
-      // check for incomplete chunk, at least "0\r\n\r\n"
-      if (len < 5) return; // incomplete, wait for more data
-
-      JsVar *crlf = jsvNewFromString("\r\n");
-      JsVar *zero = jsvNewFromInteger(0);
-      size_t startIdx = (size_t)jswrap_string_indexOf(*receiveData, crlf, zero, false);
-      jsvUnLock2(crlf, zero);
-
-      JsVar *sixteen = jsvNewFromInteger(16);
-      int chunkLen = jsvGetIntegerAndUnLock(jswrap_parseInt(*receiveData, sixteen));
-      jsvUnLock(sixteen);
-      DBG("D:%d\n", chunkLen);
-
-      // for 'chunked' set the counter to 1 to read on or 0 if at last chunk
-      jsvObjectSetChildAndUnLock(reader, HTTP_NAME_RECEIVE_COUNT, jsvNewFromInteger(chunkLen ? 1 : 0));
-      if (!chunkLen) { // no 'data' callback
-        // clear received data
-        jsvUnLock(*receiveData);
-        *receiveData = 0;
+      HttpChunkState state = (HttpChunkState)jsvGetIntegerAndUnLock(jsvObjectGetChild(reader, HTTP_NAME_CHUNK_STATE, 0));
+      JsVarInt chunkLen = jsvGetIntegerAndUnLock(jsvObjectGetChild(reader, HTTP_NAME_CHUNK_LEN, 0));
+      JsVar *data = httpChunkedDecode(*receiveData, &state, &chunkLen);
+      DBG("D:%d %d\n", state, chunkLen);
+      // execute 'data' callback or save data - if we can't, we'll decode receiveData again next time
+      if (data && !jswrap_stream_pushData(reader, data, force)) {
+        jsvUnLock(data);
         return;
       }
-
-      startIdx += 2; // skip the CRLF
-      size_t nextIdx = startIdx + (size_t)chunkLen + 2; // CRLF at the end
-      if (nextIdx < len) { // there is another chunk in the buffer
-        DBG("D:nextIdx %d %d\n", nextIdx, len);
-        nextChunk = jsvNewFromEmptyString();
-        if (!nextChunk) return; // out of memory
-        jsvAppendStringVar(nextChunk, *receiveData, nextIdx, len-nextIdx);
-      } else if (nextIdx > len) { // chunk not complete
-        DBG("D:partialIdx %d %d %d\n", len - startIdx, nextIdx - len - 2, len);
-        if (nextIdx - len < 3) return; // just CRLF missing, wait
-        // use the data available, write remaining length, wait
-        partialChunk = jsvNewFromEmptyString();
-        if (!partialChunk) return; // out of memory
-        jsvAppendPrintf(partialChunk, "%x\r\n", nextIdx - len - 2);
-      }
-
-      JsVar *chunkData = jsvNewFromEmptyString();
-      if (!chunkData) return; // out of memory
-      jsvAppendStringVar(chunkData, *receiveData, startIdx, (size_t)chunkLen);
+      jsvUnLock(data);
+      jsvObjectSetChildAndUnLock(reader, HTTP_NAME_CHUNK_STATE, jsvNewFromInteger(state));
+      jsvObjectSetChildAndUnLock(reader, HTTP_NAME_CHUNK_LEN, jsvNewFromInteger(chunkLen));
+      // for 'chunked' set the counter to 1 to read on or 0 if we've had the last chunk
+      jsvObjectSetChildAndUnLock(reader, HTTP_NAME_RECEIVE_COUNT, jsvNewFromInteger(state>=HTTP_CHUNK_TRAILER_START ? 0 : 1));
+      // all received data has been used
       jsvUnLock(*receiveData);
-      *receiveData = chunkData;
+      *receiveData = 0;
+      return;
     } else {
+      size_t len = (size_t)jsvGetStringLength(*receiveData);
       jsvObjectSetChildAndUnLock(reader, HTTP_NAME_RECEIVE_COUNT,
         jsvNewFromInteger(
           jsvGetIntegerAndUnLock(jsvObjectGetChild(reader, HTTP_NAME_RECEIVE_COUNT, JSV_INTEGER)) - (JsVarInt)len)
@@ -366,18 +413,12 @@ void socketPushReceiveData(JsVar *reader, JsVar **receiveData, bool isHttp, bool
   }
 
   // execute 'data' callback or save data
-  if (!jswrap_stream_pushData(reader, *receiveData, force)) {
-    jsvUnLock2(nextChunk, partialChunk);
+  if (!jswrap_stream_pushData(reader, *receiveData, force))
     return;
-  }
 
   // clear received data
   jsvUnLock(*receiveData);
-  *receiveData = nextChunk ? nextChunk : partialChunk;
-
-  if (nextChunk) { // process following chunks if any
-    socketPushReceiveData(reader, receiveData, isHttp, force);
-  }
+  *receiveData = 0;
 }
 
 void socketReceivedUDP(JsVar *connection, JsVar **receiveData) {
@@ -633,8 +674,10 @@ bool socketClientConnectionsIdle(JsNetwork *net) {
 
       /* We do this up here because we want to wait until we have been once
        * around the idle loop (=callbacks have been executed) before we run this */
-      if (hadHeaders)
+      if (hadHeaders && receiveData) {
         socketPushReceiveData(socket, &receiveData, isHttp, false);
+        jsvObjectSetChild(connection, HTTP_NAME_RECEIVE_DATA, receiveData); // anything we couldn't push
+      }
 
       if (!closeConnectionNow) {
         JsVar *sendData = jsvObjectGetChild(connection,HTTP_NAME_SEND_DATA,0);
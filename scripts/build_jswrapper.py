@@ -499,43 +499,46 @@ codeOut('')
 codeOut('')
 
 
-codeOut('JsVar *jswFindBuiltInFunction(JsVar *parent, const char *name) {')
+codeOut('JsVar *jswFindBuiltIn(JsVar *parent, const char *name, const JswSymList **foundIn) {')
 codeOut('  JsVar *v;')
+codeOut('  const JswSymList *l;')
 codeOut('  if (parent && !jsvIsRoot(parent)) {')
 
 codeOut('    // ------------------------------------------ INSTANCE + STATIC METHODS')
 nativeCheck = "jsvIsNativeFunction(parent) && "
 codeOut('    if (jsvIsNativeFunction(parent)) {')
-codeOut('      const JswSymList *l = jswGetSymbolListForObject(parent);')
+codeOut('      l = jswGetSymbolListForObject(parent);')
 codeOut('      if (l) {');
 codeOut('        v = jswBinarySearch(l, parent, name);')
-codeOut('        if (v) return v;');
+codeOut('        if (v) { if (foundIn) *foundIn = l; return v; }');
 codeOut('      }')
 codeOut('    }')
 for className in builtins:
   if className!="parent" and  className!="!parent" and not "constructorPtr" in className and not className.startswith(nativeCheck):
     codeOut('    if ('+className+') {')
-    codeOutBuiltins("      v = ", builtins[className])
-    codeOut('      if (v) return v;');
+    codeOut('      l = &jswSymbolTables['+builtins[className]["indexName"]+'];')
+    codeOut('      v = jswBinarySearch(l, parent, name);')
+    codeOut('      if (v) { if (foundIn) *foundIn = l; return v; }');
     codeOut("    }")
 codeOut('    // ------------------------------------------ INSTANCE METHODS WE MUST CHECK CONSTRUCTOR FOR')
 codeOut('    JsVar *proto = jsvIsObject(parent)?jsvSkipNameAndUnLock(jsvFindChildFromString(parent, JSPARSE_INHERITS_VAR, false)):0;')
 codeOut('    JsVar *constructor = jsvIsObject(proto)?jsvSkipNameAndUnLock(jsvFindChildFromString(proto, JSPARSE_CONSTRUCTOR_VAR, false)):0;')
 codeOut('    jsvUnLock(proto);')
 codeOut('    if (constructor && jsvIsNativeFunction(constructor)) {')
-codeOut('      const JswSymList *l = jswGetSymbolListForConstructorProto(constructor);')
+codeOut('      l = jswGetSymbolListForConstructorProto(constructor);')
 codeOut('      jsvUnLock(constructor);')
 codeOut('      if (l) {');
 codeOut('        v = jswBinarySearch(l, parent, name);')
-codeOut('        if (v) return v;');
+codeOut('        if (v) { if (foundIn) *foundIn = l; return v; }');
 codeOut('      }')
 codeOut('    } else {')
 codeOut('      jsvUnLock(constructor);')
 codeOut('    }')
 codeOut('    // ------------------------------------------ METHODS ON OBJECT')
 if "parent" in builtins:
-  codeOutBuiltins("    v = ", builtins["parent"])
-  codeOut('    if (v) return v;');
+  codeOut('    l = &jswSymbolTables['+builtins["parent"]["indexName"]+'];')
+  codeOut('    v = jswBinarySearch(l, parent, name);')
+  codeOut('    if (v) { if (foundIn) *foundIn = l; return v; }');
 codeOut('  } else { /* if (!parent) */')
 codeOut('    // ------------------------------------------ FUNCTIONS')
 codeOut('    // Handle pin names - eg LED1 or D5 (this is hardcoded in build_jsfunctions.py)')
@@ -550,6 +553,11 @@ codeOut('  }');
 codeOut('  return 0;')
 codeOut('}')
 
+codeOut('')
+codeOut('JsVar *jswFindBuiltInFunction(JsVar *parent, const char *name) {')
+codeOut('  return jswFindBuiltIn(parent, name, 0);')
+codeOut('}')
+
 codeOut('')
 codeOut('')
 
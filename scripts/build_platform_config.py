@@ -339,7 +339,7 @@ xon_thresh = 3 # how full (out of 8) is buffer when we sent the XON flow control
 if LINUX:
   bufferSizeIO = 256
   bufferSizeTX = 256
-  bufferSizeTimer = 16
+  bufferSizeTimer = 64
 elif EMSCRIPTEN:
   bufferSizeIO = 256
   bufferSizeTX = 256
@@ -370,7 +370,7 @@ if 'io_buffer_size' in board.info:
 
 codeOut("#define IOBUFFERMASK "+str(bufferSizeIO-1)+" // (max 65535) amount of items in event buffer - events take 5 bytes each")
 codeOut("#define TXBUFFERMASK "+str(bufferSizeTX-1)+" // (max 255) amount of items in the transmit buffer - 2 bytes each")
-codeOut("#define UTILTIMERTASK_TASKS ("+str(bufferSizeTimer)+") // Must be power of 2 - and max 256")
+codeOut("#define UTILTIMERTASK_TASKS ("+str(bufferSizeTimer)+") // (max 65535) amount of tasks in the utility timer queue")
 
 codeOut("");
 
@@ -50,8 +50,43 @@
 #define JSF_CACHE_NOT_FOUND 0xFFFFFFFF
 
 #ifdef ESPR_STORAGE_FILENAME_TABLE
+/* The FILENAME_TABLE is a hash table stored in a file in Bank 1. It starts with
+a JsfFilenameTableHeader, followed by a power of 2 number of JsfFilenameTableSlots
+which are open addressed (linear probing). Slots are left as 0xFF until they are
+used, so new files can be added to the table as they're created without
+rewriting it. Replaced files just leave a slot pointing to a replaced header,
+which we skip over when probing. */
+#define JSF_FILENAME_TABLE_MAGIC 0x4C425446 // "FTBL"
+#define JSF_FILENAME_TABLE_EMPTY 0xFFFFFFFF // slot.offset for an unused slot
+#define JSF_FILENAME_TABLE_MIN_SLOTS 16
+#define JSF_FILENAME_TABLE_MIN_FILES 200 // When we have no table, how many files+trash do we need before we make one?
+
+typedef struct {
+  uint32_t magic;     ///< JSF_FILENAME_TABLE_MAGIC
+  uint32_t slotCount; ///< Number of slots in the table (power of 2)
+  uint32_t valid;     ///< 0xFFFFFFFF if valid, or set to 0 if a file couldn't be added and the table is out of date
+  uint32_t reserved;
+} JsfFilenameTableHeader;
+
+typedef struct {
+  uint32_t offset; ///< Offset of the file's header from the start of the bank, or JSF_FILENAME_TABLE_EMPTY
+  uint32_t hash;   ///< jsfFilenameTableHash of the filename
+} JsfFilenameTableSlot;
+
 uint32_t jsfFilenameTableBank1Addr = 0; // address of DATA in the table, NOT THE HEADER (or 0 if no table)
 uint32_t jsfFilenameTableBank1Size = 0; // size of table in bytes
+uint32_t jsfFilenameTableBank1Slots = 0; // number of slots in the table
+uint32_t jsfFilenameTableBank1Used = 0; // number of slots that have been used
+bool jsfFilenameTableBuilding = false; // are we currently creating a table? (stops us recursing)
+#endif
+
+#ifndef SAVE_ON_FLASH
+uint32_t jsfCompactBackgroundAddr = 0; // If nonzero, we're compacting in the background and this is where we got to
+uint32_t jsfCompactBackgroundLastFile = 0; // The last file header we found, so each step doesn't have to search all of Storage for the end
+uint32_t jsfCompactJournalAddr = 0; // Where we'd like the next journal to go - we move along free space to spread out wear
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+bool jsfCompactBackgroundHadTable = false; // Should we recreate the FILENAME_TABLE after background compaction?
+#endif
 #endif
 
 #if ESPR_USE_STORAGE_CACHE
@@ -191,6 +226,88 @@ static bool jsfIsRealFile(JsfFileHeader *header) {
          ;
 }
 
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+/// Hash a filename for the FILENAME_TABLE (FNV-1a). Never returns JSF_FILENAME_TABLE_EMPTY
+static uint32_t jsfFilenameTableHash(JsfFileName *name) {
+  uint32_t hash = 2166136261u;
+  for (size_t i=0;i<sizeof(name->c) && name->c[i];i++)
+    hash = (hash ^ (unsigned char)name->c[i]) * 16777619u;
+  if (hash==JSF_FILENAME_TABLE_EMPTY) hash--;
+  return hash;
+}
+
+/// Forget about the FILENAME_TABLE (it doesn't remove it from flash)
+static void jsfFilenameTableReset() {
+  jsfFilenameTableBank1Addr = 0;
+  jsfFilenameTableBank1Size = 0;
+  jsfFilenameTableBank1Slots = 0;
+  jsfFilenameTableBank1Used = 0;
+}
+
+/// Use the FILENAME_TABLE whose data is at tableAddr (if it's a valid table). Returns true on success
+static bool jsfFilenameTableLoad(uint32_t tableAddr, uint32_t tableSize) {
+  jsfFilenameTableReset();
+  JsfFilenameTableHeader tableHeader;
+  if (tableSize < sizeof(JsfFilenameTableHeader)) return false;
+  jshFlashRead(&tableHeader, tableAddr, sizeof(JsfFilenameTableHeader));
+  if (tableHeader.magic != JSF_FILENAME_TABLE_MAGIC || // not a table (or an old-style table)
+      tableHeader.valid != 0xFFFFFFFF || // table is out of date
+      !tableHeader.slotCount || (tableHeader.slotCount & (tableHeader.slotCount-1)) || // not a power of 2
+      tableSize < sizeof(JsfFilenameTableHeader) + tableHeader.slotCount*sizeof(JsfFilenameTableSlot))
+    return false;
+  uint32_t used = 0;
+  uint32_t slotAddr = tableAddr + (uint32_t)sizeof(JsfFilenameTableHeader);
+  for (uint32_t i=0;i<tableHeader.slotCount;i++) {
+    uint32_t offset;
+    jshFlashRead(&offset, slotAddr, sizeof(offset));
+    if (offset != JSF_FILENAME_TABLE_EMPTY) used++;
+    slotAddr += (uint32_t)sizeof(JsfFilenameTableSlot);
+  }
+  jsfFilenameTableBank1Addr = tableAddr;
+  jsfFilenameTableBank1Size = tableSize;
+  jsfFilenameTableBank1Slots = tableHeader.slotCount;
+  jsfFilenameTableBank1Used = used;
+  return true;
+}
+
+/// Mark the FILENAME_TABLE as out of date in flash (so it won't be used after a reboot) and forget about it
+static void jsfFilenameTableInvalidate() {
+  if (!jsfFilenameTableBank1Addr) return;
+  uint32_t valid = 0;
+  JsfFilenameTableHeader tableHeader;
+  jshFlashWrite(&valid, jsfFilenameTableBank1Addr + (uint32_t)((char*)&tableHeader.valid - (char*)&tableHeader), sizeof(valid));
+  jsfFilenameTableReset();
+}
+
+/// Get the address in flash of the given slot in the FILENAME_TABLE
+static uint32_t jsfFilenameTableSlotAddr(uint32_t slot) {
+  return jsfFilenameTableBank1Addr + (uint32_t)sizeof(JsfFilenameTableHeader) + slot*(uint32_t)sizeof(JsfFilenameTableSlot);
+}
+
+/** Add a file (headerAddr = address of the header in Bank 1) to the FILENAME_TABLE. If the
+table is full it is marked as invalid in flash and we go back to scanning storage */
+static void jsfFilenameTableAdd(uint32_t headerAddr, JsfFileName *name) {
+  if (!jsfFilenameTableBank1Addr) return;
+  uint32_t mask = jsfFilenameTableBank1Slots-1;
+  JsfFilenameTableSlot slot;
+  slot.offset = headerAddr - JSF_START_ADDRESS;
+  slot.hash = jsfFilenameTableHash(name);
+  for (uint32_t i=0;i<jsfFilenameTableBank1Slots;i++) {
+    uint32_t slotAddr = jsfFilenameTableSlotAddr((slot.hash+i) & mask);
+    uint32_t offset;
+    jshFlashRead(&offset, slotAddr, sizeof(offset));
+    if (offset == JSF_FILENAME_TABLE_EMPTY) {
+      jshFlashWrite(&slot, slotAddr, sizeof(JsfFilenameTableSlot));
+      jsfFilenameTableBank1Used++;
+      return;
+    }
+  }
+  // Table is full - mark it as invalid so we don't use it after a reboot either
+  jsDebug(DBG_INFO,"FILENAME_TABLE full\n");
+  jsfFilenameTableInvalidate();
+}
+#endif
+
 
 /// Return the flags for this file based on the header
 static uint32_t jsfGetBankEndAddress(uint32_t addr) {
@@ -277,8 +394,13 @@ bool jsfEraseAll() {
   jsDebug(DBG_INFO,"EraseAll\n");
   jsfCacheClear();
 #ifdef ESPR_STORAGE_FILENAME_TABLE
-  jsfFilenameTableBank1Addr = 0;
-  jsfFilenameTableBank1Size = 0;
+  jsfFilenameTableReset();
+#endif
+#ifndef SAVE_ON_FLASH
+  if (jsfCompactBackgroundAddr) { // start again (it'll finish straight away)
+    jsfCompactBackgroundAddr = JSF_START_ADDRESS;
+    jsfCompactBackgroundLastFile = 0;
+  }
 #endif
 #ifdef JSF_BANK2_START_ADDRESS
   if (!jsfEraseArea(JSF_BANK2_START_ADDRESS, JSF_BANK2_END_ADDRESS)) return false;
@@ -297,16 +419,19 @@ static void jsfEraseFileInternal(uint32_t addr, JsfFileHeader *header, bool crea
 
 #ifdef ESPR_STORAGE_FILENAME_TABLE
   if (createFilenameTable && addr>=JSF_START_ADDRESS && addr<JSF_END_ADDRESS) { // if was erasing in Bank 1
-    // do a scan from the last FILENAME_TABLE to see how many files there are
-    uint32_t scanAddr = 0;
-    if (jsfFilenameTableBank1Addr)
-      scanAddr = jsfFilenameTableBank1Addr + jsfFilenameTableBank1Size;
-    JsfStorageStats stats = jsfGetStorageStats(scanAddr, true);
-    /* if more than 200 files were added/deleted since the last
-    FILENAME_TABLE, try and make a new one. 100 files seems to add
-    around 5ms to each Storage.list call, or 2ms to a file read. */
-    if ((stats.trashCount+stats.fileCount)>200)
-      jsfBankCreateFileTable(JSF_START_ADDRESS);
+    if (jsfFilenameTableBank1Addr) {
+      /* The table is updated as files are added, but replaced files still use
+      slots. If it's over 3/4 full, make a new one before probing gets slow. */
+      if (jsfFilenameTableBank1Used*4 > jsfFilenameTableBank1Slots*3)
+        jsfBankCreateFileTable(JSF_START_ADDRESS);
+    } else {
+      JsfStorageStats stats = jsfGetStorageStats(JSF_START_ADDRESS, true);
+      /* if there are more than 200 files (or deleted files) and no
+      FILENAME_TABLE, try and make one. 100 files seems to add
+      around 5ms to each Storage.list call, or 2ms to a file read. */
+      if ((stats.trashCount+stats.fileCount)>JSF_FILENAME_TABLE_MIN_FILES)
+        jsfBankCreateFileTable(JSF_START_ADDRESS);
+    }
   }
 #endif
 }
@@ -587,19 +712,365 @@ bool jsfBankCompact(uint32_t startAddress) {
   return false;
 }
 
-// Try and compact saved data so it'll fit in Flash again
-bool jsfCompact() {
+/* Compact saved data so it'll fit in Flash again. If we had a FILENAME_TABLE
+it's rebuilt afterwards (compaction moves files, so the old one is no longer valid)
+as long as that still leaves 'reservedSize' bytes free for the file we're trying to write. */
+static bool jsfCompactAndReserve(uint32_t reservedSize) {
   jsfCacheClear();
 #ifdef ESPR_STORAGE_FILENAME_TABLE
-  jsfFilenameTableBank1Addr = 0;
-  jsfFilenameTableBank1Size = 0;
+  bool hadFilenameTable = jsfFilenameTableBank1Addr!=0;
+  jsfFilenameTableReset();
+#endif
+#ifndef SAVE_ON_FLASH
+  if (jsfCompactBackgroundAddr) { // files will have moved, so start again
+    jsfCompactBackgroundAddr = JSF_START_ADDRESS;
+    jsfCompactBackgroundLastFile = 0;
+  }
 #endif
   bool compacted = jsfBankCompact(JSF_START_ADDRESS);
 #ifdef JSF_BANK2_START_ADDRESS
   compacted |= jsfBankCompact(JSF_BANK2_START_ADDRESS);
+#endif
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+  if (compacted && hadFilenameTable && !jsfFilenameTableBuilding) {
+    JsfStorageStats stats = jsfGetStorageStats(JSF_START_ADDRESS, true);
+    if (stats.free > reservedSize*2 + stats.fileCount*4*(uint32_t)sizeof(JsfFilenameTableSlot))
+      jsfBankCreateFileTable(JSF_START_ADDRESS);
+  }
+#else
+  NOT_USED(reservedSize);
 #endif
   return compacted;
 }
+
+// Try and compact saved data so it'll fit in Flash again
+bool jsfCompact() {
+  return jsfCompactAndReserve(0);
+}
+
+#ifndef SAVE_ON_FLASH
+/* Background compaction is done a step at a time. Each step finds the first deleted
+files after where we got to, and moves the whole files that follow them (about a page
+worth) back over them. The space left behind is covered by a deleted JSFF_COMPACTING
+file, so between steps Storage is a valid chain of files that can be used normally.
+
+So that a reset part way through a step can't lose anything, the new contents of
+all the pages a step changes are first written to a journal in the free space after
+the last file. Only then are the pages erased and written from the journal. The
+journal's checksum is written last, so at boot jsfCompactJournalRecover can tell a
+complete journal (which is written out again) from one we were still writing (whose
+pages haven't been touched yet). */
+
+#define JSF_COMPACT_JOURNAL_MAGIC 0x4C4E524A // "JRNL"
+#define JSF_COMPACT_CHUNK 128 // bytes of stack we use for copying
+
+/// The start of a background compaction journal (at the start of a page). The new page contents follow it
+typedef struct {
+  JsfFileHeader header; ///< A deleted JSFF_COMPACTING file covering the whole journal
+  uint32_t magic;       ///< JSF_COMPACT_JOURNAL_MAGIC
+  uint32_t pageAddr;    ///< The first page to rewrite
+  uint32_t pagesLength; ///< How many bytes of pages to rewrite
+  uint32_t eraseEnd;    ///< If nonzero, pages after those we rewrite are erased up to here
+  uint32_t checksum;    ///< Checksum of the above and the page contents, written once everything else is
+  uint32_t unused;      ///< pad to JSF_ALIGNMENT
+} JsfCompactJournal;
+
+/// One step of background compaction
+typedef struct {
+  uint32_t dest;   ///< Where the deleted files start (where we move files to)
+  uint32_t length; ///< How many bytes of files we move
+  uint32_t shift;  ///< How far back we move them
+  bool atEnd;      ///< There's nothing after the files we move, so Storage ends after them
+} JsfCompactStep;
+
+/// Return the address after the end of the page that addr-1 is in (or addr if it's at the start of a page)
+static uint32_t jsfGetPageEndAddress(uint32_t addr) {
+  uint32_t pageAddr, pageSize;
+  if (!jshFlashGetPage(addr-1, &pageAddr, &pageSize)) return addr;
+  return pageAddr+pageSize;
+}
+
+/// Return the address (aligned) after the end of the file whose header is at addr
+static uint32_t jsfGetFileEndAddress(uint32_t addr, JsfFileHeader *header) {
+  return jsfAlignAddress(addr + (uint32_t)sizeof(JsfFileHeader) + jsfGetFileSize(header));
+}
+
+static uint32_t jsfCompactChecksum(uint32_t checksum, unsigned char *data, uint32_t len) {
+  while (len--) checksum = (checksum ^ *(data++)) * 16777619u; // FNV-1a
+  return checksum;
+}
+
+static void jsfCompactWriteIfNotErased(unsigned char *buf, uint32_t addr, uint32_t len) {
+  for (uint32_t i=0;i<len;i++)
+    if (buf[i]!=0xFF) {
+      jshFlashWrite(buf, addr, len);
+      return;
+    }
+}
+
+/// Read what flash will contain between addr and addr+len once the step is done
+static void jsfCompactStepRead(JsfCompactStep *step, unsigned char *buf, uint32_t addr, uint32_t len) {
+  uint32_t filesEnd = step->dest + step->length;
+  while (len) {
+    uint32_t l = len;
+    if (addr < step->dest) { // before the deleted files - unchanged
+      if (l > step->dest-addr) l = step->dest-addr;
+      jshFlashRead(buf, addr, l);
+    } else if (addr < filesEnd) { // the files we're moving
+      if (l > filesEnd-addr) l = filesEnd-addr;
+      jshFlashRead(buf, addr+step->shift, l);
+    } else if (step->atEnd) { // nothing else in Storage
+      memset(buf, 0xFF, l);
+    } else if (addr < filesEnd+(uint32_t)sizeof(JsfFileHeader)) { // the header of the gap
+      JsfFileHeader gapHeader;
+      memset(&gapHeader,0,sizeof(JsfFileHeader));
+      gapHeader.size = (step->shift - (uint32_t)sizeof(JsfFileHeader)) | (JSFF_COMPACTING<<24);
+      uint32_t o = addr-filesEnd;
+      if (l > (uint32_t)sizeof(JsfFileHeader)-o) l = (uint32_t)sizeof(JsfFileHeader)-o;
+      memcpy(buf, o+(unsigned char*)&gapHeader, l);
+    } else // the rest of the gap - unchanged
+      jshFlashRead(buf, addr, l);
+    buf += l;
+    addr += l;
+    len -= l;
+  }
+}
+
+/// Erase the pages from startAddr (the start of a page) up to endAddr, last page first
+static void jsfCompactEraseBackwards(uint32_t startAddr, uint32_t endAddr) {
+  uint32_t pageAddr, pageSize;
+  while (endAddr>startAddr && jshFlashGetPage(endAddr-1, &pageAddr, &pageSize)) {
+    if (!jsfIsErased(pageAddr, pageSize))
+      jshFlashErasePage(pageAddr);
+    jshKickWatchDog();
+    endAddr = pageAddr;
+  }
+}
+
+/** Write the pages in the journal at journalAddr back to where they should be (if writePages),
+then erase the journal. This can be done again if we're reset part way through. */
+static void jsfCompactJournalApply(uint32_t journalAddr, JsfCompactJournal *journal, bool writePages) {
+  if (writePages) {
+    unsigned char buf[JSF_COMPACT_CHUNK];
+    uint32_t addr = journal->pageAddr;
+    uint32_t endAddr = journal->pageAddr + journal->pagesLength;
+    uint32_t src = journalAddr + (uint32_t)sizeof(JsfCompactJournal);
+    uint32_t pageAddr, pageSize;
+    while (addr<endAddr && jshFlashGetPage(addr, &pageAddr, &pageSize)) {
+      jsDebug(DBG_INFO,"compact> write page 0x%08x from journal\n", pageAddr);
+      jshFlashErasePage(pageAddr);
+      while (addr<pageAddr+pageSize && addr<endAddr) {
+        uint32_t l = pageAddr+pageSize-addr;
+        if (l>sizeof(buf)) l=sizeof(buf);
+        jshFlashRead(buf, src, l);
+        jsfCompactWriteIfNotErased(buf, addr, l);
+        addr += l;
+        src += l;
+      }
+      jshKickWatchDog();
+    }
+    if (journal->eraseEnd)
+      jsfCompactEraseBackwards(endAddr, journal->eraseEnd);
+  }
+  // erase the journal's first page last, so we still find it if we're reset before that
+  jsfCompactEraseBackwards(journalAddr, journalAddr + (uint32_t)sizeof(JsfCompactJournal) + journal->pagesLength);
+}
+
+/** If we were reset part way through a step of background compaction, find the journal and
+finish the step. This must be called at boot, before we check Storage is valid. */
+static void jsfCompactJournalRecover(uint32_t bankAddr) {
+  uint32_t bankEndAddr = jsfGetBankEndAddress(bankAddr);
+  uint32_t addr = bankAddr;
+  JsfCompactJournal journal;
+  while (addr) {
+    jshFlashRead(&journal, addr, sizeof(JsfCompactJournal));
+    if (journal.magic==JSF_COMPACT_JOURNAL_MAGIC &&
+        journal.header.name.firstChars==0 &&
+        jsfGetFileFlags(&journal.header)==JSFF_COMPACTING &&
+        jsfGetFileSize(&journal.header)==(uint32_t)(sizeof(JsfCompactJournal)-sizeof(JsfFileHeader))+journal.pagesLength &&
+        journal.pageAddr>=bankAddr && journal.pageAddr+journal.pagesLength<=addr &&
+        journal.eraseEnd<=addr &&
+        addr+(uint32_t)sizeof(JsfCompactJournal)+journal.pagesLength<=bankEndAddr) {
+      uint32_t checksum = jsfCompactChecksum(2166136261u, (unsigned char*)&journal.magic, 4*(uint32_t)sizeof(uint32_t));
+      unsigned char buf[JSF_COMPACT_CHUNK];
+      uint32_t src = addr + (uint32_t)sizeof(JsfCompactJournal);
+      for (uint32_t i=0;i<journal.pagesLength;i+=sizeof(buf)) {
+        uint32_t l = journal.pagesLength-i;
+        if (l>sizeof(buf)) l=sizeof(buf);
+        jshFlashRead(buf, src+i, l);
+        checksum = jsfCompactChecksum(checksum, buf, l);
+      }
+      if (checksum==JSF_WORD_UNSET) checksum=0;
+      bool complete = checksum==journal.checksum;
+      jsDebug(DBG_INFO,"compact> found %s journal at 0x%08x\n", complete?"complete":"incomplete", addr);
+      jsfCompactJournalApply(addr, &journal, complete);
+      jsfCompactBackgroundAddr = bankAddr; // carry on compacting
+      return; // there's only ever one journal
+    }
+    addr = jsfGetAddressOfNextPage(addr);
+  }
+}
+
+/** Do a step of background compaction, starting from the file header at *resumeAddr.
+*resumeAddr is set to where to start next time, or 0 if we've finished. Returns false
+if there's not enough free space for the journal. */
+static bool jsfCompactBackgroundStep(uint32_t bankAddr, uint32_t *resumeAddr) {
+  JsfFileHeader header;
+  uint32_t addr = *resumeAddr;
+  *resumeAddr = 0;
+  // find the first deleted file
+  if (!jsfGetFileHeader(addr, &header, false)) return true; // empty
+  while (jsfIsRealFile(&header)) {
+    if (!jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL|GNFH_READ_ONLY_FILENAME_START))
+      return true; // no deleted files - we're done
+  }
+  JsfCompactStep step;
+  step.dest = addr;
+  step.length = 0;
+  step.shift = 0;
+  uint32_t endAddr; // the end of the last file in Storage
+  bool more;
+  // skip all the deleted files after it
+  do {
+    endAddr = jsfGetFileEndAddress(addr, &header);
+    more = jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL|GNFH_READ_ONLY_FILENAME_START);
+  } while (more && !jsfIsRealFile(&header));
+  uint32_t pageAddr, pageSize;
+  if (!jshFlashGetPage(step.dest, &pageAddr, &pageSize)) return false;
+  if (more) {
+    /* Move whole files until we've filled the page the deleted files started in. We
+    stop if there's a gap before the next file, as we can't move it along with the others */
+    step.shift = addr - step.dest;
+    do {
+      endAddr = jsfGetFileEndAddress(addr, &header);
+      step.length = endAddr - (step.dest + step.shift);
+      more = jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL|GNFH_READ_ONLY_FILENAME_START);
+    } while (more && jsfIsRealFile(&header) && addr==endAddr &&
+             step.dest+step.length < pageAddr+pageSize);
+  }
+  step.atEnd = !more;
+  if (more) { // find the end of Storage
+    if (jsfCompactBackgroundLastFile>addr && jsfGetFileHeader(jsfCompactBackgroundLastFile, &header, false))
+      addr = jsfCompactBackgroundLastFile;
+    do {
+      endAddr = jsfGetFileEndAddress(addr, &header);
+      jsfCompactBackgroundLastFile = addr;
+    } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL|GNFH_READ_ONLY_FILENAME_START));
+  }
+  // work out which pages change
+  uint32_t changedEnd = step.dest + step.length + (step.atEnd ? 0 : (uint32_t)sizeof(JsfFileHeader));
+  uint32_t rewriteEnd = (changedEnd>pageAddr) ? jsfGetPageEndAddress(changedEnd) : pageAddr;
+  uint32_t freeAddr = jsfGetPageEndAddress(endAddr);
+  JsfCompactJournal journal;
+  memset(&journal,0,sizeof(JsfCompactJournal));
+  journal.magic = JSF_COMPACT_JOURNAL_MAGIC;
+  journal.pageAddr = pageAddr;
+  journal.pagesLength = rewriteEnd - pageAddr;
+  if (step.atEnd && freeAddr>rewriteEnd)
+    journal.eraseEnd = freeAddr;
+  if (freeAddr<rewriteEnd) freeAddr = rewriteEnd;
+  journal.header.size = ((uint32_t)(sizeof(JsfCompactJournal)-sizeof(JsfFileHeader)) + journal.pagesLength) | (JSFF_COMPACTING<<24);
+  journal.checksum = JSF_WORD_UNSET;
+  journal.unused = JSF_WORD_UNSET;
+  // find space for the journal
+  uint32_t journalSize = (uint32_t)sizeof(JsfCompactJournal) + journal.pagesLength;
+  uint32_t bankEndAddr = jsfGetBankEndAddress(bankAddr);
+  uint32_t journalAddr = (jsfCompactJournalAddr>freeAddr) ? jsfCompactJournalAddr : freeAddr;
+  if (journalAddr+journalSize > bankEndAddr)
+    journalAddr = freeAddr; // wrap around
+  if (journalAddr+journalSize > bankEndAddr) {
+    jsDebug(DBG_INFO,"compact> not enough space for journal\n");
+    return false;
+  }
+  jsDebug(DBG_INFO,"compact> move 0x%08x => 0x%08x (%d bytes), journal at 0x%08x\n", step.dest+step.shift, step.dest, step.length, journalAddr);
+  jsfEraseArea(journalAddr, journalAddr+journalSize);
+  jshFlashWrite(&journal, journalAddr, (uint32_t)sizeof(JsfCompactJournal));
+  uint32_t checksum = jsfCompactChecksum(2166136261u, (unsigned char*)&journal.magic, 4*(uint32_t)sizeof(uint32_t));
+  unsigned char buf[JSF_COMPACT_CHUNK];
+  for (uint32_t i=0;i<journal.pagesLength;i+=sizeof(buf)) {
+    uint32_t l = journal.pagesLength-i;
+    if (l>sizeof(buf)) l=sizeof(buf);
+    jsfCompactStepRead(&step, buf, pageAddr+i, l);
+    checksum = jsfCompactChecksum(checksum, buf, l);
+    jsfCompactWriteIfNotErased(buf, journalAddr+(uint32_t)sizeof(JsfCompactJournal)+i, l);
+    jshKickWatchDog();
+  }
+  if (checksum==JSF_WORD_UNSET) checksum=0;
+  journal.checksum = checksum;
+  jshFlashWrite(&journal.checksum, journalAddr + (uint32_t)((char*)&journal.checksum - (char*)&journal), (uint32_t)sizeof(journal.checksum));
+  // now the journal is complete, rewrite the pages
+  jsfCompactJournalApply(journalAddr, &journal, true);
+  jsfCompactJournalAddr = jsfGetPageEndAddress(journalAddr+journalSize);
+  // Update anything that referenced the files we moved
+  addr = step.dest;
+  while (addr < step.dest+step.length && jsfGetFileHeader(addr, &header, false)) {
+    uint32_t oldAddr = addr + step.shift;
+    jsvUpdateMemoryAddress(oldAddr, sizeof(JsfFileHeader) + jsfGetFileSize(&header), addr);
+    if (!step.atEnd && oldAddr >= rewriteEnd) {
+      /* The old copy is still there in the gap. Clear its name so anything that
+      remembered its address (eg. StorageFile) doesn't find a valid header there and write to it. */
+      uint32_t zero = 0;
+      jshFlashWrite(&zero, oldAddr + (uint32_t)((char*)&header.name.firstChars - (char*)&header), (uint32_t)sizeof(header.name.firstChars));
+    }
+    addr = jsfGetFileEndAddress(addr, &header);
+  }
+  if (!step.atEnd)
+    *resumeAddr = step.dest + step.length; // the gap
+  return true;
+}
+
+/// Start compacting Storage a bit at a time from jsfCompactBackgroundIdle
+void jsfCompactBackgroundStart() {
+  if (jsfCompactBackgroundAddr) return; // already started
+  jsfCacheClear();
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+  // Files will move, so the table would be wrong. Make sure we don't use it even after a reboot
+  jsfCompactBackgroundHadTable = jsfFilenameTableBank1Addr!=0;
+  jsfFilenameTableInvalidate();
+#endif
+  jsfCompactBackgroundAddr = JSF_START_ADDRESS;
+  jsfCompactBackgroundLastFile = 0;
+}
+
+/// Are we compacting in the background?
+bool jsfCompactBackgroundIsActive() {
+  return jsfCompactBackgroundAddr!=0;
+}
+
+/// Do a little more background compaction (called when idle)
+JsfCompactStatus jsfCompactBackgroundIdle() {
+  if (!jsfCompactBackgroundAddr) return JSFCS_NONE;
+  jsfCacheClear(); // files may move
+  uint32_t bankAddr = JSF_START_ADDRESS;
+#ifdef JSF_BANK2_START_ADDRESS
+  if (jsfCompactBackgroundAddr>=JSF_BANK2_START_ADDRESS && jsfCompactBackgroundAddr<JSF_BANK2_END_ADDRESS)
+    bankAddr = JSF_BANK2_START_ADDRESS;
+#endif
+  uint32_t resumeAddr = jsfCompactBackgroundAddr;
+  if (!jsfCompactBackgroundStep(bankAddr, &resumeAddr)) {
+    jsfCompactBackgroundAddr = 0;
+    return JSFCS_FAILED;
+  }
+  if (resumeAddr) {
+    jsfCompactBackgroundAddr = resumeAddr;
+    return JSFCS_BUSY;
+  }
+  jsfCompactBackgroundLastFile = 0;
+#ifdef JSF_BANK2_START_ADDRESS
+  if (bankAddr == JSF_START_ADDRESS) {
+    jsfCompactBackgroundAddr = JSF_BANK2_START_ADDRESS;
+    return JSFCS_BUSY;
+  }
+#endif
+  jsfCompactBackgroundAddr = 0;
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+  if (jsfCompactBackgroundHadTable)
+    jsfBankCreateFileTable(JSF_START_ADDRESS);
+  jsfCompactBackgroundHadTable = false;
+#endif
+  return JSFCS_DONE;
+}
+#endif
 char jsfStripDriveFromName(JsfFileName *name){
 #ifndef SAVE_ON_FLASH
   if (name->c[1]==':') { // if a 'drive' is specified like "C:foobar.js"
@@ -650,12 +1121,17 @@ static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flag
   uint32_t addr = 0;
   JsfFileHeader header;
   uint32_t freeAddr = 0;
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+  bool checkedTable = false;
+#endif
   while (!freeAddr) {
     addr = bankStartAddress;
     freeAddr = 0;
+    uint32_t fileCount = 0; // files and trash
     // Find a hole that's big enough for our file
     do {
       if (jsfGetFileHeader(addr, &header, false)) do {
+        fileCount++;
       } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_EMPTY));
       // If not enough space, skip to next page
       if (jsfGetSpaceLeftInPage(addr)<requiredSize) {
@@ -664,12 +1140,27 @@ static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flag
         freeAddr = addr;
       }
     } while (addr && !freeAddr);
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+    /* If the FILENAME_TABLE is getting full (or we have lots of files and no table), make
+    a new one now - before we write our header, as it may take the space we found. */
+    if (freeAddr && !checkedTable && bankStartAddress==JSF_START_ADDRESS && !jsfFilenameTableBuilding &&
+        (jsfFilenameTableBank1Addr ?
+          jsfFilenameTableBank1Used*4 >= jsfFilenameTableBank1Slots*3 :
+          fileCount > JSF_FILENAME_TABLE_MIN_FILES)) {
+      checkedTable = true;
+      jsfBankCreateFileTable(JSF_START_ADDRESS);
+      freeAddr = 0; // look again
+      continue;
+    }
+#else
+    NOT_USED(fileCount);
+#endif
     // If we don't have space, compact
     if (!freeAddr) {
       // check this for sanity - in future we might compact forward into other pages, and don't compact if so
       if (!compacted) {
         compacted = true;
-        if (!jsfCompact()) {
+        if (!jsfCompactAndReserve(requiredSize)) {
           jsDebug(DBG_INFO,"CreateFile - Compact failed\n");
           return 0;
         }
@@ -693,6 +1184,10 @@ static uint32_t jsfCreateFile(JsfFileName name, uint32_t size, JsfFileFlags flag
   jshFlashWrite(&header,addr,(uint32_t)sizeof(JsfFileHeader));
   jsDebug(DBG_INFO,"CreateFile written header\n");
   if (returnedHeader) *returnedHeader = header;
+#ifdef ESPR_STORAGE_FILENAME_TABLE
+  if (bankStartAddress==JSF_START_ADDRESS && !(flags & JSFF_FILENAME_TABLE))
+    jsfFilenameTableAdd(addr, &name);
+#endif
   addr += (uint32_t)sizeof(JsfFileHeader); // address of actual file data
   jsfCachePut(&header, addr);
   return addr;
@@ -703,34 +1198,25 @@ static uint32_t jsfBankFindFile(uint32_t bankAddress, uint32_t bankEndAddress, J
   JsfFileHeader header;
 #ifdef ESPR_STORAGE_FILENAME_TABLE
   if (jsfFilenameTableBank1Addr && addr==JSF_START_ADDRESS) {
-    uint32_t baseAddr = addr;
-    uint32_t tableAddr = jsfFilenameTableBank1Addr;
-    uint32_t tableEnd = tableAddr + jsfFilenameTableBank1Size;
-    // Now scan the table and call back for each item
-    while (tableAddr < tableEnd) {
-      // read the address and name...
-      jshFlashRead(&header, tableAddr, sizeof(JsfFileHeader));
-      tableAddr += (uint32_t)sizeof(JsfFileHeader);
-      if (memcmp(header.name.c, name.c, sizeof(name.c))==0) { // name matches
-        uint32_t fileAddr = baseAddr + header.size;
-        if (jsfGetFileHeader(fileAddr, &header, true) && // read the real header
-            (header.name.firstChars != 0)) { // check the file was not replaced
-          if (returnedHeader)
-            *returnedHeader = header;
-          return fileAddr+(uint32_t)sizeof(JsfFileHeader);
-        }
-        /* Or... the file was in our table but it's been replaced. In this case
-        stop scanning our table and instead just  do a normal scan for files
-        added after the table... */
+    /* All files in Bank 1 are in the table, so we just have to probe it: one
+    read per slot, and a header read only if the filename's hash matches */
+    uint32_t mask = jsfFilenameTableBank1Slots-1;
+    uint32_t hash = jsfFilenameTableHash(&name);
+    for (uint32_t i=0;i<jsfFilenameTableBank1Slots;i++) {
+      JsfFilenameTableSlot slot;
+      jshFlashRead(&slot, jsfFilenameTableSlotAddr((hash+i) & mask), sizeof(JsfFilenameTableSlot));
+      if (slot.offset == JSF_FILENAME_TABLE_EMPTY) break; // end of probe - not found
+      if (slot.hash != hash) continue;
+      uint32_t fileAddr = addr + slot.offset;
+      if (jsfGetFileHeader(fileAddr, &header, true) && // read the real header
+          (header.name.firstChars != 0) && // check the file was not replaced
+          memcmp(header.name.c, name.c, sizeof(name.c))==0) { // name matches
+        if (returnedHeader)
+          *returnedHeader = header;
+        return fileAddr+(uint32_t)sizeof(JsfFileHeader);
       }
     }
-    // We didn't find the file in our table...
-    // Now point 'addr' to the start of this table and fill in the header.
-    // the normal code will see this, skip over it like a normal file
-    // and carry on regardless.
-    addr = jsfFilenameTableBank1Addr - sizeof(JsfFileHeader); // address of jsfFilenameTable's header
-    header.name.firstChars = 0;
-    header.size = jsfFilenameTableBank1Size;
+    return 0;
   } else
 #endif
   if (!jsfGetFileHeader(addr, &header, false)) return 0;
@@ -868,9 +1354,16 @@ static bool jsfIsBankStorageValid(uint32_t startAddr, JsfStorageTestType testFla
       if ((testFlags & JSFSTT_FIND_FILENAME_TABLE) &&
           (startAddr==JSF_START_ADDRESS) &&
           (jsfGetFileFlags(&header) & JSFF_FILENAME_TABLE)) {
-        jsfFilenameTableBank1Addr = addr + (uint32_t)sizeof(JsfFileHeader);
-        jsfFilenameTableBank1Size  = jsfGetFileSize(&header);
+        jsfFilenameTableLoad(addr + (uint32_t)sizeof(JsfFileHeader), jsfGetFileSize(&header));
       }
+#endif
+#ifndef SAVE_ON_FLASH
+      // If we were reset between steps of a background compaction, carry on with it
+      if ((testFlags & JSFSTT_FIND_FILENAME_TABLE) &&
+          !jsfCompactBackgroundAddr &&
+          (header.name.firstChars == 0) &&
+          (jsfGetFileFlags(&header) & JSFF_COMPACTING))
+        jsfCompactBackgroundAddr = startAddr;
 #endif
       oldAddr = addr;
       jshKickWatchDog(); // stop watchdog reboots
@@ -903,6 +1396,14 @@ static bool jsfIsBankStorageValid(uint32_t startAddr, JsfStorageTestType testFla
  * may contain info (which is invalid)...
  */
 bool jsfIsStorageValid(JsfStorageTestType testFlags) {
+#ifndef SAVE_ON_FLASH
+  if (testFlags & JSFSTT_FIND_FILENAME_TABLE) { // at boot, finish any background compaction step we were reset during
+    jsfCompactJournalRecover(JSF_START_ADDRESS);
+#ifdef JSF_BANK2_START_ADDRESS
+    jsfCompactJournalRecover(JSF_BANK2_START_ADDRESS);
+#endif
+  }
+#endif
   if (!jsfIsBankStorageValid(JSF_START_ADDRESS, testFlags))
     return false;
 #ifdef JSF_BANK2_START_ADDRESS
@@ -1038,8 +1539,15 @@ bool jsfWriteFile(JsfFileName name, JsVar *data, JsfFileFlags flags, JsVarInt of
   return true;
 }
 
+/// Is this one of the blocks of the saved RAM image? (only the SAVED_CODE_VARIMAGE index file is listed)
+static bool jsfIsVarImageBlockName(JsfFileName *name) {
+  size_t l = strlen(SAVED_CODE_VARIMAGE);
+  return !memcmp(name->c, SAVED_CODE_VARIMAGE, l) && name->c[l];
+}
+
 static void jsfBankListFilesHandleFile(JsVar *files, uint32_t addr, JsfFileHeader *header, JsVar *regex, JsfFileFlags containing, JsfFileFlags notContaining, uint32_t *hash) {
   JsfFileFlags flags = jsfGetFileFlags(header);
+  if (jsfIsVarImageBlockName(&header->name)) return;
   if (notContaining&flags) return;
   if (containing && !(containing&flags)) return;
   if (flags&JSFF_STORAGEFILE) {
@@ -1078,28 +1586,18 @@ static void jsfBankListFiles(JsVar *files, uint32_t addr, JsVar *regex, JsfFileF
   memset(&header,0,sizeof(JsfFileHeader));
 #ifdef ESPR_STORAGE_FILENAME_TABLE
   if (jsfFilenameTableBank1Addr && addr==JSF_START_ADDRESS) {
-    //jsiConsolePrintf("jsfFilenameTable 0x%08x\n", jsfFilenameTableBank1Addr);
-    uint32_t baseAddr = addr;
-    uint32_t tableAddr = jsfFilenameTableBank1Addr;
-    uint32_t tableEnd = tableAddr + jsfFilenameTableBank1Size;
-    // Now scan the table and call back for each item
-    while (tableAddr < tableEnd) {
-      // read just the address
-      jshFlashRead(&header, tableAddr, 4);
-      tableAddr += (uint32_t)sizeof(JsfFileHeader);
+    // All files in Bank 1 are in the table, so just read the header for each used slot
+    for (uint32_t i=0;i<jsfFilenameTableBank1Slots;i++) {
+      uint32_t offset;
+      jshFlashRead(&offset, jsfFilenameTableSlotAddr(i), sizeof(offset));
+      if (offset == JSF_FILENAME_TABLE_EMPTY) continue;
       // Now read the header at the address we have in our table (file may have been deleted)
-      uint32_t fileAddr = baseAddr + header.size;
+      uint32_t fileAddr = addr + offset;
       if (jsfGetFileHeader(fileAddr, &header, true) && jsfIsRealFile(&header)) {
         jsfBankListFilesHandleFile(files, fileAddr, &header, regex, containing, notContaining, hash);
       }
     }
-    // We didn't find the file in our table...
-    // Now point 'addr' to the start of this table and fill in the header.
-    // the normal code will see this, skip over it like a normal file
-    // and carry on regardless.
-    addr = jsfFilenameTableBank1Addr - sizeof(JsfFileHeader); // address of jsfFilenameTable's header
-    header.name.firstChars = 0;
-    header.size = jsfFilenameTableBank1Size;
+    return;
   } else
 #endif
   if (!jsfGetFileHeader(addr, &header, true)) return;
@@ -1199,59 +1697,188 @@ int jsfLoadFromFlash_readcb(uint32_t *cbdata) {
   return data->buffer[data->bufferCnt++];
 }
 
+#ifndef ESPR_NO_VARIMAGE
+/* The RAM image is saved as an index file (SAVED_CODE_VARIMAGE) plus one file per
+block of JsVars (SAVED_CODE_VARIMAGE followed by the block number in hex). Each
+block is compressed into a buffer on the stack and then written straight to its own
+file, so we only compress once. Every block file starts with a hash of the block's
+uncompressed contents, so when we save again we only rewrite blocks that changed. */
+#define JSF_VARIMAGE_BLOCK_VARS 64 ///< Maximum number of JsVars in each block of the saved image
+#define JSF_VARIMAGE_MIN_BLOCK_VARS 4 ///< If we can't get enough stack for a block this big, give up
+
+/// The contents of the SAVED_CODE_VARIMAGE index file
+typedef struct {
+  uint32_t buildHash; ///< getBuildHash()
+  uint32_t varCount;  ///< jsvGetMemoryTotal() when saved
+  uint32_t blockVars; ///< How many JsVars in each block
+  uint32_t blockCount; ///< How many blocks were saved
+} JsfVarImageIndex;
+
+/// Get the filename for a block of the saved RAM image
+static JsfFileName jsfGetVarImageBlockName(uint32_t block) {
+  JsfFileName name = jsfNameFromString(SAVED_CODE_VARIMAGE);
+  size_t l = strlen(SAVED_CODE_VARIMAGE);
+  for (int i=3;i>=0;i--)
+    name.c[l++] = itoch((block >> (i*4)) & 15);
+  return name;
+}
+
+/// Hash the uncompressed contents of a block of the RAM image (FNV-1a)
+static uint32_t jsfGetVarImageBlockHash(unsigned char *data, uint32_t len) {
+  uint32_t hash = 2166136261u;
+  while (len--) hash = (hash ^ *(data++)) * 16777619u;
+  return hash;
+}
+
+typedef struct {
+  unsigned char *buffer; ///< where to write compressed data
+  uint32_t size;         ///< size of buffer
+  uint32_t length;       ///< how much data has been written (may be > size if we overflowed)
+} jsfVarImageBuffer;
+// cbdata = struct jsfVarImageBuffer
+static void jsfSaveToFlash_buffercb(unsigned char ch, uint32_t *cbdata) {
+  jsfVarImageBuffer *data = (jsfVarImageBuffer*)cbdata;
+  if (data->length < data->size) data->buffer[data->length] = ch;
+  data->length++;
+}
+
+/** Write one block of the RAM image to flash unless it's unchanged, using 'buffer'
+(which must be at least as big as the block) to compress it. Returns false if there wasn't space */
+static bool jsfSaveVarImageBlock(uint32_t block, unsigned char *data, uint32_t len, unsigned char *buffer, bool *changed) {
+  JsfFileName name = jsfGetVarImageBlockName(block);
+  uint32_t hash = jsfGetVarImageBlockHash(data, len);
+  JsfFileHeader header;
+  uint32_t addr = jsfFindFile(name, &header);
+  *changed = false;
+  if (addr) {
+    uint32_t oldHash;
+    jshFlashRead(&oldHash, addr, sizeof(oldHash));
+    if (oldHash == hash) return true; // unchanged - nothing to do
+    jsfEraseFileInternal(addr, &header, true);
+    jsfCacheClearFile(name);
+  }
+  *changed = true;
+  jsfVarImageBuffer out;
+  out.buffer = buffer;
+  out.size = len;
+  out.length = 0;
+  COMPRESS(data, len, jsfSaveToFlash_buffercb, (uint32_t*)&out);
+  JsfFileFlags flags = JSFF_COMPRESSED;
+  if (out.length > len) { // compression made it bigger - store uncompressed
+    flags = JSFF_NONE;
+    out.buffer = data;
+    out.length = len;
+  }
+  addr = jsfCreateFile(name, (uint32_t)sizeof(hash) + out.length, flags, NULL);
+  if (!addr) return false;
+  jsfcbData cbData;
+  memset(&cbData, 0, sizeof(cbData));
+  cbData.address = addr;
+  for (int i=0;i<4;i++)
+    jsfSaveToFlash_writecb(((unsigned char*)&hash)[i], (uint32_t*)&cbData);
+  for (uint32_t i=0;i<out.length;i++)
+    jsfSaveToFlash_writecb(out.buffer[i], (uint32_t*)&cbData);
+  jsfSaveToFlash_finish(&cbData);
+  return true;
+}
+
+/// Remove any blocks of the RAM image from 'block' onwards
+static void jsfEraseVarImageBlocks(uint32_t block) {
+  while (jsfEraseFile(jsfGetVarImageBlockName(block)))
+    block++;
+}
+
+/// Write all blocks of the RAM image, with 'blockVars' JsVars per block. Returns false if there wasn't space
+static bool jsfSaveVarImageBlocks(uint32_t blockVars, unsigned char *buffer, uint32_t *changedBlocks) {
+  uint32_t varCount = jsvGetMemoryTotal();
+  unsigned char* varPtr = (unsigned char *)_jsvGetAddressOf(1);
+  uint32_t blockSize = blockVars * (uint32_t)sizeof(JsVar);
+  uint32_t blockCount = (varCount + blockVars - 1) / blockVars;
+  *changedBlocks = 0;
+  for (uint32_t block=0;block<blockCount;block++) {
+    uint32_t len = blockSize;
+    if (block==blockCount-1)
+      len = (varCount - block*blockVars) * (uint32_t)sizeof(JsVar);
+    bool changed;
+    if (!jsfSaveVarImageBlock(block, varPtr + block*blockSize, len, buffer, &changed))
+      return false;
+    if (changed) {
+      (*changedBlocks)++;
+      jsiConsolePrint(".");
+    }
+    jshKickWatchDog();
+  }
+  return true;
+}
+#endif
+
 /// Save the RAM image to flash (this is the actual interpreter state)
 void jsfSaveToFlash() {
 #ifdef ESPR_NO_VARIMAGE
   jsiConsolePrint("Not implemented in this build\n");
 #else
-  unsigned int varSize = jsvGetMemoryTotal() * (unsigned int)sizeof(JsVar);
-  unsigned char* varPtr = (unsigned char *)_jsvGetAddressOf(1);
-
-  jsiConsolePrint("Compacting Flash...\n");
   JsfFileName name = jsfNameFromString(SAVED_CODE_VARIMAGE);
-  // Ensure we get rid of any saved code we had before
-  jsfEraseFile(name);
-  // Try and compact, just to ensure we get the maximum amount saved
-  jsfCompact();
-  jsiConsolePrint("Calculating Size...\n");
-  // Work out how much data this'll take, plus 4 bytes for build hash
-  uint32_t compressedSize = 4 + COMPRESS(varPtr, varSize, NULL, NULL);
-  // How much data do we have?
-  uint32_t savedCodeAddr = jsfCreateFile(name, compressedSize, JSFF_COMPRESSED, NULL);
-  if (!savedCodeAddr) {
-    jsiConsolePrintf("ERROR: Too big to save to flash (%d vs %d bytes)\n", compressedSize, jsfGetStorageStats(0,true).free);
+  JsfVarImageIndex index;
+  index.buildHash = getBuildHash();
+  index.varCount = jsvGetMemoryTotal();
+  // Use the biggest block size we have stack for
+  index.blockVars = JSF_VARIMAGE_BLOCK_VARS;
+  while (index.blockVars*sizeof(JsVar)+256 > jsuGetFreeStack() &&
+         index.blockVars > JSF_VARIMAGE_MIN_BLOCK_VARS)
+    index.blockVars >>= 1;
+  uint32_t blockSize = index.blockVars * (uint32_t)sizeof(JsVar);
+  if (blockSize+256 > jsuGetFreeStack()) {
+    jsiConsolePrint("Not enough free stack to save\n");
+    return;
+  }
+  index.blockCount = (index.varCount + index.blockVars - 1) / index.blockVars;
+  unsigned char *buffer = alloca(blockSize);
+  /* If the last image was saved with the same layout we can keep any blocks
+  that haven't changed. Remove the index first, so if we're interrupted we
+  don't try and load a half-written image. */
+  JsfFileHeader header;
+  uint32_t indexAddr = jsfFindFile(name, &header);
+  if (indexAddr) {
+    JsfVarImageIndex oldIndex;
+    memset(&oldIndex, 0, sizeof(oldIndex));
+    if (jsfGetFileSize(&header) >= sizeof(JsfVarImageIndex))
+      jshFlashRead(&oldIndex, indexAddr, sizeof(JsfVarImageIndex));
+    jsfEraseFile(name);
+    if (oldIndex.buildHash != index.buildHash ||
+        oldIndex.varCount != index.varCount ||
+        oldIndex.blockVars != index.blockVars)
+      jsfEraseVarImageBlocks(0); // different layout - can't reuse anything
+  }
+  jsiConsolePrint("Writing..");
+  uint32_t changedBlocks;
+  bool ok = jsfSaveVarImageBlocks(index.blockVars, buffer, &changedBlocks);
+  if (!ok) {
+    jsfEraseVarImageBlocks(0);
+    jsiConsolePrintf("\nERROR: Too big to save to flash (%d bytes free)\n", jsfGetStorageStats(0,true).free);
     jsvSoftInit();
     jspSoftInit();
     jsiConsolePrint("Deleting command history and trying again...\n");
     while (jsiFreeMoreMemory());
     jspSoftKill();
     jsvSoftKill();
-    compressedSize = 4 + COMPRESS(varPtr, varSize, NULL, NULL);
-    savedCodeAddr = jsfCreateFile(name, compressedSize, JSFF_COMPRESSED, NULL);
+    ok = jsfSaveVarImageBlocks(index.blockVars, buffer, &changedBlocks);
   }
-  if (!savedCodeAddr) {
+  // Finally write the index, which makes the image valid
+  if (ok) {
+    indexAddr = jsfCreateFile(name, sizeof(JsfVarImageIndex), JSFF_NONE, NULL);
+    ok = indexAddr!=0;
+  }
+  if (!ok) {
+    jsfEraseVarImageBlocks(0);
     if (jsfGetStorageStats(JSF_DEFAULT_START_ADDRESS, true).fileBytes)
-      jsiConsolePrint("Not enough free space to save. Try require('Storage').eraseAll()\n");
+      jsiConsolePrint("\nNot enough free space to save. Try require('Storage').eraseAll()\n");
     else
-      jsiConsolePrint("Code is too big to save to Flash.\n");
+      jsiConsolePrint("\nCode is too big to save to Flash.\n");
     return;
   }
-  // Ok, we have space!
-  // Now start writing
-  jsfcbData cbData;
-  memset(&cbData, 0, sizeof(cbData));
-  cbData.address = savedCodeAddr;
-  cbData.endAddress = jsfAlignAddress(savedCodeAddr+compressedSize);
-  jsiConsolePrint("Writing..");
-  // write the hash
-  uint32_t hash = getBuildHash();
-  int i;
-  for (i=0;i<4;i++)
-    jsfSaveToFlash_writecb(((unsigned char*)&hash)[i], (uint32_t*)&cbData);
-  // write compressed data
-  COMPRESS(varPtr, varSize, jsfSaveToFlash_writecb, (uint32_t*)&cbData);
-  jsfSaveToFlash_finish(&cbData);
-  jsiConsolePrintf("\nCompressed %d bytes to %d\n", varSize, compressedSize);
+  jshFlashWriteAligned(&index, indexAddr, sizeof(JsfVarImageIndex));
+  jsfEraseVarImageBlocks(index.blockCount); // remove any blocks left over from a bigger image
+  jsiConsolePrintf("\nWrote %d of %d blocks\n", changedBlocks, index.blockCount);
 #endif
 }
 
@@ -1260,29 +1887,45 @@ void jsfSaveToFlash() {
 void jsfLoadStateFromFlash() {
 #ifndef ESPR_NO_VARIMAGE
   JsfFileHeader header;
-  uint32_t savedCode = jsfFindFile(jsfNameFromString(SAVED_CODE_VARIMAGE),&header);
-  if (!savedCode) {
+  uint32_t indexAddr = jsfFindFile(jsfNameFromString(SAVED_CODE_VARIMAGE),&header);
+  if (!indexAddr || jsfGetFileSize(&header) < sizeof(JsfVarImageIndex)) {
     return;
   }
-
-  //  unsigned int dataSize = jsvGetMemoryTotal() * sizeof(JsVar);
-  unsigned char* varPtr = (unsigned char *)_jsvGetAddressOf(1);
-
-  jsfcbData cbData;
-  memset(&cbData, 0, sizeof(cbData));
-  cbData.address = savedCode;
-  cbData.endAddress = savedCode+jsfGetFileSize(&header);
-
-  uint32_t hash;
-  int i;
-  for (i=0;i<4;i++)
-    ((char*)&hash)[i] = (char)jsfLoadFromFlash_readcb((uint32_t*)&cbData);
-  if (hash != getBuildHash()) {
+  JsfVarImageIndex index;
+  jshFlashRead(&index, indexAddr, sizeof(JsfVarImageIndex));
+  if (index.buildHash != getBuildHash()) {
     jsiConsolePrintf("Not loading saved code from different Espruino firmware.\n");
     return;
   }
-  jsiConsolePrintf("Loading %d bytes from flash...\n", jsfGetFileSize(&header));
-  DECOMPRESS(jsfLoadFromFlash_readcb, (uint32_t*)&cbData, varPtr);
+  if (index.varCount != jsvGetMemoryTotal() || !index.blockVars) {
+    jsiConsolePrintf("Not loading saved code with different amount of variables.\n");
+    return;
+  }
+  // Check all blocks are there before we overwrite anything
+  for (uint32_t block=0;block<index.blockCount;block++) {
+    if (!jsfFindFile(jsfGetVarImageBlockName(block), NULL)) {
+      jsiConsolePrintf("Saved code is incomplete - not loading.\n");
+      return;
+    }
+  }
+  jsiConsolePrintf("Loading %d blocks from flash...\n", index.blockCount);
+  unsigned char* varPtr = (unsigned char *)_jsvGetAddressOf(1);
+  uint32_t blockSize = index.blockVars * (uint32_t)sizeof(JsVar);
+  for (uint32_t block=0;block<index.blockCount;block++) {
+    uint32_t addr = jsfFindFile(jsfGetVarImageBlockName(block), &header);
+    uint32_t size = jsfGetFileSize(&header);
+    if (size < 4) continue;
+    unsigned char *blockPtr = varPtr + block*blockSize;
+    if (jsfGetFileFlags(&header) & JSFF_COMPRESSED) {
+      jsfcbData cbData;
+      memset(&cbData, 0, sizeof(cbData));
+      cbData.address = addr + 4; // skip hash
+      cbData.endAddress = addr + size;
+      DECOMPRESS(jsfLoadFromFlash_readcb, (uint32_t*)&cbData, blockPtr);
+    } else {
+      jshFlashRead(blockPtr, addr + 4, size - 4);
+    }
+  }
 #endif
 }
 
@@ -1336,6 +1979,7 @@ void jsfRemoveCodeFromFlash() {
   jsiConsolePrint("Erasing saved code.");
 #ifndef ESPR_NO_VARIMAGE
   jsfEraseFile(jsfNameFromString(SAVED_CODE_VARIMAGE));
+  jsfEraseVarImageBlocks(0);
 #endif
   jsfEraseFile(jsfNameFromString(SAVED_CODE_BOOTCODE));
   jsfEraseFile(jsfNameFromString(SAVED_CODE_BOOTCODE_RESET));
@@ -1360,6 +2004,7 @@ void jsfResetStorage() {
 #ifdef ESPR_STORAGE_FILENAME_TABLE
 /// Create a lookup table for filenames. On success return file's address
 static uint32_t jsfBankCreateFileTable(uint32_t startAddr) {
+  if (startAddr != JSF_START_ADDRESS || jsfFilenameTableBuilding) return 0; // we only use a table for Bank 1
   JsfFileHeader header;
   memset(&header,0,sizeof(JsfFileHeader));
   uint32_t fileCount = 0;
@@ -1369,30 +2014,45 @@ static uint32_t jsfBankCreateFileTable(uint32_t startAddr) {
     if (jsfIsRealFile(&header)) fileCount++;
   } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL));
   jsDebug(DBG_INFO,"jsfBankCreateFileTable - %d files\n", fileCount);
-  // now write table
+  // remove the old table
   JsfFileName name = jsfNameFromString("[FILENAME_TABLE]");
-  uint32_t tableAddr = jsfFindFile(name, &header); // address of file data (not header)
-  if (tableAddr) jsfEraseFileInternal(tableAddr, &header, false);
-  uint32_t tableSize = fileCount * (uint32_t)sizeof(JsfFileHeader);
-  if (tableSize==0) return 0; // empty table
+  uint32_t tableAddr; // address of file data (not header)
+  if (jsfFilenameTableBank1Addr) { // the table isn't in itself, so jsfFindFile won't find it
+    tableAddr = jsfFilenameTableBank1Addr;
+    if (!jsfGetFileHeader(tableAddr - (uint32_t)sizeof(JsfFileHeader), &header, true)) tableAddr = 0;
+  } else
+    tableAddr = jsfFindFile(name, &header);
+  if (tableAddr) {
+    jsfCacheClearFile(name);
+    jsfEraseFileInternal(tableAddr, &header, false);
+  }
+  jsfFilenameTableReset();
+  if (fileCount==0) return 0; // empty table
+  // at least twice as many slots as files (so probes stay short and there's room to add more)
+  uint32_t slotCount = JSF_FILENAME_TABLE_MIN_SLOTS;
+  while (slotCount < fileCount*2) slotCount <<= 1;
+  uint32_t tableSize = (uint32_t)sizeof(JsfFilenameTableHeader) + slotCount*(uint32_t)sizeof(JsfFilenameTableSlot);
+  jsfFilenameTableBuilding = true;
   tableAddr = jsfCreateFile(name, tableSize, JSFF_FILENAME_TABLE, &header);
+  jsfFilenameTableBuilding = false;
   if (!tableAddr) return 0; // couldn't create file
-  // Now rescan files and write into file
+  jsfCacheClearFile(name); // we don't want to find this with jsfFindFile
+  JsfFilenameTableHeader tableHeader;
+  memset(&tableHeader, 0xFF, sizeof(tableHeader));
+  tableHeader.magic = JSF_FILENAME_TABLE_MAGIC;
+  tableHeader.slotCount = slotCount;
+  jshFlashWriteAligned(&tableHeader, tableAddr, sizeof(JsfFilenameTableHeader));
+  jsfFilenameTableBank1Addr = tableAddr;
+  jsfFilenameTableBank1Size = tableSize;
+  jsfFilenameTableBank1Slots = slotCount;
+  jsfFilenameTableBank1Used = 0;
+  // Now rescan files and add them to the table
   addr = startAddr;
-  uint32_t writeAddr = tableAddr;
   if (jsfGetFileHeader(addr, &header, true)) do {
-    if (jsfIsRealFile(&header)) {
-      JsfFileHeader filenameTableHeader = header;
-      filenameTableHeader.size = addr - startAddr; // write file address into file
-      jshFlashWriteAligned(&filenameTableHeader, writeAddr, sizeof(JsfFileHeader));
-      writeAddr += (uint32_t)sizeof(JsfFileHeader);
-    }
+    if (jsfIsRealFile(&header))
+      jsfFilenameTableAdd(addr, &header.name);
   } while (jsfGetNextFileHeader(&addr, &header, GNFH_GET_ALL));
-  if (startAddr == JSF_START_ADDRESS) {
-    jsfFilenameTableBank1Addr = tableAddr;
-    jsfFilenameTableBank1Size = tableSize;
-  }
-  return tableAddr;
+  return jsfFilenameTableBank1Addr;
 }
 
 /// Create a lookup table for files - this speeds up file access
@@ -44,7 +44,9 @@ typedef struct {
 typedef enum {
   JSFF_NONE,              ///< A normal file
 #ifndef SAVE_ON_FLASH
-  JSFF_FILENAME_TABLE = 32,        ///< A file that contains a list of JsfFileHeader structs with 'size' pointing to the file addresses at the time it was created
+  JSFF_LOGFILE = 8,                ///< A page of a log StorageFile - a ring of fixed size pages (Storage.open with {log:true})
+  JSFF_COMPACTING = 16,            ///< A deleted file that fills the gap left by a background compaction that hasn't finished yet (or is its journal)
+  JSFF_FILENAME_TABLE = 32,        ///< A file that contains a hash table of filenames and file addresses, updated as files are added
 #endif
   JSFF_STORAGEFILE = 64,  ///< This file is a 'storage file' created by Storage.open
   JSFF_COMPRESSED = 128   ///< This file contains compressed data (used only for .varimg currently)
@@ -80,6 +82,20 @@ bool jsfEraseFile(JsfFileName name);
 bool jsfEraseAll();
 /// Try and compact saved data so it'll fit in Flash again
 bool jsfCompact();
+#ifndef SAVE_ON_FLASH
+typedef enum {
+  JSFCS_NONE,   ///< Not compacting
+  JSFCS_BUSY,   ///< Still compacting
+  JSFCS_DONE,   ///< Compaction has just finished
+  JSFCS_FAILED, ///< Compaction has just failed (not enough free space for the journal)
+} JsfCompactStatus;
+/// Start compacting Storage a bit at a time from jsfCompactBackgroundIdle. Storage can still be used normally in between
+void jsfCompactBackgroundStart();
+/// Are we compacting in the background?
+bool jsfCompactBackgroundIsActive();
+/// Do a little more background compaction (called when idle)
+JsfCompactStatus jsfCompactBackgroundIdle();
+#endif
 /** Return all files in flash as a JsVar array of names. If regex is supplied, it is used to filter the filenames using String.match(regexp)
  * If containing!=0, file flags must contain one of the 'containing' argument's bits.
  * Flags can't contain any bits in the 'notContaining' argument
@@ -98,7 +114,7 @@ typedef enum {
   JSFSTT_NORMAL,   ///< Just files, or all space if storage empty
   JSFSTT_ALL,      ///< all space, including empty space
   JSFSTT_TYPE_MASK = 7,
-  JSFSTT_FIND_FILENAME_TABLE = 128, ///< When we scan, should we also update our link to the FILENAME_TABLE
+  JSFSTT_FIND_FILENAME_TABLE = 128, ///< When we scan, should we also update our link to the FILENAME_TABLE (and finish any background compaction step we were reset during)
 } JsfStorageTestType;
 /** Return false if the current storage is not valid
  * or is corrupt somehow. Basically that means if
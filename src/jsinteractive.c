@@ -58,6 +58,10 @@ typedef enum {
 
 JsVar *events = 0; // Array of events to execute
 JsVarRef timerArray = 0; // Linked List of timers to check and run
+static JsVarRef timerHeap = 0; // Flat string containing a JsiTimerHeap (see jsiTimerHeapRebuild)
+static unsigned int timerHeapPass = 0; // Incremented each time we check timers in jsiIdle
+static unsigned int timerLinearPass = 0; // timerHeapPass when timerLinearLastId was set
+static JsVarInt timerLinearLastId = -1; // If there's no heap, the last timer we ran this pass (see jsiTimerGetNextLinear)
 JsVarRef watchArray = 0; // Linked List of input watches to check and run
 // ----------------------------------------------------------------------------
 IOEventFlags consoleDevice = DEFAULT_CONSOLE_DEVICE; ///< The console device for user interaction
@@ -434,6 +438,206 @@ static JsVarRef _jsiInitNamedArray(const char *name) {
   return arrayRef;
 }
 
+/* Timers in timerArray have an absolute 'time' they should fire at. So we don't
+ * have to look at every timer each time around the idle loop we also keep a binary
+ * min-heap of (time,id) in a flat string, so the next timer is always the first
+ * element. Entries aren't removed when a timer is cleared or changed - they're
+ * just ignored when they get to the top and the timer's time no longer matches. */
+typedef struct {
+  JsSysTime time; ///< Absolute time the timer should fire at
+  JsVarInt id; ///< The timer's index in timerArray
+  unsigned int pass; ///< timerHeapPass when this was added - so intervals that are rescheduled don't run twice in one go
+} JsiTimerHeapEntry;
+
+typedef struct {
+  unsigned int count; ///< Amount of entries used
+  unsigned int size; ///< Amount of entries there is space for
+} JsiTimerHeap; // followed by JsiTimerHeapEntry[size]
+
+static ALWAYS_INLINE JsiTimerHeapEntry *jsiTimerHeapEntries(JsiTimerHeap *h) {
+  return (JsiTimerHeapEntry*)&h[1];
+}
+
+static bool jsiTimerHeapLess(const JsiTimerHeapEntry *a, const JsiTimerHeapEntry *b) {
+  // timers with the same time run in the order they were added
+  return a->time < b->time || (a->time == b->time && a->id < b->id);
+}
+
+static void jsiTimerHeapPush(JsiTimerHeap *h, JsVarInt id, JsSysTime time) {
+  JsiTimerHeapEntry *e = jsiTimerHeapEntries(h);
+  JsiTimerHeapEntry n;
+  n.time = time;
+  n.id = id;
+  n.pass = timerHeapPass;
+  unsigned int i = h->count++;
+  while (i) {
+    unsigned int parent = (i-1)>>1;
+    if (!jsiTimerHeapLess(&n, &e[parent])) break;
+    e[i] = e[parent];
+    i = parent;
+  }
+  e[i] = n;
+}
+
+static void jsiTimerHeapPop(JsiTimerHeap *h) {
+  JsiTimerHeapEntry *e = jsiTimerHeapEntries(h);
+  JsiTimerHeapEntry last = e[--h->count];
+  unsigned int i = 0;
+  while (true) {
+    unsigned int child = i*2+1;
+    if (child >= h->count) break;
+    if (child+1 < h->count && jsiTimerHeapLess(&e[child+1], &e[child])) child++;
+    if (!jsiTimerHeapLess(&e[child], &last)) break;
+    e[i] = e[child];
+    i = child;
+  }
+  e[i] = last;
+}
+
+/// Create a new timer heap from what's in timerArray. If we're out of memory JSIS_TIMERS_CHANGED is left set so we try again next time
+static void jsiTimerHeapRebuild() {
+  jsiStatus |= JSIS_TIMERS_CHANGED;
+  if (!timerArray) return;
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  // leave space for as many timers again, so we don't have to rebuild often
+  unsigned int size = (unsigned int)jsvGetChildren(timerArrayPtr)*2 + 4;
+  JsVar *heapVar = jsvNewFlatStringOfLength((unsigned int)(sizeof(JsiTimerHeap) + size*sizeof(JsiTimerHeapEntry)));
+  if (!heapVar) {
+    // remove the old one to give us a better chance of allocating next time
+    jsvObjectRemoveChild(execInfo.hiddenRoot, JSI_TIMER_HEAP_NAME);
+    timerHeap = 0;
+    jsvUnLock(timerArrayPtr);
+    return;
+  }
+  JsiTimerHeap *h = (JsiTimerHeap*)jsvGetFlatStringPointer(heapVar);
+  h->count = 0;
+  h->size = size;
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it) && h->count<h->size) {
+    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
+    JsVarInt id = jsvGetIntegerAndUnLock(jsvObjectIteratorGetKey(&it));
+    jsiTimerHeapPush(h, id, (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0)));
+    jsvUnLock(timerPtr);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(timerArrayPtr);
+  jsvObjectSetChild(execInfo.hiddenRoot, JSI_TIMER_HEAP_NAME, heapVar);
+  timerHeap = jsvGetRef(heapVar);
+  jsvUnLock(heapVar);
+  jsiStatus &= ~JSIS_TIMERS_CHANGED;
+}
+
+/// Add the timer with the given index in timerArray to the heap
+static void jsiTimerHeapAdd(JsVarInt id, JsSysTime time) {
+  if (jsiStatus & JSIS_TIMERS_CHANGED) return; // we'll rebuild the heap anyway
+  bool full = true;
+  if (timerHeap) {
+    JsVar *heapVar = jsvLock(timerHeap);
+    JsiTimerHeap *h = (JsiTimerHeap*)jsvGetFlatStringPointer(heapVar);
+    if (h->count < h->size) jsiTimerHeapPush(h, id, time);
+    full = h->count == h->size;
+    jsvUnLock(heapVar);
+  }
+  // If it's full, rebuild it from timerArray - this also removes entries for old timers
+  if (full) jsiTimerHeapRebuild();
+}
+
+/** If we couldn't allocate a timer heap, look through all of timerArray for the next timer to
+ * execute (see jsiTimerHeapGetNext). Due timers run in the order they were added, each at most once per pass */
+static JsVar *jsiTimerGetNextLinear(JsVar *timerArrayPtr, JsVar **timerName, JsVarInt *id, JsSysTime *nextTime) {
+  if (timerLinearPass != timerHeapPass) {
+    timerLinearPass = timerHeapPass;
+    timerLinearLastId = -1;
+  }
+  JsVar *timerPtr = 0;
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *name = jsvObjectIteratorGetKey(&it);
+    JsVar *timer = jsvSkipName(name);
+    JsVarInt timerId = jsvGetInteger(name);
+    JsSysTime time = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timer, "time", 0));
+    if (time <= jsiLastIdleTime && timerId > timerLinearLastId) {
+      timerLinearLastId = timerId;
+      *timerName = name;
+      *id = timerId;
+      *nextTime = time;
+      timerPtr = timer;
+      break;
+    }
+    if (time < *nextTime) *nextTime = time;
+    jsvUnLock2(timer, name);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  return timerPtr;
+}
+
+/** Get the next timer that should be executed this time around the idle loop (or 0),
+ * and remove it from the heap. timerName is set to its (locked) name in timerArray so
+ * we only have to look it up once. nextTime is set to the time of the next timer */
+static JsVar *jsiTimerHeapGetNext(JsVar *timerArrayPtr, JsVar **timerName, JsVarInt *id, JsSysTime *nextTime) {
+  *nextTime = JSSYSTIME_MAX;
+  *timerName = 0;
+  if (jsiStatus & JSIS_TIMERS_CHANGED) jsiTimerHeapRebuild();
+  if (!timerHeap) // out of memory - do it the slow way so timers still run
+    return jsiTimerGetNextLinear(timerArrayPtr, timerName, id, nextTime);
+  JsVar *heapVar = jsvLock(timerHeap);
+  JsiTimerHeap *h = (JsiTimerHeap*)jsvGetFlatStringPointer(heapVar);
+  JsiTimerHeapEntry *e = jsiTimerHeapEntries(h);
+  JsVar *timerPtr = 0;
+  while (h->count) {
+    JsVar *name = jsvGetArrayIndex(timerArrayPtr, e[0].id);
+    timerPtr = jsvSkipName(name);
+    if (timerPtr && (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0)) == e[0].time) {
+      *id = e[0].id;
+      *nextTime = e[0].time;
+      if (e[0].time <= jsiLastIdleTime && e[0].pass != timerHeapPass) {
+        jsiTimerHeapPop(h);
+        *timerName = name;
+      } else { // not time yet
+        jsvUnLock2(timerPtr, name);
+        timerPtr = 0;
+      }
+      break;
+    }
+    // timer was removed or its time was changed
+    jsvUnLock2(timerPtr, name);
+    timerPtr = 0;
+    jsiTimerHeapPop(h);
+  }
+  jsvUnLock(heapVar);
+  return timerPtr;
+}
+
+/// Add the given amount of time to all timers
+static void jsiTimersShift(JsSysTime diff) {
+  if (!timerArray) return;
+  JsVar *timerArrayPtr = jsvLock(timerArray);
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, timerArrayPtr);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
+    JsSysTime time = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0));
+    jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(time + diff));
+    jsvUnLock(timerPtr);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsvUnLock(timerArrayPtr);
+  // Everything moved by the same amount, so the order in the heap is still right
+  if (timerHeap) {
+    JsVar *heapVar = jsvLock(timerHeap);
+    JsiTimerHeap *h = (JsiTimerHeap*)jsvGetFlatStringPointer(heapVar);
+    JsiTimerHeapEntry *e = jsiTimerHeapEntries(h);
+    for (unsigned int i=0;i<h->count;i++)
+      e[i].time += diff;
+    jsvUnLock(heapVar);
+  }
+}
+
 // Used when recovering after being flashed
 // 'claim' anything we are using
 void jsiSoftInit(bool hasBeenReset) {
@@ -462,6 +666,9 @@ void jsiSoftInit(bool hasBeenReset) {
 #ifndef EMBEDDED
   jsiTimeSinceCtrlC = 0xFFFFFFFF;
 #endif
+  // Timer times are saved relative to when we saved, so make them absolute again
+  jsiTimersShift(jsiLastIdleTime);
+  jsiTimerHeapRebuild();
 
   // Set up interpreter flags and remove
   JsVar *flags = jsvObjectGetChild(execInfo.hiddenRoot, JSI_JSFLAGS_NAME, 0);
@@ -733,6 +940,10 @@ void jsiSoftKill() {
     events=0;
   }
   if (timerArray) {
+    // Save timer times relative to now, and remove the heap (it's rebuilt in jsiSoftInit)
+    jsiTimersShift(-jsiLastIdleTime);
+    jsvObjectRemoveChild(execInfo.hiddenRoot, JSI_TIMER_HEAP_NAME);
+    timerHeap = 0;
     jsvUnRefRef(timerArray);
     timerArray=0;
   }
@@ -951,12 +1162,25 @@ int jsiCountBracketsInInput() {
   return brackets;
 }
 
-/// Tries to get rid of some memory (by clearing command history). Returns true if it got rid of something, false if it didn't.
+/// Remove a cache from hiddenRoot. Returns true if there was one to remove
+static bool jsiFreeCache(const char *name) {
+  JsVar *cache = jsvObjectGetChild(execInfo.hiddenRoot, name, 0);
+  if (!cache) return false;
+  jsvUnLock(cache);
+  jsvObjectRemoveChild(execInfo.hiddenRoot, name);
+  return true;
+}
+
+/// Tries to get rid of some memory (by clearing caches and command history). Returns true if it got rid of something, false if it didn't.
 bool jsiFreeMoreMemory() {
 #ifdef USE_DEBUGGER
   // remove debug history first
   jsvObjectRemoveChild(execInfo.hiddenRoot, JSI_DEBUG_HISTORY_NAME);
 #endif
+  // caches can just be recreated when they're next needed
+  if (jsiFreeCache(JS_REGEXP_CACHE_VAR)) return true;
+  if (jsiFreeCache(JS_FFT_TWIDDLE_VAR)) return true;
+  if (jsiFreeCache(JS_GRAPHICS_GLYPH_CACHE_VAR)) return true;
   // delete history one item at a time
   JsVar *history = jsvObjectGetChild(execInfo.hiddenRoot, JSI_HISTORY_NAME, 0);
   if (!history) return 0;
@@ -1984,8 +2208,12 @@ void jsiIdle() {
             bool oldWatchState = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr, "state",0));
             JsVar *timeout = jsvObjectGetChild(watchPtr, "timeout", 0);
             if (timeout) { // if we had a timeout, update the callback time
-              JsSysTime timeoutTime = jsiLastIdleTime + (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timeout, "time", 0));
-              jsvUnLock(jsvObjectSetChild(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce)));
+              JsSysTime timeoutTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timeout, "time", 0));
+              JsVar *timerArrayPtr = jsvLock(timerArray);
+              JsVar *timeoutName = jsvGetIndexOf(timerArrayPtr, timeout, true);
+              if (timeoutName)
+                jsiTimerSetTime(jsvGetInteger(timeoutName), timeout, eventTime + debounce);
+              jsvUnLock2(timeoutName, timerArrayPtr);
               jsvObjectSetChildAndUnLock(timeout, "state", jsvNewFromBool(pinIsHigh));
               if (eventTime > timeoutTime && pinIsHigh!=oldWatchState) {
                 // timeout should have fired, but we didn't get around to executing it!
@@ -2003,7 +2231,7 @@ void jsiIdle() {
               timeout = jsvNewObject();
               if (timeout) {
                 jsvObjectSetChild(timeout, "watch", watchPtr); // no unlock
-                jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger((JsSysTime)(eventTime - jsiLastIdleTime) + debounce));
+                jsvObjectSetChildAndUnLock(timeout, "time", jsvNewFromLongInteger(eventTime + debounce));
                 jsvObjectSetChildAndUnLock(timeout, "callback", jsvObjectGetChild(watchPtr, "callback", 0));
                 jsvObjectSetChildAndUnLock(timeout, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
                 jsvObjectSetChildAndUnLock(timeout, "pin", jsvNewFromPin(pin));
@@ -2080,133 +2308,110 @@ void jsiIdle() {
     jsiTimeSinceCtrlC = 0xFFFFFFFF;
 #endif
 
+  // Execute any timers that are due, in the order they're due
+  timerHeapPass++;
   JsVar *timerArrayPtr = jsvLock(timerArray);
-  JsvObjectIterator it;
-  // Go through all intervals and decrement time
-  jsvObjectIteratorNew(&it, timerArrayPtr);
-  while (jsvObjectIteratorHasValue(&it)) {
-    JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
-    JsSysTime timerTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0));
-    JsSysTime timeUntilNext = timerTime - timePassed;
-    jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(timeUntilNext));
-    jsvUnLock(timerPtr);
-    jsvObjectIteratorNext(&it);
-  }
-  jsvObjectIteratorFree(&it);
-  // Now go through intervals and execute if needed
-  do {
-    jsiStatus = jsiStatus & ~JSIS_TIMERS_CHANGED;
-    jsvObjectIteratorNew(&it, timerArrayPtr);
-    while (jsvObjectIteratorHasValue(&it) && !(jsiStatus & JSIS_TIMERS_CHANGED)) {
-      bool hasDeletedTimer = false;
-      JsVar *timerPtr = jsvObjectIteratorGetValue(&it);
-      JsSysTime timerTime = (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0));
-      if (timerTime<=0) {
-        // we're now doing work
-        jsiSetBusy(BUSY_INTERACTIVE, true);
-        wasBusy = true;
-        JsVar *timerCallback = jsvObjectGetChild(timerPtr, "callback", 0);
-        JsVar *watchPtr = jsvObjectGetChild(timerPtr, "watch", 0); // for debounce - may be undefined
-        bool exec = true;
-        JsVar *data = 0;
-        if (watchPtr) {
-          bool watchState = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr, "state", 0));
-          bool timerState = jsvGetBoolAndUnLock(jsvObjectGetChild(timerPtr, "state", 0));
-          jsvObjectSetChildAndUnLock(watchPtr, "state", jsvNewFromBool(timerState));
-          exec = false;
-          if (watchState!=timerState) {
-            // Create the 'time' variable that will be passed to the user and stored as last time
-            JsVarInt delay = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
-            JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(jsiLastIdleTime+timerTime-delay)/1000);
-            // If it's the right edge...
-            if (jsiShouldExecuteWatch(watchPtr, timerState)) {
-              data = jsvNewObject();
-              // if we were from a watch then we were delayed by the debounce time...
-              if (data) {
-                exec = true;
-                // if it was a watch, set the last state up
-                jsvObjectSetChildAndUnLock(data, "state", jsvNewFromBool(timerState));
-                // set up the lastTime variable of data to what was in the watch
-                jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
-                // set up the watches lastTime to this one
-                jsvObjectSetChild(data, "time", timePtr); // don't unlock - use this later
-                jsvObjectSetChildAndUnLock(data, "pin", jsvObjectGetChild(watchPtr, "pin", 0));
-              }
-            }
-            // Update lastTime regardless of which edge we're watching
-            jsvObjectSetChildAndUnLock(watchPtr, "lastTime", timePtr);
-          }
-        }
-        bool removeTimer = false;
-        if (exec) {
-          bool execResult;
+  JsVarInt timerId;
+  JsSysTime timerTime;
+  JsVar *timerPtr, *timerName;
+  while ((timerPtr = jsiTimerHeapGetNext(timerArrayPtr, &timerName, &timerId, &timerTime))) {
+    // we're now doing work
+    jsiSetBusy(BUSY_INTERACTIVE, true);
+    wasBusy = true;
+    JsVar *timerCallback = jsvObjectGetChild(timerPtr, "callback", 0);
+    JsVar *watchPtr = jsvObjectGetChild(timerPtr, "watch", 0); // for debounce - may be undefined
+    bool exec = true;
+    JsVar *data = 0;
+    if (watchPtr) {
+      bool watchState = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr, "state", 0));
+      bool timerState = jsvGetBoolAndUnLock(jsvObjectGetChild(timerPtr, "state", 0));
+      jsvObjectSetChildAndUnLock(watchPtr, "state", jsvNewFromBool(timerState));
+      exec = false;
+      if (watchState!=timerState) {
+        // Create the 'time' variable that will be passed to the user and stored as last time
+        JsVarInt delay = jsvGetIntegerAndUnLock(jsvObjectGetChild(watchPtr, "debounce", 0));
+        JsVar *timePtr = jsvNewFromFloat(jshGetMillisecondsFromTime(timerTime-delay)/1000);
+        // If it's the right edge...
+        if (jsiShouldExecuteWatch(watchPtr, timerState)) {
+          data = jsvNewObject();
+          // if we were from a watch then we were delayed by the debounce time...
           if (data) {
-            execResult = jsiExecuteEventCallback(0, timerCallback, 1, &data);
-          } else {
-            JsVar *argsArray = jsvObjectGetChild(timerPtr, "args", 0);
-            execResult = jsiExecuteEventCallbackArgsArray(0, timerCallback, argsArray);
-            jsvUnLock(argsArray);
-          }
-          if (!execResult) {
-            JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
-            if (interval) { // if interval then it's setInterval not setTimeout
-              jsvUnLock(interval);
-              jsError("Ctrl-C while processing interval - removing it.");
-              jsErrorFlags |= JSERR_CALLBACK;
-              removeTimer = true;
-            }
-          }
-        }
-        jsvUnLock(data);
-        if (watchPtr) { // if we had a watch pointer, be sure to remove us from it
-          jsvObjectRemoveChild(watchPtr, "timeout");
-          // Deal with non-recurring watches
-          if (exec) {
-            bool watchRecurring = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr,  "recur", 0));
-            if (!watchRecurring) {
-              JsVar *watchArrayPtr = jsvLock(watchArray);
-              JsVar *watchNamePtr = jsvGetIndexOf(watchArrayPtr, watchPtr, true);
-              if (watchNamePtr) {
-                jsvRemoveChild(watchArrayPtr, watchNamePtr);
-                jsvUnLock(watchNamePtr);
-              }
-              jsvUnLock(watchArrayPtr);
-              Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
-              if (!jsiIsWatchingPin(pin))
-                jshPinWatch(pin, false, JSPW_NONE);
-            }
+            exec = true;
+            // if it was a watch, set the last state up
+            jsvObjectSetChildAndUnLock(data, "state", jsvNewFromBool(timerState));
+            // set up the lastTime variable of data to what was in the watch
+            jsvObjectSetChildAndUnLock(data, "lastTime", jsvObjectGetChild(watchPtr, "lastTime", 0));
+            // set up the watches lastTime to this one
+            jsvObjectSetChild(data, "time", timePtr); // don't unlock - use this later
+            jsvObjectSetChildAndUnLock(data, "pin", jsvObjectGetChild(watchPtr, "pin", 0));
           }
-          jsvUnLock(watchPtr);
         }
-        // Load interval *after* executing code, in case it has changed
+        // Update lastTime regardless of which edge we're watching
+        jsvObjectSetChildAndUnLock(watchPtr, "lastTime", timePtr);
+      }
+    }
+    bool removeTimer = false;
+    if (exec) {
+      bool execResult;
+      if (data) {
+        execResult = jsiExecuteEventCallback(0, timerCallback, 1, &data);
+      } else {
+        JsVar *argsArray = jsvObjectGetChild(timerPtr, "args", 0);
+        execResult = jsiExecuteEventCallbackArgsArray(0, timerCallback, argsArray);
+        jsvUnLock(argsArray);
+      }
+      if (!execResult) {
         JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
-        if (!removeTimer && interval) {
-          timerTime = timerTime + jsvGetLongInteger(interval);
-          jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(timerTime));
-        } else {
-          // free
-          // Beware... may have already been removed!
-          jsvObjectIteratorRemoveAndGotoNext(&it, timerArrayPtr);
-          hasDeletedTimer = true;
-          timerTime = -1;
+        if (interval) { // if interval then it's setInterval not setTimeout
+          jsvUnLock(interval);
+          jsError("Ctrl-C while processing interval - removing it.");
+          jsErrorFlags |= JSERR_CALLBACK;
+          removeTimer = true;
         }
-        jsvUnLock2(timerCallback,interval);
       }
-      // update the time until the next timer
-      if (timerTime>=0 && timerTime < minTimeUntilNext)
-        minTimeUntilNext = timerTime;
-      // update the timer's time
-      if (!hasDeletedTimer)
-        jsvObjectIteratorNext(&it);
-      jsvUnLock(timerPtr);
     }
-    jsvObjectIteratorFree(&it);
-  } while (jsiStatus & JSIS_TIMERS_CHANGED);
+    jsvUnLock(data);
+    if (watchPtr) { // if we had a watch pointer, be sure to remove us from it
+      jsvObjectRemoveChild(watchPtr, "timeout");
+      // Deal with non-recurring watches
+      if (exec) {
+        bool watchRecurring = jsvGetBoolAndUnLock(jsvObjectGetChild(watchPtr,  "recur", 0));
+        if (!watchRecurring) {
+          JsVar *watchArrayPtr = jsvLock(watchArray);
+          JsVar *watchNamePtr = jsvGetIndexOf(watchArrayPtr, watchPtr, true);
+          if (watchNamePtr) {
+            jsvRemoveChild(watchArrayPtr, watchNamePtr);
+            jsvUnLock(watchNamePtr);
+          }
+          jsvUnLock(watchArrayPtr);
+          Pin pin = jshGetPinFromVarAndUnLock(jsvObjectGetChild(watchPtr, "pin", 0));
+          if (!jsiIsWatchingPin(pin))
+            jshPinWatch(pin, false, JSPW_NONE);
+        }
+      }
+      jsvUnLock(watchPtr);
+    }
+    // Beware... the timer may have been removed (the name is no longer referenced by timerArray) or replaced by the code we executed!
+    if (jsvGetRefs(timerName) && jsvGetFirstChild(timerName)==jsvGetRef(timerPtr)) {
+      // Load interval *after* executing code, in case it has changed
+      JsVar *interval = jsvObjectGetChild(timerPtr, "interval", 0);
+      if (!removeTimer && interval) {
+        jsiTimerSetTime(timerId, timerPtr, timerTime + jsvGetLongInteger(interval));
+      } else {
+        jsvRemoveChild(timerArrayPtr, timerName);
+      }
+      jsvUnLock(interval);
+    }
+    jsvUnLock3(timerName, timerCallback, timerPtr);
+  }
   jsvUnLock(timerArrayPtr);
-  /* We might have left the timers loop with stuff to do because the contents of it
-   * changed. It's not a big deal because it could only have changed because a timer
-   * got executed - so `wasBusy` got set and we know we're going to go around the
-   * loop again before sleeping.
+  // work out the time until the next timer
+  if (timerTime != JSSYSTIME_MAX)
+    minTimeUntilNext = (timerTime > jsiLastIdleTime) ? timerTime - jsiLastIdleTime : 0;
+  /* We might have left the timers loop with timers still due (intervals that are
+   * running behind, or timers added while we were executing). It's not a big deal
+   * because that only happens when a timer got executed - so `wasBusy` got set
+   * and we know we're going to go around the loop again before sleeping.
    */
 
   // Check for events that might need to be processed from other libraries
@@ -2286,6 +2491,19 @@ void jsiIdle() {
   if (jsiStatus & JSIS_WATCHDOG_AUTO)
     jshKickWatchDog();
 
+#ifndef ESPR_NO_INCREMENTAL_GC
+  /* if we've been around this loop, there is nothing to do, and
+   * we have a spare slice of time then let's start some Garbage Collection
+   * if we think we need to. Once started, we do a slice each time around
+   * the loop so events don't have to wait for the whole collection. */
+  if (jsvGarbageCollectIncrementalInProgress() ||
+      (loopsIdling==1 &&
+       minTimeUntilNext > jshGetTimeFromMilliseconds(JSV_GC_SLICE_MILLISECONDS) &&
+       !jsvMoreFreeVariablesThan(JS_VARS_BEFORE_IDLE_GC))) {
+    jsiSetBusy(BUSY_INTERACTIVE, true);
+    jsvGarbageCollectIncremental(jshGetTimeFromMilliseconds(JSV_GC_SLICE_MILLISECONDS));
+    jsiSetBusy(BUSY_INTERACTIVE, false);
+#else
   /* if we've been around this loop, there is nothing to do, and
    * we have a spare 10ms then let's do some Garbage Collection
    * if we think we need to */
@@ -2295,6 +2513,7 @@ void jsiIdle() {
     jsiSetBusy(BUSY_INTERACTIVE, true);
     jsvGarbageCollect();
     jsiSetBusy(BUSY_INTERACTIVE, false);
+#endif
     /* Return here so we run around the idle loop again
      * and check whether any events came in during GC. If not
      * then we'll sleep. */
@@ -2424,7 +2643,7 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data) {
     JsVar *timerInterval = jsvObjectGetChild(timer, "interval", 0);
     user_callback(timerInterval ? "setInterval(" : "setTimeout(", user_data);
     jsiDumpJSON(user_callback, user_data, timerCallback, 0);
-    cbprintf(user_callback, user_data, ", %f); // %v\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timer, "time", 0))), timerNumber);
+    cbprintf(user_callback, user_data, ", %f); // %v\n", jshGetMillisecondsFromTime(timerInterval ? jsvGetLongInteger(timerInterval) : (jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timer, "time", 0)) - jsiLastIdleTime)), timerNumber);
     jsvUnLock3(timerInterval, timerCallback, timerNumber);
     // next
     jsvUnLock(timer);
@@ -2473,9 +2692,21 @@ JsVarInt jsiTimerAdd(JsVar *timerPtr) {
   JsVar *timerArrayPtr = jsvLock(timerArray);
   JsVarInt itemIndex = jsvArrayAddToEnd(timerArrayPtr, timerPtr, 1) - 1;
   jsvUnLock(timerArrayPtr);
+  jsiTimerHeapAdd(itemIndex, (JsSysTime)jsvGetLongIntegerAndUnLock(jsvObjectGetChild(timerPtr, "time", 0)));
   return itemIndex;
 }
 
+void jsiTimerSetTime(JsVarInt id, JsVar *timerPtr, JsSysTime time) {
+  jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(time));
+  jsiTimerHeapAdd(id, time);
+}
+
+void jsiTimersSystemTimeChanged(JsSysTime diff) {
+  // keep the same time until each timer fires
+  jsiTimersShift(diff);
+  jsiLastIdleTime += diff;
+}
+
 void jsiTimersChanged() {
   jsiStatus |= JSIS_TIMERS_CHANGED;
 }
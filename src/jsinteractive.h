@@ -19,6 +19,7 @@
 
 #define JSI_WATCHES_NAME "watches"
 #define JSI_TIMERS_NAME "timers"
+#define JSI_TIMER_HEAP_NAME "timerq" ///< heap of when timers are next due (see jsinteractive.c)
 #define JSI_DEBUG_HISTORY_NAME "dbghist"
 #define JSI_HISTORY_NAME "history"
 #define JSI_INIT_CODE_NAME "init" ///< used to temporarily store initialisation JS code for state in save()
@@ -146,7 +147,7 @@ typedef enum {
   JSIS_NONE,
   JSIS_ECHO_OFF           = 1<<0, ///< do we provide any user feedback? OFF=no
   JSIS_ECHO_OFF_FOR_LINE  = 1<<1, ///< Echo is off just for one line, then back on
-  JSIS_TIMERS_CHANGED     = 1<<2,
+  JSIS_TIMERS_CHANGED     = 1<<2, ///< The heap of timer times needs rebuilding from timerArray
 #ifdef USE_DEBUGGER
   JSIS_IN_DEBUGGER        = 1<<3, ///< We're inside the debug loop
   JSIS_EXIT_DEBUGGER      = 1<<4, ///< we've been asked to exit the debug loop
@@ -182,8 +183,10 @@ void jsiDumpState(vcbprintf_callback user_callback, void *user_data);
 extern JsVarRef timerArray; // Linked List of timers to check and run
 extern JsVarRef watchArray; // Linked List of input watches to check and run
 
-extern JsVarInt jsiTimerAdd(JsVar *timerPtr);
-extern void jsiTimersChanged(); // Flag timers changed so we can skip out of the loop if needed
+extern JsVarInt jsiTimerAdd(JsVar *timerPtr); ///< Add a timer (with an absolute 'time' to fire at) to timerArray, returns its index
+extern void jsiTimerSetTime(JsVarInt id, JsVar *timerPtr, JsSysTime time); ///< Set the absolute time a timer (already in timerArray) should fire at
+extern void jsiTimersSystemTimeChanged(JsSysTime diff); ///< The system time has been changed by diff - move timers so they fire after the same delay
+extern void jsiTimersChanged(); // Flag timers changed so we rebuild our list of when they're due
 // end for jswrap_interactive/io.c ------------------------------------------------
 
 #ifdef USE_DEBUGGER
@@ -17,6 +17,8 @@
 #include "jsjit.h"
 #include "jsjitc.h"
 #include "jsinteractive.h"
+#include "jsnative.h"
+#include "jswrap_functions.h"
 
 #define JSP_ASSERT_MATCH(TOKEN) { assert(lex->tk==(TOKEN));jslGetNextToken(); } // Match where if we have the wrong token, it's an internal error
 #define JSP_MATCH_WITH_RETURN(TOKEN, RETURN_VAL) if (!jslMatch((TOKEN))) return RETURN_VAL;
@@ -31,31 +33,291 @@ void jsjStatement();
 void jsjBlockOrStatement();
 // ----------------------------------------------------------------------------
 
+/* Local variables and arguments. Before compiling a function we scan it for
+ * arguments and var/let/const declarations, and give each one a slot in a
+ * stack frame that's allocated at the start of the function:
+ *
+ * * Arguments and most locals are NAMEs that aren't in any scope. They're locked
+ *   and referenced, so the normal code for assignment/++/etc works on them
+ * * Integer locals (only ever assigned integer literals) are stored as raw 32
+ *   bit ints, and only converted to a JsVar when needed. Locals changed with
+ *   ++/-- are NAMEs, as they can overflow and turn into floats
+ *
+ * NAMEs are in slots 0..jsjVarLocalCount-1 (arguments first) and ints follow */
+JsVar *jsjLocals = 0; ///< Local variable name -> JSJL_* flags while scanning, then (slot<<1)|isInt
+int jsjVarLocalCount = 0; ///< How many locals are stored as NAMEs
+int jsjLocalCount = 0; ///< How many locals there are in total (size of the stack frame)
+
+#define JSJL_ARG 1 ///< While scanning: this local is a function argument
+#define JSJL_NOT_INT 2 ///< While scanning: this local can't be stored as an int
+#define JSJL_SEEN 4 ///< While scanning: this local has been used already
+#define JSJ_MAX_LOCALS 64 ///< Maximum number of arguments+locals in a JIT function
+#define JSJ_MAX_ARGS 4 ///< Maximum number of arguments (they're all passed in registers)
+
+/// Get the information for a local variable (or -1 if it's not a local)
+static int jsjGetLocalInfo(const char *name) {
+  if (!jsjLocals) return -1;
+  JsVar *v = jsvObjectGetChild(jsjLocals, name, 0);
+  if (!v) return -1;
+  return (int)jsvGetIntegerAndUnLock(v);
+}
+
+static void jsjSetLocalInfo(const char *name, int info) {
+  jsvObjectSetChildAndUnLock(jsjLocals, name, jsvNewFromInteger(info));
+}
+
+/// Get the offset from SP of a local variable's slot right now
+static int jsjLocalOffset(int slot) {
+  return (jsjcGetStackDepth() - jsjLocalCount + slot) * JSJC_STACK_ITEM_SIZE;
+}
+
+/// Could this token be the end of an expression? (used to spot missing semicolons)
+static bool jsjIsOperandEnd(int tk) {
+  return tk==LEX_ID || tk==LEX_INT || tk==LEX_FLOAT || tk==LEX_STR ||
+         tk==LEX_TEMPLATE_LITERAL || tk==LEX_REGEX || tk==')' || tk==']' ||
+         tk==LEX_R_TRUE || tk==LEX_R_FALSE || tk==LEX_R_NULL ||
+         tk==LEX_R_UNDEFINED || tk==LEX_R_THIS;
+}
+
+/// Could this token be the start of a new statement after a missing semicolon?
+static bool jsjIsOperandStart(int tk) {
+  return tk==LEX_ID || tk==LEX_INT || tk==LEX_FLOAT || tk==LEX_STR ||
+         tk==LEX_TEMPLATE_LITERAL ||
+         (tk>=_LEX_R_LIST_START && tk<=_LEX_R_LIST_END);
+}
+
+static bool jsjIsCompoundAssignment(int tk) {
+  return tk==LEX_PLUSEQUAL || tk==LEX_MINUSEQUAL || tk==LEX_MULEQUAL ||
+         tk==LEX_DIVEQUAL || tk==LEX_MODEQUAL || tk==LEX_ANDEQUAL ||
+         tk==LEX_OREQUAL || tk==LEX_XOREQUAL || tk==LEX_LSHIFTEQUAL ||
+         tk==LEX_RSHIFTEQUAL || tk==LEX_RSHIFTUNSIGNEDEQUAL;
+}
+
+/// Scan to the end of the function, adding any var/let/const declarations to jsjLocals
+static void jsjScanDeclarations() {
+  int brackets = 0;
+  while (lex->tk!=LEX_EOF && (brackets || lex->tk!='}')) {
+    if (lex->tk==LEX_R_VAR || lex->tk==LEX_R_LET || lex->tk==LEX_R_CONST) {
+      jslGetNextToken();
+      int nesting = 0, lastTk = 0;
+      bool expectName = true;
+      while (lex->tk!=LEX_EOF) {
+        int tk = lex->tk;
+        if (nesting==0 && (tk==';' || tk==')' || tk=='}')) break;
+        if (nesting==0 && jsjIsOperandEnd(lastTk) && jsjIsOperandStart(tk)) break; // no semicolon
+        if (expectName && nesting==0 && tk==LEX_ID) {
+          const char *name = jslGetTokenValueAsString();
+          if (jsjGetLocalInfo(name)<0) jsjSetLocalInfo(name, 0);
+          expectName = false;
+        } else if (nesting==0 && tk==',') expectName = true;
+        else if (tk=='(' || tk=='[' || tk=='{') nesting++;
+        else if (tk==')' || tk==']' || tk=='}') nesting--;
+        lastTk = tk;
+        jslGetNextToken();
+      }
+      // the token that ended the declaration is handled as normal
+    } else {
+      if (lex->tk=='{') brackets++;
+      if (lex->tk=='}') brackets--;
+      jslGetNextToken();
+    }
+  }
+}
+
+/// Is the current token an integer literal that fits in 32 bits?
+static bool jsjIsInt32Literal(bool negate) {
+  if (lex->tk!=LEX_INT) return false;
+  long long v = stringToInt(jslGetTokenValueAsString());
+  return v <= (negate ? 0x80000000LL : 0x7FFFFFFFLL);
+}
+
+/// Scan to the end of the function, figuring out which locals can be stored as integers
+static void jsjScanUsage() {
+  int brackets = 0, lastTk = 0;
+  while (lex->tk!=LEX_EOF && (brackets || lex->tk!='}')) {
+    int tk = lex->tk;
+    int info = (tk==LEX_ID && lastTk!='.') ? jsjGetLocalInfo(jslGetTokenValueAsString()) : -1;
+    if (info>=0 && !(info&JSJL_ARG)) {
+      char name[JSLEX_MAX_TOKEN_LENGTH];
+      strncpy(name, jslGetTokenValueAsString(), sizeof(name));
+      int lastTkBeforeName = lastTk;
+      bool isInt = true;
+      jslGetNextToken();
+      lastTk = LEX_ID;
+      if (lex->tk=='=') { // must be assigned an integer literal, and nothing else
+        jslGetNextToken();
+        lastTk = '=';
+        bool negate = lex->tk=='-';
+        if (negate) {
+          jslGetNextToken();
+          lastTk = '-';
+        }
+        if (jsjIsInt32Literal(negate)) {
+          jslGetNextToken();
+          lastTk = LEX_INT;
+          isInt = lex->tk==';' || lex->tk==',' || lex->tk==')' || lex->tk=='}';
+        } else isInt = false;
+      } else {
+        // it could be read before it's set (or declared with no value)
+        if (!(info&JSJL_SEEN)) isInt = false;
+        if (jsjIsCompoundAssignment(lex->tk)) isInt = false;
+        // ++/-- could overflow, and the value has to become a float
+        if (lex->tk==LEX_PLUSPLUS || lex->tk==LEX_MINUSMINUS ||
+            lastTkBeforeName==LEX_PLUSPLUS || lastTkBeforeName==LEX_MINUSMINUS) isInt = false;
+      }
+      jsjSetLocalInfo(name, info | JSJL_SEEN | (isInt?0:JSJL_NOT_INT));
+      continue; // the current token hasn't been looked at yet
+    }
+    if (tk=='{') brackets++;
+    if (tk=='}') brackets--;
+    lastTk = tk;
+    jslGetNextToken();
+  }
+}
+
+// Create a float from its bits (as we can't pass doubles in integer registers on x86-64/hard float ARM)
+NO_INLINE JsVar *_jsjxNewFromFloatBits(uint64_t bits) {
+  JsVarFloat f;
+  memcpy(&f, &bits, sizeof(f));
+  return jsvNewFromFloat(f);
+}
+
+// Create a local variable (a NAME that's not in any scope). Utility function called from JIT code
+NO_INLINE JsVar *_jsjxNewLocal(const char *name, JsVar *value) {
+  JsVar *local = jsvNewFromString(name);
+  if (!local) return 0;
+  jsvMakeIntoVariableName(local, value);
+  // reference it, so jsvReplaceWithOrAddToRoot doesn't think it's a new global
+  jsvRef(local);
+  return local;
+}
+
+// Free the locals created with _jsjxNewLocal. Utility function called from JIT code before returning
+NO_INLINE void _jsjxFreeLocals(JsVar **locals, int count) {
+  for (int i=0;i<count;i++) {
+    if (!locals[i]) continue;
+    jsvUnRef(locals[i]);
+    jsvUnLock(locals[i]);
+  }
+}
+
+// Pop a value off the stack, converting raw ints/bools to JsVars. This may clobber r1-r3
 void jsjPopAsVar(int reg) {
   JsjValueType varType = jsjcPop(reg);
   if (varType==JSJVT_JSVAR) return;
-  if (varType==JSJVT_INT) {
-    if (reg) jsjcMov(0, reg);
-    jsjcCall(jsvNewFromInteger); // FIXME: what about clobbering r1-r3?
-    if (reg) jsjcMov(reg, 0);
-    return;
-  }
-  assert(0);
+  if (reg) jsjcMov(0, reg);
+  if (varType==JSJVT_INT)
+    jsjcCall(jsvNewFromInteger);
+  else
+    jsjcCall(jsvNewFromBool);
+  if (reg) jsjcMov(reg, 0);
+}
+
+// If an item on the stack (0=top) is a raw int/bool, convert it to a JsVar in place
+void jsjBoxStackItem(int item) {
+  JsjValueType varType = jsjcGetStackType(item);
+  if (varType==JSJVT_JSVAR) return;
+  int offset = item*JSJC_STACK_ITEM_SIZE;
+  jsjcLoadImm(0, JSJAR_SP, offset);
+  if (varType==JSJVT_INT)
+    jsjcCall(jsvNewFromInteger);
+  else
+    jsjcCall(jsvNewFromBool);
+  jsjcStoreImm(0, JSJAR_SP, offset);
+  jsjcSetStackType(item, JSJVT_JSVAR);
 }
 
 void jsjPopAsBool(int reg) {
-  // FIXME handle int/bool differently?
-  jsjPopAsVar(0);
-  jsjcCall(jsvGetBoolAndUnLock); // optimisation: we should know if we have a var or a name here, so can skip jsvSkipNameAndUnLock sometimes
+  if (jsjcGetStackType(0)==JSJVT_JSVAR) {
+    jsjcPop(0);
+    jsjcCall(jsvSkipNameAndUnLock); // arguments, locals and globals are names - we want their value. optimisation: we should know if we have a var or a name here, so can skip this sometimes
+    jsjcCall(jsvGetBoolAndUnLock);
+    // only the bottom bits of a returned bool are defined on some platforms
+    jsjcLiteral32(1, 1);
+    jsjcAND(0, 1);
+  } else {
+    jsjcPop(0); // raw ints and bools can be compared with 0 as-is
+  }
   if (reg != 0) jsjcMov(reg, 0);
 }
 
 void jsjPopAndUnLock() {
-  jsjPopAsVar(0); // a -> r0
-  // optimisation: if item on stack is NOT a variable, no need to covert+unlock!
+  if (jsjcGetStackType(0)!=JSJVT_JSVAR) {
+    jsjcAddSP(JSJC_STACK_ITEM_SIZE); // raw values don't need unlocking
+    return;
+  }
+  jsjcPop(0); // a -> r0
   jsjcCall(jsvUnLock); // we're throwing this away now - unlock
 }
 
+/// After a compare, set r0 to 1 if the condition is true or 0 if not
+void jsjConditionToBool(JsjAsmCondition cond) {
+  JsVar *oldBlock = jsjcStartBlock();
+  jsjcLiteral32(0, 1);
+  JsVar *trueBlock = jsjcStopBlock(oldBlock);
+  oldBlock = jsjcStartBlock();
+  jsjcLiteral32(0, 0);
+  jsjcBranchRelative((int)jsvGetStringLength(trueBlock)); // jump over true block
+  JsVar *falseBlock = jsjcStopBlock(oldBlock);
+  jsjcBranchConditionalRelative(cond, (int)jsvGetStringLength(falseBlock));
+  jsjcEmitBlock(falseBlock);
+  jsjcEmitBlock(trueBlock);
+  jsvUnLock2(falseBlock, trueBlock);
+}
+
+/// Free any locals and return. The return value should be in r0
+void jsjReturn() {
+  if (jsjVarLocalCount) {
+    if (jsjLocalOffset(0)) {
+      jsExceptionHere(JSET_ERROR, "JIT: Can't return here");
+      return;
+    }
+    jsjcMov(4, 0); // r4 = return value (it's preserved over calls)
+    jsjcMov(0, JSJAR_SP); // r0 = address of the first local
+    jsjcLiteral32(1, (uint32_t)jsjVarLocalCount);
+    jsjcCall(_jsjxFreeLocals);
+    jsjcMov(0, 4);
+  }
+  int depth = jsjcGetStackDepth();
+  if (depth) {
+    jsjcAddSP(depth*JSJC_STACK_ITEM_SIZE); // remove the stack frame
+    // ... but code after this (eg. after an 'if') still has it
+    for (int i=0;i<depth;i++) jsjcStackPushed(JSJVT_INT);
+  }
+  jsjcPopAllAndReturn();
+}
+
+/// Parse an integer literal (which jsjScanUsage has checked for) and store it in an integer local. Leaves the value in r0
+void jsjIntLocalAssign(int slot) {
+  bool negate = lex->tk=='-';
+  if (negate) JSP_ASSERT_MATCH('-');
+  if (lex->tk!=LEX_INT) {
+    JSP_MATCH(LEX_INT); // error
+  }
+  long long v = stringToInt(jslGetTokenValueAsString());
+  JSP_ASSERT_MATCH(LEX_INT);
+  if (negate) v = -v;
+  jsjcLiteral32(0, (uint32_t)v);
+  jsjcStoreImm(0, JSJAR_SP, jsjLocalOffset(slot));
+}
+
+/// We've just parsed the name of a local variable (with the given info from jsjGetLocalInfo)
+void jsjFactorLocal(int info) {
+  int slot = info>>1;
+  if (!(info&1)) { // a NAME - push it
+    jsjcLoadImm(0, JSJAR_SP, jsjLocalOffset(slot));
+    jsjcCall(jsvLockAgainSafe);
+    jsjcPush(0, JSJVT_JSVAR);
+  } else if (lex->tk=='=') { // integer assignment
+    JSP_ASSERT_MATCH('=');
+    jsjIntLocalAssign(slot);
+    jsjcPush(0, JSJVT_INT);
+  } else { // integer read
+    jsjcLoadImm(0, JSJAR_SP, jsjLocalOffset(slot));
+    jsjcPush(0, JSJVT_INT);
+  }
+}
+
 void jsjPopNoName(int reg) {
   jsjPopAsVar(0); // a -> r0
   jsjcCall(jsvSkipNameAndUnLock); // optimisation: we should know if we have a var or a name here, so can skip jsvSkipNameAndUnLock sometimes
@@ -63,7 +325,11 @@ void jsjPopNoName(int reg) {
 }
 
 void jsjFactor() {
-  if (lex->tk==LEX_ID) {
+  if (lex->tk==LEX_ID && jsjGetLocalInfo(jslGetTokenValueAsString())>=0) {
+    int info = jsjGetLocalInfo(jslGetTokenValueAsString());
+    JSP_ASSERT_MATCH(LEX_ID);
+    jsjFactorLocal(info);
+  } else if (lex->tk==LEX_ID) {
     JsVar *a = jslGetTokenValueAsVar();
     jsjcLiteralString(0, a, true); // null terminated
     jsvUnLock(a);
@@ -73,19 +339,19 @@ void jsjFactor() {
   } else if (lex->tk==LEX_INT) {
     int64_t v = stringToInt(jslGetTokenValueAsString());
     JSP_ASSERT_MATCH(LEX_INT);
-    if (v>>32) {
+    if (v>0x7FFFFFFF) {
       jsjcLiteral64(0, (uint64_t)v);
       jsjcCall(jsvNewFromLongInteger);
+      jsjcPush(0, JSJVT_JSVAR);
     } else {
       jsjcLiteral32(0, (uint32_t)v);
-      jsjcCall(jsvNewFromInteger);
+      jsjcPush(0, JSJVT_INT); // converted to a JsVar only if needed
     }
-    jsjcPush(0, JSJVT_JSVAR); // FIXME - push an int and convert later
   } else if (lex->tk==LEX_FLOAT) {
     double v = stringToFloat(jslGetTokenValueAsString());
     JSP_ASSERT_MATCH(LEX_FLOAT);
     jsjcLiteral64(0, *((uint64_t*)&v));
-    jsjcCall(jsvNewFromFloat);
+    jsjcCall(_jsjxNewFromFloatBits); // we can't pass a double in int registers on all platforms
     jsjcPush(0, JSJVT_JSVAR);
   } else if (lex->tk=='(') {
     JSP_ASSERT_MATCH('(');
@@ -143,8 +409,8 @@ void jsjFactor() {
   } else JSP_MATCH(LEX_EOF);
 }
 
-/// Look up 'parent.a[index]'. Utility function called from JIT code
-uint64_t _jsjxObjectLookup(JsVar *index, JsVar *parent, JsVar *a) {
+/// Look up 'parent.a[index]'. Utility function called from JIT code. Returns (a,parent)
+JsjValuePair _jsjxObjectLookup(JsVar *index, JsVar *parent, JsVar *a) {
   JsVar *resultParent = jsvSkipNameWithParent(a,true,parent);
   jsvUnLock2(a, parent);
   JsVar *resultA = 0;
@@ -160,7 +426,7 @@ uint64_t _jsjxObjectLookup(JsVar *index, JsVar *parent, JsVar *a) {
     }
   }
   jsvUnLock(index);
-  return ((uint64_t)(size_t)resultA) | (((uint64_t)(size_t)resultParent)<<32);
+  return jsjcValuePair(resultA, resultParent);
 }
 
 // Like jspeFunctionCall but we unlock ALL the vars supplied
@@ -171,6 +437,13 @@ NO_INLINE JsVar *_jsjxFunctionCallAndUnLock(JsVar *function, JsVar *functionName
   return r;
 }
 
+// Call a built-in native function (see jsjGetBuiltInCall) with JsVar arguments, then unlock them
+NO_INLINE JsVar *_jsjxNativeCallAndUnLock(void *function, JsnArgumentType argTypes, int argCount, JsVar **argPtr) {
+  JsVar *r = jsnCallFunction(function, argTypes, 0, argPtr, argCount);
+  jsvUnLockMany((unsigned)argCount, argPtr);
+  return r;
+}
+
 // Call jsvReplaceWithOrAddToRoot but unlock the second argument
 NO_INLINE void _jsxReplaceWithOrAddToRootUnlockSrc(JsVar *dst, JsVar *src) {
   jsvReplaceWithOrAddToRoot(dst, src);
@@ -208,6 +481,7 @@ NO_INLINE JsVar *_jsxMathsOpSkipNamesAndUnLock(JsVar *a, JsVar *b, int op) {
 bool jsjFactorMember() {
   bool parentOnStack = false;
   while ((lex->tk=='.' || lex->tk=='[') && JSJ_PARSING) {
+    jsjBoxStackItem(parentOnStack ? 1 : 0); // we need a JsVar to look up a member of
     if (lex->tk == '.') { // ------------------------------------- Record Access
       JSP_ASSERT_MATCH('.');
       if (jslIsIDOrReservedWord()) {
@@ -225,7 +499,7 @@ bool jsjFactorMember() {
     } else if (lex->tk == '[') { // ------------------------------------- Array Access
       JSP_ASSERT_MATCH('[');
       jsjAssignmentExpression();
-      jsjcPop(0);
+      jsjPopAsVar(0);
       jsjcCall(jsvAsArrayIndexAndUnLock);
       JSP_MATCH_WITH_RETURN(']', false); // if we fail we're stopping compilation anyway
       // r0 = index
@@ -244,19 +518,303 @@ bool jsjFactorMember() {
   return parentOnStack;
 }
 
+/// Arguments have been pushed onto the stack in the wrong order and r7 = argPtr - swap them around if we have >1
+void jsjReverseArguments(int argCount) {
+  if (argCount<=1) return;
+  DEBUG_JIT("; FUNCTION CALL reverse arguments\n");
+  for (int i=0;i<argCount/2;i++) {
+    int a1 = i*JSJC_STACK_ITEM_SIZE;
+    int a2 = (argCount-(i+1))*JSJC_STACK_ITEM_SIZE;
+    jsjcLoadImm(0, 7, a1); // r0 = memory[argPtr+a1]
+    jsjcLoadImm(1, 7, a2); // ...
+    jsjcStoreImm(0, 7, a2);
+    jsjcStoreImm(1, 7, a1);
+  }
+}
+
+/// A call to a function built into Espruino, found by jsjGetBuiltInCall
+typedef struct {
+  JsVar *name; ///< The global function or built-in object
+  JsVar *member; ///< The method of the built-in object, or 0 if a global function
+  const JswSymList *symbols; ///< The symbol list the method was found in
+} JsjBuiltInCall;
+
+/// Is 'name(' or 'name.member(' still the built-in it was when we compiled? Called from JIT code before calling it
+NO_INLINE bool _jsjxIsBuiltInUnchanged(const char *name, const char *member, const JswSymList *symbols) {
+  JsVar *rootVar = jsvSkipNameAndUnLock(jsvFindChildFromString(execInfo.root, name, false));
+  if (!rootVar) return true; // not defined in root, so it's still the built-in
+  bool unchanged = false;
+  if (member) { // setting a member of a built-in object adds the object to root
+    JsVar *memberName = jsvFindChildFromString(rootVar, member, false);
+    unchanged = !memberName && jswGetSymbolListForObject(rootVar)==symbols;
+    jsvUnLock(memberName);
+  }
+  jsvUnLock(rootVar);
+  return unchanged;
+}
+
+// Call a built-in that has been redefined since it was compiled (see jsjNativeFunctionCall), then unlock the arguments
+NO_INLINE JsVar *_jsjxBuiltInFallbackCallAndUnLock(const char *name, const char *member, int argCount, JsVar **argPtr) {
+  JsVar *thisArg = 0;
+  JsVar *functionName = jspGetNamedVariable(name);
+  if (member) {
+    thisArg = jsvSkipNameAndUnLock(functionName);
+    functionName = jspGetNamedField(thisArg, member, true);
+  }
+  JsVar *function = jsvSkipName(functionName);
+  JsVar *r = jspeFunctionCall(function, functionName, thisArg, false, argCount, argPtr);
+  jsvUnLockMany((unsigned)argCount, argPtr);
+  jsvUnLock3(function, functionName, thisArg);
+  return r;
+}
+
+/* If we're at 'name(' or 'Object.name(' where 'name' is a function built into
+ * Espruino (from the jswrapper symbol tables), skip to the '(' and return the
+ * native function so it can be called without looking it up each time.
+ * The code we emit checks that the built-in hasn't been redefined before
+ * calling it (see jsjNativeFunctionCall). */
+JsVar *jsjGetBuiltInCall(JsjBuiltInCall *call) {
+  call->name = 0;
+  call->member = 0;
+  call->symbols = 0;
+  if (lex->tk!=LEX_ID || jsjGetLocalInfo(jslGetTokenValueAsString())>=0) return 0;
+  char name[JSLEX_MAX_TOKEN_LENGTH];
+  strcpy(name, jslGetTokenValueAsString());
+  size_t start = lex->tokenStart;
+  JsVar *rootVar = jsvSkipNameAndUnLock(jsvFindChildFromString(execInfo.root, name, false));
+  JsVar *fn = 0;
+  jslGetNextToken();
+  if (lex->tk=='(') { // global function, eg. digitalWrite(...)
+    if (!rootVar && !jswIsBuiltInObject(name))
+      fn = jswFindBuiltInFunction(0, name);
+  } else if (lex->tk=='.') { // static method of a built-in object, eg. Math.sqrt(...)
+    jslGetNextToken();
+    if (lex->tk==LEX_ID && (rootVar || jswIsBuiltInObject(name))) {
+      JsVar *obj = rootVar ? jsvLockAgain(rootVar) : jswFindBuiltInFunction(0, name);
+      const char *member = jslGetTokenValueAsString();
+      const JswSymList *symbols = jswGetSymbolListForObject(obj);
+      const JswSymList *foundIn = 0;
+      JsVar *memberName = symbols ? jsvFindChildFromString(obj, member, false) : 0;
+      if (symbols && !memberName) { // not overridden by a member of the object
+        fn = jswFindBuiltIn(obj, member, &foundIn);
+        if (foundIn!=symbols) {
+          jsvUnLock(fn);
+          fn = 0;
+        }
+      }
+      if (fn) {
+        call->member = jsvNewFromString(member);
+        call->symbols = symbols;
+      }
+      jsvUnLock2(memberName, obj);
+      jslGetNextToken();
+      if (lex->tk!='(' || !call->member) {
+        jsvUnLock(fn);
+        fn = 0;
+      }
+    }
+  }
+  jsvUnLock(rootVar);
+  if (fn && (!jsvIsNativeFunction(fn) ||
+             (fn->varData.native.argTypes & JSWAT_THIS_ARG) || // needs an instance
+             fn->varData.native.ptr==(void*)jswrap_eval)) { // needs the current scope
+    jsvUnLock(fn);
+    fn = 0;
+  }
+  if (fn) call->name = jsvNewFromString(name);
+  if (!call->name) { // not a built-in (or out of memory) - go back
+    jsvUnLock2(fn, call->member);
+    call->member = 0;
+    fn = 0;
+    jslSeekTo(start);
+  }
+  return fn;
+}
+
+/// Can a native function with these argument types be called directly from JIT code (rather than with jsnCallFunction)?
+bool jsjIsDirectNativeCall(JsnArgumentType argTypes) {
+  JsnArgumentType returnType = argTypes & JSWAT_MASK;
+  if (returnType!=JSWAT_VOID && returnType!=JSWAT_JSVAR && returnType!=JSWAT_BOOL &&
+      returnType!=JSWAT_INT32 && returnType!=JSWAT_PIN) return false;
+  for (int i=1;(argTypes>>(JSWAT_BITS*i)) & JSWAT_MASK;i++) {
+    if (i>JSJ_MAX_ARGS) return false; // we only pass arguments in registers
+    JsnArgumentType argType = (argTypes>>(JSWAT_BITS*i)) & JSWAT_MASK;
+    if (argType!=JSWAT_JSVAR && argType!=JSWAT_BOOL &&
+        argType!=JSWAT_INT32 && argType!=JSWAT_PIN) return false; // floats and argument arrays
+  }
+  return true;
+}
+
+/// Convert an item on the stack (0=top) in place into what a native function wants for an argument of the given type
+void jsjConvertStackItemForNative(int item, JsnArgumentType argType) {
+  JsjValueType varType = jsjcGetStackType(item);
+  if (argType==JSWAT_INT32 && varType!=JSJVT_JSVAR) return; // raw ints and bools are fine as-is
+  if (argType==JSWAT_BOOL && varType==JSJVT_BOOL) return;
+  jsjBoxStackItem(item);
+  if (argType!=JSWAT_INT32 && argType!=JSWAT_BOOL && argType!=JSWAT_PIN) return;
+  int offset = item*JSJC_STACK_ITEM_SIZE;
+  jsjcLoadImm(0, JSJAR_SP, offset);
+  if (argType==JSWAT_INT32) {
+    jsjcCall(jsvGetIntegerAndUnLock);
+  } else if (argType==JSWAT_BOOL) {
+    jsjcCall(jsvGetBoolAndUnLock);
+    jsjcLiteral32(1, 1); // only the bottom bits of a returned bool are defined on some platforms
+    jsjcAND(0, 1);
+  } else {
+    jsjcCall(jshGetPinFromVarAndUnLock);
+    jsjcLiteral32(1, 0xFF); // Pin is a byte
+    jsjcAND(0, 1);
+  }
+  jsjcStoreImm(0, JSJAR_SP, offset);
+  jsjcSetStackType(item, argType==JSWAT_BOOL ? JSJVT_BOOL : JSJVT_INT);
+}
+
+/// Call a native function with the arguments on the stack (and leave the result on the stack as a JsVar)
+static void jsjNativeFunctionCallFast(void *function, JsnArgumentType argTypes, bool direct, int paramCount, int argCount) {
+  if (direct) {
+    for (int i=0;i<paramCount && i<argCount;i++)
+      jsjConvertStackItemForNative(argCount-(i+1), (argTypes>>(JSWAT_BITS*(i+1))) & JSWAT_MASK);
+    // Arguments go in registers, extra ones are ignored
+    for (int i=0;i<paramCount;i++) {
+      JsnArgumentType argType = (argTypes>>(JSWAT_BITS*(i+1))) & JSWAT_MASK;
+      if (i<argCount) jsjcLoadImm(i, JSJAR_SP, (argCount-(i+1))*JSJC_STACK_ITEM_SIZE);
+      else jsjcLiteral32(i, (argType==JSWAT_PIN) ? PIN_UNDEFINED : 0); // not supplied - undefined
+    }
+    jsjcCall(function);
+    JsnArgumentType returnType = argTypes & JSWAT_MASK;
+    JsjValueType resultType = JSJVT_JSVAR;
+    if (returnType==JSWAT_VOID) {
+      jsjcLiteral32(0, 0); // undefined
+    } else if (returnType==JSWAT_INT32) {
+      resultType = JSJVT_INT;
+    } else if (returnType==JSWAT_BOOL) {
+      jsjcLiteral32(1, 1); // only the bottom bits of a returned bool are defined on some platforms
+      jsjcAND(0, 1);
+      resultType = JSJVT_BOOL;
+    } else if (returnType==JSWAT_PIN) {
+      jsjcLiteral32(1, 0xFF);
+      jsjcAND(0, 1);
+      jsjcCall(jsvNewFromPin);
+    }
+    jsjcMov(4, 0); // r4 = result (it's preserved over calls)
+    for (int i=0;i<argCount;i++)
+      jsjPopAndUnLock(); // unlock any JsVar arguments
+    jsjcMov(0, 4);
+    jsjcPush(0, resultType);
+    jsjBoxStackItem(0); // the fallback call returns a JsVar, so we must too
+  } else {
+    jsjcMov(7, JSJAR_SP); // r7 = argPtr
+    jsjReverseArguments(argCount);
+    jsjcLiteralAddress(0, function);
+    jsjcLiteral32(1, argTypes);
+    jsjcLiteral32(2, (uint32_t)argCount);
+    jsjcMov(3, 7);
+    jsjcCall(_jsjxNativeCallAndUnLock); // r0 = _jsjxNativeCallAndUnLock(function, argTypes, argCount, argPtr)
+    if (argCount) jsjcAddSP(argCount*JSJC_STACK_ITEM_SIZE);
+    jsjcPush(0, JSJVT_JSVAR);
+  }
+}
+
+/// Load the name and member of a built-in call into r0 and r1 (r1=0 if it's a global function)
+static void jsjLoadBuiltInCallName(JsjBuiltInCall *call) {
+  jsjcLiteralString(0, call->name, true);
+  if (call->member) jsjcLiteralString(1, call->member, true);
+  else jsjcLiteral32(1, 0);
+}
+
+/** Parse the arguments for a call to a built-in native function (from jsjGetBuiltInCall)
+ * and call it. If the argument types allow it we convert the arguments ourselves and call
+ * the function directly, otherwise we call it via jsnCallFunction.
+ *
+ * As the built-in could be redefined after we compile, we check it hasn't been at run
+ * time first, and if it has we look it up and call it like any other function. */
+void jsjNativeFunctionCall(JsVar *fn, JsjBuiltInCall *call) {
+  void *function = fn->varData.native.ptr;
+  JsnArgumentType argTypes = (JsnArgumentType)fn->varData.native.argTypes;
+  bool direct = jsjIsDirectNativeCall(argTypes);
+  int paramCount = 0; // how many arguments the native function takes
+  while ((argTypes>>(JSWAT_BITS*(paramCount+1))) & JSWAT_MASK) paramCount++;
+  DEBUG_JIT("; NATIVE CALL %s\n", direct ? "direct" : "jsnCallFunction");
+  int argCount = 0;
+  JSP_MATCH('(');
+  while (JSJ_PARSING && lex->tk!=')' && lex->tk!=LEX_EOF) {
+    jsjAssignmentExpression();
+    // raw ints/bools are left as-is, as the native function may not need them converted
+    if (jsjcGetStackType(0)==JSJVT_JSVAR) {
+      jsjPopNoName(0);
+      jsjcPush(0, JSJVT_JSVAR);
+    }
+    argCount++;
+    if (lex->tk!=')') JSP_MATCH(',');
+  }
+  JSP_MATCH(')');
+  if (!JSJ_PARSING) return;
+  // Anything we won't pass in a register is a JsVar whichever way we call
+  JsjValueType paramStackTypes[JSJ_MAX_ARGS];
+  int rawCount = direct ? ((paramCount<argCount) ? paramCount : argCount) : 0;
+  for (int i=0;i<argCount;i++) {
+    if (i<rawCount) paramStackTypes[i] = jsjcGetStackType(argCount-(i+1));
+    else jsjBoxStackItem(argCount-(i+1));
+  }
+  DEBUG_JIT("; NATIVE CALL check built-in\n");
+  jsjLoadBuiltInCallName(call);
+  jsjcLiteralAddress(2, (void*)call->symbols);
+  jsjcCall(_jsjxIsBuiltInUnchanged);
+  jsjcLiteral32(1, 1); // only the bottom bits of a returned bool are defined on some platforms
+  jsjcAND(0, 1);
+  jsjcCompareImm(0, 0);
+  JsVar *oldBlock = jsjcStartBlock();
+  jsjNativeFunctionCallFast(function, argTypes, direct, paramCount, argCount);
+  JsVar *fastBlock = jsjcStopBlock(oldBlock);
+  // the fast block took the arguments off the stack - put them back for the fallback
+  jsjcStackPopped();
+  for (int i=0;i<argCount;i++)
+    jsjcStackPushed((i<rawCount) ? paramStackTypes[i] : JSJVT_JSVAR);
+  oldBlock = jsjcStartBlock();
+  DEBUG_JIT("; NATIVE CALL redefined\n");
+  for (int i=0;i<rawCount;i++)
+    jsjBoxStackItem(argCount-(i+1));
+  jsjcMov(7, JSJAR_SP); // r7 = argPtr
+  jsjReverseArguments(argCount);
+  jsjLoadBuiltInCallName(call);
+  jsjcLiteral32(2, (uint32_t)argCount);
+  jsjcMov(3, 7);
+  jsjcCall(_jsjxBuiltInFallbackCallAndUnLock); // r0 = _jsjxBuiltInFallbackCallAndUnLock(name, member, argCount, argPtr)
+  if (argCount) jsjcAddSP(argCount*JSJC_STACK_ITEM_SIZE);
+  jsjcPush(0, JSJVT_JSVAR);
+  JsVar *slowBlock = jsjcStopBlock(oldBlock);
+  // if it was redefined (r0==0), jump over the fast block
+  jsjcBranchConditionalRelative(JSJAC_EQ, (int)jsvGetStringLength(fastBlock) + JSJC_BRANCH_SIZE);
+  jsjcEmitBlock(fastBlock);
+  jsjcBranchRelative((int)jsvGetStringLength(slowBlock)); // jump over the fallback
+  jsjcEmitBlock(slowBlock);
+  jsvUnLock2(fastBlock, slowBlock);
+  DEBUG_JIT("; NATIVE CALL end\n");
+}
+
 void jsjFactorFunctionCall() {
-  jsjFactor();
-  bool parentOnStack = jsjFactorMember(); // FIXME we need to call this and also somehow remember 'parent'
+  bool parentOnStack = false;
+  JsjBuiltInCall call;
+  JsVar *builtIn = jsjGetBuiltInCall(&call);
+  if (builtIn) {
+    jsjNativeFunctionCall(builtIn, &call);
+    jsvUnLock3(builtIn, call.name, call.member);
+  } else {
+    jsjFactor();
+    parentOnStack = jsjFactorMember(); // FIXME we need to call this and also somehow remember 'parent'
+  }
   // FIXME: what about 'new'?
 
   while (lex->tk=='(' /*|| (isConstructor && JSP_SHOULD_EXECUTE))*/ && JSJ_PARSING) {
-    if (parentOnStack) {
-      DEBUG_JIT("; FUNCTION CALL r6 = 'this'\n");
-      jsjcPop(6); // r6 = this/parent
-      parentOnStack = false;
+    /* funcName and 'this' stay on the stack while we parse the arguments (so
+     * function calls in the arguments can't overwrite them) */
+    if (!parentOnStack) {
+      jsjBoxStackItem(0); // funcName
+      DEBUG_JIT("; FUNCTION CALL no 'this'\n");
+      jsjcLiteral32(0, 0);
+      jsjcPush(0, JSJVT_JSVAR);
     }
-    DEBUG_JIT("; FUNCTION CALL r4 = funcName\n");
-    jsjcPop(4); // r4 = funcName
+    parentOnStack = false;
     DEBUG_JIT("; FUNCTION CALL arguments\n");
     /* PARSE OUR ARGUMENTS
      * Push each new argument onto the stack (it grows down)
@@ -277,42 +835,32 @@ void jsjFactorFunctionCall() {
       if (lex->tk!=')') JSP_MATCH(',');
     }
     JSP_MATCH(')');
-    // r4=funcName, args on the stack
+    // stack = funcName, this, args
     jsjcMov(7, JSJAR_SP); // r7 = argPtr
     jsjcPush(7, JSJVT_INT); // argPtr (6th arg - on stack)
     // Args are in the wrong order - we have to swap them around if we have >1!
-    if (argCount>1) {
-      DEBUG_JIT("; FUNCTION CALL reverse arguments\n");
-      for (int i=0;i<argCount/2;i++) {
-        int a1 = i*4;
-        int a2 = (argCount-(i+1))*4;
-        jsjcLoadImm(0, 7, a1); // r0 = memory[argPtr+a1]
-        jsjcLoadImm(1, 7, a2); // ...
-        jsjcStoreImm(0, 7, a2);
-        jsjcStoreImm(1, 7, a1);
-      }
-    }
+    jsjReverseArguments(argCount);
+    jsjcLiteral32(2, argCount); //
+    jsjcPush(2, JSJVT_INT); // argCount (5th arg - on stack)
     DEBUG_JIT("; FUNCTION CALL jspeFunctionCall\n");
+    int thisOffset = (2+argCount)*JSJC_STACK_ITEM_SIZE;
+    int funcNameOffset = thisOffset + JSJC_STACK_ITEM_SIZE;
     // First arg
-    jsjcMov(0, 4); jsjcCall(jsvSkipName); // r0 = func
-    jsjcMov(5, 0); // r5 = func
+    jsjcLoadImm(0, JSJAR_SP, funcNameOffset);
+    jsjcCall(jsvSkipName); // r0 = func
     // for constructors we'd have to do something special here
-    jsjcMov(1, 4); // Second arg, r1 = funcName
-    jsjcLiteral32(2, argCount); //
-    jsjcPush(2, JSJVT_INT); // argCount (5th arg - on stack)
-    jsjcMov(2, 6); // parent (from r6)
+    jsjcLoadImm(1, JSJAR_SP, funcNameOffset); // Second arg, r1 = funcName
+    jsjcLoadImm(2, JSJAR_SP, thisOffset); // Third arg, r2 = this
     jsjcLiteral32(3, 0); // isParsing = false
     jsjcCall(_jsjxFunctionCallAndUnLock); // a = jspeFunctionCall(func, funcName, thisArg/parent, isParsing, argCount, argPtr);
     DEBUG_JIT("; FUNCTION CALL cleanup stack\n");
-    jsjcAddSP(4*(2+argCount)); // pop off argCount,argPtr + all the arguments
+    jsjcAddSP(JSJC_STACK_ITEM_SIZE*(4+argCount)); // pop off argCount,argPtr + all the arguments + this + funcName
     jsjcPush(0, JSJVT_JSVAR); // push return value from jspeFunctionCall
     DEBUG_JIT("; FUNCTION CALL end\n");
-    // FIXME - also unlock/clear 'parent'
-    // parent=0;
-    // a = jsjFactorMember(a, &parent);
   }
   if (parentOnStack) {
-    jsjcPop(4); // just remove parent from the stack. We don't care where it goes!
+    jsjcPop(0); // remove parent from the stack (it was locked by _jsjxObjectLookup)
+    jsjcCall(jsvUnLock);
   }
 }
 
@@ -320,7 +868,11 @@ void __jsjPostfixExpression() {
   while (lex->tk==LEX_PLUSPLUS || lex->tk==LEX_MINUSMINUS) {
     int op = lex->tk; // POSFIX expression =>  i++, i--
     JSP_ASSERT_MATCH(op);
-    jsjPopAsVar(0); // old value -> r0
+    if (jsjcGetStackType(0)!=JSJVT_JSVAR) {
+      jsExceptionHere(JSET_ERROR, "JIT: Can't use ++/-- here");
+      return;
+    }
+    jsjcPop(0); // old value -> r0
     jsjcLiteral32(1, op==LEX_PLUSPLUS ? '+' : '-'); // add the operation
     jsjcCall(_jsxPostfixIncDec); // JsVar *_jsxPostfixIncDec(JsVar *var, char op)
     jsjcPush(0, JSJVT_JSVAR); // push result (value BEFORE we inc/dec)
@@ -333,7 +885,11 @@ void jsjPostfixExpression() {
     int op = lex->tk;
     JSP_ASSERT_MATCH(op);
     jsjPostfixExpression(); // recurse to get our var...
-    jsjPopAsVar(0); // old value -> r0
+    if (jsjcGetStackType(0)!=JSJVT_JSVAR) {
+      jsExceptionHere(JSET_ERROR, "JIT: Can't use ++/-- here");
+      return;
+    }
+    jsjcPop(0); // old value -> r0
     jsjcLiteral32(1, op==LEX_PLUSPLUS ? '+' : '-'); // add the operation
     jsjcCall(_jsxPrefixIncDec); // JsVar *_jsxPrefixIncDec(JsVar *var, char op)
     jsjcPush(0, JSJVT_JSVAR); // push result (value AFTER we inc/dec)
@@ -398,6 +954,21 @@ unsigned int jsjGetBinaryExpressionPrecedence(int op) {
   }
 }
 
+// If op is a comparison we can do natively on two ints, set the condition and return true
+bool jsjGetIntComparison(int op, JsjAsmCondition *cond) {
+  switch (op) {
+  case '<': *cond = JSJAC_LT; return true;
+  case '>': *cond = JSJAC_GT; return true;
+  case LEX_LEQUAL: *cond = JSJAC_LE; return true;
+  case LEX_GEQUAL: *cond = JSJAC_GE; return true;
+  case LEX_EQUAL:
+  case LEX_TYPEEQUAL: *cond = JSJAC_EQ; return true;
+  case LEX_NEQUAL:
+  case LEX_NTYPEEQUAL: *cond = JSJAC_NE; return true;
+  default: return false;
+  }
+}
+
 void __jsjBinaryExpression(unsigned int lastPrecedence) {
   /* This one's a bit strange. Basically all the ops have their own precedence, it's not
    * like & and | share the same precedence. We don't want to recurse for each one,
@@ -462,9 +1033,21 @@ void __jsjBinaryExpression(unsigned int lastPrecedence) {
           }
         }
         jsvUnLock2(av, bv);
-      } else */{  // --------------------------------------------- NORMAL
-        jsjPopAsVar(1); // b -> r1
-        jsjPopAsVar(0); // a -> r0
+      } else */
+      JsjAsmCondition cond;
+      if (jsjcGetStackType(0)==JSJVT_INT && jsjcGetStackType(1)==JSJVT_INT &&
+          jsjGetIntComparison(op, &cond)) { // ------------------------ INT COMPARISON
+        jsjcPop(1); // b -> r1
+        jsjcPop(0); // a -> r0
+        jsjcCompare(0, 1);
+        jsjConditionToBool(cond);
+        jsjcPush(0, JSJVT_BOOL); // push result
+      } else {  // --------------------------------------------- NORMAL
+        // convert ints/bools in place first, as converting clobbers registers
+        jsjBoxStackItem(0);
+        jsjBoxStackItem(1);
+        jsjcPop(1); // b -> r1
+        jsjcPop(0); // a -> r0
         jsjcLiteral32(2, op);
         jsjcCall(_jsxMathsOpSkipNamesAndUnLock); // unlocks arguments
         jsjcPush(0, JSJVT_JSVAR); // push result
@@ -496,6 +1079,10 @@ NO_INLINE void jsjAssignmentExpression() {
 
     int op = lex->tk;
     JSP_ASSERT_MATCH(op);
+    if (jsjcGetStackType(0)!=JSJVT_JSVAR) {
+      jsExceptionHere(JSET_ERROR, "JIT: Invalid assignment");
+      return;
+    }
     jsjAssignmentExpression();
     jsjPopNoName(1); // ensure we get rid of any references on the RHS
     jsjcPop(0); // pop LHS
@@ -591,7 +1178,7 @@ void jsjStatementIf() {
   }
   DEBUG_JIT("; IF jump after condition\n");
   // if false, jump after true block (if an 'else' we need to jump over the jsjcBranchRelative
-  jsjcBranchConditionalRelative(JSJAC_EQ, jsvGetStringLength(trueBlock) + (falseBlock?2:0));
+  jsjcBranchConditionalRelative(JSJAC_EQ, jsvGetStringLength(trueBlock) + (falseBlock?JSJC_BRANCH_SIZE:0));
   DEBUG_JIT("; IF true block\n");
   jsjcEmitBlock(trueBlock);
   jsvUnLock(trueBlock);
@@ -605,6 +1192,35 @@ void jsjStatementIf() {
 
 }
 
+void jsjStatementVar() {
+  JSP_ASSERT_MATCH(lex->tk); // var/let/const
+  while (JSJ_PARSING) {
+    if (lex->tk!=LEX_ID) {
+      JSP_MATCH(LEX_ID); // error
+    }
+    // jsjScanDeclarations will have allocated a slot for this
+    int info = jsjGetLocalInfo(jslGetTokenValueAsString());
+    if (info<0) {
+      jsExceptionHere(JSET_ERROR, "JIT: Unknown local variable %s", jslGetTokenValueAsString());
+      return;
+    }
+    JSP_ASSERT_MATCH(LEX_ID);
+    if (lex->tk=='=') {
+      JSP_ASSERT_MATCH('=');
+      if (info&1) {
+        jsjIntLocalAssign(info>>1);
+      } else {
+        jsjAssignmentExpression();
+        jsjPopNoName(1); // r1 = value
+        jsjcLoadImm(0, JSJAR_SP, jsjLocalOffset(info>>1)); // r0 = local's NAME
+        jsjcCall(_jsxReplaceWithOrAddToRootUnlockSrc); // void _jsxReplaceWithOrAddToRootUnlockSrc(JsVar *dst, JsVar *src)
+      }
+    }
+    if (lex->tk!=',') return;
+    JSP_ASSERT_MATCH(',');
+  }
+}
+
 void jsjStatementFor() {
   JSP_ASSERT_MATCH(LEX_R_FOR);
   JSP_MATCH('(');
@@ -638,7 +1254,7 @@ void jsjStatementFor() {
   jsjBlockOrStatement();
   JsVar *mainBlock = jsjcStopBlock(oldBlock);
   // Now figure out the jump length and jump (if condition is false)
-  jsjcBranchConditionalRelative(JSJAC_EQ, jsvGetStringLength(iteratorBlock) + jsvGetStringLength(mainBlock) + 2);
+  jsjcBranchConditionalRelative(JSJAC_EQ, jsvGetStringLength(iteratorBlock) + jsvGetStringLength(mainBlock) + JSJC_BRANCH_SIZE);
   DEBUG_JIT("; FOR Main block\n");
   jsjcEmitBlock(mainBlock);
   jsvUnLock(mainBlock);
@@ -647,7 +1263,7 @@ void jsjStatementFor() {
   jsvUnLock(iteratorBlock);
   // after the iterator, jump back to condition
   DEBUG_JIT("; FOR jump back to condition\n");
-  jsjcBranchRelative(codePosCondition - jsjcGetByteCount());
+  jsjcBranchRelative(codePosCondition - (jsjcGetByteCount()+JSJC_BRANCH_SIZE));
   DEBUG_JIT("; FOR end\n");
 }
 
@@ -684,10 +1300,10 @@ void jsjStatement() {
     jsjBlock();
   } else if (lex->tk==';') {
     JSP_ASSERT_MATCH(';');/* Empty statement - to allow things like ;;; */
-/*} else if (lex->tk==LEX_R_VAR ||
+  } else if (lex->tk==LEX_R_VAR ||
             lex->tk==LEX_R_LET ||
             lex->tk==LEX_R_CONST) {
-    return jsjStatementVar();*/
+    return jsjStatementVar();
   } else if (lex->tk==LEX_R_IF) {
     return jsjStatementIf();
   /*} else if (lex->tk==LEX_R_DO) {
@@ -706,7 +1322,7 @@ void jsjStatement() {
     } else {
       jsjcLiteral32(0, 0);
     }
-    jsjcPopAllAndReturn();
+    jsjReturn();
 /*} else if (lex->tk==LEX_R_THROW) {
   } else if (lex->tk==LEX_R_FUNCTION) {
   } else if (lex->tk==LEX_R_CONTINUE) {
@@ -729,21 +1345,115 @@ void jsjBlockOrStatement() {
   }
 }
 
-JsVar *jsjParseFunction() {
+/// Find the function's arguments and locals, give them stack slots, and emit code to set them up
+void jsjSetupLocals(JsVar *funcVar, int *argCount) {
+  // Arguments come first, in order
+  JsvObjectIterator it;
+  jsvObjectIteratorNew(&it, funcVar);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *param = jsvObjectIteratorGetKey(&it);
+    if (jsvIsFunctionParameter(param)) {
+      char name[JSLEX_MAX_TOKEN_LENGTH+1];
+      jsvGetString(param, name, sizeof(name));
+      jsjSetLocalInfo(&name[1], JSJL_ARG); // skip the '\xFF'
+      (*argCount)++;
+    }
+    jsvUnLock(param);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  if (*argCount > JSJ_MAX_ARGS) {
+    jsExceptionHere(JSET_ERROR, "JIT: Too many arguments (max %d)", JSJ_MAX_ARGS);
+    return;
+  }
+  // Now scan the code, then go back to the start
+  JslCharPos funcCodeStart;
+  jslCharPosFromLex(&funcCodeStart);
+  jsjScanDeclarations();
+  jslSeekToP(&funcCodeStart);
+  jsjScanUsage();
+  jslSeekToP(&funcCodeStart);
+  jslCharPosFree(&funcCodeStart);
+  // Allocate slots - NAMEs first, then ints
+  jsvObjectIteratorNew(&it, jsjLocals);
+  while (jsvObjectIteratorHasValue(&it)) {
+    int info = (int)jsvGetIntegerAndUnLock(jsvObjectIteratorGetValue(&it));
+    if (info & (JSJL_ARG|JSJL_NOT_INT)) jsjVarLocalCount++;
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  int varSlot = 0, slot = jsjVarLocalCount;
+  jsvObjectIteratorNew(&it, jsjLocals);
+  while (jsvObjectIteratorHasValue(&it)) {
+    int info = (int)jsvGetIntegerAndUnLock(jsvObjectIteratorGetValue(&it));
+    bool isInt = !(info & (JSJL_ARG|JSJL_NOT_INT));
+    JsVar *v = jsvNewFromInteger(isInt ? ((slot++)<<1)|1 : (varSlot++)<<1);
+    jsvObjectIteratorSetValue(&it, v);
+    jsvUnLock(v);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+  jsjLocalCount = slot;
+  if (!jsjLocalCount) return;
+  if (jsjLocalCount > JSJ_MAX_LOCALS) {
+    jsExceptionHere(JSET_ERROR, "JIT: Too many local variables (max %d)", JSJ_MAX_LOCALS);
+    return;
+  }
+  DEBUG_JIT("; LOCALS %d (%d NAMEs)\n", jsjLocalCount, jsjVarLocalCount);
+  jsjcSubSP(jsjLocalCount*JSJC_STACK_ITEM_SIZE);
+  for (int i=0;i<*argCount;i++)
+    jsjcStoreImm(i, JSJAR_SP, jsjLocalOffset(i)); // arguments are in r0-r3
+  jsvObjectIteratorNew(&it, jsjLocals);
+  while (jsvObjectIteratorHasValue(&it)) {
+    JsVar *name = jsvObjectIteratorGetKey(&it);
+    int info = (int)jsvGetIntegerAndUnLock(jsvObjectIteratorGetValue(&it));
+    int offset = jsjLocalOffset(info>>1);
+    if (info&1) { // integer
+      jsjcLiteral32(0, 0);
+      jsjcStoreImm(0, JSJAR_SP, offset);
+    } else { // NAME, with the argument's value if there was one
+      if ((info>>1) < *argCount) jsjcLoadImm(1, JSJAR_SP, offset);
+      else jsjcLiteral32(1, 0);
+      jsjcLiteralString(0, name, true);
+      jsjcCall(_jsjxNewLocal); // JsVar *_jsjxNewLocal(const char *name, JsVar *value)
+      jsjcStoreImm(0, JSJAR_SP, offset);
+    }
+    jsvUnLock(name);
+    jsvObjectIteratorNext(&it);
+  }
+  jsvObjectIteratorFree(&it);
+}
+
+JsVar *jsjParseFunction(JsVar *funcVar, JsnArgumentType *argTypes) {
+  // funcVar is 0 if we're not executing (eg. after an uncaught exception) - just parse normally
+  if (!funcVar || (execInfo.execute&EXEC_RUN_MASK)!=EXEC_YES) return 0;
+  JsExecFlags oldExecute = execInfo.execute;
   jsjcStart();
-  // FIXME: I guess we need to create a function execution scope and unpack parameters?
-  // Maybe we could use jspeFunctionCall to do all this for us (not creating a native function but a 'normal' one
-  // with native function code...
-  jsjcPushAll(); // Function start
+  jsjcPushAll(); // Function start - r0-r3 are the arguments
+  jsjLocals = jsvNewObject();
+  jsjVarLocalCount = 0;
+  jsjLocalCount = 0;
+  int argCount = 0;
+  if (jsjLocals) jsjSetupLocals(funcVar, &argCount);
+  // arguments are all passed as JsVars
+  *argTypes = JSWAT_JSVAR;
+  for (int i=0;i<argCount && i<JSJ_MAX_ARGS;i++)
+    *argTypes |= (JsnArgumentType)(JSWAT_JSVAR << (JSWAT_BITS*(i+1)));
   jsjBlockNoBrackets();
   // optimisation: if the last statement was a return, no need for this. Could check if last instruction was 'POP {r4,r5,r6,r7,pc}'
   // Return 'undefined' from function if no other return statement
   jsjcLiteral32(0, 0);
-  jsjcPopAllAndReturn();
+  jsjReturn();
+  jsvUnLock(jsjLocals);
+  jsjLocals = 0;
+  jsjVarLocalCount = 0;
+  jsjLocalCount = 0;
   JsVar *v = jsjcStop();
   JsVar *exception = jspGetException();
   if (!exception) return v;
-  // We had an error - don't return half-complete code
+  // We had an error - don't return half-complete code, and allow the function to be parsed normally.
+  // Only clear the error flags that compiling set, not any that were already there
+  execInfo.execute &= (JsExecFlags)~(EXEC_EXCEPTION & ~oldExecute);
   jsiConsolePrintf("JIT %v\n", exception);
   if (jsvIsObject(exception)) {
     JsVar *stackTrace = jsvObjectGetChild(exception, "stack", 0);
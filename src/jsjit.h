@@ -20,12 +20,21 @@
 #endif
 
 #include "jsparse.h"
+#include "jswrapper.h"
+
+#ifdef __x86_64__
+#define JSJ_X86_64 ///< Emit x86-64 code (so JIT code can run in Linux builds) rather than ARM Thumb-2
+#define JSJ_CODE_OFFSET 0 ///< Amount added to the address of JIT code in order to call it
+#else
+#define JSJ_CODE_OFFSET 1 ///< Amount added to the address of JIT code in order to call it (bit 0 set = 'thumb')
+#endif
 
 JsVar *jsjEvaluateVar(JsVar *str);
 JsVar *jsjEvaluate(const char *str);
 
-// parse a function and return a native string of the code. Assumes '{' has already been parsed
-JsVar *jsjParseFunction();
+/* parse a function and return a native string of the code. Assumes '{' has already been parsed.
+ * The arguments that the code needs when called are put in argTypes */
+JsVar *jsjParseFunction(JsVar *funcVar, JsnArgumentType *argTypes);
 
 #endif /* JSJIT_H_ */
 #endif /* ESPR_JIT */
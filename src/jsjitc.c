@@ -40,6 +40,14 @@ FILE *f;
 // The ARM Thumb-2 code we're in the process of creating
 JsVar *jitCode = 0;
 int blockCount = 0;
+// How many items are on the stack, and what types they are (so jsjcPop can tell us what we have)
+int stackDepth = 0;
+JsjValueType stackTypes[JSJC_MAX_STACK_DEPTH];
+// Addresses used by jsjcCall/jsjcLiteralAddress. These are stored after the code, so calls can load them PC-relative rather than building a literal each time
+void *poolEntries[JSJC_MAX_POOL_ENTRIES];
+int poolCount = 0;
+// Where jsjcPushAll wrote the instruction that loads the address of the pool into JSJC_POOL_REG (or -1 if there's no pool)
+int poolPatchOffset = -1;
 
 void jsjcDebugPrintf(const char *fmt, ...) {
   if (jsFlags & JSF_JIT_DEBUG) {
@@ -58,14 +66,38 @@ void jsjcStart() {
 #endif
   jitCode = jsvNewFromEmptyString();
   blockCount = 0;
+  stackDepth = 0;
+  poolCount = 0;
+  poolPatchOffset = -1;
 }
 
 JsVar *jsjcStop() {
   assert(blockCount==0);
+  int poolOffset = 0;
+  if (poolPatchOffset>=0) {
+    // Add the constant pool to the end of the code, aligned
+    while (jsjcGetByteCount() & (JSJC_POOL_ITEM_SIZE-1)) {
+      uint8_t zero = 0;
+      jsjcEmit(&zero, 1);
+    }
+    poolOffset = jsjcGetByteCount();
+    DEBUG_JIT("... constant pool (%d entries) ...\n", poolCount);
+    for (int i=0;i<poolCount;i++)
+      jsjcEmit(&poolEntries[i], JSJC_POOL_ITEM_SIZE);
+  }
+  JsVar *v = jsvAsFlatString(jitCode);
+  if (v && poolPatchOffset>=0) {
+    // Now we know where the pool is, point jsjcPushAll's code at it
+    unsigned char *code = (unsigned char *)jsvGetFlatStringPointer(v);
+    jsjcPatchPoolAddress(code, poolPatchOffset, poolOffset);
+#ifdef JIT_OUTPUT_FILE
+    fseek(f, poolPatchOffset, SEEK_SET);
+    fwrite(&code[poolPatchOffset], 1, JSJC_POOL_PATCH_SIZE, f);
+#endif
+  }
 #ifdef JIT_OUTPUT_FILE
   fclose(f);
 #endif
-  JsVar *v = jsvAsFlatString(jitCode);
   jsvUnLock(jitCode);
   jitCode = 0;
   return v;
@@ -86,34 +118,83 @@ JsVar *jsjcStopBlock(JsVar *oldBlock) {
   return v;
 }
 
-void jsjcEmit16(uint16_t v) {
-  //DEBUG_JIT("> %04x\n", v);
+void jsjcEmit(const void *data, size_t len) {
 #ifdef JIT_OUTPUT_FILE
-  if (!blockCount) {
-    fputc(v&255, f);
-    fputc(v>>8, f);
-  }
+  if (!blockCount) fwrite(data, 1, len, f);
 #endif
-  jsvAppendStringBuf(jitCode, (char *)&v, 2);
+  jsvAppendStringBuf(jitCode, (const char *)data, len);
 }
 
 // Emit a whole block of code
 void jsjcEmitBlock(JsVar *block) {
   DEBUG_JIT("... code block ...\n");
-  JsvStringIterator it;
-  jsvStringIteratorNew(&it, block, 0);
-  while (jsvStringIteratorHasChar(&it)) {
-    unsigned int v = (unsigned)jsvStringIteratorGetCharAndNext(&it);
-    v = v | (((unsigned)jsvStringIteratorGetCharAndNext(&it)) << 8);
-    jsjcEmit16((uint16_t)v);
+#ifdef JIT_OUTPUT_FILE
+  if (!blockCount) {
+    JsvStringIterator it;
+    jsvStringIteratorNew(&it, block, 0);
+    while (jsvStringIteratorHasChar(&it))
+      fputc(jsvStringIteratorGetCharAndNext(&it), f);
+    jsvStringIteratorFree(&it);
   }
-  jsvStringIteratorFree(&it);
+#endif
+  jsvAppendStringVarComplete(jitCode, block);
 }
 
 int jsjcGetByteCount() {
   return jsvGetStringLength(jitCode);
 }
 
+int jsjcGetStackDepth() {
+  return stackDepth;
+}
+
+JsjValueType jsjcGetStackType(int item) {
+  int i = stackDepth-(item+1);
+  if (i<0 || i>=JSJC_MAX_STACK_DEPTH) return JSJVT_JSVAR;
+  return stackTypes[i];
+}
+
+void jsjcSetStackType(int item, JsjValueType type) {
+  int i = stackDepth-(item+1);
+  if (i>=0 && i<JSJC_MAX_STACK_DEPTH) stackTypes[i] = type;
+}
+
+void jsjcStackPushed(JsjValueType type) {
+  if (stackDepth>=JSJC_MAX_STACK_DEPTH) {
+    // we'd lose track of types, so we can't compile this
+    if (type!=JSJVT_JSVAR) jsExceptionHere(JSET_ERROR, "JIT: Expression too complex");
+  } else
+    stackTypes[stackDepth] = type;
+  stackDepth++;
+}
+
+JsjValueType jsjcStackPopped() {
+  JsjValueType type = jsjcGetStackType(0);
+  if (stackDepth>0) stackDepth--; // could be unbalanced if we stopped parsing because of an error
+  return type;
+}
+
+void jsjcStartPool() {
+  assert(blockCount==0);
+  poolPatchOffset = jsjcGetByteCount();
+}
+
+int jsjcGetPoolIndex(void *addr) {
+  if (poolPatchOffset<0) return -1; // no pool register set up
+  for (int i=0;i<poolCount;i++)
+    if (poolEntries[i]==addr) return i;
+  if (poolCount>=JSJC_MAX_POOL_ENTRIES) return -1;
+  poolEntries[poolCount] = addr;
+  return poolCount++;
+}
+
+#ifndef JSJ_X86_64 // x86-64 backend is in jsjitc_x86.c
+
+void jsjcEmit16(uint16_t v) {
+  //DEBUG_JIT("> %04x\n", v);
+  jsjcEmit(&v, 2);
+}
+
 void jsjcLiteral8(int reg, uint8_t data) {
   assert(reg<8);
   // https://web.eecs.umich.edu/~prabal/teaching/eecs373-f11/readings/ARMv7-M_ARM.pdf page 347
@@ -122,8 +203,8 @@ void jsjcLiteral8(int reg, uint8_t data) {
   jsjcEmit16((uint16_t)n);
 }
 
-void jsjcLiteral16(int reg, bool hi16, uint16_t data) {
-  assert(reg<16);
+/// Encode MOVW/MOVT into two 16 bit words
+static void jsjcEncodeLiteral16(uint16_t *code, int reg, bool hi16, uint16_t data) {
   // https://web.eecs.umich.edu/~prabal/teaching/eecs373-f11/readings/ARMv7-M_ARM.pdf page 347
   // https://developer.arm.com/documentation/ddi0308/d/Thumb-Instructions/Alphabetical-list-of-Thumb-instructions/MOV--immediate-
   int imm4,i,imm3,imm8;
@@ -131,8 +212,16 @@ void jsjcLiteral16(int reg, bool hi16, uint16_t data) {
   i = (data>>11)&1;
   imm3 = (data>>8)&7;
   imm8 = data&255;
-  jsjcEmit16((uint16_t)(0b1111001001000000 | (hi16?(1<<7):0)|  (i<<10) | imm4));
-  jsjcEmit16((uint16_t)((imm3<<12) | imm8 | (reg<<8)));
+  code[0] = (uint16_t)(0b1111001001000000 | (hi16?(1<<7):0)|  (i<<10) | imm4);
+  code[1] = (uint16_t)((imm3<<12) | imm8 | (reg<<8));
+}
+
+void jsjcLiteral16(int reg, bool hi16, uint16_t data) {
+  assert(reg<16);
+  uint16_t code[2];
+  jsjcEncodeLiteral16(code, reg, hi16, data);
+  jsjcEmit16(code[0]);
+  jsjcEmit16(code[1]);
 }
 
 void jsjcLiteral32(int reg, uint32_t data) {
@@ -196,6 +285,22 @@ void jsjcBranchRelative(int bytes) {
   jsjcEmit16((uint16_t)(0b1110000000000000 | imm11)); // unconditional branch
 }
 
+// Compare two registers (as signed 32 bit ints). jsjcBranchConditionalRelative can then be called
+void jsjcCompare(int regA, int regB) {
+  DEBUG_JIT("CMP r%d,r%d\n", regA, regB);
+  assert(regA>=0 && regA<8);
+  assert(regB>=0 && regB<8);
+  jsjcEmit16((uint16_t)(0b0100001010000000 | (regB<<3) | regA));
+}
+
+// regTo = regTo + regFrom (as 32 bit ints), setting the overflow flag
+void jsjcAdd(int regTo, int regFrom) {
+  DEBUG_JIT("ADDS r%d,r%d,r%d\n", regTo, regTo, regFrom);
+  assert(regTo>=0 && regTo<8);
+  assert(regFrom>=0 && regFrom<8);
+  jsjcEmit16((uint16_t)(0b0001100000000000 | (regFrom<<6) | (regTo<<3) | regTo));
+}
+
 // Jump a number of bytes forward or back, based on condition flags
 void jsjcBranchConditionalRelative(JsjAsmCondition cond, int bytes) {
   DEBUG_JIT("B[%d] %s%d (addr 0x%04x)\n", cond, (bytes>0)?"+":"", (uint32_t)(bytes), jsjcGetByteCount()+bytes);
@@ -206,6 +311,23 @@ void jsjcBranchConditionalRelative(JsjAsmCondition cond, int bytes) {
   jsjcEmit16((uint16_t)(0b1101000000000000 | (cond<<8) | imm8)); // conditional branch
 }
 
+void jsjcLiteralAddress(int reg, void *addr) {
+  assert(reg<8);
+  int idx = jsjcGetPoolIndex(addr);
+  if (idx<0) { // no space in the pool
+    jsjcLiteral32(reg, (uint32_t)(size_t)addr);
+    return;
+  }
+  int offset = idx*JSJC_POOL_ITEM_SIZE;
+  DEBUG_JIT("LDR r%d,[r%d,#%d] (=0x%08x)\n", reg, JSJC_POOL_REG, offset, (uint32_t)(size_t)addr);
+  if (offset<128) {
+    jsjcEmit16((uint16_t)(0b0110100000000000 | ((offset>>2)<<6) | (JSJC_POOL_REG<<3) | reg));
+  } else { // LDR.W Rt,[Rn,#imm12]
+    jsjcEmit16((uint16_t)(0b1111100011010000 | JSJC_POOL_REG));
+    jsjcEmit16((uint16_t)((reg<<12) | offset));
+  }
+}
+
 #ifdef DEBUG_JIT_CALLS
 void _jsjcCall(void *c, const char *name) {
 #else
@@ -216,7 +338,7 @@ void jsjcCall(void *c) {
     jsjcEmit16((uint16_t)(0b1111000000000000 | ((v>>11)&0x7FF)));
     jsjcEmit16((uint16_t)(0b1111100000000000 | (v&0x7FF)));
   } else */{
-    jsjcLiteral32(7, (uint32_t)(size_t)c); // save address to r7
+    jsjcLiteralAddress(7, c); // save address to r7
 #ifdef DEBUG_JIT_CALLS
     DEBUG_JIT("BLX r7 (%s)\n", name);
 #else
@@ -255,39 +377,54 @@ void jsjcPush(int reg, JsjValueType type) {
   DEBUG_JIT("PUSH {r%d}\n", reg);
   assert(reg>=0 && reg<8);
   jsjcEmit16((uint16_t)(0b1011010000000000 | (1<<reg)));
+  jsjcStackPushed(type);
 }
 
 JsjValueType jsjcPop(int reg) {
   DEBUG_JIT("POP {r%d}\n", reg);
   assert(reg>=0 && reg<8);
   jsjcEmit16((uint16_t)(0b1011110000000000 | (1<<reg)));
-  return JSJVT_JSVAR; // FIXME
+  return jsjcStackPopped();
 }
 
 void jsjcAddSP(int amt) {
   assert((amt&3)==0 && amt>0 && amt<512);
   DEBUG_JIT("ADD SP,SP,#%d\n", amt);
   jsjcEmit16((uint16_t)(0b1011000000000000 | (amt>>2)));
+  for (int i=0;i<amt;i+=JSJC_STACK_ITEM_SIZE) jsjcStackPopped();
 }
 
 void jsjcSubSP(int amt) {
   assert((amt&3)==0 && amt>0 && amt<512);
   DEBUG_JIT("SUB SP,SP,#%d\n", amt);
   jsjcEmit16((uint16_t)(0b1011000010000000 | (amt>>2)));
+  for (int i=0;i<amt;i+=JSJC_STACK_ITEM_SIZE) jsjcStackPushed(JSJVT_INT);
 }
 
 
 void jsjcLoadImm(int reg, int regAddr, int offset) {
-  assert((offset&3)==0 && offset>=0 && offset<128);
   assert(reg<8);
+  if (regAddr==JSJAR_SP) { // LDR Rt,[SP,#imm8*4]
+    assert((offset&3)==0 && offset>=0 && offset<1024);
+    DEBUG_JIT("LDR r%d,SP,#%d\n", reg, offset);
+    jsjcEmit16((uint16_t)(0b1001100000000000 | (reg<<8) | (offset>>2)));
+    return;
+  }
+  assert((offset&3)==0 && offset>=0 && offset<128);
   assert(regAddr<8);
   DEBUG_JIT("LDR r%d,r%d,#%d\n", reg, regAddr, offset);
   jsjcEmit16((uint16_t)(0b0110100000000000 | ((offset>>2)<<6) | (regAddr<<3) | reg));
 }
 
 void jsjcStoreImm(int reg, int regAddr, int offset) {
-  assert((offset&3)==0 && offset>=0 && offset<128);
   assert(reg<8);
+  if (regAddr==JSJAR_SP) { // STR Rt,[SP,#imm8*4]
+    assert((offset&3)==0 && offset>=0 && offset<1024);
+    DEBUG_JIT("STR r%d,SP,#%d\n", reg, offset);
+    jsjcEmit16((uint16_t)(0b1001000000000000 | (reg<<8) | (offset>>2)));
+    return;
+  }
+  assert((offset&3)==0 && offset>=0 && offset<128);
   assert(regAddr<8);
   DEBUG_JIT("STR r%d,r%d,#%d\n", reg, regAddr, offset);
   jsjcEmit16((uint16_t)(0b0110000000000000 | ((offset>>2)<<6) | (regAddr<<3) | reg));
@@ -296,6 +433,21 @@ void jsjcStoreImm(int reg, int regAddr, int offset) {
 void jsjcPushAll() {
   DEBUG_JIT("PUSH {r4,r5,r6,r7,lr}\n");
   jsjcEmit16(0xb5f0);
+  // Load the address of the constant pool into r5. We don't know where it is yet, so jsjcPatchPoolAddress fills in the MOVW
+  jsjcStartPool();
+  DEBUG_JIT("MOVW r%d,#(pool-pc)\n", JSJC_POOL_REG);
+  jsjcLiteral16(JSJC_POOL_REG, false, 0);
+  DEBUG_JIT("ADD r%d,PC\n", JSJC_POOL_REG);
+  jsjcEmit16((uint16_t)(0b0100010001111000 | JSJC_POOL_REG));
+}
+
+void jsjcPatchPoolAddress(unsigned char *code, int patchOffset, int poolOffset) {
+  // 'ADD rx,PC' is 4 bytes after the MOVW, and PC reads as the ADD's address + 4
+  int offset = poolOffset - (patchOffset + 8);
+  assert(offset>=0 && offset<65536);
+  uint16_t movw[2];
+  jsjcEncodeLiteral16(movw, JSJC_POOL_REG, false, (uint16_t)offset);
+  memcpy(&code[patchOffset], movw, sizeof(movw));
 }
 void jsjcPopAllAndReturn() {
   DEBUG_JIT("POP {r4,r5,r6,r7,pc}\n");
@@ -308,4 +460,6 @@ void jsjcPopAllAndReturn() {
   jsjcEmit16(0b0100011100000000 | (reg<<3));
 }*/
 
+#endif /* !JSJ_X86_64 */
+
 #endif /* ESPR_JIT */
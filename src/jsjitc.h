@@ -23,10 +23,15 @@
 void jsjcDebugPrintf(const char *fmt, ...);
 
 typedef enum {
-  JSJVT_INT,
-  JSJVT_JSVAR
+  JSJVT_INT,   ///< A raw 32 bit integer
+  JSJVT_BOOL,  ///< A raw boolean (0 or 1)
+  JSJVT_JSVAR  ///< A locked JsVar (which could be a NAME)
 } JsjValueType;
 
+#define JSJC_MAX_STACK_DEPTH 64 ///< How many items we keep track of the types for on the stack
+#define JSJC_MAX_POOL_ENTRIES 64 ///< How many different addresses we can store in the constant pool
+#define JSJC_POOL_REG 5 ///< Register (preserved over calls) that holds the address of the constant pool
+
 typedef enum {
   JSJAC_EQ, // 0
   JSJAC_NE,
@@ -44,6 +49,11 @@ typedef enum {
   JSJAC_LE,
 } JsjAsmCondition;
 
+/* Registers are always given as ARM registers. On x86-64 these are mapped
+ * onto real registers (see jsjitc_x86.c) and the ARM calling convention is
+ * emulated, so r0-r3 are the first 4 arguments, r0 (and r1) are the return
+ * value, r4-r7 are preserved over calls, and arguments 5 and 6 are pushed
+ * onto the stack before jsjcCall. */
 typedef enum {
   JSJAR_r0,
   JSJAR_r1,
@@ -54,6 +64,24 @@ typedef enum {
   JSJAR_PC = 15,
 } JsjAsmReg;
 
+#ifdef JSJ_X86_64
+#define JSJC_STACK_ITEM_SIZE 8 ///< How many bytes jsjcPush uses on the stack
+#define JSJC_BRANCH_SIZE 5 ///< How many bytes the code from jsjcBranchRelative takes up
+#define JSJC_POOL_ITEM_SIZE 8 ///< How many bytes each address in the constant pool uses
+#define JSJC_POOL_PATCH_SIZE 7 ///< How many bytes jsjcPatchPoolAddress modifies
+/// Two values returned from a function called with jsjcCall - end up in r0 and r1 (rax,rdx)
+typedef struct { JsVar *r0, *r1; } JsjValuePair;
+#define jsjcValuePair(R0,R1) ((JsjValuePair){(R0),(R1)})
+#else
+#define JSJC_STACK_ITEM_SIZE 4 ///< How many bytes jsjcPush uses on the stack
+#define JSJC_BRANCH_SIZE 2 ///< How many bytes the code from jsjcBranchRelative takes up
+#define JSJC_POOL_ITEM_SIZE 4 ///< How many bytes each address in the constant pool uses
+#define JSJC_POOL_PATCH_SIZE 4 ///< How many bytes jsjcPatchPoolAddress modifies
+/// Two values returned from a function called with jsjcCall - end up in r0 and r1
+typedef uint64_t JsjValuePair;
+#define jsjcValuePair(R0,R1) (((uint64_t)(size_t)(R0)) | (((uint64_t)(size_t)(R1))<<32))
+#endif
+
 
 
 // Called before start of JIT output
@@ -68,6 +96,8 @@ JsVar *jsjcStopBlock(JsVar *oldBlock);
 void jsjcEmitBlock(JsVar *block);
 // Get what byte we're at in our code
 int jsjcGetByteCount();
+// Add raw bytes of code (used by the backends)
+void jsjcEmit(const void *data, size_t len);
 
 // Add 16 bit literal
 void jsjcLiteral16(int reg, bool hi16, uint16_t data);
@@ -75,6 +105,14 @@ void jsjcLiteral16(int reg, bool hi16, uint16_t data);
 void jsjcLiteral32(int reg, uint32_t data);
 // Add 64 bit literal in reg,reg+1
 void jsjcLiteral64(int reg, uint64_t data);
+// Called by jsjcPushAll's backend when it emits the code that loads the address of the constant pool
+void jsjcStartPool();
+// Get the index of an address in the constant pool, adding it if needed. Returns -1 if there is no pool or it is full
+int jsjcGetPoolIndex(void *addr);
+// Called from jsjcStop with the finished code, to make jsjcPushAll's code point to the constant pool
+void jsjcPatchPoolAddress(unsigned char *code, int patchOffset, int poolOffset);
+// Load an address into a register (from the constant pool if possible)
+void jsjcLiteralAddress(int reg, void *addr);
 // Call a function
 #ifdef DEBUG_JIT_CALLS
 void _jsjcCall(void *c, const char *name);
@@ -86,9 +124,9 @@ void jsjcCall(void *c);
 int jsjcLiteralString(int reg, JsVar *str, bool nullTerminate);
 // Compare a register with a literal. jsjcBranchConditionalRelative can then be called
 void jsjcCompareImm(int reg, int literal);
-// Jump a number of bytes forward or back
+// Jump a number of bytes forward or back (relative to the end of the branch)
 void jsjcBranchRelative(int bytes);
-// Jump a number of bytes forward or back, based on condition flags
+// Jump a number of bytes forward or back (relative to the end of the branch), based on condition flags
 void jsjcBranchConditionalRelative(JsjAsmCondition cond, int bytes);
 // Move one register to another
 void jsjcMov(int regTo, int regFrom);
@@ -96,19 +134,34 @@ void jsjcMov(int regTo, int regFrom);
 void jsjcMVN(int regTo, int regFrom);
 // regTo = regTo & regFrom
 void jsjcAND(int regTo, int regFrom);
+// Compare two registers (as signed 32 bit ints). jsjcBranchConditionalRelative can then be called
+void jsjcCompare(int regA, int regB);
+// regTo = regTo + regFrom (as 32 bit ints), setting the overflow flag
+void jsjcAdd(int regTo, int regFrom);
 // Push a register onto the stack
 void jsjcPush(int reg, JsjValueType type);
 // Pop off the stack to a register
 JsjValueType jsjcPop(int reg);
-// Add a value to the stack pointer (only multiple of 4)
+// Add a value to the stack pointer (only multiple of JSJC_STACK_ITEM_SIZE)
 void jsjcAddSP(int amt);
-// Subtract a value from the stack pointer (only multiple of 4)
+// Subtract a value from the stack pointer (only multiple of JSJC_STACK_ITEM_SIZE)
 void jsjcSubSP(int amt);
+// How many items are on the stack (since jsjcStart)
+int jsjcGetStackDepth();
+// Get the type of the item on the stack (0 = top of the stack)
+JsjValueType jsjcGetStackType(int item);
+// Set the type of the item on the stack (0 = top of the stack) - used when converting in place
+void jsjcSetStackType(int item, JsjValueType type);
+// Called by the backends when an item has been pushed
+void jsjcStackPushed(JsjValueType type);
+// Called by the backends when an item has been popped - returns its type
+JsjValueType jsjcStackPopped();
 // reg = mem[regAddr + offset]
 void jsjcLoadImm(int reg, int regAddr, int offset);
 // mem[regAddr + offset] = reg
 void jsjcStoreImm(int reg, int regAddr, int offset);
 
+// Save registers at the start of a function and set up JSJC_POOL_REG. Afterwards r0-r3 still contain the function's arguments
 void jsjcPushAll();
 void jsjcPopAllAndReturn();
 
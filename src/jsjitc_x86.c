@@ -0,0 +1,370 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2013 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Recursive descent JIT - x86-64 backend
+ * ----------------------------------------------------------------------------
+
+ This implements the same jsjc* functions as jsjitc.c, but outputs x86-64 code
+ for the System V ABI (Linux) so JIT code can run (and be tested) on a PC.
+
+ jsjit.c is written for ARM, so we map ARM registers onto x86 registers:
+
+   r0 -> rax : first argument and return value (copied to rdi for calls)
+   r1 -> rsi : second argument / second return value (copied from rdx after calls)
+   r2 -> rdx : third argument
+   r3 -> rcx : fourth argument
+   r4-r7 -> rbx,r12,r13,r14 : preserved over calls (r5/r12 holds the constant pool address)
+   sp -> rsp
+
+ ARM passes the 5th and 6th arguments on the stack, so before each call we
+ load those into r8/r9. r15 holds the stack pointer while calling (as we have
+ to align rsp to 16 bytes) and rbp is the frame pointer, so that 'return'
+ can restore the stack whatever is on it.
+
+ Disassemble jit.bin with `objdump -D -b binary -m i386:x86-64 jit.bin`
+
+ */
+#ifdef ESPR_JIT
+#include "jsjitc.h"
+#ifdef JSJ_X86_64
+
+#define X86_RAX 0
+#define X86_RCX 1
+#define X86_RDX 2
+#define X86_RBX 3
+#define X86_RSP 4
+#define X86_RBP 5
+#define X86_RSI 6
+#define X86_RDI 7
+#define X86_R8  8
+#define X86_R9  9
+#define X86_R11 11
+#define X86_R12 12
+#define X86_R13 13
+#define X86_R14 14
+#define X86_R15 15
+
+#define X86_REX_W 0x48
+#define X86_SAVED_REGS 5 ///< rbx, r12-r15 - pushed after rbp by jsjcPushAll
+
+static const char *x86RegNames[16] = {
+  "rax","rcx","rdx","rbx","rsp","rbp","rsi","rdi",
+  "r8","r9","r10","r11","r12","r13","r14","r15"
+};
+
+/// Convert an ARM register number to the x86 register we use for it
+static int x86Reg(int reg) {
+  switch (reg) {
+    case 0: return X86_RAX;
+    case 1: return X86_RSI;
+    case 2: return X86_RDX;
+    case 3: return X86_RCX;
+    case 4: return X86_RBX;
+    case 5: return X86_R12;
+    case 6: return X86_R13;
+    case 7: return X86_R14;
+    case JSJAR_SP: return X86_RSP;
+    default: assert(0); return X86_RAX;
+  }
+}
+
+static void x86Emit8(uint8_t v) {
+  jsjcEmit(&v, 1);
+}
+
+static void x86Emit32(uint32_t v) {
+  jsjcEmit(&v, 4); // x86 is little endian, like us
+}
+
+/// REX prefix for a 64 bit operation with 'reg' in ModRM.reg and 'rm' in ModRM.rm
+static void x86EmitREXW(int reg, int rm) {
+  x86Emit8((uint8_t)(X86_REX_W | ((reg&8)?4:0) | ((rm&8)?1:0)));
+}
+
+/// 64 bit op with both operands registers, eg. MOV rm,reg
+static void x86EmitRegReg(uint8_t opcode, int reg, int rm) {
+  x86EmitREXW(reg, rm);
+  x86Emit8(opcode);
+  x86Emit8((uint8_t)(0xC0 | ((reg&7)<<3) | (rm&7)));
+}
+
+/// 64 bit op on memory at [base+offset], eg. MOV reg,[base+offset]
+static void x86EmitRegMem(uint8_t opcode, int reg, int base, int offset) {
+  x86EmitREXW(reg, base);
+  x86Emit8(opcode);
+  x86Emit8((uint8_t)(0x80 | ((reg&7)<<3) | (base&7))); // [base+disp32]
+  if ((base&7)==X86_RSP) x86Emit8(0x24); // rsp/r12 as a base need a SIB byte
+  x86Emit32((uint32_t)offset);
+}
+
+/// 32 bit op with both operands registers, eg. ADD r/m32,r32
+static void x86EmitRegReg32(uint8_t opcode, int reg, int rm) {
+  if ((reg|rm)&8) x86Emit8((uint8_t)(0x40 | ((reg&8)?4:0) | ((rm&8)?1:0)));
+  x86Emit8(opcode);
+  x86Emit8((uint8_t)(0xC0 | ((reg&7)<<3) | (rm&7)));
+}
+
+/// Load an address into an x86 register - from the constant pool if we can
+static void x86LoadAddress(int xreg, void *addr) {
+  int idx = jsjcGetPoolIndex(addr);
+  if (idx<0) { // MOV r64,imm64
+    uint64_t v = (uint64_t)(size_t)addr;
+    x86Emit8((uint8_t)(X86_REX_W | ((xreg&8)?1:0)));
+    x86Emit8((uint8_t)(0xB8 | (xreg&7)));
+    x86Emit32((uint32_t)v);
+    x86Emit32((uint32_t)(v>>32));
+    return;
+  }
+  x86EmitRegMem(0x8B, xreg, x86Reg(JSJC_POOL_REG), idx*JSJC_POOL_ITEM_SIZE); // MOV r64,[r12+disp32]
+}
+
+static void x86Push(int xreg) {
+  if (xreg&8) x86Emit8(0x41); // REX.B
+  x86Emit8((uint8_t)(0x50 | (xreg&7)));
+}
+
+static void x86Pop(int xreg) {
+  if (xreg&8) x86Emit8(0x41); // REX.B
+  x86Emit8((uint8_t)(0x58 | (xreg&7)));
+}
+
+static void x86Mov(int xregTo, int xregFrom) {
+  x86EmitRegReg(0x89, xregFrom, xregTo); // MOV r/m64, r64
+}
+
+void jsjcLiteral32(int reg, uint32_t data) {
+  DEBUG_JIT("MOV r%d,#0x%08x\n", reg,data);
+  int xreg = x86Reg(reg);
+  // MOV r32,imm32 - zero extends to 64 bits
+  if (xreg&8) x86Emit8(0x41);
+  x86Emit8((uint8_t)(0xB8 | (xreg&7)));
+  x86Emit32(data);
+}
+
+void jsjcLiteral16(int reg, bool hi16, uint16_t data) {
+  assert(!hi16); // only used by jsjcLiteral32 on ARM
+  jsjcLiteral32(reg, data);
+}
+
+void jsjcLiteral64(int reg, uint64_t data) {
+  // Unlike ARM this fits in one register
+  DEBUG_JIT("MOV r%d,#0x%08x%08x\n", reg,(uint32_t)(data>>32),(uint32_t)data);
+  int xreg = x86Reg(reg);
+  x86Emit8((uint8_t)(X86_REX_W | ((xreg&8)?1:0)));
+  x86Emit8((uint8_t)(0xB8 | (xreg&7)));
+  x86Emit32((uint32_t)data);
+  x86Emit32((uint32_t)(data>>32));
+}
+
+void jsjcLiteralAddress(int reg, void *addr) {
+  DEBUG_JIT("MOV r%d,=0x%x\n", reg, (uint32_t)(size_t)addr);
+  x86LoadAddress(x86Reg(reg), addr);
+}
+
+int jsjcLiteralString(int reg, JsVar *str, bool nullTerminate) {
+  /* We store the String data here in-line, so store the address of it then jump forward over the data. */
+  int len = (int)jsvGetStringLength(str);
+  int realLen = len + (nullTerminate?1:0);
+  int xreg = x86Reg(reg);
+  DEBUG_JIT("LEA r%d,[rip+%d]\n", reg, JSJC_BRANCH_SIZE);
+  x86Emit8((uint8_t)(X86_REX_W | ((xreg&8)?4:0)));
+  x86Emit8(0x8D);
+  x86Emit8((uint8_t)(0x05 | ((xreg&7)<<3))); // [rip+disp32]
+  x86Emit32(JSJC_BRANCH_SIZE); // data is after the jump
+  // jump over the data
+  jsjcBranchRelative(realLen);
+  // write the data
+  DEBUG_JIT("... %d bytes data (%q) ...\n", (uint32_t)(realLen), str);
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  for (int i=0;i<realLen;i++)
+    x86Emit8((uint8_t)jsvStringIteratorGetCharAndNext(&it)); // returns 0 at the end
+  jsvStringIteratorFree(&it);
+  return len;
+}
+
+// Compare a register with a literal. jsjcBranchConditionalRelative can then be called
+void jsjcCompareImm(int reg, int literal) {
+  DEBUG_JIT("CMP r%d,#%d\n", reg, literal);
+  assert(literal>=0 && literal<128);
+  // Like ARM we compare 32 bits - ints are kept in the bottom 32 bits of the register
+  int xreg = x86Reg(reg);
+  if (xreg&8) x86Emit8(0x41); // REX.B
+  x86Emit8(0x83); // CMP r/m32,imm8
+  x86Emit8((uint8_t)(0xC0 | (7<<3) | (xreg&7)));
+  x86Emit8((uint8_t)literal);
+}
+
+// Compare two registers (as signed 32 bit ints). jsjcBranchConditionalRelative can then be called
+void jsjcCompare(int regA, int regB) {
+  DEBUG_JIT("CMP r%d,r%d\n", regA, regB);
+  x86EmitRegReg32(0x39, x86Reg(regB), x86Reg(regA)); // CMP r/m32,r32
+}
+
+// regTo = regTo + regFrom (as 32 bit ints), setting the overflow flag
+void jsjcAdd(int regTo, int regFrom) {
+  DEBUG_JIT("ADD r%d,r%d\n", regTo, regFrom);
+  x86EmitRegReg32(0x01, x86Reg(regFrom), x86Reg(regTo)); // ADD r/m32,r32
+}
+
+void jsjcBranchRelative(int bytes) {
+  DEBUG_JIT("JMP %s%d (addr 0x%04x)\n", (bytes>0)?"+":"", (uint32_t)(bytes), jsjcGetByteCount()+JSJC_BRANCH_SIZE+bytes);
+  x86Emit8(0xE9); // JMP rel32 - relative to the end of the instruction
+  x86Emit32((uint32_t)bytes);
+}
+
+// Jump a number of bytes forward or back, based on condition flags
+void jsjcBranchConditionalRelative(JsjAsmCondition cond, int bytes) {
+  // Jcc rel32 opcodes for each ARM condition (after a CMP)
+  static const uint8_t x86Conditions[] = {
+    0x84, // EQ -> JE
+    0x85, // NE -> JNE
+    0x83, // CS -> JAE
+    0x82, // CC -> JB
+    0x88, // MI -> JS
+    0x89, // PL -> JNS
+    0x80, // VS -> JO
+    0x81, // VC -> JNO
+    0x87, // HI -> JA
+    0x86, // LS -> JBE
+    0x8D, // GE -> JGE
+    0x8C, // LT -> JL
+    0x8F, // GT -> JG
+    0x8E, // LE -> JLE
+  };
+  assert(cond>=0 && cond<sizeof(x86Conditions));
+  DEBUG_JIT("J[%d] %s%d (addr 0x%04x)\n", cond, (bytes>0)?"+":"", (uint32_t)(bytes), jsjcGetByteCount()+6+bytes);
+  x86Emit8(0x0F);
+  x86Emit8(x86Conditions[cond]);
+  x86Emit32((uint32_t)bytes);
+}
+
+#ifdef DEBUG_JIT_CALLS
+void _jsjcCall(void *c, const char *name) {
+  DEBUG_JIT("CALL %s\n", name);
+#else
+void jsjcCall(void *c) {
+  DEBUG_JIT("CALL 0x%x\n", (uint32_t)(size_t)c);
+#endif
+  x86Mov(X86_RDI, X86_RAX); // r0 -> first argument
+  // arguments 5 and 6 were pushed onto the stack ARM-style: MOV r8,[rsp] / MOV r9,[rsp+8]
+  jsjcEmit("\x4C\x8B\x04\x24", 4);
+  jsjcEmit("\x4C\x8B\x4C\x24\x08", 5);
+  x86LoadAddress(X86_R11, c);
+  // save and align the stack pointer, as the ABI requires
+  x86Mov(X86_R15, X86_RSP);
+  jsjcEmit("\x48\x83\xE4\xF0", 4); // AND rsp,-16
+  jsjcEmit("\x41\xFF\xD3", 3); // CALL r11
+  x86Mov(X86_RSP, X86_R15);
+  x86Mov(X86_RSI, X86_RDX); // second return value -> r1
+}
+
+void jsjcMov(int regTo, int regFrom) {
+  DEBUG_JIT("MOV r%d <- r%d\n", regTo, regFrom);
+  assert(regFrom!=JSJAR_PC); // see jsjcLiteralString
+  x86Mov(x86Reg(regTo), x86Reg(regFrom));
+}
+
+// Move negated register
+void jsjcMVN(int regTo, int regFrom) {
+  DEBUG_JIT("NOT r%d <- r%d\n", regTo, regFrom);
+  int xreg = x86Reg(regTo);
+  if (regTo!=regFrom) x86Mov(xreg, x86Reg(regFrom));
+  x86EmitRegReg(0xF7, 2, xreg); // NOT r/m64
+}
+
+// regTo = regTo & regFrom
+void jsjcAND(int regTo, int regFrom) {
+  DEBUG_JIT("AND r%d <- r%d\n", regTo, regFrom);
+  x86EmitRegReg(0x21, x86Reg(regFrom), x86Reg(regTo)); // AND r/m64, r64
+}
+
+void jsjcPush(int reg, JsjValueType type) {
+  DEBUG_JIT("PUSH r%d (%s)\n", reg, x86RegNames[x86Reg(reg)]);
+  x86Push(x86Reg(reg));
+  jsjcStackPushed(type);
+}
+
+JsjValueType jsjcPop(int reg) {
+  DEBUG_JIT("POP r%d (%s)\n", reg, x86RegNames[x86Reg(reg)]);
+  x86Pop(x86Reg(reg));
+  return jsjcStackPopped();
+}
+
+void jsjcAddSP(int amt) {
+  assert((amt&(JSJC_STACK_ITEM_SIZE-1))==0 && amt>0);
+  DEBUG_JIT("ADD rsp,#%d\n", amt);
+  jsjcEmit("\x48\x81\xC4", 3); // ADD rsp,imm32
+  x86Emit32((uint32_t)amt);
+  for (int i=0;i<amt;i+=JSJC_STACK_ITEM_SIZE) jsjcStackPopped();
+}
+
+void jsjcSubSP(int amt) {
+  assert((amt&(JSJC_STACK_ITEM_SIZE-1))==0 && amt>0);
+  DEBUG_JIT("SUB rsp,#%d\n", amt);
+  jsjcEmit("\x48\x81\xEC", 3); // SUB rsp,imm32
+  x86Emit32((uint32_t)amt);
+  for (int i=0;i<amt;i+=JSJC_STACK_ITEM_SIZE) jsjcStackPushed(JSJVT_INT);
+}
+
+void jsjcLoadImm(int reg, int regAddr, int offset) {
+  DEBUG_JIT("MOV r%d,[r%d+%d]\n", reg, regAddr, offset);
+  x86EmitRegMem(0x8B, x86Reg(reg), x86Reg(regAddr), offset); // MOV r64,r/m64
+}
+
+void jsjcStoreImm(int reg, int regAddr, int offset) {
+  DEBUG_JIT("MOV [r%d+%d],r%d\n", regAddr, offset, reg);
+  x86EmitRegMem(0x89, x86Reg(reg), x86Reg(regAddr), offset); // MOV r/m64,r64
+}
+
+void jsjcPushAll() {
+  DEBUG_JIT("PUSH {rbp,rbx,r12,r13,r14,r15}, MOV rbp,rsp, MOV r0,rdi\n");
+  x86Push(X86_RBP);
+  x86Mov(X86_RBP, X86_RSP);
+  x86Push(X86_RBX);
+  x86Push(X86_R12);
+  x86Push(X86_R13);
+  x86Push(X86_R14);
+  x86Push(X86_R15);
+  // LEA r12,[rip+disp32] - address of the constant pool, filled in by jsjcPatchPoolAddress
+  jsjcStartPool();
+  DEBUG_JIT("LEA r%d,[rip+(pool)]\n", JSJC_POOL_REG);
+  int xreg = x86Reg(JSJC_POOL_REG);
+  x86Emit8((uint8_t)(X86_REX_W | ((xreg&8)?4:0)));
+  x86Emit8(0x8D);
+  x86Emit8((uint8_t)(0x05 | ((xreg&7)<<3))); // [rip+disp32]
+  x86Emit32(0);
+  x86Mov(X86_RAX, X86_RDI); // first argument -> r0 (r1-r3 are already in the right place)
+}
+
+void jsjcPatchPoolAddress(unsigned char *code, int patchOffset, int poolOffset) {
+  // rip-relative, so relative to the end of the LEA
+  uint32_t disp = (uint32_t)(poolOffset - (patchOffset + JSJC_POOL_PATCH_SIZE));
+  memcpy(&code[patchOffset+3], &disp, 4);
+}
+
+void jsjcPopAllAndReturn() {
+  DEBUG_JIT("LEA rsp,[rbp-%d], POP {r15,r14,r13,r12,rbx,rbp}, RET\n", X86_SAVED_REGS*8);
+  // restore the stack pointer to just after jsjcPushAll - we may have returned with stuff on the stack
+  x86Emit8(X86_REX_W);
+  x86Emit8(0x8D);
+  x86Emit8((uint8_t)(0x40 | (X86_RSP<<3) | X86_RBP)); // [rbp+disp8]
+  x86Emit8((uint8_t)(-X86_SAVED_REGS*8));
+  x86Pop(X86_R15);
+  x86Pop(X86_R14);
+  x86Pop(X86_R13);
+  x86Pop(X86_R12);
+  x86Pop(X86_RBX);
+  x86Pop(X86_RBP);
+  x86Emit8(0xC3); // RET
+}
+
+#endif /* JSJ_X86_64 */
+#endif /* ESPR_JIT */
@@ -141,8 +141,10 @@ JsVar *jspFindPrototypeFor(const char *className) {
 }
 
 /** Here we assume that we have already looked in the parent itself -
- * and are now going down looking at the stuff it inherited */
-JsVar *jspeiFindChildFromStringInParents(JsVar *parent, const char *name) {
+ * and are now going down looking at the stuff it inherited. If what
+ * we found wasn't in an Object, *cacheable is set to false (see
+ * jspGetNamedFieldInParents) */
+static JsVar *jspeiFindChildFromStringInParentsCacheable(JsVar *parent, const char *name, bool *cacheable) {
   if (jsvIsObject(parent)) {
     // If an object, look for an 'inherits' var
     JsVar *inheritsFrom = jsvObjectGetChild(parent, JSPARSE_INHERITS_VAR, 0);
@@ -155,8 +157,10 @@ JsVar *jspeiFindChildFromStringInParents(JsVar *parent, const char *name) {
       // we have what it inherits from (this is ACTUALLY the prototype var)
       // https://developer.mozilla.org/en-US/docs/JavaScript/Reference/Global_Objects/Object/proto
       JsVar *child = jsvFindChildFromString(inheritsFrom, name, false);
-      if (!child)
-        child = jspeiFindChildFromStringInParents(inheritsFrom, name);
+      if (child) {
+        if (!jsvIsObject(inheritsFrom)) *cacheable = false;
+      } else
+        child = jspeiFindChildFromStringInParentsCacheable(inheritsFrom, name, cacheable);
       jsvUnLock(inheritsFrom);
       if (child) return child;
     } else
@@ -174,6 +178,7 @@ JsVar *jspeiFindChildFromStringInParents(JsVar *parent, const char *name) {
           JsVar *proto = jsvObjectGetChild(obj, JSPARSE_PROTOTYPE_VAR, 0);
           if (proto) {
             result = jsvFindChildFromString(proto, name, false);
+            if (result && !jsvIsObject(proto)) *cacheable = false;
             jsvUnLock(proto);
           }
         }
@@ -191,6 +196,13 @@ JsVar *jspeiFindChildFromStringInParents(JsVar *parent, const char *name) {
   return 0;
 }
 
+/** Here we assume that we have already looked in the parent itself -
+ * and are now going down looking at the stuff it inherited */
+JsVar *jspeiFindChildFromStringInParents(JsVar *parent, const char *name) {
+  bool cacheable;
+  return jspeiFindChildFromStringInParentsCacheable(parent, name, &cacheable);
+}
+
 JsVar *jspeiGetScopesAsVar() {
   if (!execInfo.scopesVar) return 0; // no scopes!
   // If just one element, return it (no array)
@@ -345,11 +357,23 @@ NO_INLINE bool jspeFunctionDefinitionInternal(JsVar *funcVar, bool expressionOnl
         // save start position so if we fail we go back to a normal function parse
         JslCharPos funcCodeStart;
         jslCharPosFromLex(&funcCodeStart);
-        JsVar *funcCodeVar = jsjParseFunction();
+        JsnArgumentType argTypes;
+        JsVar *funcCodeVar = jsjParseFunction(funcVar, &argTypes);
         if (funcCodeVar) { // compilation could have failed!
           funcVar->flags = (funcVar->flags & ~JSV_VARTYPEMASK) | JSV_NATIVE_FUNCTION; // convert to native fn
-          funcVar->varData.native.ptr = (void *)(size_t)1; // offset 1 = 'thumb'
-          funcVar->varData.native.argTypes = JSWAT_JSVAR; // FIXME - need to add parameters if any specified...
+          funcVar->varData.native.ptr = (void *)(size_t)JSJ_CODE_OFFSET;
+          funcVar->varData.native.argTypes = argTypes;
+          // remove parameters - native functions would treat them as bound arguments
+          JsvObjectIterator it;
+          jsvObjectIteratorNew(&it, funcVar);
+          while (jsvObjectIteratorHasValue(&it)) {
+            JsVar *param = jsvObjectIteratorGetKey(&it);
+            bool isParam = jsvIsFunctionParameter(param);
+            jsvUnLock(param);
+            if (isParam) jsvObjectIteratorRemoveAndGotoNext(&it, funcVar);
+            else jsvObjectIteratorNext(&it);
+          }
+          jsvObjectIteratorFree(&it);
           jsvUnLock2(jsvAddNamedChild(funcVar, funcCodeVar, JSPARSE_FUNCTION_CODE_NAME), funcCodeVar);
           JSP_MATCH('}');
           jslCharPosFree(&funcCodeStart);
@@ -933,16 +957,123 @@ JsVar *jspGetNamedVariable(const char *tokenName) {
   return a;
 }
 
-/// Used by jspGetNamedField / jspGetVarNamedField
-static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName) {
+#ifdef ESPR_INLINE_CACHE
+typedef enum {
+  JSPIC_EMPTY,
+  JSPIC_NAME,    ///< Found in a prototype - 'name' is the name in the prototype
+  JSPIC_BUILTIN, ///< A built-in function, found in 'symbols'
+} PACKED_FLAGS JspInlineCacheType;
+
+typedef enum {
+  JSPIC_KEY_OBJECT, ///< key is the ref of the object's __proto__ (or 0)
+  JSPIC_KEY_NATIVE, ///< key is the native function's pointer
+  JSPIC_KEY_BASIC,  ///< key is the name from jswGetBasicObjectName
+} PACKED_FLAGS JspInlineCacheKeyType;
+
+/** Inline cache for an `a.b` in the code (see jspeFactorMember). If `b` wasn't
+ * in `a` itself, this remembers where it was found, so next time we can skip
+ * searching the prototype chain and the built-in symbol tables. */
+typedef struct {
+  JspInlineCacheType type;
+  JspInlineCacheKeyType keyType;
+  uint32_t epoch; ///< jsvPropertyEpoch when this was filled in - if it has changed this is invalid
+  size_t key; ///< What decided where `a` inherits from (see jspGetInlineCacheKey)
+  JsVarRef name; ///< JSPIC_NAME: the name found in the prototype
+  const JswSymList *symbols; ///< JSPIC_BUILTIN: the symbol table the function was found in
+} JspInlineCache;
+
+/// Inline caches, indexed by the position of the field name in the code
+static JspInlineCache jspInlineCaches[JSP_INLINE_CACHE_SIZE];
+
+/// Get the inline cache for the field name the lexer is currently at
+static JspInlineCache *jspGetInlineCache() {
+  size_t h = (size_t)jsvGetRef(lex->sourceVar)*31 + lex->tokenStart;
+  return &jspInlineCaches[h & (JSP_INLINE_CACHE_SIZE-1)];
+}
+
+/** Work out what decides where 'object' inherits things from (the
+ * same things are looked at by jspeiFindChildFromStringInParents and
+ * jswFindBuiltInFunction). Returns false if we can't cache lookups on it. */
+static bool jspGetInlineCacheKey(JsVar *object, JspInlineCacheKeyType *keyType, size_t *key) {
+  if (jsvIsRoot(object)) return false;
+  if (jsvIsObject(object)) {
+    JsVar *proto = jsvFindChildFromString(object, JSPARSE_INHERITS_VAR, false);
+    if (proto && jsvIsNameWithValue(proto)) { // not a reference to a prototype
+      jsvUnLock(proto);
+      return false;
+    }
+    *keyType = JSPIC_KEY_OBJECT;
+    *key = proto ? jsvGetFirstChild(proto) : 0;
+    jsvUnLock(proto);
+  } else if (jsvIsNativeFunction(object)) {
+    *keyType = JSPIC_KEY_NATIVE;
+    *key = (size_t)object->varData.native.ptr;
+  } else {
+    const char *basicName = jswGetBasicObjectName(object);
+    if (!basicName) return false;
+    *keyType = JSPIC_KEY_BASIC;
+    *key = (size_t)basicName;
+  }
+  return true;
+}
+#else
+typedef void JspInlineCache;
+#endif
+
+/// Used by jspGetNamedField / jspGetVarNamedField. cache may be 0
+static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* name, bool returnName, JspInlineCache *cache) {
+  JsVar *child = 0;
+#ifdef ESPR_INLINE_CACHE
+  JspInlineCacheKeyType keyType;
+  size_t key;
+  if (cache && !jspGetInlineCacheKey(object, &keyType, &key))
+    cache = 0;
+  if (cache && cache->type!=JSPIC_EMPTY && cache->epoch==jsvPropertyEpoch &&
+      cache->keyType==keyType && cache->key==key) {
+    // The name is checked, as different code could be using this cache entry
+    if (cache->type==JSPIC_NAME) {
+      child = jsvLock(cache->name);
+      if (!jsvIsStringEqual(child, name)) {
+        jsvUnLock(child);
+        child = 0;
+      }
+    } else
+      child = jswBinarySearch(cache->symbols, object, name);
+  }
+  if (!child) {
+    // Now look in prototypes
+    bool cacheable = true;
+    child = jspeiFindChildFromStringInParentsCacheable(object, name, &cacheable);
+    const JswSymList *symbols = 0;
+    /* Check for builtins via separate function
+     * This way we save on RAM for built-ins because everything comes out of program code */
+    if (!child)
+      child = jswFindBuiltIn(object, name, &symbols);
+    if (cache) {
+      cache->type = JSPIC_EMPTY;
+      if (child && symbols) {
+        cache->type = JSPIC_BUILTIN;
+        cache->symbols = symbols;
+      } else if (child && cacheable && jsvIsName(child)) {
+        cache->type = JSPIC_NAME;
+        cache->name = jsvGetRef(child);
+      }
+      cache->keyType = keyType;
+      cache->key = key;
+      cache->epoch = jsvPropertyEpoch;
+    }
+  }
+#else
+  NOT_USED(cache);
   // Now look in prototypes
-  JsVar * child = jspeiFindChildFromStringInParents(object, name);
+  child = jspeiFindChildFromStringInParents(object, name);
 
   /* Check for builtins via separate function
    * This way we save on RAM for built-ins because everything comes out of program code */
   if (!child) {
     child = jswFindBuiltInFunction(object, name);
   }
+#endif
 
   /* We didn't get here if we found a child in the object itself, so
    * if we're here then we probably have the wrong name - so for example
@@ -1000,7 +1131,7 @@ static NO_INLINE JsVar *jspGetNamedFieldInParents(JsVar *object, const char* nam
  * NOTE: ArrayBuffer/Strings are not handled here. We assume that if we're
  * passing a char* rather than a JsVar it's because we're looking up via
  * a symbol rather than a variable. To handle these use jspGetVarNamedField  */
-JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
+static JsVar *jspGetNamedFieldWithCache(JsVar *object, const char* name, bool returnName, JspInlineCache *cache) {
 
   JsVar *child = 0;
   // if we're an object (or pretending to be one)
@@ -1008,7 +1139,7 @@ JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
     child = jsvFindChildFromString(object, name, false);
 
   if (!child) {
-    child = jspGetNamedFieldInParents(object, name, returnName);
+    child = jspGetNamedFieldInParents(object, name, returnName, cache);
 
     // If not found and is the prototype, create it
     if (!child && jsvIsFunction(object) && strcmp(name, JSPARSE_PROTOTYPE_VAR)==0) {
@@ -1022,6 +1153,10 @@ JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
   else return jsvSkipNameAndUnLock(child);
 }
 
+JsVar *jspGetNamedField(JsVar *object, const char* name, bool returnName) {
+  return jspGetNamedFieldWithCache(object, name, returnName, 0);
+}
+
 /// see jspGetNamedField - note that nameVar should have had jsvAsArrayIndex called on it first
 JsVar *jspGetVarNamedField(JsVar *object, JsVar *nameVar, bool returnName) {
 
@@ -1048,7 +1183,7 @@ JsVar *jspGetVarNamedField(JsVar *object, JsVar *nameVar, bool returnName) {
       char name[JSLEX_MAX_TOKEN_LENGTH];
       jsvGetString(nameVar, name, JSLEX_MAX_TOKEN_LENGTH);
       // try and find it in parents
-      child = jspGetNamedFieldInParents(object, name, returnName);
+      child = jspGetNamedFieldInParents(object, name, returnName, 0);
 
       // If not found and is the prototype, create it
       if (!child && jsvIsFunction(object) && jsvIsStringEqual(nameVar, JSPARSE_PROTOTYPE_VAR)) {
@@ -1077,8 +1212,13 @@ NO_INLINE JsVar *jspeFactorMember(JsVar *a, JsVar **parentResult) {
 
           JsVar *aVar = jsvSkipNameWithParent(a,true,parent);
           JsVar *child = 0;
-          if (aVar)
+          if (aVar) {
+#ifdef ESPR_INLINE_CACHE
+            child = jspGetNamedFieldWithCache(aVar, name, true, jspGetInlineCache());
+#else
             child = jspGetNamedField(aVar, name, true);
+#endif
+          }
           if (!child) {
             if (!jsvIsNullish(aVar)) {
               // if no child found, create a pointer to where it could be
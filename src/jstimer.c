@@ -15,12 +15,11 @@
 #include "jsparse.h"
 #include "jsinteractive.h"
 
-/// Data for our tasks (eg when, what they are, etc)
+/** Data for our tasks (eg when, what they are, etc). This is a binary min-heap
+ * ordered by time, so utilTimerTasks[0] is always the next task to execute */
 UtilTimerTask utilTimerTasks[UTILTIMERTASK_TASKS];
-/// queue beginning (push tasks on here)
-volatile unsigned char utilTimerTasksHead = 0;
-/// queue end (tasks pop off here as they are complete)
-volatile unsigned char utilTimerTasksTail = 0;
+/// Amount of tasks in utilTimerTasks
+volatile unsigned short utilTimerTasksCount = 0;
 
 /// Is the utility timer actually running?
 volatile bool utilTimerOn = false;
@@ -31,8 +30,96 @@ unsigned int utilTimerData;
 uint16_t utilTimerReload0H, utilTimerReload0L, utilTimerReload1H, utilTimerReload1L;
 /// When we rescheduled the timer, how far in the future were we meant to get called (in system time)?
 int utilTimerPeriod;
-/// Incremented with utilTimerPeriod - used when we're adding multiple items and we want them all relative to each other
+/** Incremented with utilTimerPeriod - used when we're adding multiple items and we want them all relative to each other.
+ * Task times in utilTimerTasks are relative to utilTimerOffset=0, so they don't need updating as time passes */
 volatile int utilTimerOffset;
+/// Incremented for each task added to utilTimerTasks - used to order tasks with the same time
+static uint32_t utilTimerSeq;
+
+#ifndef SAVE_ON_FLASH
+/// Statistics for the utility timer, shown by E.dumpTimers()
+typedef struct {
+  unsigned int inserted; ///< Tasks added
+  unsigned int removed; ///< Tasks removed before they completed
+  unsigned int full; ///< Times a task couldn't be added because the queue was full
+  unsigned short maxTasks; ///< Most tasks there have been in the queue at once
+  JsSysTime maxIrqOffTime; ///< Longest time interrupts were off while accessing the queue (outside the IRQ)
+} UtilTimerStats;
+static UtilTimerStats utilTimerStats;
+static JsSysTime utilTimerIrqOffTime;
+#endif
+
+/// Turn interrupts off to access the queue (measuring for how long if we can)
+static void utilTimerInterruptOff() {
+  jshInterruptOff();
+#ifndef SAVE_ON_FLASH
+  utilTimerIrqOffTime = jshGetSystemTime();
+#endif
+}
+
+/// Turn interrupts back on after utilTimerInterruptOff
+static void utilTimerInterruptOn() {
+#ifndef SAVE_ON_FLASH
+  JsSysTime t = jshGetSystemTime() - utilTimerIrqOffTime;
+  if (t > utilTimerStats.maxIrqOffTime) utilTimerStats.maxIrqOffTime = t;
+#endif
+  jshInterruptOn();
+}
+
+/// How long until the given task time (in the utilTimerTasks list) is reached. Copes with wrapping
+static ALWAYS_INLINE int utilTimerTimeUntil(int time) {
+  return (int)((uint32_t)time - (uint32_t)utilTimerOffset);
+}
+
+/// Should task a be executed before task b? If both have the same time, the one added first goes first
+static ALWAYS_INLINE bool utilTimerTaskBefore(const UtilTimerTask *a, const UtilTimerTask *b) {
+  int diff = (int)((uint32_t)a->time - (uint32_t)b->time);
+  if (diff) return diff < 0;
+  return (int)(a->seq - b->seq) < 0;
+}
+
+/// Move the task at index i up the heap until it's in the right place. Returns its new index
+static unsigned int utilTimerHeapSiftUp(UtilTimerTask *tasks, unsigned int i) {
+  UtilTimerTask task = tasks[i];
+  while (i) {
+    unsigned int parent = (i-1)>>1;
+    if (!utilTimerTaskBefore(&task, &tasks[parent])) break;
+    tasks[i] = tasks[parent];
+    i = parent;
+  }
+  tasks[i] = task;
+  return i;
+}
+
+/// Move the task at index i down the heap until it's in the right place
+static void utilTimerHeapSiftDown(UtilTimerTask *tasks, unsigned int count, unsigned int i) {
+  UtilTimerTask task = tasks[i];
+  while (true) {
+    unsigned int child = i*2+1;
+    if (child >= count) break;
+    if (child+1 < count && utilTimerTaskBefore(&tasks[child+1], &tasks[child])) child++;
+    if (!utilTimerTaskBefore(&tasks[child], &task)) break;
+    tasks[i] = tasks[child];
+    i = child;
+  }
+  tasks[i] = task;
+}
+
+/// Remove the task at index i from the heap
+static void utilTimerHeapRemove(UtilTimerTask *tasks, unsigned int *count, unsigned int i) {
+  (*count)--;
+  if (i == *count) return;
+  tasks[i] = tasks[*count];
+  utilTimerHeapSiftDown(tasks, *count, i);
+  utilTimerHeapSiftUp(tasks, i);
+}
+
+/// Remove the task at index i from utilTimerTasks
+static void utilTimerRemoveIndex(unsigned int i) {
+  unsigned int count = utilTimerTasksCount;
+  utilTimerHeapRemove(utilTimerTasks, &count, i);
+  utilTimerTasksCount = (unsigned short)count;
+}
 
 
 #ifndef SAVE_ON_FLASH
@@ -91,16 +178,10 @@ void jstUtilTimerInterruptHandler() {
     utilTimerInIRQ = true;
     // TODO: Keep UtilTimer running and then use the value from it
     // to estimate how long utilTimerPeriod really was
-    // Subtract utilTimerPeriod from all timers' time
-    int t = utilTimerTasksTail;
-    while (t!=utilTimerTasksHead) {
-      utilTimerTasks[t].time -= utilTimerPeriod;
-      t = (t+1) & (UTILTIMERTASK_TASKS-1);
-    }
     utilTimerOffset += utilTimerPeriod;
     // Check timers and execute any timers that are due
-    while (utilTimerTasksTail!=utilTimerTasksHead && utilTimerTasks[utilTimerTasksTail].time <= 0) {
-      UtilTimerTask *task = &utilTimerTasks[utilTimerTasksTail];
+    while (utilTimerTasksCount && utilTimerTimeUntil(utilTimerTasks[0].time) <= 0) {
+      UtilTimerTask *task = &utilTimerTasks[0];
       void (*executeFn)(JsSysTime time, void* userdata) = 0;
       void *executeData = 0;
       switch (task->type) {
@@ -146,12 +227,10 @@ void jstUtilTimerInterruptHandler() {
         jstUtilTimerInterruptHandlerNextByte(task);
         task->data.buffer.currentValue = (unsigned short)sum;
         // now search for other tasks writing to this pin... (polyphony)
-        int t = (utilTimerTasksTail+1) & (UTILTIMERTASK_TASKS-1);
-        while (t!=utilTimerTasksHead) {
-          if (UET_IS_BUFFER_WRITE_EVENT(utilTimerTasks[t].type) && 
+        for (unsigned int t=1;t<utilTimerTasksCount;t++) {
+          if (UET_IS_BUFFER_WRITE_EVENT(utilTimerTasks[t].type) &&
               utilTimerTasks[t].data.buffer.pinFunction == task->data.buffer.pinFunction)
             sum += ((int)(unsigned int)utilTimerTasks[t].data.buffer.currentValue) - 32768;
-          t = (t+1) & (UTILTIMERTASK_TASKS-1);
         }
         // saturate
         if (sum<0) sum = 0;
@@ -167,23 +246,13 @@ void jstUtilTimerInterruptHandler() {
       // If we need to repeat
       if (task->repeatInterval) {
         // update time (we know time > task->time)
-        task->time += task->repeatInterval;
-
-        // do an in-place bubble sort to ensure that times are still in the right order
-        unsigned char ta = utilTimerTasksTail;
-        unsigned char tb = (ta+1) & (UTILTIMERTASK_TASKS-1);
-        while (tb != utilTimerTasksHead) {
-          if (utilTimerTasks[ta].time > utilTimerTasks[tb].time) {
-            UtilTimerTask task = utilTimerTasks[ta];
-            utilTimerTasks[ta] = utilTimerTasks[tb];
-            utilTimerTasks[tb] = task;
-          }
-          ta = tb;
-          tb = (tb+1) & (UTILTIMERTASK_TASKS-1);
-        }
+        task->time = (int)((uint32_t)task->time + task->repeatInterval);
+        task->seq = utilTimerSeq++; // as if it had just been added
+        // and move it down the heap so times are still in the right order
+        utilTimerHeapSiftDown(utilTimerTasks, utilTimerTasksCount, 0);
       } else {
         // Otherwise no repeat - just go straight to the next one!
-        utilTimerTasksTail = (utilTimerTasksTail+1) & (UTILTIMERTASK_TASKS-1);
+        utilTimerRemoveIndex(0);
       }
 
       // execute the function if we had one (we do this now, because if we did it earlier we'd have to cope with everything changing)
@@ -191,8 +260,8 @@ void jstUtilTimerInterruptHandler() {
     }
 
     // re-schedule the timer if there is something left to do
-    if (utilTimerTasksTail != utilTimerTasksHead) {
-      utilTimerPeriod = utilTimerTasks[utilTimerTasksTail].time;
+    if (utilTimerTasksCount) {
+      utilTimerPeriod = utilTimerTimeUntil(utilTimerTasks[0].time);
       if (utilTimerPeriod<0) utilTimerPeriod=0;
       jshUtilTimerReschedule(utilTimerPeriod);
     } else {
@@ -222,14 +291,13 @@ uint32_t jstGetUtilTimerOffset() {
 
 /// Is the timer full - can it accept any other signals?
 static bool utilTimerIsFull() {
-  unsigned char nextHead = (utilTimerTasksHead+1) & (UTILTIMERTASK_TASKS-1);
-  return nextHead == utilTimerTasksTail;
+  return utilTimerTasksCount >= UTILTIMERTASK_TASKS;
 }
 
 /* Restart the utility timer with the right period. This should not normally
 need to be called by anything outside jstimer.c */
 void  jstRestartUtilTimer() {
-  utilTimerPeriod = utilTimerTasks[utilTimerTasksTail].time;
+  utilTimerPeriod = utilTimerTimeUntil(utilTimerTasks[0].time);
   if (utilTimerPeriod<0) utilTimerPeriod=0;
   jshUtilTimerStart(utilTimerPeriod);
 }
@@ -241,87 +309,75 @@ void  jstRestartUtilTimer() {
  */
 bool utilTimerInsertTask(UtilTimerTask *task, uint32_t *timerOffset) {
   // check if queue is full or not
-  if (utilTimerIsFull()) return false;
-  if (!utilTimerInIRQ) jshInterruptOff();
-
-  // See above - keep times in sync
-  if (timerOffset)
-    task->time += (int)*timerOffset - (int)utilTimerOffset;
-
-  // find out where to insert
-  unsigned char insertPos = utilTimerTasksTail;
-  while (insertPos != utilTimerTasksHead && utilTimerTasks[insertPos].time < task->time)
-    insertPos = (insertPos+1) & (UTILTIMERTASK_TASKS-1);
-  bool haveChangedTimer = insertPos==utilTimerTasksTail;
-  //jsiConsolePrintf("Insert at %d, Tail is %d\n",insertPos,utilTimerTasksTail);
-  // shift items forward
-  int i = utilTimerTasksHead;
-  while (i != insertPos) {
-    unsigned char next = (i+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    utilTimerTasks[i] = utilTimerTasks[next];
-    i = next;
+  if (utilTimerIsFull()) {
+#ifndef SAVE_ON_FLASH
+    utilTimerStats.full++;
+#endif
+    return false;
   }
-  // add new item
-  utilTimerTasks[insertPos] = *task;
-  // increase task list size
-  utilTimerTasksHead = (utilTimerTasksHead+1) & (UTILTIMERTASK_TASKS-1);
-  //jsiConsolePrint("Head is %d\n", utilTimerTasksHead);
+  if (!utilTimerInIRQ) utilTimerInterruptOff();
+
+  // See above - keep times in sync, and store relative to utilTimerOffset=0
+  UtilTimerTask newTask = *task;
+  newTask.time = (int)((uint32_t)task->time + (timerOffset ? *timerOffset : (uint32_t)utilTimerOffset));
+  newTask.seq = utilTimerSeq++;
+
+  // add it to the end, and move it up the heap
+  unsigned int insertPos = utilTimerTasksCount;
+  utilTimerTasks[insertPos] = newTask;
+  utilTimerTasksCount++;
+  insertPos = utilTimerHeapSiftUp(utilTimerTasks, insertPos);
+  bool haveChangedTimer = insertPos==0;
+#ifndef SAVE_ON_FLASH
+  utilTimerStats.inserted++;
+  if (utilTimerTasksCount > utilTimerStats.maxTasks)
+    utilTimerStats.maxTasks = utilTimerTasksCount;
+#endif
   // now set up timer if not already set up...
   if (!utilTimerOn || haveChangedTimer) {
     utilTimerOn = true;
     jstRestartUtilTimer();
   }
-  if (!utilTimerInIRQ) jshInterruptOn();
+  if (!utilTimerInIRQ) utilTimerInterruptOn();
   return true;
 }
 
+/** Find the task that 'checkCallback' returns true for that will be executed last.
+ * Returns its index in utilTimerTasks, or -1. Call with interrupts off */
+static int utilTimerFindLastTask(bool (checkCallback)(UtilTimerTask *task, void* data), void *checkCallbackData) {
+  int found = -1;
+  for (unsigned int i=0;i<utilTimerTasksCount;i++) {
+    if ((found<0 || !utilTimerTaskBefore(&utilTimerTasks[i], &utilTimerTasks[found])) &&
+        checkCallback(&utilTimerTasks[i], checkCallbackData))
+      found = (int)i;
+  }
+  return found;
+}
+
 /// Remove the task that that 'checkCallback' returns true for. Returns false if none found
 bool utilTimerRemoveTask(bool (checkCallback)(UtilTimerTask *task, void* data), void *checkCallbackData) {
-  jshInterruptOff();
-  unsigned char ptr = utilTimerTasksHead;
-  if (ptr != utilTimerTasksTail) {
-    unsigned char endPtr = ((utilTimerTasksTail+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1));
-    ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    // now we're at the last timer task - work back until we've just gone back past utilTimerTasksTail
-    while (ptr != endPtr) {
-      if (checkCallback(&utilTimerTasks[ptr], checkCallbackData)) {
-        // shift tail back along
-        unsigned char next = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-        while (next!=endPtr) {
-          utilTimerTasks[ptr] = utilTimerTasks[next];
-          ptr = next;
-          next = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-        }
-        // move 'end' pointer back
-        utilTimerTasksTail = (utilTimerTasksTail+1) & (UTILTIMERTASK_TASKS-1);
-        jshInterruptOn();
-        return true;
-      }
-      ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    }
+  utilTimerInterruptOff();
+  int i = utilTimerFindLastTask(checkCallback, checkCallbackData);
+  if (i>=0) {
+    utilTimerRemoveIndex((unsigned int)i);
+#ifndef SAVE_ON_FLASH
+    utilTimerStats.removed++;
+#endif
   }
-  jshInterruptOn();
-  return false;
+  utilTimerInterruptOn();
+  return i>=0;
 }
 
 /// If 'checkCallback' returns true for a task, set 'task' to it and return true. Returns false if none found
 bool utilTimerGetLastTask(bool (checkCallback)(UtilTimerTask *task, void* data), void *checkCallbackData, UtilTimerTask *task) {
-  jshInterruptOff();
-  unsigned char ptr = utilTimerTasksHead;
-  if (ptr != utilTimerTasksTail) {
-    ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    // now we're at the last timer task - work back until we've just gone back past utilTimerTasksTail
-    while (ptr != ((utilTimerTasksTail+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1))) {
-      if (checkCallback(&utilTimerTasks[ptr], checkCallbackData)) {
-        *task = utilTimerTasks[ptr];
-        jshInterruptOn();
-        return true;
-      }
-      ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    }
+  utilTimerInterruptOff();
+  int i = utilTimerFindLastTask(checkCallback, checkCallbackData);
+  if (i>=0) {
+    *task = utilTimerTasks[i];
+    task->time = utilTimerTimeUntil(task->time); // as utilTimerInsertTask expects
   }
-  jshInterruptOn();
-  return false;
+  utilTimerInterruptOn();
+  return i>=0;
 }
 
 // --------------------------------------------------------------------------------------------
@@ -405,40 +461,38 @@ bool jstPinPWM(JsVarFloat freq, JsVarFloat dutyCycle, Pin pin) {
   }
 
   // First, search for existing PWM tasks
-  UtilTimerTask *ptaskon=0, *ptaskoff=0;
-  jshInterruptOff();
-  unsigned char ptr = utilTimerTasksHead;
-  if (ptr != utilTimerTasksTail) {
-    ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
-    // now we're at the last timer task - work back until we've just gone back past utilTimerTasksTail
-    while (ptr != ((utilTimerTasksTail+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1))) {
-      if (jstPinTaskChecker(&utilTimerTasks[ptr], (void*)&pin)) {
-        if (utilTimerTasks[ptr].data.set.value)
-          ptaskon = &utilTimerTasks[ptr];
-        else
-          ptaskoff = &utilTimerTasks[ptr];
-      }
-      ptr = (ptr+UTILTIMERTASK_TASKS-1) & (UTILTIMERTASK_TASKS-1);
+  int onIdx=-1, offIdx=-1;
+  utilTimerInterruptOff();
+  for (unsigned int i=0;i<utilTimerTasksCount;i++) {
+    if (jstPinTaskChecker(&utilTimerTasks[i], (void*)&pin)) {
+      if (utilTimerTasks[i].data.set.value)
+        onIdx = (int)i;
+      else
+        offIdx = (int)i;
     }
   }
-  if (ptaskon && ptaskoff) {
+  if (onIdx>=0 && offIdx>=0) {
     // Great! We have PWM... Just update it
-    if (ptaskoff->time > ptaskon->time)
-      ptaskoff->time = ptaskon->time + pulseLength;
+    UtilTimerTask *ptaskon = &utilTimerTasks[onIdx], *ptaskoff = &utilTimerTasks[offIdx];
+    if (utilTimerTaskBefore(ptaskon, ptaskoff))
+      ptaskoff->time = (int)((uint32_t)ptaskon->time + (uint32_t)pulseLength);
     else
-      ptaskoff->time = ptaskon->time + pulseLength - (unsigned int)period;
+      ptaskoff->time = (int)((uint32_t)ptaskon->time + (uint32_t)pulseLength - (uint32_t)period);
     ptaskon->repeatInterval = (unsigned int)period;
     ptaskoff->repeatInterval = (unsigned int)period;
+    // the 'off' task's time changed, so move it to the right place in the heap
+    utilTimerHeapSiftDown(utilTimerTasks, utilTimerTasksCount, (unsigned int)offIdx);
+    utilTimerHeapSiftUp(utilTimerTasks, (unsigned int)offIdx);
     /* don't bother rescheduling - everything will work out next time
      * the timer fires anyway. */
     // All done - just return!
-    jshInterruptOn();
+    utilTimerInterruptOn();
     return true;
   }
-  jshInterruptOn();
+  utilTimerInterruptOn();
 
   /// Remove any tasks using the given pin (if they existed)
-  if (ptaskon || ptaskoff) {
+  if (onIdx>=0 || offIdx>=0) {
     while (utilTimerRemoveTask(jstPinTaskChecker, (void*)&pin));
   }
   UtilTimerTask taskon, taskoff;
@@ -504,9 +558,9 @@ bool jstSetWakeUp(JsSysTime period) {
   // work out if we're waiting for a timer,
   // and if so, when it's going to be
   jshInterruptOff();
-  if (utilTimerTasksTail!=utilTimerTasksHead) {
+  if (utilTimerTasksCount) {
     hasTimer = true;
-    nextTime = utilTimerTasks[utilTimerTasksTail].time;
+    nextTime = utilTimerTimeUntil(utilTimerTasks[0].time);
   }
   jshInterruptOn();
 
@@ -526,17 +580,17 @@ bool jstSetWakeUp(JsSysTime period) {
  * before the wakeup event */
 void jstClearWakeUp() {
   bool removedTimer = false;
-  jshInterruptOff();
+  utilTimerInterruptOff();
   // while the first item is a wakeup, remove it
-  while (utilTimerTasksTail!=utilTimerTasksHead &&
-      utilTimerTasks[utilTimerTasksTail].type == UET_WAKEUP) {
-    utilTimerTasksTail = (utilTimerTasksTail+1) & (UTILTIMERTASK_TASKS-1);
+  while (utilTimerTasksCount &&
+      utilTimerTasks[0].type == UET_WAKEUP) {
+    utilTimerRemoveIndex(0);
     removedTimer = true;
   }
   // if the queue is now empty, and we stop the timer
-  if (utilTimerTasksTail==utilTimerTasksHead && removedTimer)
+  if (!utilTimerTasksCount && removedTimer)
     jshUtilTimerDisable();
-  jshInterruptOn();
+  utilTimerInterruptOn();
 }
 
 #ifndef SAVE_ON_FLASH
@@ -587,7 +641,7 @@ bool jstStopBufferTimerTask(JsVar *var) {
 void jstReset() {
   jshUtilTimerDisable();
   utilTimerOn = false;
-  utilTimerTasksTail = utilTimerTasksHead = 0;
+  utilTimerTasksCount = 0;
   utilTimerOffset = 0;
   utilTimerPeriod = 0;
 }
@@ -602,20 +656,20 @@ void jstDumpUtilityTimers() {
   int i;
   UtilTimerTask uTimerTasks[UTILTIMERTASK_TASKS];
   jshInterruptOff();
-  for (i=0;i<UTILTIMERTASK_TASKS;i++)
+  unsigned int uTimerTasksCount = utilTimerTasksCount;
+  for (i=0;i<(int)uTimerTasksCount;i++)
     uTimerTasks[i] = utilTimerTasks[i];
-  unsigned char uTimerTasksHead = utilTimerTasksHead;
-  unsigned char uTimerTasksTail = utilTimerTasksTail;
+  int uTimerOffset = utilTimerOffset;
   jshInterruptOn();
 
   jsiConsolePrintf("Util Timer %s\n", utilTimerOn?"on":"off");
-  unsigned char t = uTimerTasksTail;
   bool hadTimers = false;
-  while (t!=uTimerTasksHead) {
+  while (uTimerTasksCount) {
     hadTimers = true;
-
-    UtilTimerTask task = uTimerTasks[t];
-    jsiConsolePrintf("%08d us", (int)(1000*jshGetMillisecondsFromTime(task.time)));
+    // take tasks off our copy of the heap, so we print them in order
+    UtilTimerTask task = uTimerTasks[0];
+    utilTimerHeapRemove(uTimerTasks, &uTimerTasksCount, 0);
+    jsiConsolePrintf("%08d us", (int)(1000*jshGetMillisecondsFromTime((int)((uint32_t)task.time - (uint32_t)uTimerOffset))));
     jsiConsolePrintf(", repeat %08d us", (int)(1000*jshGetMillisecondsFromTime(task.repeatInterval)));
     jsiConsolePrintf(" : ");
 
@@ -636,10 +690,13 @@ void jstDumpUtilityTimers() {
     case UET_EXECUTE : jsiConsolePrintf("EXECUTE %x(%x)\n", task.data.execute.fn, task.data.execute.userdata); break;
     default : jsiConsolePrintf("Unknown type %d\n", task.type); break;
     }
-
-    t = (t+1) & (UTILTIMERTASK_TASKS-1);
   }
   if (!hadTimers)
       jsiConsolePrintf("No Timers found.\n");
+#ifndef SAVE_ON_FLASH
+  jsiConsolePrintf("%d of %d tasks used (max %d)\n", utilTimerTasksCount, UTILTIMERTASK_TASKS, utilTimerStats.maxTasks);
+  jsiConsolePrintf("%d added, %d removed, %d failed (full)\n", utilTimerStats.inserted, utilTimerStats.removed, utilTimerStats.full);
+  jsiConsolePrintf("Max IRQ off time %d us\n", (int)(1000*jshGetMillisecondsFromTime(utilTimerStats.maxIrqOffTime)));
+#endif
 
 }
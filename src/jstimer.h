@@ -89,8 +89,9 @@ typedef union UtilTimerTaskData {
 } UtilTimerTaskData;
 
 typedef struct UtilTimerTask {
-  int time; // time in future (not system time) at which to set pins (JshSysTime scaling, cropped to 32 bits)
+  int time; // time in future (not system time) at which to set pins (JshSysTime scaling, cropped to 32 bits). In the queue itself this is stored relative to utilTimerOffset=0
   unsigned int repeatInterval; // if nonzero, repeat the timer
+  uint32_t seq; // set from utilTimerSeq when the task is added (or repeats), so tasks with the same time execute in the order they were added
   UtilTimerTaskData data; // data used when timer is hit
   UtilTimerEventType type; // the type of this task - do we set pin(s) or read/write data
 } PACKED_FLAGS UtilTimerTask;
@@ -149,7 +150,7 @@ void jstReset();
 This should be done with interrupts off */
 void jstSystemTimeChanged(JsSysTime diff);
 
-/// Dump the current list of timers
+/// Dump the current list of timers (and statistics about the queue)
 void jstDumpUtilityTimers();
 
 /* Restart the utility timer with the right period. This should not normally
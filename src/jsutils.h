@@ -44,6 +44,10 @@
 #define ESPR_NO_GET_SET 1
 #define ESPR_NO_LINE_NUMBERS 1
 #define ESPR_NO_LET_SCOPING 1
+#define ESPR_NO_PROPERTY_INDEX 1
+#define ESPR_NO_ARRAY_INDEX_CACHE 1
+#define ESPR_NO_INCREMENTAL_GC 1
+#define ESPR_NO_JSON_PATH 1
 #endif
 
 #ifndef alloca
@@ -305,6 +309,32 @@ typedef int64_t JsSysTime;
 #define JS_VARS_BEFORE_IDLE_GC 32
 #endif
 
+/* When an Object has more than this many children, a hash index of the
+ * children's names is built so we don't have to search the whole list
+ * of children for each lookup. See jsvFindChildFromString */
+#ifndef JSV_PROPERTY_INDEX_THRESHOLD
+#define JSV_PROPERTY_INDEX_THRESHOLD 32
+#endif
+
+/* How many `a.b` lookups that had to search prototypes/built-ins get
+ * remembered (see jspeFactorMember) when ESPR_INLINE_CACHE is defined. That
+ * uses a few hundred bytes of RAM, so boards with plenty of it (Linux, ESP32)
+ * define it in their board file. Must be a power of 2 */
+#ifndef JSP_INLINE_CACHE_SIZE
+#define JSP_INLINE_CACHE_SIZE 32
+#endif
+
+/* Idle garbage collection is done incrementally, in slices of at most this
+ * many milliseconds, so that events and timers don't have to wait for a whole
+ * collection. JSV_GC_MARK_STACK_SIZE is the number of variable references
+ * held in the (heap allocated) mark stack used while doing so. */
+#ifndef JSV_GC_SLICE_MILLISECONDS
+#define JSV_GC_SLICE_MILLISECONDS 2
+#endif
+#ifndef JSV_GC_MARK_STACK_SIZE
+#define JSV_GC_MARK_STACK_SIZE 64
+#endif
+
 // javascript specific names
 #define JSPARSE_RETURN_VAR JS_HIDDEN_CHAR_STR"rtn" // variable name used for returning function results
 #define JSPARSE_PROTOTYPE_VAR "prototype"
@@ -318,12 +348,16 @@ typedef int64_t JsSysTime;
 #define JSPARSE_FUNCTION_THIS_NAME JS_HIDDEN_CHAR_STR"ths" // the 'this' variable - for bound functions
 #define JSPARSE_FUNCTION_NAME_NAME JS_HIDDEN_CHAR_STR"nam" // for named functions (a = function foo() { foo(); })
 #define JSPARSE_FUNCTION_LINENUMBER_NAME JS_HIDDEN_CHAR_STR"lin" // The line number offset of the function
+#define JSV_PROPERTY_INDEX_NAME JS_HIDDEN_CHAR_STR"idx" // hash index of an Object's children - always the first child
 #define JS_EVENT_PREFIX "#on"
 #define JS_TIMEZONE_VAR "tz"
 #ifndef ESPR_NO_DAYLIGHT_SAVING
 #define JS_DST_SETTINGS_VAR "dst"
 #endif
 #define JS_GRAPHICS_VAR "gfx"
+#define JS_FFT_TWIDDLE_VAR "fft" ///< cached sin/cos tables for E.FFT
+#define JS_GRAPHICS_GLYPH_CACHE_VAR "glyph" ///< cached vector font glyphs and widths (see glyph_cache.c)
+#define JS_REGEXP_CACHE_VAR "regex" ///< recently compiled RegExp programs, keyed by source (see jswrap_regexp.c)
 
 #define JSPARSE_EXCEPTION_VAR "except" // when exceptions are thrown, they're stored in the root scope
 #define JSPARSE_STACKTRACE_VAR "sTrace" // for errors/exceptions, a stack trace is stored as a string
@@ -64,6 +64,97 @@ volatile bool touchedFreeList = false;
 volatile JsVarRef jsVarFirstEmpty; ///< reference of first unused variable (variables are in a linked list)
 volatile MemBusyType isMemoryBusy; ///< Are we doing garbage collection or similar, so can't access memory?
 
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+/* The last element found by jsvGetArrayIndex, so that accessing an array
+ * sequentially (eg. `for (i=0;i<a.length;i++) a[i]`) can step on from the last
+ * element rather than searching from one end of the array each time. We only
+ * remember references, so jsvArrayIndexCacheCheck must be called whenever a
+ * name is unlinked from an array, or a name or array is freed.
+ * This only helps sequential access - arrays are still linked lists (there's no
+ * packed/flat array type), so random access is O(n) and each element still
+ * needs a name and a value var. */
+static JsVarRef jsvArrayIndexCacheArray = 0;
+static JsVarRef jsvArrayIndexCacheName = 0;
+
+static void jsvArrayIndexCacheClear() {
+  jsvArrayIndexCacheArray = 0;
+  jsvArrayIndexCacheName = 0;
+}
+
+/// Clear the array index cache if it refers to the given variable
+static ALWAYS_INLINE void jsvArrayIndexCacheCheck(JsVarRef ref) {
+  if (ref==jsvArrayIndexCacheName || ref==jsvArrayIndexCacheArray)
+    jsvArrayIndexCacheClear();
+}
+#endif
+
+#ifndef ESPR_NO_INCREMENTAL_GC
+/* State for jsvGarbageCollectIncremental. This is a tri-colour mark and
+ * sweep: JSV_GARBAGE_COLLECT set means 'white' (not yet found to be used),
+ * vars on the mark stack are 'grey' and everything else is 'black'. Between
+ * slices jsvRef acts as a write barrier, pushing any white var that gets
+ * referenced, and jsvLock does the same for any white var that gets locked,
+ * so the mark can't miss anything that's moved around while JS code runs. */
+typedef enum {
+  GCI_IDLE,   ///< No collection in progress
+  GCI_FLAG,   ///< Setting JSV_GARBAGE_COLLECT on all used vars
+  GCI_ROOTS,  ///< Pushing locked vars onto the mark stack
+  GCI_MARK,   ///< Marking everything reachable from the mark stack
+  GCI_RESCAN, ///< The mark stack overflowed - finding white children of black vars, and white locked vars
+  GCI_UNREF,  ///< Unreferencing used vars that are referenced from garbage
+  GCI_SWEEP,  ///< Freeing garbage
+} PACKED_FLAGS JsvGCIncState;
+
+static volatile JsvGCIncState gcIncState = GCI_IDLE;
+static JsVarRef gcIncIndex; ///< The next var to look at when scanning through all vars
+static JsVar *gcIncStack; ///< Locked flat string of JsVarRefs used as a mark stack
+static volatile unsigned int gcIncStackLen; ///< Amount of items in gcIncStack
+static volatile bool gcIncOverflow; ///< We couldn't push something onto gcIncStack
+static JsvGarbageCollectStats gcIncStats; ///< Stats for the collection in progress
+static JsvGarbageCollectStats gcIncLastStats; ///< Stats for the last complete collection
+
+/// Make a white var grey by pushing it onto the mark stack
+static void jsvGCIncPush(JsVar *var) {
+  // In an IRQ we might be interrupting a slice, so leave it for a rescan
+  if (gcIncStackLen < JSV_GC_MARK_STACK_SIZE && !jshIsInInterrupt()) {
+    ((JsVarRef*)jsvGetFlatStringPointer(gcIncStack))[gcIncStackLen++] = jsvGetRef(var);
+  } else
+    gcIncOverflow = true;
+}
+
+/// A var is being freed - make sure it's not left on the mark stack
+static void jsvGCIncForget(JsVarRef ref) {
+  JsVarRef *stack = (JsVarRef*)jsvGetFlatStringPointer(gcIncStack);
+  unsigned int i;
+  for (i=0;i<gcIncStackLen;i++)
+    if (stack[i]==ref) stack[i] = 0;
+}
+
+#ifdef DEBUG
+unsigned int jsvGCIncDebugSliceSteps = 0;
+#endif
+#endif
+
+#ifdef ESPR_INLINE_CACHE
+uint32_t jsvPropertyEpoch = 0;
+
+/** Does this name decide where properties are inherited from? That's `__proto__`/`prototype`,
+ * or a built-in class like `Array` that arrays/strings/etc get their prototype from */
+static bool jsvIsInheritanceName(JsVar *name) {
+  if (!jsvIsString(name)) return false;
+  char ch = name->varData.str[0];
+  if (ch=='_' || ch=='p') // quick check first
+    return jsvIsStringEqual(name, JSPARSE_INHERITS_VAR) || jsvIsStringEqual(name, JSPARSE_PROTOTYPE_VAR);
+  if (ch>='A' && ch<='Z') {
+    char buf[24];
+    if (jsvGetStringLength(name) >= sizeof(buf)) return false;
+    jsvGetString(name, buf, sizeof(buf));
+    return jswIsBuiltInObject(buf);
+  }
+  return false;
+}
+#endif
+
 // ----------------------------------------------------------------------------
 // ----------------------------------------------------------------------------
 
@@ -190,6 +281,9 @@ void jsvSetMaxVarsUsed(unsigned int size) {
 void jsvCreateEmptyVarList() {
   assert(!isMemoryBusy);
   isMemoryBusy = MEMBUSY_SYSTEM;
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+  jsvArrayIndexCacheClear(); // vars may have changed (eg. loaded from flash)
+#endif
   jsVarFirstEmpty = 0;
   JsVar firstVar; // temporary var to simplify code in the loop below
   jsvSetNextSibling(&firstVar, 0);
@@ -233,10 +327,17 @@ void jsvClearEmptyVarList() {
 }
 
 void jsvSoftInit() {
+#ifdef ESPR_INLINE_CACHE
+  jsvPropertyEpoch++; // vars may have changed (eg. loaded from flash)
+#endif
   jsvCreateEmptyVarList();
 }
 
 void jsvSoftKill() {
+#ifndef ESPR_NO_INCREMENTAL_GC
+  // make sure no JSV_GARBAGE_COLLECT flags are left lying around
+  if (gcIncState!=GCI_IDLE) jsvGarbageCollect();
+#endif
   jsvClearEmptyVarList();
 }
 
@@ -279,6 +380,11 @@ void jsvInit(unsigned int size) {
   assert(size==0);
 #endif
 
+#ifndef ESPR_NO_INCREMENTAL_GC
+  gcIncState = GCI_IDLE;
+  gcIncStack = 0;
+  gcIncStackLen = 0;
+#endif
   jsVarFirstEmpty = jsvInitJsVars(1/*first*/, jsVarsSize);
   jsvSoftInit();
 }
@@ -348,7 +454,12 @@ void jsvSetMemoryTotal(unsigned int jsNewVarCount) {
   // allocate more blocks
   unsigned int i;
   for (i=oldBlockCount;i<newBlockCount;i++)
+#if defined(ESPR_JIT) && defined(LINUX)
+    jsVarBlocks[i] = (JsVar *)mmap(NULL, sizeof(JsVar) * JSVAR_BLOCK_SIZE, PROT_EXEC | PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, 0, 0); // JIT code is stored in variables
+#else
     jsVarBlocks[i] = malloc(sizeof(JsVar) * JSVAR_BLOCK_SIZE);
+#endif
   /** and now reset all the newly allocated vars. We know jsVarFirstEmpty
    * is 0 (because jsiFreeMoreMemory returned 0) so we can just assign it.  */
   assert(!jsVarFirstEmpty);
@@ -533,6 +644,10 @@ JsVar *jsvNewWithFlags(JsVarFlags flags) {
     } while (!__sync_bool_compare_and_swap(&jsVarFirstEmpty, empty, next));
     assert(v->flags == JSV_UNUSED);*/
     jsvResetVariable(v, flags); // setup variable, and add one lock
+#ifndef ESPR_NO_INCREMENTAL_GC
+    // While flagging for GC, new vars must be flagged too (see jsvGarbageCollectIncremental)
+    if (gcIncState==GCI_FLAG) v->flags |= (JsVarFlags)JSV_GARBAGE_COLLECT;
+#endif
     // return pointer
     return v;
   }
@@ -565,6 +680,9 @@ JsVar *jsvNewWithFlags(JsVarFlags flags) {
 
 static void jsvFreePtrInternal(JsVar *var) {
   assert(jsvGetLocks(var)==0);
+#ifndef ESPR_NO_INCREMENTAL_GC
+  if (gcIncStackLen) jsvGCIncForget(jsvGetRef(var));
+#endif
   var->flags = JSV_UNUSED;
   // add this to our free list
   jshInterruptOff(); // to allow this to be used from an IRQ
@@ -580,6 +698,10 @@ ALWAYS_INLINE void jsvFreePtr(JsVar *var) {
   assert((!jsvGetNextSibling(var) && !jsvGetPrevSibling(var)) || // check that next/prevSibling are not set
       jsvIsRefUsedForData(var) ||  // UNLESS we're part of a string and nextSibling/prevSibling are used for string data
       (jsvIsName(var) && (jsvGetNextSibling(var)==jsvGetPrevSibling(var)))); // UNLESS we're signalling that we're jsvild
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+  if (jsvIsArray(var) || jsvIsName(var))
+    jsvArrayIndexCacheCheck(jsvGetRef(var));
+#endif
 
   // Names that Link to other things
   if (jsvIsNameWithValue(var)) {
@@ -714,6 +836,11 @@ JsVar *jsvLock(JsVarRef ref) {
   //var->locks++;
   assert(jsvGetLocks(var) < JSV_LOCK_MAX);
   var->flags += JSV_LOCK_ONE;
+#ifndef ESPR_NO_INCREMENTAL_GC
+  // locks don't go through jsvRef, so we need a barrier here too (jsvLockAgain doesn't as the var is already locked)
+  if (gcIncState>=GCI_ROOTS && gcIncState<=GCI_RESCAN && (var->flags & JSV_GARBAGE_COLLECT))
+    jsvGCIncPush(var);
+#endif
 #ifdef DEBUG
   if (jsvGetLocks(var)==0) {
     jsError("Too many locks to Variable!");
@@ -797,9 +924,31 @@ JsVar *jsvRef(JsVar *var) {
   if (jsvGetRefs(var) < JSVARREFCOUNT_MAX) // if we hit max refcounts, just keep them - GC will fix it later
     jsvSetRefs(var, (JsVarRefCounter)(jsvGetRefs(var)+1));
   assert(jsvGetRefs(var));
+#ifndef ESPR_NO_INCREMENTAL_GC
+  // write barrier - whatever now references this var may already have been marked
+  if (gcIncState>=GCI_ROOTS && gcIncState<=GCI_RESCAN && (var->flags & JSV_GARBAGE_COLLECT))
+    jsvGCIncPush(var);
+#endif
   return var;
 }
 
+/** Write barrier for links between siblings. The mark only reaches an object's
+ * children through firstChild/nextSibling, and those aren't references so they
+ * don't go through jsvRef. When a firstChild/nextSibling is changed to point at
+ * an existing var, call this so the var can't be missed if what now links to it
+ * has already been marked. */
+static ALWAYS_INLINE void jsvGCIncLinked(JsVarRef ref) {
+#ifndef ESPR_NO_INCREMENTAL_GC
+  if (ref && gcIncState>=GCI_ROOTS && gcIncState<=GCI_RESCAN) {
+    JsVar *v = jsvGetAddressOf(ref);
+    if (v->flags & JSV_GARBAGE_COLLECT)
+      jsvGCIncPush(v);
+  }
+#else
+  NOT_USED(ref);
+#endif
+}
+
 /// Unreference - set this variable as not used by anything
 void jsvUnRef(JsVar *var) {
   assert(var && jsvGetRefs(var)>0 && jsvHasRef(var));
@@ -912,6 +1061,15 @@ JsVar *jsvNewFlatStringOfLength(unsigned int byteLength) {
   /* We now have the string! All that's left is to clear it */
   // clear data
   memset((char*)&flatString[1], 0, sizeof(JsVar)*(requiredBlocks-1));
+#ifndef ESPR_NO_INCREMENTAL_GC
+  if (gcIncState!=GCI_IDLE) {
+    if (gcIncState==GCI_FLAG) flatString->flags |= (JsVarFlags)JSV_GARBAGE_COLLECT;
+    // Don't let the incremental GC resume scanning from inside the string's data
+    JsVarRef ref = jsvGetRef(flatString);
+    if (gcIncIndex>ref && gcIncIndex<ref+requiredBlocks)
+      gcIncIndex = (JsVarRef)(ref+requiredBlocks);
+  }
+#endif
   /* We did mess with the free list - set it here in case we
   are trying to create a flat string in an IRQ while trying to
   make one outside the IRQ too */
@@ -2425,6 +2583,209 @@ int jsvCompareInteger(JsVar *va, JsVar *vb) {
     return 0;
 }
 
+#ifndef ESPR_NO_PROPERTY_INDEX
+/* Objects with lots of children get a hash index of their children's names
+ * so that jsvFindChildFromString/jsvFindChildFromVar don't have to walk the
+ * whole linked list. The index is a flat string containing a
+ * JsvPropertyIndexHeader followed by a power of 2 number of JsVarRef slots
+ * (open addressing, linear probing). It is stored in a hidden name that is
+ * always the first child of the object, so it can be found straight away and
+ * the GC sees it like any other child.
+ *
+ * The references in the index are weak, so jsvAddName/jsvRemoveChild keep it
+ * up to date. If we can't allocate memory to grow it we just remove it, and
+ * lookups go back to searching the list. */
+
+#define JSV_PROPERTY_INDEX_EMPTY 0
+#define JSV_PROPERTY_INDEX_DELETED ((JsVarRef)~(JsVarRef)0) ///< Never a valid ref - see JSVAR_CACHE_SIZE
+
+typedef struct {
+  uint32_t count; ///< Number of names in the index
+  uint32_t used;  ///< Number of slots that are not empty (names + deleted)
+} PACKED_FLAGS JsvPropertyIndexHeader;
+
+static unsigned int jsvPropertyIndexHashStr(const char *str) {
+  unsigned int hash = 2166136261u; // FNV-1a
+  while (*str) hash = (hash ^ (unsigned char)*(str++)) * 16777619u;
+  return hash;
+}
+
+static unsigned int jsvPropertyIndexHashVar(JsVar *name) {
+  unsigned int hash = 2166136261u; // must match jsvPropertyIndexHashStr
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, name, 0);
+  while (jsvStringIteratorHasChar(&it)) {
+    hash = (hash ^ (unsigned char)jsvStringIteratorGetChar(&it)) * 16777619u;
+    jsvStringIteratorNext(&it);
+  }
+  jsvStringIteratorFree(&it);
+  return hash;
+}
+
+static bool jsvIsPropertyIndexName(JsVar *v) {
+  return v->varData.str[0]==JS_HIDDEN_CHAR && jsvIsStringEqual(v, JSV_PROPERTY_INDEX_NAME);
+}
+
+/// If this object has a property index, return its name (NOT locked)
+static JsVar *jsvPropertyIndexGetName(JsVar *parent) {
+  if (!jsvIsObject(parent) || !jsvGetFirstChild(parent)) return 0;
+  JsVar *name = jsvGetAddressOf(jsvGetFirstChild(parent));
+  return jsvIsPropertyIndexName(name) ? name : 0;
+}
+
+/// Get the slots (and number of slots) in the given index
+static JsVarRef *jsvPropertyIndexGetSlots(JsVar *index, unsigned int *size) {
+  *size = (unsigned int)((jsvGetCharactersInVar(index) - sizeof(JsvPropertyIndexHeader)) / sizeof(JsVarRef));
+  return (JsVarRef*)(jsvGetFlatStringPointer(index) + sizeof(JsvPropertyIndexHeader));
+}
+
+/// Add a name to the index, return false if there's not enough space for it
+static bool jsvPropertyIndexInsert(JsVar *index, JsVar *name) {
+  JsvPropertyIndexHeader *header = (JsvPropertyIndexHeader*)jsvGetFlatStringPointer(index);
+  unsigned int size;
+  JsVarRef *slots = jsvPropertyIndexGetSlots(index, &size);
+  if ((header->used+1)*4 > size*3) return false; // keep at least 1/4 of slots empty
+  unsigned int i = jsvPropertyIndexHashVar(name) & (size-1);
+  while (slots[i]!=JSV_PROPERTY_INDEX_EMPTY && slots[i]!=JSV_PROPERTY_INDEX_DELETED)
+    i = (i+1) & (size-1);
+  if (slots[i]==JSV_PROPERTY_INDEX_EMPTY) header->used++;
+  slots[i] = jsvGetRef(name);
+  header->count++;
+  return true;
+}
+
+/** Create a new index containing all of parent's string names (with space
+ * for extraChildren more), and make it the parent's first child (replacing
+ * any old one). Return false on failure. */
+static bool jsvPropertyIndexBuild(JsVar *parent, unsigned int extraChildren) {
+  if (!jsvIsObject(parent) || jshIsInInterrupt()) return false;
+  unsigned int children = extraChildren;
+  JsVarRef childref = jsvGetFirstChild(parent);
+  while (childref) {
+    children++;
+    childref = jsvGetNextSibling(jsvGetAddressOf(childref));
+  }
+  unsigned int size = 16;
+  while (size < children*2) size <<= 1;
+  JsVar *index = jsvNewFlatStringOfLength((unsigned int)(sizeof(JsvPropertyIndexHeader) + size*sizeof(JsVarRef)));
+  if (!index) return false;
+  // flat strings are zeroed, so the header is 0 and all slots are EMPTY
+  JsVar *indexName = jsvPropertyIndexGetName(parent);
+  childref = jsvGetFirstChild(parent);
+  while (childref) {
+    JsVar *child = jsvGetAddressOf(childref);
+    if (child!=indexName && jsvIsString(child) &&
+        !jsvPropertyIndexInsert(index, child)) {
+      jsvUnLock(index); // more children than we thought
+      return false;
+    }
+    childref = jsvGetNextSibling(child);
+  }
+  if (indexName) {
+    jsvSetValueOfName(indexName, index);
+  } else {
+    // Don't use jsvNewWithFlags if it would have to try and free memory
+    if (!jsVarFirstEmpty) {
+      jsvUnLock(index);
+      return false;
+    }
+    indexName = jsvMakeIntoVariableName(jsvNewFromString(JSV_PROPERTY_INDEX_NAME), index);
+    if (!indexName) {
+      jsvUnLock(index);
+      return false;
+    }
+    // Link in as the first child
+    JsVarRef indexNameRef = jsvGetRef(jsvRef(indexName));
+    JsVarRef firstChild = jsvGetFirstChild(parent);
+    if (firstChild) {
+      jsvSetPrevSibling(jsvGetAddressOf(firstChild), indexNameRef);
+      jsvSetNextSibling(indexName, firstChild);
+      jsvGCIncLinked(firstChild);
+    } else
+      jsvSetLastChild(parent, indexNameRef);
+    jsvSetFirstChild(parent, indexNameRef);
+    jsvUnLock(indexName);
+  }
+  jsvUnLock(index);
+  return true;
+}
+
+/// Called when a name has been added to parent
+static void jsvPropertyIndexAdd(JsVar *parent, JsVar *name) {
+  JsVar *indexName = jsvPropertyIndexGetName(parent);
+  if (!indexName) return;
+  JsVar *index = jsvLock(jsvGetFirstChild(indexName));
+  bool added = jsvPropertyIndexInsert(index, name);
+  jsvUnLock(index);
+  // If it's full, make a new one with more space
+  if (!added && !jsvPropertyIndexBuild(parent, JSV_PROPERTY_INDEX_THRESHOLD)) {
+    // no memory - remove the index altogether and go back to searching
+    indexName = jsvLockAgain(indexName);
+    jsvRemoveChild(parent, indexName);
+    jsvUnLock(indexName);
+  }
+}
+
+/// Called when a name is about to be removed from parent
+static void jsvPropertyIndexRemove(JsVar *parent, JsVar *name) {
+  JsVar *indexName = jsvPropertyIndexGetName(parent);
+  if (!indexName || indexName==name) return;
+  JsVar *index = jsvLock(jsvGetFirstChild(indexName));
+  JsvPropertyIndexHeader *header = (JsvPropertyIndexHeader*)jsvGetFlatStringPointer(index);
+  unsigned int size;
+  JsVarRef *slots = jsvPropertyIndexGetSlots(index, &size);
+  JsVarRef nameRef = jsvGetRef(name);
+  unsigned int i = jsvPropertyIndexHashVar(name) & (size-1);
+  while (slots[i]!=JSV_PROPERTY_INDEX_EMPTY) {
+    if (slots[i]==nameRef) {
+      slots[i] = JSV_PROPERTY_INDEX_DELETED;
+      header->count--;
+      break;
+    }
+    i = (i+1) & (size-1);
+  }
+  jsvUnLock(index);
+}
+
+/** Find a child using the index. Exactly one of str/var should be set.
+ * Returns a LOCKED name, or 0 */
+static JsVar *jsvPropertyIndexFind(JsVar *indexName, const char *str, JsVar *var) {
+  JsVar *index = jsvGetAddressOf(jsvGetFirstChild(indexName));
+  unsigned int size;
+  JsVarRef *slots = jsvPropertyIndexGetSlots(index, &size);
+  unsigned int i = (str ? jsvPropertyIndexHashStr(str) : jsvPropertyIndexHashVar(var)) & (size-1);
+  while (slots[i]!=JSV_PROPERTY_INDEX_EMPTY) {
+    if (slots[i]!=JSV_PROPERTY_INDEX_DELETED) {
+      JsVar *child = jsvGetAddressOf(slots[i]);
+      if (str ? (child->varData.str[0]==str[0] && jsvIsStringEqual(child, str)) :
+                jsvIsBasicVarEqual(child, var))
+        return jsvLockAgain(child);
+    }
+    i = (i+1) & (size-1);
+  }
+  return 0;
+}
+
+/** Remove all property indexes. Used when defragmenting, as that moves
+ * variables around and the references in an index wouldn't get updated.
+ * They'll be rebuilt when they're next needed. */
+static void jsvPropertyIndexRemoveAll() {
+  for (unsigned int i=0;i<jsvGetMemoryTotal();i++) {
+    JsVar *v = _jsvGetAddressOf((JsVarRef)(i+1));
+    if (jsvIsFlatString(v)) {
+      i += (unsigned int)jsvGetFlatStringBlocks(v); // skip forward
+    } else {
+      JsVar *indexName = jsvPropertyIndexGetName(v);
+      if (indexName) {
+        indexName = jsvLockAgain(indexName);
+        jsvRemoveChild(v, indexName);
+        jsvUnLock(indexName);
+      }
+    }
+  }
+}
+#endif
+
 /** Copy only a name, not what it points to. ALTHOUGH the link to what it points to is maintained unless linkChildren=false
     If keepAsName==false, this will be converted into a normal variable */
 JsVar *jsvCopyNameOnly(JsVar *src, bool linkChildren, bool keepAsName) {
@@ -2566,7 +2927,13 @@ JsVar *jsvCopy(JsVar *src, bool copyChildren) {
       vr = jsvGetFirstChild(src);
       while (vr) {
         JsVar *name = jsvLock(vr);
+#ifndef ESPR_NO_PROPERTY_INDEX
+        // the index refers to src's names, so don't copy it
+        JsVar *child = jsvIsPropertyIndexName(name) ? 0 :
+            jsvCopyNameOnly(name, true/*link children*/, true/*keep as name*/); // NO DEEP COPY!
+#else
         JsVar *child = jsvCopyNameOnly(name, true/*link children*/, true/*keep as name*/); // NO DEEP COPY!
+#endif
         if (child) { // could have been out of memory
           jsvAddName(dst, child);
           jsvUnLock(child);
@@ -2612,6 +2979,7 @@ void jsvAddName(JsVar *parent, JsVar *namedChild) {
         JsVar *insertBefore = jsvLock(jsvGetNextSibling(insertAfter));
         jsvSetPrevSibling(insertBefore, jsvGetRef(namedChild));
         jsvSetNextSibling(namedChild, jsvGetRef(insertBefore));
+        jsvGCIncLinked(jsvGetRef(insertBefore));
         jsvUnLock(insertBefore);
       } else {
         // We're at the end - just set up the parent
@@ -2627,6 +2995,7 @@ void jsvAddName(JsVar *parent, JsVar *namedChild) {
       jsvUnLock(firstChild);
 
       jsvSetNextSibling(namedChild, jsvGetFirstChild(parent));
+      jsvGCIncLinked(jsvGetFirstChild(parent));
       // finally set the new child as the first one
       jsvSetFirstChild(parent, jsvGetRef(namedChild));
     }
@@ -2635,6 +3004,16 @@ void jsvAddName(JsVar *parent, JsVar *namedChild) {
     jsvSetFirstChild(parent, r);
     jsvSetLastChild(parent, r);
   }
+#ifndef ESPR_NO_PROPERTY_INDEX
+  if (jsvIsString(namedChild))
+    jsvPropertyIndexAdd(parent, namedChild);
+#endif
+#ifdef ESPR_INLINE_CACHE
+  /* If the object isn't referenced it can't be a prototype yet (and this is
+   * probably just an object literal being built) */
+  if ((jsvIsObject(parent) && jsvGetRefs(parent)) || jsvIsInheritanceName(namedChild))
+    jsvPropertyEpoch++;
+#endif
 }
 
 JsVar *jsvAddNamedChild(JsVar *parent, JsVar *child, const char *name) {
@@ -2664,8 +3043,16 @@ JsVar *jsvSetValueOfName(JsVar *name, JsVar *src) {
     else
       name->flags = (name->flags & (JsVarFlags)~JSV_VARTYPEMASK) | JSV_NAME_INT;
     jsvSetFirstChild(name, 0);
-  } else if (jsvGetFirstChild(name))
-    jsvUnRefRef(jsvGetFirstChild(name)); // free existing
+  } else if (jsvGetFirstChild(name)) {
+    // free existing
+    JsVar *existing = jsvLock(jsvGetFirstChild(name));
+    jsvUnRef(existing);
+    jsvUnLock(existing);
+  }
+#ifdef ESPR_INLINE_CACHE
+  // Storing a value only changes lookups if it changes where things inherit from (eg. `Array=...`)
+  if (jsvIsInheritanceName(name)) jsvPropertyEpoch++;
+#endif
   if (src) {
     if (jsvIsInt(name)) {
       if ((jsvIsInt(src) || jsvIsBoolean(src)) && !jsvIsPin(src)) {
@@ -2718,20 +3105,38 @@ JsVar *jsvFindChildFromString(JsVar *parent, const char *name, bool addIfNotFoun
   }
 
   assert(jsvHasChildren(parent));
-  JsVarRef childref = jsvGetFirstChild(parent);
-  while (childref) {
-    // Don't Lock here, just use GetAddressOf - to try and speed up the finding
-    // TODO: We can do this now, but when/if we move to cacheing vars, it'll break
-    JsVar *child = jsvGetAddressOf(childref);
-    if (*(int*)fastCheck==*(int*)child->varData.str && // speedy check of first 4 bytes
-        jsvIsStringEqual(child, name)) {
-      // found it! unlock parent but leave child locked
-      return jsvLockAgain(child);
+  JsVar *child = 0;
+#ifndef ESPR_NO_PROPERTY_INDEX
+  JsVar *indexName = jsvPropertyIndexGetName(parent);
+  if (indexName) {
+    child = jsvPropertyIndexFind(indexName, name, 0);
+  } else {
+    unsigned int children = 0;
+#endif
+    JsVarRef childref = jsvGetFirstChild(parent);
+    while (childref) {
+      // Don't Lock here, just use GetAddressOf - to try and speed up the finding
+      // TODO: We can do this now, but when/if we move to cacheing vars, it'll break
+      JsVar *c = jsvGetAddressOf(childref);
+      if (*(int*)fastCheck==*(int*)c->varData.str && // speedy check of first 4 bytes
+          jsvIsStringEqual(c, name)) {
+        // found it! unlock parent but leave child locked
+        child = jsvLockAgain(c);
+        break;
+      }
+      childref = jsvGetNextSibling(c);
+#ifndef ESPR_NO_PROPERTY_INDEX
+      children++;
+#endif
     }
-    childref = jsvGetNextSibling(child);
+#ifndef ESPR_NO_PROPERTY_INDEX
+    // Searching took a while - make an index for next time
+    if (children > JSV_PROPERTY_INDEX_THRESHOLD)
+      jsvPropertyIndexBuild(parent, 0);
   }
+#endif
+  if (child) return child;
 
-  JsVar *child = 0;
   if (addIfNotFound) {
     child = jsvMakeIntoVariableName(jsvNewFromString(name), 0);
     if (child) // could be out of memory
@@ -2790,16 +3195,30 @@ JsVar *jsvAsName(JsVar *var) {
 /** Non-recursive finding */
 JsVar *jsvFindChildFromVar(JsVar *parent, JsVar *childName, bool addIfNotFound) {
   JsVar *child;
-  JsVarRef childref = jsvGetFirstChild(parent);
-
-  while (childref) {
-    child = jsvLock(childref);
-    if (jsvIsBasicVarEqual(child, childName)) {
-      // found it! unlock parent but leave child locked
-      return child;
+  if (jsvIsArray(parent) && jsvIsInt(childName)) {
+    // integer array elements are sorted, so we can search more quickly
+    child = jsvGetArrayIndex(parent, childName->varData.integer);
+    if (child) return child;
+  } else {
+#ifndef ESPR_NO_PROPERTY_INDEX
+    JsVar *indexName = jsvIsString(childName) ? jsvPropertyIndexGetName(parent) : 0;
+    if (indexName) {
+      child = jsvPropertyIndexFind(indexName, 0, childName);
+      if (child) return child;
+    } else
+#endif
+    {
+      JsVarRef childref = jsvGetFirstChild(parent);
+      while (childref) {
+        child = jsvLock(childref);
+        if (jsvIsBasicVarEqual(child, childName)) {
+          // found it! unlock parent but leave child locked
+          return child;
+        }
+        childref = jsvGetNextSibling(child);
+        jsvUnLock(child);
+      }
     }
-    childref = jsvGetNextSibling(child);
-    jsvUnLock(child);
   }
 
   child = 0;
@@ -2815,12 +3234,25 @@ void jsvRemoveChild(JsVar *parent, JsVar *child) {
   assert(jsvIsName(child));
 #ifdef DEBUG
   assert(!(jsvGetPrevSibling(child) || jsvGetNextSibling(child)) || jsvIsChild(parent, child));
+#endif
+#ifndef ESPR_NO_PROPERTY_INDEX
+  if (jsvIsString(child))
+    jsvPropertyIndexRemove(parent, child);
 #endif
   JsVarRef childref = jsvGetRef(child);
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+  jsvArrayIndexCacheCheck(childref);
+#endif
+#ifdef ESPR_INLINE_CACHE
+  // like jsvAddName - only a referenced object can be a prototype
+  if ((jsvIsObject(parent) && jsvGetRefs(parent)) || jsvIsInheritanceName(child))
+    jsvPropertyEpoch++;
+#endif
   bool wasChild = false;
   // unlink from parent
   if (jsvGetFirstChild(parent) == childref) {
     jsvSetFirstChild(parent, jsvGetNextSibling(child));
+    jsvGCIncLinked(jsvGetNextSibling(child));
     wasChild = true;
   }
   if (jsvGetLastChild(parent) == childref) {
@@ -2842,6 +3274,7 @@ void jsvRemoveChild(JsVar *parent, JsVar *child) {
     JsVar *v = jsvLock(jsvGetPrevSibling(child));
     assert(jsvGetNextSibling(v) == jsvGetRef(child));
     jsvSetNextSibling(v, jsvGetNextSibling(child));
+    jsvGCIncLinked(jsvGetNextSibling(child));
     jsvUnLock(v);
     wasChild = true;
   }
@@ -3075,56 +3508,70 @@ size_t jsvCountJsVarsUsed(JsVar *v) {
   return c;
 }
 
+/** Starting at childref, search in the given direction for the element with the
+ * given index. Stops as soon as we have passed where it would have been. */
+static JsVar *jsvGetArrayIndexFrom(JsVarRef childref, JsVarInt index, bool forwards) {
+  while (childref) {
+    JsVar *child = jsvGetAddressOf(childref);
+    if (!jsvIsInt(child)) return 0; // string keys are always at the end
+    JsVarInt childIndex = child->varData.integer;
+    if (childIndex == index) return jsvLockAgain(child);
+    if (forwards ? (childIndex > index) : (childIndex < index)) return 0;
+    childref = forwards ? jsvGetNextSibling(child) : jsvGetPrevSibling(child);
+  }
+  return 0;
+}
+
 JsVar *jsvGetArrayIndex(const JsVar *arr, JsVarInt index) {
   JsVarRef childref = jsvGetLastChild(arr);
   JsVarInt lastArrayIndex = 0;
   // Look at last non-string element!
   while (childref) {
-    JsVar *child = jsvLock(childref);
+    JsVar *child = jsvGetAddressOf(childref);
     if (jsvIsInt(child)) {
       lastArrayIndex = child->varData.integer;
       // it was the last element... sorted!
       if (lastArrayIndex == index) {
-        return child;
+        return jsvLockAgain(child);
       }
-      jsvUnLock(child);
       break;
     }
     // if not an int, keep going
     childref = jsvGetPrevSibling(child);
-    jsvUnLock(child);
   }
   // it's not in this array - don't search the whole lot...
-  if (index > lastArrayIndex)
+  if (!childref || index > lastArrayIndex || index < 0)
     return 0;
-  // otherwise is it more than halfway through?
-  if (index > lastArrayIndex/2) {
-    // it's in the final half of the array (probably) - search backwards
-    while (childref) {
-      JsVar *child = jsvLock(childref);
-
-      assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
-      childref = jsvGetPrevSibling(child);
-      jsvUnLock(child);
-    }
-  } else {
-    // it's in the first half of the array (probably) - search forwards
-    childref = jsvGetFirstChild(arr);
-    while (childref) {
-      JsVar *child = jsvLock(childref);
-
-      assert(jsvIsInt(child));
-      if (child->varData.integer == index) {
-        return child;
-      }
-      childref = jsvGetNextSibling(child);
-      jsvUnLock(child);
+  // Work out where's best to start searching from
+  JsVarRef startRef = childref; // last integer element
+  bool forwards = false;
+  JsVarInt distance = lastArrayIndex - index;
+  if (index < distance) {
+    startRef = jsvGetFirstChild(arr);
+    forwards = true;
+    distance = index;
+  }
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+  JsVarRef arrRef = jsvGetRef((JsVar*)arr);
+  if (jsvArrayIndexCacheArray == arrRef) {
+    JsVar *cached = jsvGetAddressOf(jsvArrayIndexCacheName);
+    assert(jsvIsInt(cached));
+    JsVarInt cachedIndex = cached->varData.integer;
+    JsVarInt cachedDistance = (index > cachedIndex) ? index-cachedIndex : cachedIndex-index;
+    if (cachedDistance < distance) {
+      startRef = jsvArrayIndexCacheName;
+      forwards = index >= cachedIndex;
     }
   }
-  return 0; // undefined
+  JsVar *child = jsvGetArrayIndexFrom(startRef, index, forwards);
+  if (child) {
+    jsvArrayIndexCacheArray = arrRef;
+    jsvArrayIndexCacheName = jsvGetRef(child);
+  }
+  return child;
+#else
+  return jsvGetArrayIndexFrom(startRef, index, forwards);
+#endif
 }
 
 JsVar *jsvGetArrayItem(const JsVar *arr, JsVarInt index) {
@@ -3305,9 +3752,13 @@ JsVar *jsvArrayPopFirst(JsVar *arr) {
   assert(jsvIsArray(arr));
   if (jsvGetFirstChild(arr)) {
     JsVar *child = jsvLock(jsvGetFirstChild(arr));
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+    jsvArrayIndexCacheCheck(jsvGetFirstChild(arr));
+#endif
     if (jsvGetFirstChild(arr) == jsvGetLastChild(arr))
       jsvSetLastChild(arr, 0); // if 1 item in array
     jsvSetFirstChild(arr, jsvGetNextSibling(child)); // unlink from end of array
+    jsvGCIncLinked(jsvGetNextSibling(child));
     jsvUnRef(child); // as no longer in array
     if (jsvGetNextSibling(child)) {
       JsVar *v = jsvLock(jsvGetNextSibling(child));
@@ -3819,7 +4270,19 @@ static bool jsvGarbageCollectMarkUsed(JsVar *var) {
 /** Run a garbage collection sweep - return nonzero if things have been freed */
 int jsvGarbageCollect() {
   if (isMemoryBusy) return 0;
+#ifndef ESPR_NO_INCREMENTAL_GC
+  // A full collection makes any incremental one in progress redundant
+  if (gcIncState!=GCI_IDLE) {
+    gcIncState = GCI_IDLE;
+    gcIncStackLen = 0;
+    jsvUnLock(gcIncStack);
+    gcIncStack = 0;
+  }
+#endif
   isMemoryBusy = MEMBUSY_GC;
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+  jsvArrayIndexCacheClear(); // we may free the vars it refers to
+#endif
   JsVarRef i;
   // Add GC flags to anything that is currently used
   for (i=1;i<=jsVarsSize;i++)  {
@@ -3935,7 +4398,198 @@ int jsvGarbageCollect() {
   return (int)freedCount;
 }
 
+#ifndef ESPR_NO_INCREMENTAL_GC
+/// Push any white children of this var onto the mark stack
+static void jsvGCIncPushChildren(JsVar *var) {
+  JsVarRef child;
+  JsVar *childVar;
+  if (jsvHasCharacterData(var) && !jsvIsStringExt(var)) {
+    // non-recursively scan strings
+    child = jsvGetLastChild(var);
+    while (child) {
+      childVar = jsvGetAddressOf(child);
+      childVar->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
+      child = jsvGetLastChild(childVar);
+    }
+  }
+  // intentionally no else
+  if (jsvHasSingleChild(var) || jsvHasChildren(var)) {
+    /* For objects we only push the first child, and names push their
+     * next sibling. This keeps the stack small for big objects */
+    child = jsvGetFirstChild(var);
+    if (child && (jsvGetAddressOf(child)->flags & JSV_GARBAGE_COLLECT))
+      jsvGCIncPush(jsvGetAddressOf(child));
+  }
+  if (jsvIsName(var) && !jsvIsRefUsedForData(var)) {
+    child = jsvGetNextSibling(var);
+    if (child && (jsvGetAddressOf(child)->flags & JSV_GARBAGE_COLLECT))
+      jsvGCIncPush(jsvGetAddressOf(child));
+  }
+}
+
+/// Pop one var off the mark stack and mark it - returns false if the stack was empty
+static bool jsvGCIncMarkOne() {
+  if (!gcIncStackLen) return false;
+  JsVarRef ref = ((JsVarRef*)jsvGetFlatStringPointer(gcIncStack))[--gcIncStackLen];
+  if (!ref) return true; // it was freed while on the stack
+  JsVar *var = jsvGetAddressOf(ref);
+  if (var->flags & JSV_GARBAGE_COLLECT) {
+    var->flags &= (JsVarFlags)~JSV_GARBAGE_COLLECT;
+    jsvGCIncPushChildren(var);
+  }
+  return true;
+}
+
+/// If the mark stack overflowed, clear the flag and return true
+static bool jsvGCIncCheckOverflow() {
+  jshInterruptOff();
+  bool overflow = gcIncOverflow;
+  gcIncOverflow = false;
+  jshInterruptOn();
+  return overflow;
+}
+
+/// Do one unit of work in the current incremental GC phase - returns true if the collection is complete
+static bool jsvGCIncStep() {
+  if (gcIncState==GCI_MARK) {
+    if (jsvGCIncMarkOne()) return false;
+    if (jsvGCIncCheckOverflow()) {
+      gcIncState = GCI_RESCAN;
+    } else { // nothing left grey, and anything locked since GCI_ROOTS was pushed by jsvLock
+      gcIncState = GCI_UNREF;
+#ifndef ESPR_NO_ARRAY_INDEX_CACHE
+      jsvArrayIndexCacheClear(); // we may free the vars it refers to
+#endif
+    }
+    gcIncIndex = 1;
+    return false;
+  }
+  if (gcIncIndex > jsVarsSize) { // finished scanning through all vars
+    gcIncIndex = 1;
+    if (gcIncState==GCI_SWEEP) return true;
+    if (gcIncState==GCI_RESCAN) gcIncState = GCI_MARK;
+    else gcIncState++;
+    return false;
+  }
+  JsVarRef i = gcIncIndex++;
+  JsVar *var = jsvGetAddressOf(i);
+  if (var->flags==JSV_UNUSED) return false;
+  bool isFlatString = jsvIsFlatString(var);
+  if (isFlatString) // skip the flat string's data
+    gcIncIndex = (JsVarRef)(gcIncIndex+jsvGetFlatStringBlocks(var));
+  bool isWhite = (var->flags & JSV_GARBAGE_COLLECT)!=0;
+  switch (gcIncState) {
+  case GCI_FLAG:
+    var->flags |= (JsVarFlags)JSV_GARBAGE_COLLECT;
+    break;
+  case GCI_ROOTS:
+    if (isWhite && jsvGetLocks(var)>0)
+      jsvGCIncPush(var);
+    break;
+  case GCI_RESCAN:
+    if (!isWhite) jsvGCIncPushChildren(var);
+    else if (jsvGetLocks(var)>0) jsvGCIncPush(var); // may have been locked when the stack was full
+    break;
+  case GCI_UNREF:
+    /* If this garbage had a child that is used, we need to unref it.
+     * This is done before anything is freed, as after that a freed var
+     * could be reallocated, and we'd unref the wrong thing. */
+    if (isWhite && !isFlatString && jsvHasSingleChild(var) && jsvGetFirstChild(var)) {
+      JsVar *child = jsvGetAddressOf(jsvGetFirstChild(var));
+      if (child->flags!=JSV_UNUSED && !(child->flags & JSV_GARBAGE_COLLECT))
+        jsvUnRef(child);
+    }
+    break;
+  case GCI_SWEEP:
+    if (isWhite) {
+      unsigned int count = isFlatString ? (unsigned int)jsvGetFlatStringBlocks(var) : 0;
+      gcIncStats.freed += count+1;
+      // free in reverse, so the free list ends up in kind of the right order
+      jshInterruptOff(); // allocations could happen from an IRQ
+      do {
+        JsVar *p = jsvGetAddressOf((JsVarRef)(i+count));
+        p->flags = JSV_UNUSED;
+        jsvSetNextSibling(p, jsVarFirstEmpty);
+        jsVarFirstEmpty = (JsVarRef)(i+count);
+      } while (count--);
+      touchedFreeList = true;
+      jshInterruptOn();
+    }
+    break;
+  default:
+    break;
+  }
+  return false;
+}
+
+bool jsvGarbageCollectIncremental(JsSysTime budget) {
+  if (isMemoryBusy) return false;
+  JsSysTime startTime = jshGetSystemTime();
+  if (gcIncState==GCI_IDLE) {
+    // this may itself run a full GC if memory is very fragmented
+    JsVar *stack = jsvNewFlatStringOfLength(JSV_GC_MARK_STACK_SIZE*(unsigned int)sizeof(JsVarRef));
+    if (!stack) {
+      // not enough memory for a mark stack - we'll just have to do it all at once
+      jsvGarbageCollect();
+      return true;
+    }
+    gcIncStack = stack;
+    gcIncStackLen = 0;
+    gcIncOverflow = false;
+    gcIncIndex = 1;
+    memset(&gcIncStats, 0, sizeof(gcIncStats));
+    gcIncState = GCI_FLAG;
+  }
+  isMemoryBusy = MEMBUSY_GC;
+  bool finished = false;
+  unsigned int steps = 0;
+  while (!finished) {
+    finished = jsvGCIncStep();
+    // checking the time is relatively slow, so only do it every so often
+    if (((++steps)&63)==0 && (jshGetSystemTime()-startTime) > budget)
+      break;
+#ifdef DEBUG
+    if (jsvGCIncDebugSliceSteps && steps>=jsvGCIncDebugSliceSteps)
+      break;
+#endif
+  }
+  isMemoryBusy = MEM_NOT_BUSY;
+  JsSysTime pause = jshGetSystemTime()-startTime;
+  if (pause > gcIncStats.maxPause) gcIncStats.maxPause = pause;
+  gcIncStats.slices++;
+  if (finished) {
+    gcIncState = GCI_IDLE;
+    jsvUnLock(gcIncStack);
+    gcIncStack = 0;
+    gcIncLastStats = gcIncStats;
+  }
+  return finished;
+}
+
+bool jsvGarbageCollectIncrementalInProgress() {
+  return gcIncState!=GCI_IDLE;
+}
+
+#ifdef DEBUG
+const char *jsvGarbageCollectIncrementalPhase() {
+  const char *phases[] = { "idle", "flag", "roots", "mark", "rescan", "unref", "sweep" };
+  return phases[gcIncState];
+}
+#endif
+
+void jsvGarbageCollectIncrementalStats(JsvGarbageCollectStats *stats) {
+  *stats = gcIncLastStats;
+}
+#endif
+
 void jsvDefragment() {
+#ifdef ESPR_INLINE_CACHE
+  jsvPropertyEpoch++; // vars are about to move
+#endif
+#ifndef ESPR_NO_PROPERTY_INDEX
+  // indexes contain references that we won't update when moving vars
+  jsvPropertyIndexRemoveAll();
+#endif
   // garbage collect - removes cruft
   // also puts free list in order
   jsvGarbageCollect();
@@ -685,9 +685,43 @@ static ALWAYS_INLINE bool jsvArrayIsEmpty(JsVar *arr) { assert(jsvIsArray(arr));
 /** Write debug info for this Var out to the console */
 void jsvTrace(JsVar *var, int indent);
 
+#ifdef ESPR_INLINE_CACHE
+/** Incremented whenever something happens that could change which object a
+ * property is inherited from: a property being added to or removed from an
+ * object that is referenced, `__proto__`/`prototype` or a built-in class (eg.
+ * `Array`) being set, or memory being moved around. Just storing a new value in
+ * an existing property doesn't change it. Anything that caches the results
+ * of looking up properties (see jspeFactorMember) must check it. */
+extern uint32_t jsvPropertyEpoch;
+#endif
+
 /** Run a garbage collection sweep - return nonzero if things have been freed */
 int jsvGarbageCollect();
 
+#ifndef ESPR_NO_INCREMENTAL_GC
+/// Statistics for the last completed incremental garbage collection
+typedef struct {
+  unsigned int slices; ///< How many calls to jsvGarbageCollectIncremental the collection took
+  unsigned int freed; ///< How many variables were freed
+  JsSysTime maxPause; ///< The longest time spent in a single call to jsvGarbageCollectIncremental
+} JsvGarbageCollectStats;
+
+/** Do some of an incremental garbage collection, for (roughly) no longer than
+ * 'budget'. If no collection is in progress, a new one is started. Returns
+ * true if a collection finished during this call. */
+bool jsvGarbageCollectIncremental(JsSysTime budget);
+/// Is an incremental garbage collection in progress?
+bool jsvGarbageCollectIncrementalInProgress();
+/// Get statistics for the last completed incremental garbage collection
+void jsvGarbageCollectIncrementalStats(JsvGarbageCollectStats *stats);
+#ifdef DEBUG
+/// If nonzero, each slice does at most this many steps. Used to test the write barriers
+extern unsigned int jsvGCIncDebugSliceSteps;
+/// Get the name of the phase the incremental garbage collection is in
+const char *jsvGarbageCollectIncrementalPhase();
+#endif
+#endif
+
 /** Defragement memory - this could take a while with interrupts turned off! */
 void jsvDefragment();
 
@@ -341,6 +341,13 @@ void jsvStringIteratorGoto(JsvStringIterator *it, JsVar *str, size_t idx) {
   if (idx>=it->varIndex) {
     it->charIdx = idx - it->varIndex;
     jsvStringIteratorCatchUp(it);
+#ifdef SPIFLASH_BASE
+  } else if (it->var && jsvIsFlashString(it->var)) {
+    // just load the block we need - no need to start again
+    it->varIndex = idx;
+    it->charIdx = 0;
+    jsvStringIteratorLoadFlashString(it);
+#endif
   } else {
     jsvStringIteratorFree(it);
     jsvStringIteratorNew(it, str, idx);
@@ -448,6 +455,33 @@ void   jsvArrayBufferIteratorNew(JsvArrayBufferIterator *it, JsVar *arrayBuffer,
   it->hasAccessedElement = false;
 }
 
+#ifdef SPIFLASH_BASE
+/* ArrayBuffers in Flash Strings are read a block at a time into the String iterator's
+buffer. We move on by just incrementing it->it.charIdx, and load the next block when we
+need it. We don't have a bigger buffer of our own, as this iterator is in JsvIterator's
+union and that would make every JsvIterator bigger. */
+static ALWAYS_INLINE bool jsvArrayBufferIteratorIsFlash(JsvArrayBufferIterator *it) {
+  return it->it.var && jsvIsFlashString(it->it.var);
+}
+
+/// Ensure the current element is loaded (if it isn't all in one block the String iterator will load the rest)
+static void jsvArrayBufferIteratorLoadFlash(JsvArrayBufferIterator *it) {
+  JsvStringIterator *sit = &it->it;
+  if (sit->charIdx+JSV_ARRAYBUFFER_GET_SIZE(it->type) > sit->charsInVar && jsvArrayBufferIteratorIsFlash(it))
+    jsvStringIteratorLoadFlashString(sit);
+}
+
+/// it->it has been restored from a copy whose buffer may have gone - force a reload on the next access
+static void jsvArrayBufferIteratorUnloadFlash(JsvArrayBufferIterator *it) {
+  JsvStringIterator *sit = &it->it;
+  if (!jsvArrayBufferIteratorIsFlash(it)) return;
+  sit->varIndex += sit->charIdx;
+  sit->charIdx = 0;
+  sit->charsInVar = 0;
+  sit->ptr = 0;
+}
+#endif
+
 /// Clone the iterator
 ALWAYS_INLINE void jsvArrayBufferIteratorClone(JsvArrayBufferIterator *dstit, JsvArrayBufferIterator *it) {
   *dstit = *it;
@@ -458,6 +492,29 @@ static void jsvArrayBufferIteratorGetValueData(JsvArrayBufferIterator *it, char
   if (it->type == ARRAYBUFFERVIEW_UNDEFINED) return;
   assert(!it->hasAccessedElement); // we just haven't implemented this case yet
   int i,dataLen = (int)JSV_ARRAYBUFFER_GET_SIZE(it->type);
+  JsvStringIterator *sit = &it->it;
+#ifdef SPIFLASH_BASE
+  jsvArrayBufferIteratorLoadFlash(it);
+#endif
+  if (dataLen!=1 && sit->ptr && sit->charIdx+(size_t)dataLen <= sit->charsInVar && !jsvIsNativeString(sit->var)) {
+    // Fast path - the whole element is in the current block of data (RAM, or the buffer for Flash Strings)
+    const char *src = &sit->ptr[sit->charIdx];
+    if (it->type & ARRAYBUFFERVIEW_BIG_ENDIAN) {
+      for (i=0;i<dataLen;i++) data[dataLen-1-i] = src[i];
+    } else
+      memcpy(data, src, (size_t)dataLen);
+#ifdef SPIFLASH_BASE
+    if (jsvArrayBufferIteratorIsFlash(it))
+      sit->charIdx += (size_t)dataLen; // jsvArrayBufferIteratorLoadFlash will load the next block
+    else
+#endif
+    {
+      sit->charIdx += (size_t)dataLen-1;
+      jsvStringIteratorNextInline(sit);
+    }
+    it->hasAccessedElement = true;
+    return;
+  }
   if (it->type & ARRAYBUFFERVIEW_BIG_ENDIAN) {
     for (i=dataLen-1;i>=0;i--) {
        data[i] = jsvStringIteratorGetChar(&it->it);
@@ -512,6 +569,9 @@ JsVar *jsvArrayBufferIteratorGetValueAndRewind(JsvArrayBufferIterator *it) {
   JsVar *v = jsvArrayBufferIteratorGetValue(it);
   jsvStringIteratorFree(&it->it);
   it->it = oldIt;
+#ifdef SPIFLASH_BASE
+  jsvArrayBufferIteratorUnloadFlash(it); // ptr may point to oldIt's buffer, or a block we've since replaced
+#endif
   it->hasAccessedElement = false;
   return v;
 }
@@ -616,6 +676,9 @@ void jsvArrayBufferIteratorSetValueAndRewind(JsvArrayBufferIterator *it, JsVar *
   jsvStringIteratorFree(&it->it);
   jsvStringIteratorClone(&it->it, &oldIt);
   jsvStringIteratorFree(&oldIt);
+#ifdef SPIFLASH_BASE
+  jsvArrayBufferIteratorUnloadFlash(it);
+#endif
   it->hasAccessedElement = false;
 }
 
@@ -635,6 +698,12 @@ void   jsvArrayBufferIteratorNext(JsvArrayBufferIterator *it) {
   it->byteOffset += JSV_ARRAYBUFFER_GET_SIZE(it->type);
   if (!it->hasAccessedElement) {
     unsigned int dataLen = JSV_ARRAYBUFFER_GET_SIZE(it->type);
+#ifdef SPIFLASH_BASE
+    if (dataLen && jsvArrayBufferIteratorIsFlash(it)) {
+      it->it.charIdx += dataLen; // jsvArrayBufferIteratorLoadFlash will load the next block
+      return;
+    }
+#endif
     while (dataLen--)
       jsvStringIteratorNext(&it->it);
   } else
@@ -48,6 +48,10 @@ uint32_t jsvIterateCallbackCount(JsVar *var);
 unsigned int jsvIterateCallbackToBytes(JsVar *var, unsigned char *data, unsigned int dataSize);
 
 // --------------------------------------------------------------------------------------------
+#ifdef SPIFLASH_BASE
+#define JSV_FLASH_STRING_BUFFER_SIZE 16 ///< How much of a Flash String a String iterator reads at once (power of 2). Kept small as JsLex and JsvIterator contain iterators
+#endif
+
 typedef struct JsvStringIterator {
   size_t charIdx; ///< index of character in var
   size_t charsInVar; ///< total characters in var
@@ -55,7 +59,7 @@ typedef struct JsvStringIterator {
   JsVar *var; ///< current StringExt we're looking at
   char  *ptr; ///< a pointer to string data
 #ifdef SPIFLASH_BASE // when using flash strings, we need somewhere to put the data
-  char flashStringBuffer[16];
+  char flashStringBuffer[JSV_FLASH_STRING_BUFFER_SIZE];
 #endif
 } JsvStringIterator;
 
@@ -103,8 +107,10 @@ void jsvStringIteratorNext(JsvStringIterator *it);
 void jsvStringIteratorGetPtrAndNext(JsvStringIterator *it, unsigned char **data, unsigned int *len);
 
 #ifdef SPIFLASH_BASE
-// For 'Flash Strings' only - loads each block from flash memory as required
-static void jsvStringIteratorLoadFlashString(JsvStringIterator *it) {
+/* For 'Flash Strings' only - load the data from the current position up to the next
+blockSize boundary in flash into buffer (blockSize is a power of 2, buffer is at least
+that big), so when iterating all but the first read are whole, aligned blocks. */
+static void jsvStringIteratorLoadFlashStringBlock(JsvStringIterator *it, char *buffer, size_t blockSize) {
   it->varIndex += it->charIdx;
   it->charIdx = 0;
   uint32_t l = (uint32_t)it->var->varData.nativeStr.len;
@@ -112,13 +118,20 @@ static void jsvStringIteratorLoadFlashString(JsvStringIterator *it) {
     it->ptr = 0; // past end of string
     it->charsInVar = 0;
   } else {
+    uint32_t addr = (uint32_t)it->varIndex+(uint32_t)(size_t)it->var->varData.nativeStr.ptr;
     it->charsInVar = l - it->varIndex;
-    if (it->charsInVar > sizeof(it->flashStringBuffer))
-      it->charsInVar = sizeof(it->flashStringBuffer);
-    jshFlashRead(it->flashStringBuffer, (uint32_t)it->varIndex+(uint32_t)(size_t)it->var->varData.nativeStr.ptr, (uint32_t)it->charsInVar);
-    it->ptr = (char*)it->flashStringBuffer;
+    size_t blockLen = blockSize - (addr & (blockSize-1));
+    if (it->charsInVar > blockLen)
+      it->charsInVar = blockLen;
+    jshFlashRead(buffer, addr, (uint32_t)it->charsInVar);
+    it->ptr = buffer;
   }
 }
+
+// For 'Flash Strings' only - loads each block from flash memory as required
+static void jsvStringIteratorLoadFlashString(JsvStringIterator *it) {
+  jsvStringIteratorLoadFlashStringBlock(it, it->flashStringBuffer, JSV_FLASH_STRING_BUFFER_SIZE);
+}
 #endif
 
 /// Ensures that the correct JsVar is loaded with data for the Iterator. ONLY FOR INTERNAL USE
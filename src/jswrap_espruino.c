@@ -410,81 +410,150 @@ JsVarFloat jswrap_espruino_convolve(JsVar *arr1, JsVar *arr2, int offset) {
 #define FFTDATATYPE float
 #endif
 
-// http://paulbourke.net/miscellaneous/dft/
-/*
-   This computes an in-place complex-to-complex FFT
-   x and y are the real and imaginary arrays of 2^m points.
-   dir =  1 gives forward transform
-   dir = -1 gives reverse transform
- */
-short FFT(short int dir,long m,FFTDATATYPE *x,FFTDATATYPE *y)
-{
-  long n,i,i1,j,k,i2,l,l1,l2;
-  FFTDATATYPE c1,c2,tx,ty,t1,t2,u1,u2,z;
+/// Twiddle factors cos/sin(2*PI*k/n) for k<n/2. An FFT of m<=n points uses every (n/m)th entry
+typedef struct {
+  const FFTDATATYPE *cosT;
+  const FFTDATATYPE *sinT;
+  unsigned int n; ///< The FFT size the table was made for
+} FFTTwiddles;
+
+static void fftFillTwiddles(FFTDATATYPE *t, unsigned int n) {
+  unsigned int k, h = n>>1;
+  for (k=0;k<h;k++) {
+    double a = 2*PI*k/n;
+    t[k] = (FFTDATATYPE)jswrap_math_sin(a + PI/2);
+    t[h+k] = (FFTDATATYPE)jswrap_math_sin(a);
+  }
+}
+
+static void fftSetTwiddles(FFTTwiddles *tw, const FFTDATATYPE *t, unsigned int n) {
+  tw->cosT = t;
+  tw->sinT = &t[n>>1];
+  tw->n = n;
+}
 
-  /* Calculate the number of points */
-  n = 1;
-  for (i=0;i<m;i++)
-    n *= 2;
+/** Get twiddle factors for an FFT of n points. These are cached in hiddenRoot
+ and only recalculated when a bigger FFT is needed. Returns the locked table,
+ or 0 if there wasn't enough memory to store it. */
+static JsVar *fftGetCachedTwiddles(FFTTwiddles *tw, unsigned int n) {
+  JsVar *t = jsvObjectGetChild(execInfo.hiddenRoot, JS_FFT_TWIDDLE_VAR, 0);
+  if (t && jsvGetStringLength(t) < n*sizeof(FFTDATATYPE)) {
+    jsvUnLock(t);
+    t = 0;
+    jsvObjectRemoveChild(execInfo.hiddenRoot, JS_FFT_TWIDDLE_VAR); // free it so the memory can be reused
+  }
+  if (!t) {
+    t = jsvNewFlatStringOfLength((unsigned int)(n*sizeof(FFTDATATYPE)));
+    if (!t) return 0;
+    fftFillTwiddles((FFTDATATYPE*)jsvGetFlatStringPointer(t), n);
+    jsvObjectSetChild(execInfo.hiddenRoot, JS_FFT_TWIDDLE_VAR, t);
+  }
+  fftSetTwiddles(tw, (FFTDATATYPE*)jsvGetFlatStringPointer(t), (unsigned int)(jsvGetStringLength(t)/sizeof(FFTDATATYPE)));
+  return t;
+}
 
+/** In-place, unscaled complex-to-complex FFT of 2^m points. Element i is at
+ re[i*s] and im[i*s], so this works on separate (s=1) or interleaved (s=2) data. */
+static void fftComplex(FFTDATATYPE *re, FFTDATATYPE *im, unsigned int s, unsigned int m, bool inverse, const FFTTwiddles *tw) {
+  unsigned int n = 1U<<m, i, j, k, l1, l2;
+  FFTDATATYPE t;
   /* Do the bit reversal */
-  i2 = n >> 1;
   j = 0;
-  for (i=0;i<n-1;i++) {
+  for (i=0;i+1<n;i++) {
     if (i < j) {
-      tx = x[i];
-      ty = y[i];
-      x[i] = x[j];
-      y[i] = y[j];
-      x[j] = tx;
-      y[j] = ty;
+      t = re[i*s]; re[i*s] = re[j*s]; re[j*s] = t;
+      t = im[i*s]; im[i*s] = im[j*s]; im[j*s] = t;
     }
-    k = i2;
+    k = n >> 1;
     while (k <= j) {
       j -= k;
       k >>= 1;
     }
     j += k;
   }
-
   /* Compute the FFT */
-  c1 = -1.0;
-  c2 = 0.0;
-  l2 = 1;
-  for (l=0;l<m;l++) {
-    l1 = l2;
-    l2 <<= 1;
-    u1 = 1.0;
-    u2 = 0.0;
+  for (l2=2;l2<=n;l2<<=1) {
+    unsigned int step = tw->n / l2;
+    l1 = l2 >> 1;
     for (j=0;j<l1;j++) {
+      FFTDATATYPE u1 = tw->cosT[j*step];
+      FFTDATATYPE u2 = inverse ? tw->sinT[j*step] : -tw->sinT[j*step];
       for (i=j;i<n;i+=l2) {
-        i1 = i + l1;
-        t1 = u1 * x[i1] - u2 * y[i1];
-        t2 = u1 * y[i1] + u2 * x[i1];
-        x[i1] = x[i] - t1;
-        y[i1] = y[i] - t2;
-        x[i] += t1;
-        y[i] += t2;
+        unsigned int a = i*s, b = (i+l1)*s;
+        FFTDATATYPE t1 = u1 * re[b] - u2 * im[b];
+        FFTDATATYPE t2 = u1 * im[b] + u2 * re[b];
+        re[b] = re[a] - t1;
+        im[b] = im[a] - t2;
+        re[a] += t1;
+        im[a] += t2;
       }
-      z =  u1 * c1 - u2 * c2;
-      u2 = u1 * c2 + u2 * c1;
-      u1 = z;
     }
-    c2 = (FFTDATATYPE)jswrap_math_sqrt((1.0 - c1) / 2.0);
-    if (dir == 1)
-      c2 = -c2;
-    c1 = (FFTDATATYPE)jswrap_math_sqrt((1.0 + c1) / 2.0);
   }
+}
 
-  /* Scaling for forward transform */
-  if (dir == 1) {
-    for (i=0;i<n;i++) {
-      x[i] /= (FFTDATATYPE)n;
-      y[i] /= (FFTDATATYPE)n;
+/** In-place, unscaled forward FFT of 2^m real points (m>=1), done as an FFT
+ of 2^(m-1) complex points. The result is packed: d[0] is the (real) DC
+ value, d[1] the (real) value at n/2, and d[2k],d[2k+1] is bin k for 0<k<n/2. */
+static void fftReal(FFTDATATYPE *d, unsigned int m, const FFTTwiddles *tw) {
+  unsigned int n = 1U<<m, h = n>>1, k, step = tw->n / n;
+  fftComplex(d, d+1, 2, m-1, false, tw);
+  FFTDATATYPE r = d[0], i = d[1];
+  d[0] = r + i;
+  d[1] = r - i;
+  // Split the result for the even and odd elements, bins k and h-k at once
+  for (k=1;k<=h/2;k++) {
+    FFTDATATYPE *a = &d[2*k], *b = &d[2*(h-k)];
+    // F = (Z[k] + conj(Z[h-k]))/2, G = (Z[k] - conj(Z[h-k]))/2
+    FFTDATATYPE fr = (a[0] + b[0]) * (FFTDATATYPE)0.5, fi = (a[1] - b[1]) * (FFTDATATYPE)0.5;
+    FFTDATATYPE gr = (a[0] - b[0]) * (FFTDATATYPE)0.5, gi = (a[1] + b[1]) * (FFTDATATYPE)0.5;
+    // H = i * W^k * G, where W^k = cos - i*sin
+    FFTDATATYPE c = tw->cosT[k*step], sn = tw->sinT[k*step];
+    FFTDATATYPE hr = sn*gr - c*gi, hi = c*gr + sn*gi;
+    // X[k] = F - H, X[h-k] = conj(F + H)
+    a[0] = fr - hr;
+    a[1] = fi - hi;
+    if (b != a) {
+      b[0] = fr + hr;
+      b[1] = -(fi + hi);
     }
   }
+}
 
-  return(TRUE);
+/// Turn the packed output of fftReal into the magnitude (or power) of all n bins, in place
+static void fftRealToMagnitude(FFTDATATYPE *d, unsigned int n, FFTDATATYPE scale, bool power) {
+  unsigned int h = n>>1, k;
+  if (n<2) {
+    d[0] *= scale;
+    d[0] = power ? d[0]*d[0] : (FFTDATATYPE)jswrap_math_abs(d[0]);
+    return;
+  }
+  FFTDATATYPE nyquist = d[1] * scale;
+  // bin k is read from d[2k] before d[k] is written, so we can work forwards
+  for (k=0;k<h;k++) {
+    FFTDATATYPE r = d[2*k] * scale, i = k ? d[2*k+1] * scale : 0;
+    FFTDATATYPE p = r*r + i*i;
+    d[k] = power ? p : (FFTDATATYPE)jswrap_math_sqrt(p);
+  }
+  d[h] = power ? nyquist*nyquist : (FFTDATATYPE)jswrap_math_abs(nyquist);
+  // the spectrum of real data is symmetric
+  for (k=1;k<h;k++)
+    d[n-k] = d[k];
+}
+
+/// If arr is a typed array of FFTDATATYPE with n elements in RAM, return a pointer to its data so we can work in place
+static FFTDATATYPE *fftGetDirectPointer(JsVar *arr, size_t n) {
+  if (!jsvIsArrayBuffer(arr) || jsvGetArrayBufferLength(arr)!=n ||
+      arr->varData.arraybuffer.type != (sizeof(FFTDATATYPE)==4 ? ARRAYBUFFERVIEW_FLOAT32 : ARRAYBUFFERVIEW_FLOAT64))
+    return 0;
+  // Native strings may point to flash, so we can't write to them
+  JsVar *backing = jsvGetArrayBufferBackingString(arr, NULL);
+  bool inRAM = !jsvIsNativeString(backing) && !jsvIsFlashString(backing);
+  jsvUnLock(backing);
+  if (!inRAM) return 0;
+  size_t len;
+  char *ptr = jsvGetDataPointer(arr, &len);
+  if (!ptr || ((size_t)ptr & 3)) return 0;
+  return (FFTDATATYPE*)ptr;
 }
 
 /*JSON{
@@ -496,22 +565,31 @@ short FFT(short int dir,long m,FFTDATATYPE *x,FFTDATATYPE *y)
   "params" : [
     ["arrReal","JsVar","An array of real values"],
     ["arrImage","JsVar","An array of imaginary values (or if undefined, all values will be taken to be 0)"],
-    ["inverse","bool","Set this to true if you want an inverse FFT - otherwise leave as 0"]
+    ["options","JsVar","Set this to true if you want an inverse FFT - otherwise leave as 0. Or an object: `{inverse:bool, output:'magnitude'/'power'}`"]
   ],
-  "typescript" : "FFT(arrReal: string | number[] | ArrayBuffer, arrImage?: string | number[] | ArrayBuffer, inverse?: boolean): any;"
+  "typescript" : "FFT(arrReal: string | number[] | ArrayBuffer, arrImage?: string | number[] | ArrayBuffer, options?: boolean | { inverse?: boolean, output?: \"magnitude\" | \"power\" }): any;"
 }
 Performs a Fast Fourier Transform (FFT) in 32 bit floats on the supplied data
 and writes it back into the original arrays. Note that if only one array is
 supplied, the data written back is the modulus of the complex result
-`sqrt(r*r+i*i)`.
+`sqrt(r*r+i*i)` - or the power `r*r+i*i` if `{output:"power"}` is given.
+
+If only one array is supplied, the data is real and so the FFT is computed with
+half the number of complex points, which is roughly twice as fast.
+
+If a `Float32Array` is supplied whose length is a power of 2, the FFT is
+performed in place on its data. Otherwise, there has to be enough room on the
+stack to allocate one (or with `arrImage`, two) arrays of 32 bit floating point
+numbers - this will limit the maximum size of FFT possible to around 1024 items
+on most platforms.
 
-In order to perform the FFT, there has to be enough room on the stack to
-allocate two arrays of 32 bit floating point numbers - this will limit the
-maximum size of FFT possible to around 1024 items on most platforms.
+The sin/cos tables used by the FFT are calculated the first time an FFT of a
+given size is performed and are then kept in memory, so subsequent FFTs of the
+same size or smaller are faster.
 
 **Note:** on the Original Espruino board, FFTs are performed in 64bit arithmetic
 as there isn't space to include the 32 bit maths routines (2x more RAM is
-required).
+required) - so `Float64Array` is needed for in-place operation.
  */
 void _jswrap_espruino_FFT_getData(FFTDATATYPE *dst, JsVar *src, size_t length) {
   JsvIterator it;
@@ -527,60 +605,102 @@ void _jswrap_espruino_FFT_getData(FFTDATATYPE *dst, JsVar *src, size_t length) {
   while (i<length)
     dst[i++]=0;
 }
-void _jswrap_espruino_FFT_setData(JsVar *dst, FFTDATATYPE *src, FFTDATATYPE *srcModulus, size_t length) {
+void _jswrap_espruino_FFT_setData(JsVar *dst, FFTDATATYPE *src, size_t length) {
   JsvIterator it;
   jsvIteratorNew(&it, dst, JSIF_EVERY_ARRAY_ELEMENT);
   size_t i=0;
   while (i<length && jsvIteratorHasElement(&it)) {
-    JsVarFloat f;
-    if (srcModulus)
-      f = jswrap_math_sqrt(src[i]*src[i] + srcModulus[i]*srcModulus[i]);
-    else
-      f = src[i];
-
-    jsvUnLock(jsvIteratorSetValue(&it, jsvNewFromFloat(f)));
+    jsvUnLock(jsvIteratorSetValue(&it, jsvNewFromFloat(src[i])));
     i++;
     jsvIteratorNext(&it);
   }
   jsvIteratorFree(&it);
 }
-void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, bool inverse) {
+void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, JsVar *options) {
   if (!(jsvIsIterable(arrReal)) ||
       !(jsvIsUndefined(arrImag) || jsvIsIterable(arrImag))) {
     jsExceptionHere(JSET_ERROR, "Expecting first 2 arguments to be iterable or undefined, not %t and %t", arrReal, arrImag);
     return;
   }
+  bool inverse = false, power = false;
+  if (jsvIsObject(options)) {
+    inverse = jsvGetBoolAndUnLock(jsvObjectGetChild(options, "inverse", 0));
+    JsVar *output = jsvObjectGetChild(options, "output", 0);
+    if (output && jsvIsStringEqual(output, "power")) power = true;
+    else if (output && !jsvIsStringEqual(output, "magnitude")) {
+      jsExceptionHere(JSET_ERROR, "Unknown output type %q", output);
+      jsvUnLock(output);
+      return;
+    }
+    jsvUnLock(output);
+  } else
+    inverse = jsvGetBool(options);
 
   // get length and work out power of 2
   size_t l = (size_t)jsvGetLength(arrReal);
   size_t pow2 = 1;
-  int order = 0;
+  unsigned int order = 0;
   while (pow2 < l) {
     pow2 <<= 1;
     order++;
   }
+  // If we had imaginary data then DON'T modulus the result
+  bool hasImagResult = jsvIsIterable(arrImag);
 
-  if (jsuGetFreeStack() < 256+sizeof(FFTDATATYPE)*pow2*2) {
+  // Work out where we'll do the FFT, and how much stack we need
+  FFTTwiddles tw;
+  unsigned int twiddleSize = pow2<2 ? 2 : (unsigned int)pow2;
+  JsVar *twiddles = fftGetCachedTwiddles(&tw, twiddleSize);
+  FFTDATATYPE *vReal = fftGetDirectPointer(arrReal, pow2);
+  FFTDATATYPE *vImag = hasImagResult ? fftGetDirectPointer(arrImag, pow2) : 0;
+  size_t workspace = (vReal ? 0 : pow2) + ((hasImagResult && !vImag) ? pow2 : 0) + (twiddles ? 0 : twiddleSize);
+  if (jsuGetFreeStack() < 256+sizeof(FFTDATATYPE)*workspace) {
     jsExceptionHere(JSET_ERROR, "Insufficient stack for computing FFT");
+    jsvUnLock(twiddles);
     return;
   }
-
-  FFTDATATYPE *vReal = (FFTDATATYPE*)alloca(sizeof(FFTDATATYPE)*pow2*2);
-  FFTDATATYPE *vImag = &vReal[pow2];
+  FFTDATATYPE *buf = workspace ? (FFTDATATYPE*)alloca(sizeof(FFTDATATYPE)*workspace) : 0;
+  if (!twiddles) { // not enough memory to cache them - just use the stack
+    fftFillTwiddles(buf, twiddleSize);
+    fftSetTwiddles(&tw, buf, twiddleSize);
+    buf += twiddleSize;
+  }
 
   // load data
-  _jswrap_espruino_FFT_getData(vReal, arrReal, pow2);
-  _jswrap_espruino_FFT_getData(vImag, arrImag, pow2);
+  bool realInPlace = vReal!=0, imagInPlace = vImag!=0;
+  if (!vReal) {
+    vReal = buf;
+    buf += pow2;
+    _jswrap_espruino_FFT_getData(vReal, arrReal, pow2);
+  }
+  if (hasImagResult && !vImag) {
+    vImag = buf;
+    _jswrap_espruino_FFT_getData(vImag, arrImag, pow2);
+  }
 
   // do FFT
-  FFT(inverse ? -1 : 1, order, vReal, vImag);
+  if (hasImagResult) {
+    fftComplex(vReal, vImag, 1, order, inverse, &tw);
+    if (!inverse) { // Scaling for forward transform
+      size_t i;
+      for (i=0;i<pow2;i++) {
+        vReal[i] /= (FFTDATATYPE)pow2;
+        vImag[i] /= (FFTDATATYPE)pow2;
+      }
+    }
+  } else {
+    /* The input is real. For real data the inverse transform is the complex
+     conjugate of the forward one, so the magnitudes are the same bar the scaling */
+    if (order) fftReal(vReal, order, &tw);
+    fftRealToMagnitude(vReal, (unsigned int)pow2, inverse ? 1 : (FFTDATATYPE)1/(FFTDATATYPE)pow2, power);
+  }
+  jsvUnLock(twiddles);
 
   // Put the results back
-  // If we had imaginary data then DON'T modulus the result
-  bool hasImagResult = jsvIsIterable(arrImag);
-  _jswrap_espruino_FFT_setData(arrReal, vReal, hasImagResult?0:vImag, pow2);
-  if (hasImagResult)
-    _jswrap_espruino_FFT_setData(arrImag, vImag, 0, pow2);
+  if (!realInPlace)
+    _jswrap_espruino_FFT_setData(arrReal, vReal, pow2);
+  if (hasImagResult && !imagInPlace)
+    _jswrap_espruino_FFT_setData(arrImag, vImag, pow2);
 }
 
 /*JSON{
@@ -1188,6 +1308,9 @@ int jswrap_espruino_reverseByte(int v) {
   "generate" : "jswrap_espruino_dumpTimers"
 }
 Output the current list of Utility Timer Tasks - for debugging only
+
+This also outputs statistics: how many tasks are/have been in the queue, and the
+longest time interrupts were disabled while the queue was being modified.
  */
 void jswrap_espruino_dumpTimers() {
   jstDumpUtilityTimers();
@@ -1324,6 +1447,31 @@ void jswrap_e_dumpVariables() {
   }
 }
 
+/*JSON{
+  "type" : "staticmethod",
+  "#if" : "defined(DEBUG) && !defined(ESPR_NO_INCREMENTAL_GC)",
+  "class" : "E",
+  "name" : "gcStep",
+  "generate" : "jswrap_e_gcStep",
+  "params" : [
+    ["steps","int","The maximum number of steps of garbage collection to do"]
+  ],
+  "return" : ["JsVar","The phase the garbage collection is now in (`idle` if it finished)"]
+}
+**Only available in debug builds.** Do a slice of at most `steps` steps of
+incremental garbage collection right now, starting a new collection if one
+isn't in progress. Calling this between modifications of objects is used to
+test the garbage collector.
+ */
+#if defined(DEBUG) && !defined(ESPR_NO_INCREMENTAL_GC)
+JsVar *jswrap_e_gcStep(int steps) {
+  jsvGCIncDebugSliceSteps = (unsigned int)(steps>0 ? steps : 1);
+  jsvGarbageCollectIncremental(jshGetTimeFromMilliseconds(1000));
+  jsvGCIncDebugSliceSteps = 0;
+  return jsvNewFromString(jsvGarbageCollectIncrementalPhase());
+}
+#endif
+
 /*JSON{
   "type" : "staticmethod",
   "ifndef" : "SAVE_ON_FLASH",
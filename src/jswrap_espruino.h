@@ -22,7 +22,7 @@ JsVarFloat jswrap_espruino_clip(JsVarFloat x, JsVarFloat min, JsVarFloat max);
 JsVarFloat jswrap_espruino_sum(JsVar *arr);
 JsVarFloat jswrap_espruino_variance(JsVar *arr, JsVarFloat mean);
 JsVarFloat jswrap_espruino_convolve(JsVar *a, JsVar *b, int offset);
-void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, bool inverse);
+void jswrap_espruino_FFT(JsVar *arrReal, JsVar *arrImag, JsVar *options);
 
 void jswrap_espruino_enableWatchdog(JsVarFloat time, JsVar *isAuto);
 void jswrap_espruino_kickWatchdog();
@@ -45,6 +45,7 @@ void jswrap_espruino_dumpLockedVars();
 void jswrap_espruino_dumpFreeList();
 void jswrap_e_dumpFragmentation();
 void jswrap_e_dumpVariables();
+JsVar *jswrap_e_gcStep(int steps);
 JsVar *jswrap_espruino_getSizeOf(JsVar *v, int depth);
 JsVarInt jswrap_espruino_getAddressOf(JsVar *v, bool flatAddress);
 void jswrap_espruino_mapInPlace(JsVar *from, JsVar *to, JsVar *map, JsVarInt bits);
@@ -421,12 +421,13 @@ To set the timezone for all new Dates, use `E.setTimeZone(hours)`.
 void jswrap_interactive_setTime(JsVarFloat time) {
   jshInterruptOff();
   JsSysTime stime = jshGetTimeFromMilliseconds(time*1000);
-  jsiLastIdleTime = stime;
   JsSysTime oldtime = jshGetSystemTime();
   // set system time
   jshSetSystemTime(stime);
   // update any currently running timers so they don't get broken
   jstSystemTimeChanged(stime - oldtime);
+  // JS timers too (use the time we actually got, as not all platforms can set it)
+  jsiTimersSystemTimeChanged(jshGetSystemTime() - oldtime);
   jshInterruptOn();
 }
 
@@ -555,7 +556,7 @@ JsVar *_jswrap_interface_setTimeoutOrInterval(JsVar *func, JsVarFloat interval,
   // Create a new timer
   JsVar *timerPtr = jsvNewObject();
   JsSysTime intervalInt = jshGetTimeFromMilliseconds(interval);
-  jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger((jshGetSystemTime() - jsiLastIdleTime) + intervalInt));
+  jsvObjectSetChildAndUnLock(timerPtr, "time", jsvNewFromLongInteger(jshGetSystemTime() + intervalInt));
   if (!isTimeout) {
     jsvObjectSetChildAndUnLock(timerPtr, "interval", jsvNewFromLongInteger(intervalInt));
   }
@@ -566,7 +567,6 @@ JsVar *_jswrap_interface_setTimeoutOrInterval(JsVar *func, JsVarFloat interval,
   // Add to array
   JsVar *itemIndex = jsvNewFromInteger(jsiTimerAdd(timerPtr));
   jsvUnLock(timerPtr);
-  jsiTimersChanged(); // mark timers as changed
   return itemIndex;
 }
 JsVar *jswrap_interface_setInterval(JsVar *func, JsVarFloat timeout, JsVar *args) {
@@ -629,6 +629,7 @@ void _jswrap_interface_clearTimeoutOrInterval(JsVar *idVarArr, bool isTimeout) {
       jsvUnLock2(watchPtr, timerPtr);
     }
     jsvObjectIteratorFree(&it);
+    jsiTimersChanged(); // rebuild list of when timers are due, removing the old ones
   } else {
     JsVar *idVar = jsvGetArrayItem(idVarArr, 0);
     if (jsvIsUndefined(idVar)) {
@@ -644,7 +645,6 @@ void _jswrap_interface_clearTimeoutOrInterval(JsVar *idVarArr, bool isTimeout) {
     }
   }
   jsvUnLock(timerArrayPtr);
-  jsiTimersChanged(); // mark timers as changed
 }
 void jswrap_interface_clearInterval(JsVar *idVarArr) {
   _jswrap_interface_clearTimeoutOrInterval(idVarArr, false);
@@ -677,13 +677,13 @@ void jswrap_interface_changeInterval(JsVar *idVar, JsVarFloat interval) {
   if (interval<TIMER_MIN_INTERVAL) interval=TIMER_MIN_INTERVAL;
   JsVar *timerName = jsvIsBasic(idVar) ? jsvFindChildFromVar(timerArrayPtr, idVar, false) : 0;
   if (timerName) {
+    JsVarInt timerId = jsvGetInteger(timerName);
     JsVar *timer = jsvSkipNameAndUnLock(timerName);
     JsSysTime intervalInt = jshGetTimeFromMilliseconds(interval);
     jsvObjectSetChildAndUnLock(timer, "interval", jsvNewFromLongInteger(intervalInt));
-    jsvObjectSetChildAndUnLock(timer, "time", jsvNewFromLongInteger((jshGetSystemTime()-jsiLastIdleTime) + intervalInt));
+    jsiTimerSetTime(timerId, timer, jshGetSystemTime() + intervalInt);
     jsvUnLock(timer);
     // timerName already unlocked
-    jsiTimersChanged(); // mark timers as changed
   } else {
     jsExceptionHere(JSET_ERROR, "Unknown Interval");
   }
@@ -186,6 +186,253 @@ JsVar *jswrap_json_parse(JsVar *v) {
   return res;
 }
 
+#ifndef ESPR_NO_JSON_PATH
+/* The functions below scan JSON a character at a time with a JsvStringIterator
+ * (so work directly on Strings in flash), and skip over values without
+ * allocating any variables. Only the value we want is then parsed with
+ * jswrap_json_parse_internal. */
+
+typedef enum {
+  JSONP_FOUND,
+  JSONP_NOT_FOUND,
+  JSONP_INVALID,
+} JsonPathResult;
+
+static void jsonSkipWhitespace(JsvStringIterator *it) {
+  while (isWhitespace(jsvStringIteratorGetChar(it)))
+    jsvStringIteratorNext(it);
+}
+
+/// Iterator is on the opening quote of a string - skip over it (returns false if it doesn't end)
+static bool jsonSkipString(JsvStringIterator *it) {
+  char quote = jsvStringIteratorGetCharAndNext(it);
+  while (jsvStringIteratorHasChar(it)) {
+    char ch = jsvStringIteratorGetCharAndNext(it);
+    if (ch=='\\') jsvStringIteratorNext(it);
+    else if (ch==quote) return true;
+  }
+  return false;
+}
+
+/// Iterator is on the opening quote of a string - skip over it and return true if it's equal to the String 'key'
+static bool jsonMatchString(JsvStringIterator *it, JsVar *key, bool *valid) {
+  char quote = jsvStringIteratorGetCharAndNext(it);
+  JsvStringIterator kit;
+  jsvStringIteratorNew(&kit, key, 0);
+  bool match = true;
+  while (jsvStringIteratorHasChar(it)) {
+    char ch = jsvStringIteratorGetCharAndNext(it);
+    if (ch==quote) {
+      match = match && !jsvStringIteratorHasChar(&kit);
+      jsvStringIteratorFree(&kit);
+      return match;
+    }
+    if (ch=='\\') {
+      ch = jsvStringIteratorGetCharAndNext(it);
+      if (ch!='"' && ch!='\'' && ch!='\\' && ch!='/') match = false; // we don't decode other escapes - assume no match
+    }
+    if (!jsvStringIteratorHasChar(&kit) || jsvStringIteratorGetCharAndNext(&kit)!=ch) match = false;
+  }
+  jsvStringIteratorFree(&kit);
+  *valid = false;
+  return false;
+}
+
+/// Skip over any JSON value (without allocating anything). Returns false if it's not valid
+static bool jsonSkipValue(JsvStringIterator *it) {
+  jsonSkipWhitespace(it);
+  char ch = jsvStringIteratorGetChar(it);
+  if (ch=='{' || ch=='[') {
+    // we don't check the contents are valid, just that brackets match up
+    int depth = 0;
+    do {
+      if (!jsvStringIteratorHasChar(it)) return false;
+      ch = jsvStringIteratorGetChar(it);
+      if (ch=='"' || ch=='\'') {
+        if (!jsonSkipString(it)) return false;
+        continue;
+      }
+      if (ch=='{' || ch=='[') depth++;
+      else if (ch=='}' || ch==']') depth--;
+      jsvStringIteratorNext(it);
+    } while (depth>0);
+    return true;
+  }
+  if (ch=='"' || ch=='\'') return jsonSkipString(it);
+  // number, true, false or null
+  size_t start = jsvStringIteratorGetIndex(it);
+  while (jsvStringIteratorHasChar(it)) {
+    ch = jsvStringIteratorGetChar(it);
+    if (ch==',' || ch=='}' || ch==']' || isWhitespace(ch)) break;
+    jsvStringIteratorNext(it);
+  }
+  return jsvStringIteratorGetIndex(it)!=start;
+}
+
+/// Iterator is on an object or array. Move it to the value of the given key/index (a String)
+static JsonPathResult jsonFindChild(JsvStringIterator *it, JsVar *key) {
+  jsonSkipWhitespace(it);
+  char ch = jsvStringIteratorGetChar(it);
+  if (ch=='[') {
+    // arrays can only be indexed by a positive integer
+    if (!jsvIsStringNumericStrict(key)) return JSONP_NOT_FOUND;
+    JsVarInt index = jsvGetInteger(key);
+    jsvStringIteratorNext(it);
+    for (JsVarInt i=0;;i++) {
+      jsonSkipWhitespace(it);
+      if (jsvStringIteratorGetChar(it)==']') return JSONP_NOT_FOUND;
+      if (i==index) return JSONP_FOUND;
+      if (!jsonSkipValue(it)) return JSONP_INVALID;
+      jsonSkipWhitespace(it);
+      if (jsvStringIteratorGetChar(it)!=',') return jsvStringIteratorGetChar(it)==']' ? JSONP_NOT_FOUND : JSONP_INVALID;
+      jsvStringIteratorNext(it);
+    }
+  } else if (ch=='{') {
+    jsvStringIteratorNext(it);
+    while (true) {
+      jsonSkipWhitespace(it);
+      ch = jsvStringIteratorGetChar(it);
+      if (ch=='}') return JSONP_NOT_FOUND;
+      if (ch!='"' && ch!='\'') return JSONP_INVALID;
+      bool valid = true;
+      bool match = jsonMatchString(it, key, &valid);
+      jsonSkipWhitespace(it);
+      if (!valid || jsvStringIteratorGetChar(it)!=':') return JSONP_INVALID;
+      jsvStringIteratorNext(it);
+      jsonSkipWhitespace(it);
+      if (match) return JSONP_FOUND;
+      if (!jsonSkipValue(it)) return JSONP_INVALID;
+      jsonSkipWhitespace(it);
+      if (jsvStringIteratorGetChar(it)!=',') return jsvStringIteratorGetChar(it)=='}' ? JSONP_NOT_FOUND : JSONP_INVALID;
+      jsvStringIteratorNext(it);
+    }
+  }
+  return JSONP_NOT_FOUND; // not an object or array
+}
+
+/// Move the iterator to the value given by path, which is either a String of keys separated by '.', or an array of keys
+static JsonPathResult jsonFindPath(JsvStringIterator *it, JsVar *path) {
+  JsonPathResult r = JSONP_FOUND;
+  if (jsvIsArray(path)) {
+    JsvObjectIterator pit;
+    jsvObjectIteratorNew(&pit, path);
+    while (r==JSONP_FOUND && jsvObjectIteratorHasValue(&pit)) {
+      JsVar *key = jsvAsStringAndUnLock(jsvObjectIteratorGetValue(&pit));
+      r = key ? jsonFindChild(it, key) : JSONP_NOT_FOUND;
+      jsvUnLock(key);
+      jsvObjectIteratorNext(&pit);
+    }
+    jsvObjectIteratorFree(&pit);
+  } else if (!jsvIsUndefined(path)) {
+    JsVar *pathStr = jsvAsString(path);
+    size_t len = jsvGetStringLength(pathStr);
+    size_t start = 0;
+    while (len && r==JSONP_FOUND) {
+      // each key is the text up to the next '.'
+      JsvStringIterator pit;
+      jsvStringIteratorNew(&pit, pathStr, start);
+      while (jsvStringIteratorHasChar(&pit) && jsvStringIteratorGetChar(&pit)!='.')
+        jsvStringIteratorNext(&pit);
+      size_t end = jsvStringIteratorGetIndex(&pit);
+      jsvStringIteratorFree(&pit);
+      JsVar *key = jsvNewFromStringVar(pathStr, start, end-start);
+      r = key ? jsonFindChild(it, key) : JSONP_NOT_FOUND;
+      jsvUnLock(key);
+      if (end>=len) break;
+      start = end+1;
+    }
+    jsvUnLock(pathStr);
+  }
+  jsonSkipWhitespace(it);
+  return r;
+}
+
+/** The lexer is at an array or object - parse each item and call callback(value,key) with it.
+Returns true if the callback threw an exception (rather than the JSON being invalid) */
+static bool jsonParseItems(JsVar *callback) {
+  bool isArray = lex->tk=='[';
+  if (!isArray && lex->tk!='{') {
+    jsExceptionHere(JSET_ERROR, "Expecting an array or object");
+    return false;
+  }
+  int endToken = isArray ? ']' : '}';
+  jslGetNextToken();
+  int index = 0;
+  while (lex->tk!=endToken && !jspHasError()) {
+    JsVar *key;
+    if (isArray) {
+      key = jsvNewFromInteger(index++);
+    } else {
+      if (lex->tk!=LEX_STR) {
+        jslMatch(LEX_STR); // error
+        return false;
+      }
+      key = jslGetTokenValueAsVar();
+      jslGetNextToken();
+      if (!jslMatch(':')) {
+        jsvUnLock(key);
+        return false;
+      }
+    }
+    JsVar *value = jswrap_json_parse_internal();
+    if (!value) {
+      jsvUnLock(key);
+      return false;
+    }
+    JsVar *args[2] = {value, key};
+    JsVar *r = jspExecuteFunction(callback, 0, 2, args);
+    jsvUnLock2(value, key);
+    if (jspHasError()) {
+      jsvUnLock(r);
+      return true;
+    }
+    bool stop = jsvIsBoolean(r) && !jsvGetBool(r);
+    jsvUnLock(r);
+    if (stop) return false; // callback returned false
+    if (lex->tk!=endToken && !jslMatch(',')) return false;
+  }
+  return false;
+}
+
+JsVar *jsonParsePath(JsVar *str, JsVar *path, JsVar *callback, bool noExceptions) {
+  if (!jsvIsString(str)) {
+    str = jsvAsString(str);
+    JsVar *r = jsonParsePath(str, path, callback, noExceptions);
+    jsvUnLock(str);
+    return r;
+  }
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  JsonPathResult found = jsonFindPath(&it, path);
+  size_t valueIndex = jsvStringIteratorGetIndex(&it);
+  jsvStringIteratorFree(&it);
+  if (found==JSONP_INVALID) {
+    if (!noExceptions)
+      jsExceptionHere(JSET_SYNTAXERROR, "Invalid JSON at position %d", (int)valueIndex);
+    return 0;
+  }
+  if (found!=JSONP_FOUND) return 0;
+  // Now parse just the value we found
+  JsLex lex;
+  JsLex *oldLex = jslSetLex(&lex);
+  jslInit(str);
+  if (valueIndex) jslSeekTo(valueIndex);
+  JsVar *res = 0;
+  bool callbackError = false;
+  if (jsvIsFunction(callback)) callbackError = jsonParseItems(callback);
+  else res = jswrap_json_parse_internal();
+  jslKill();
+  jslSetLex(oldLex);
+  if (noExceptions && !callbackError && jspHasError()) {
+    // the JSON was invalid - but exceptions from the callback are still thrown
+    jsvUnLock2(res, jspGetException());
+    execInfo.execute &= ~EXEC_EXCEPTION;
+    res = 0;
+  }
+  return res;
+}
+#endif // ESPR_NO_JSON_PATH
+
 /* This is like jsfGetJSONWithCallback, but handles ONLY functions (and does not print the initial 'function' text) */
 void jsfGetJSONForFunctionWithCallback(JsVar *var, JSONFlags flags, vcbprintf_callback user_callback, void *user_data) {
   assert(jsvIsFunction(var));
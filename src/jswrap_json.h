@@ -16,6 +16,14 @@
 JsVar *jswrap_json_stringify(JsVar *v, JsVar *replacer, JsVar *space);
 JsVar *jswrap_json_parse_ext(JsVar *v, bool throwExceptions);
 JsVar *jswrap_json_parse(JsVar *v);
+#ifndef ESPR_NO_JSON_PATH
+/** Parse JSON from a String (which may be in flash) but only create variables for
+ * the value at 'path' (a String like "a.b.0" or an array of keys). If 'callback'
+ * is a function it is called with (value,key) for each item in that value instead,
+ * so only one item is ever in memory at a time. If noExceptions is set, invalid
+ * JSON just returns undefined (exceptions thrown by 'callback' are still thrown). */
+JsVar *jsonParsePath(JsVar *str, JsVar *path, JsVar *callback, bool noExceptions);
+#endif
 
 typedef enum {
   JSON_NONE,
@@ -23,12 +23,283 @@
  *    * When the pipe closes, unless 'end=false' on initialisation, we call
  *      'end' on destination, and 'close' on source.
  *
+ * Built-in streams (Serial, Socket, StorageFile, File) and ArrayBuffers are
+ * handled natively - data is copied through a buffer on the stack rather
+ * than calling 'read' and 'write' in JS. User-defined streams still use
+ * their JS methods.
+ *
  * ----------------------------------------------------------------------------
  */
 
 #include "jswrap_pipe.h"
 #include "jswrap_object.h"
 #include "jswrap_stream.h"
+#include "jswrap_serial.h"
+#include "jswrap_storage.h"
+#include "jsserial.h"
+#ifdef USE_NET
+#include "jswrap_net.h"
+#endif
+#ifdef USE_FILESYSTEM
+#include "jswrap_file.h"
+#endif
+
+/// Size of the buffer on the stack used when piping between native streams
+#define PIPE_BUFFER_SIZE 128
+
+/// Native code to read from a built-in stream
+typedef struct {
+  void (*builtIn)(void); ///< The built-in 'read' method this replaces (0 for ArrayBuffers)
+  /// Read up to len bytes into buf. Returns the number of bytes read (0 if waiting for data), or -1 if the stream has finished
+  int (*read)(JsVar *source, size_t position, char *buf, int len);
+  /// If set, used instead of 'read' to get up to len bytes as a string in one go. Returns 0 if the stream has finished
+  JsVar *(*readString)(JsVar *source, size_t position, int len);
+} PipeSource;
+
+/// Native code to write to a built-in stream
+typedef struct {
+  void (*builtIn)(void); ///< The built-in 'write' method this replaces (0 for ArrayBuffers)
+  /// Write len bytes from buf. Returns false if we should wait for a 'drain' event
+  bool (*write)(JsVar *destination, size_t position, const char *buf, int len);
+  /// If set, called after each chunk has been written (eg. to sync files)
+  void (*flush)(JsVar *destination);
+} PipeSink;
+
+/// Get the length of an ArrayBuffer (or view) in bytes
+static size_t pipeArrayBufferByteLength(JsVar *ab) {
+  return jsvGetArrayBufferLength(ab) * JSV_ARRAYBUFFER_GET_SIZE(ab->varData.arraybuffer.type);
+}
+
+/// Take up to len bytes from the stream's buffer, trimming it once (an empty string if waiting for data)
+static JsVar *pipeStreamReadString(JsVar *source, size_t position, int len) {
+  NOT_USED(position);
+  JsVar *data = jsvObjectGetChild(source, STREAM_BUFFER_NAME, 0);
+  if (!jsvIsString(data)) {
+    jsvUnLock(data);
+    return jsvNewFromEmptyString();
+  }
+  if (jsvGetStringLength(data) <= (size_t)len) {
+    jsvObjectRemoveChild(source, STREAM_BUFFER_NAME);
+    return data;
+  }
+  JsVar *chunk = jsvNewFromStringVar(data, 0, (size_t)len);
+  jsvObjectSetChildAndUnLock(source, STREAM_BUFFER_NAME, jsvNewFromStringVar(data, (size_t)len, JSVAPPENDSTRINGVAR_MAXLENGTH));
+  jsvUnLock(data);
+  return chunk;
+}
+
+static int pipeStorageFileRead(JsVar *source, size_t position, char *buf, int len) {
+  NOT_USED(position);
+  JsVar *data = jswrap_storagefile_read(source, len);
+  if (!data) return -1; // end of file
+  int n = (int)jsvGetStringChars(data, 0, buf, (size_t)len);
+  jsvUnLock(data);
+  return n;
+}
+
+#ifdef USE_FILESYSTEM
+static int pipeFileRead(JsVar *source, size_t position, char *buf, int len) {
+  NOT_USED(position);
+  int n = (int)jswrap_file_readBytes(source, buf, (size_t)len);
+  return n ? n : -1; // nothing read means end of file
+}
+#endif
+
+static int pipeArrayBufferRead(JsVar *source, size_t position, char *buf, int len) {
+  size_t length = pipeArrayBufferByteLength(source);
+  if (position >= length) return -1; // all read
+  if ((size_t)len > length-position) len = (int)(length-position);
+  uint32_t offset;
+  JsVar *backing = jsvGetArrayBufferBackingString(source, &offset);
+  jsvGetStringChars(backing, offset+position, buf, (size_t)len);
+  jsvUnLock(backing);
+  return len;
+}
+
+static bool pipeSerialWrite(JsVar *destination, size_t position, const char *buf, int len) {
+  NOT_USED(position);
+  serial_sender serialSend;
+  serial_sender_data serialSendData;
+  if (jsserialGetSendFunction(destination, &serialSend, &serialSendData)) {
+    for (int i=0;i<len;i++)
+      serialSend((unsigned char)buf[i], &serialSendData);
+  }
+  return true;
+}
+
+#ifdef USE_NET
+static bool pipeSocketWrite(JsVar *destination, size_t position, const char *buf, int len) {
+  NOT_USED(position);
+  // Sockets keep the data as a string until it is sent, so we must create one
+  JsVar *data = jsvNewStringOfLength((unsigned int)len, buf);
+  bool r = data ? jswrap_net_socket_write(destination, data) : true;
+  jsvUnLock(data);
+  return r;
+}
+#endif
+
+static bool pipeStorageFileWrite(JsVar *destination, size_t position, const char *buf, int len) {
+  NOT_USED(position);
+  JsVar *data = jsvNewStringOfLength((unsigned int)len, buf);
+  if (data) jswrap_storagefile_write(destination, data);
+  jsvUnLock(data);
+  return true;
+}
+
+#ifdef USE_FILESYSTEM
+static bool pipeFileWrite(JsVar *destination, size_t position, const char *buf, int len) {
+  NOT_USED(position);
+  jswrap_file_writeBytes(destination, buf, (size_t)len);
+  return true;
+}
+
+static void pipeFileFlush(JsVar *destination) {
+  jswrap_file_sync(destination);
+}
+#endif
+
+static bool pipeArrayBufferWrite(JsVar *destination, size_t position, const char *buf, int len) {
+  size_t length = pipeArrayBufferByteLength(destination);
+  if (position >= length) return true; // anything past the end is lost
+  if ((size_t)len > length-position) len = (int)(length-position);
+  uint32_t offset;
+  JsVar *backing = jsvGetArrayBufferBackingString(destination, &offset);
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, backing, offset+position);
+  for (int i=0;i<len;i++)
+    jsvStringIteratorSetCharAndNext(&it, buf[i]);
+  jsvStringIteratorFree(&it);
+  jsvUnLock(backing);
+  return true;
+}
+
+static const PipeSource pipeSources[] = {
+  { 0, pipeArrayBufferRead, 0 },
+  { (void (*)(void))jswrap_stream_read, 0, pipeStreamReadString }, // Serial, Socket, HTTP
+  { (void (*)(void))jswrap_storagefile_read, pipeStorageFileRead, 0 },
+#ifdef USE_FILESYSTEM
+  { (void (*)(void))jswrap_file_read, pipeFileRead, 0 },
+#endif
+};
+
+static const PipeSink pipeSinks[] = {
+  { 0, pipeArrayBufferWrite, 0 },
+  { (void (*)(void))jswrap_serial_write, pipeSerialWrite, 0 },
+#ifdef USE_NET
+  { (void (*)(void))jswrap_net_socket_write, pipeSocketWrite, 0 }, // Socket, HTTP client request
+#endif
+  { (void (*)(void))jswrap_storagefile_write, pipeStorageFileWrite, 0 },
+#ifdef USE_FILESYSTEM
+  { (void (*)(void))jswrap_file_write, pipeFileWrite, pipeFileFlush },
+#endif
+};
+
+/// Get the built-in function that a native source/sink replaces (0 for ArrayBuffers). Returns false if there isn't one
+static bool pipeGetBuiltIn(JsVar *obj, JsVar *method, void **builtIn) {
+  *builtIn = 0;
+  if (jsvIsArrayBuffer(obj)) return true;
+  if (!jsvIsNativeFunction(method)) return false;
+  *builtIn = jsvGetNativeFunctionPtr(method);
+  return *builtIn != 0;
+}
+
+/// Find a native way to read from source, returning the index+1 in pipeSources, or 0 if we must call 'read' in JS
+static int pipeFindSource(JsVar *source, JsVar *readFunc) {
+  void *builtIn;
+  if (!pipeGetBuiltIn(source, readFunc, &builtIn)) return 0;
+  for (unsigned int i=0;i<sizeof(pipeSources)/sizeof(PipeSource);i++)
+    if ((void*)pipeSources[i].builtIn == builtIn) return (int)i+1;
+  return 0;
+}
+
+/// Find a native way to write to destination, returning the index+1 in pipeSinks, or 0 if we must call 'write' in JS
+static int pipeFindSink(JsVar *destination, JsVar *writeFunc) {
+  void *builtIn;
+  if (!pipeGetBuiltIn(destination, writeFunc, &builtIn)) return 0;
+  for (unsigned int i=0;i<sizeof(pipeSinks)/sizeof(PipeSink);i++)
+    if ((void*)pipeSinks[i].builtIn == builtIn) return (int)i+1;
+  return 0;
+}
+
+static const PipeSource *pipeGetSource(JsVar *pipe) {
+  int type = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"sourceType",0));
+  return type ? &pipeSources[type-1] : 0;
+}
+
+static const PipeSink *pipeGetSink(JsVar *pipe) {
+  int type = (int)jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"destinationType",0));
+  return type ? &pipeSinks[type-1] : 0;
+}
+
+/// Read up to len bytes from a native source into a new string. Returns 0 if the stream has finished
+static JsVar *pipeNativeReadString(const PipeSource *src, JsVar *source, size_t position, int len) {
+  if (src->readString) return src->readString(source, position, len);
+  char buf[PIPE_BUFFER_SIZE];
+  JsVar *data = 0;
+  while (len>0) {
+    int requested = len<PIPE_BUFFER_SIZE ? len : PIPE_BUFFER_SIZE;
+    int n = src->read(source, position, buf, requested);
+    if (n<0) break; // end of stream
+    if (!data) data = jsvNewFromEmptyString();
+    if (!data) break; // out of memory
+    jsvAppendStringBuf(data, buf, (size_t)n);
+    if (n<requested) break; // no more data available right now
+    position += (size_t)n;
+    len -= n;
+  }
+  return data;
+}
+
+/// Write data (usually a string) to a native sink. Returns false if we should wait for a 'drain' event
+static bool pipeNativeWriteVar(const PipeSink *dst, JsVar *destination, size_t position, JsVar *data) {
+  char buf[PIPE_BUFFER_SIZE];
+  JsVar *str = jsvAsString(data);
+  bool ok = true;
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, 0);
+  while (jsvStringIteratorHasChar(&it)) {
+    int n = 0;
+    while (jsvStringIteratorHasChar(&it) && n<PIPE_BUFFER_SIZE)
+      buf[n++] = jsvStringIteratorGetCharAndNext(&it);
+    if (!dst->write(destination, position, buf, n)) ok = false;
+    position += (size_t)n;
+  }
+  jsvStringIteratorFree(&it);
+  jsvUnLock(str);
+  if (dst->flush) dst->flush(destination);
+  return ok;
+}
+
+/** Copy up to len bytes from a native source to a native sink, updating position. Returns false if
+the source has finished, and sets 'wait' if we should wait for a 'drain' event */
+static bool pipeNativeTransfer(const PipeSource *src, const PipeSink *dst, JsVar *source, JsVar *destination, size_t *position, int len, bool *wait) {
+  if (src->readString) {
+    JsVar *data = src->readString(source, *position, len);
+    if (!data) return false; // end of stream
+    size_t n = jsvGetStringLength(data);
+    if (n && !pipeNativeWriteVar(dst, destination, *position, data)) *wait = true;
+    jsvUnLock(data);
+    *position += n;
+    return true;
+  }
+  char buf[PIPE_BUFFER_SIZE];
+  size_t pos = *position;
+  bool transferred = false;
+  while (len>0) {
+    int requested = len<PIPE_BUFFER_SIZE ? len : PIPE_BUFFER_SIZE;
+    int n = src->read(source, pos, buf, requested);
+    if (n<0) break; // end of stream
+    transferred = true;
+    if (n==0) break; // waiting for data
+    if (!dst->write(destination, pos, buf, n)) *wait = true;
+    pos += (size_t)n;
+    len -= n;
+    if (n<requested) break; // no more data available right now
+  }
+  if (pos != *position && dst->flush) dst->flush(destination);
+  *position = pos;
+  return transferred;
+}
 
 static JsVar* pipeGetArray(bool create) {
   return jsvObjectGetChild(execInfo.hiddenRoot, "pipes", create ? JSV_ARRAY : 0);
@@ -41,28 +312,32 @@ static void handlePipeClose(JsVar *arr, JsvObjectIterator *it, JsVar* pipe) {
   // but if it is and it has data it should have a a STREAM_BUFFER_NAME field
   JsVar *source = jsvObjectGetChild(pipe,"source",0);
   JsVar *destination = jsvObjectGetChild(pipe,"destination",0);
-  if (source && destination) {
+  if (source && destination && !jsvIsArrayBuffer(source)) {
     JsVar *buffer = jsvObjectGetChild(source, STREAM_BUFFER_NAME, 0);
     if (buffer && jsvGetStringLength(buffer)) {
       jsvObjectRemoveChild(source, STREAM_BUFFER_NAME); // remove outstanding data
+      JsVarInt position = jsvGetIntegerAndUnLock(jsvObjectGetChild(pipe,"position",0));
       /* call write fn - we ignore drain/etc here because the source has
       just closed and we want to get this sorted quickly */
-      JsVar *writeFunc = jspGetNamedField(destination, "write", false);
-      if (jsvIsFunction(writeFunc)) { // do the objects have the necessary methods on them?
-        jsvUnLock(jspExecuteFunction(writeFunc, destination, 1, &buffer));
+      const PipeSink *dst = pipeGetSink(pipe);
+      if (dst) {
+        pipeNativeWriteVar(dst, destination, (size_t)position, buffer);
+      } else {
+        JsVar *writeFunc = jspGetNamedField(destination, "write", false);
+        if (jsvIsFunction(writeFunc)) { // do the objects have the necessary methods on them?
+          jsvUnLock(jspExecuteFunction(writeFunc, destination, 1, &buffer));
+        }
+        jsvUnLock(writeFunc);
       }
-      jsvUnLock(writeFunc);
       // update position
-      JsVar *position = jsvObjectGetChild(pipe,"position",0);
-      jsvSetInteger(position, jsvGetInteger(position) + (JsVarInt)jsvGetStringLength(buffer));
-      jsvUnLock(position);
+      jsvObjectSetChildAndUnLock(pipe, "position", jsvNewFromInteger(position + (JsVarInt)jsvGetStringLength(buffer)));
     }
     jsvUnLock(buffer);
   }
   // also call 'end' if 'end' was passed as an initialisation option
   if (jsvGetBoolAndUnLock(jsvObjectGetChild(pipe,"end",0))) {
     // call destination.end if available
-    if (destination) {
+    if (destination && !jsvIsArrayBuffer(destination)) {
       // remove our drain and close listeners.
       // TODO: This removes ALL listeners. Maybe we should just remove ours?
       jswrap_object_removeAllListeners_cstr(destination, "drain");
@@ -83,7 +358,7 @@ static void handlePipeClose(JsVar *arr, JsvObjectIterator *it, JsVar* pipe) {
     /* call source.close if available - probably not what node does
     but seems very sensible in this case. If you don't want it,
     set end:false */
-    if (source) {
+    if (source && !jsvIsArrayBuffer(source)) {
       // TODO: This removes ALL listeners. Maybe we should just remove ours?
       jswrap_object_removeAllListeners_cstr(source, "close");
       // execute the 'close' function
@@ -105,36 +380,51 @@ static bool handlePipe(JsVar *arr, JsvObjectIterator *it, JsVar* pipe) {
   if (paused) return false;
 
   JsVar *position = jsvObjectGetChild(pipe,"position",0);
+  size_t pos = (size_t)jsvGetInteger(position);
   JsVar *chunkSize = jsvObjectGetChild(pipe,"chunkSize",0);
   JsVar *source = jsvObjectGetChild(pipe,"source",0);
   JsVar *destination = jsvObjectGetChild(pipe,"destination",0);
 
   bool dataTransferred = false;
   if(source && destination && chunkSize && position) {
-    JsVar *readFunc = jspGetNamedField(source, "read", false);
-    JsVar *writeFunc = jspGetNamedField(destination, "write", false);
-    if (jsvIsFunction(readFunc) && jsvIsFunction(writeFunc)) { // do the objects have the necessary methods on them?
-      JsVar *buffer = jspExecuteFunction(readFunc, source, 1, &chunkSize);
+    const PipeSource *src = pipeGetSource(pipe);
+    const PipeSink *dst = pipeGetSink(pipe);
+    JsVar *readFunc = src ? 0 : jspGetNamedField(source, "read", false);
+    JsVar *writeFunc = dst ? 0 : jspGetNamedField(destination, "write", false);
+    bool wait = false;
+    if (src && dst) { // both built in - we can copy data directly
+      dataTransferred = pipeNativeTransfer(src, dst, source, destination, &pos, (int)jsvGetInteger(chunkSize), &wait);
+    } else if ((src || jsvIsFunction(readFunc)) && (dst || jsvIsFunction(writeFunc))) { // do the objects have the necessary methods on them?
+      JsVar *buffer = src ?
+          pipeNativeReadString(src, source, pos, (int)jsvGetInteger(chunkSize)) :
+          jspExecuteFunction(readFunc, source, 1, &chunkSize);
       if(buffer) {
         JsVarInt bufferSize = jsvGetLength(buffer);
         if (bufferSize>0) {
-          JsVar *response = jspExecuteFunction(writeFunc, destination, 1, &buffer);
-          if (jsvIsBoolean(response) && jsvGetBool(response)==false) {
+          if (dst) {
+            wait = !pipeNativeWriteVar(dst, destination, pos, buffer);
+          } else {
+            JsVar *response = jspExecuteFunction(writeFunc, destination, 1, &buffer);
             // If boolean false was returned, wait for drain event (http://nodejs.org/api/stream.html#stream_writable_write_chunk_encoding_callback)
-            jsvObjectSetChildAndUnLock(pipe,"drainWait",jsvNewFromBool(true));
+            wait = jsvIsBoolean(response) && jsvGetBool(response)==false;
+            jsvUnLock(response);
           }
-          jsvUnLock(response);
-          jsvSetInteger(position, jsvGetInteger(position) + bufferSize);
+          pos += (size_t)bufferSize;
         }
         jsvUnLock(buffer);
         dataTransferred = true; // so we don't close the pipe if we get an empty string
       }
     } else {
-      if(!jsvIsFunction(readFunc))
+      if(!src && !jsvIsFunction(readFunc))
         jsExceptionHere(JSET_ERROR, "Source Stream does not implement the required read(length) method.");
-      if(!jsvIsFunction(writeFunc))
+      if(!dst && !jsvIsFunction(writeFunc))
         jsExceptionHere(JSET_ERROR, "Destination Stream does not implement the required write(buffer) method.");
     }
+    if (wait)
+      jsvObjectSetChildAndUnLock(pipe,"drainWait",jsvNewFromBool(true));
+    // small ints are stored in the name, so we can't just set 'position' directly
+    if (pos != (size_t)jsvGetInteger(position))
+      jsvObjectSetChildAndUnLock(pipe,"position",jsvNewFromInteger((JsVarInt)pos));
     jsvUnLock2(readFunc, writeFunc);
   }
 
@@ -243,8 +533,8 @@ static void jswrap_pipe_dst_close_listener(JsVar *destination) {
   "ifndef" : "SAVE_ON_FLASH",
   "generate" : "jswrap_pipe",
   "params" : [
-    ["source","JsVar","The source file/stream that will send content."],
-    ["destination","JsVar","The destination file/stream that will receive content from the source."],
+    ["source","JsVar","The source file/stream/ArrayBuffer that will send content."],
+    ["destination","JsVar","The destination file/stream/ArrayBuffer that will receive content from the source."],
     ["options","JsVar",["An optional object `{ chunkSize : int=64, end : bool=true, complete : function }`","chunkSize : The amount of data to pipe from source to destination at a time","complete : a function to call when the pipe activity is complete","end : call the 'end' function on the destination when the source is finished"]]
   ]
 }*/
@@ -254,10 +544,10 @@ void jswrap_pipe(JsVar* source, JsVar* dest, JsVar* options) {
   JsVar *arr = pipeGetArray(true);
   JsVar* position = jsvNewFromInteger(0);
   if (pipe && arr && position) {// out of memory?
-    JsVar *readFunc = jspGetNamedField(source, "read", false);
-    JsVar *writeFunc = jspGetNamedField(dest, "write", false);
-    if(jsvIsFunction(readFunc)) {
-      if(jsvIsFunction(writeFunc)) {
+    JsVar *readFunc = jsvIsArrayBuffer(source) ? 0 : jspGetNamedField(source, "read", false);
+    JsVar *writeFunc = jsvIsArrayBuffer(dest) ? 0 : jspGetNamedField(dest, "write", false);
+    if(jsvIsArrayBuffer(source) || jsvIsFunction(readFunc)) {
+      if(jsvIsArrayBuffer(dest) || jsvIsFunction(writeFunc)) {
         JsVarInt chunkSize = 64;
         bool callEnd = true;
         // parse Options Object
@@ -281,10 +571,18 @@ void jswrap_pipe(JsVar* source, JsVar* dest, JsVar* options) {
         } else if (!jsvIsUndefined(options)) {
           jsExceptionHere(JSET_TYPEERROR, "'options' must be an object, or undefined");
         }
-        // set up our event listeners
-        jswrap_object_addEventListener(source, "close", jswrap_pipe_src_close_listener, JSWAT_THIS_ARG);
-        jswrap_object_addEventListener(dest, "drain", jswrap_pipe_drain_listener, JSWAT_VOID | (JSWAT_JSVAR << (JSWAT_BITS*1)));
-        jswrap_object_addEventListener(dest, "close", jswrap_pipe_dst_close_listener, JSWAT_THIS_ARG);
+        // set up our event listeners (ArrayBuffers don't have events)
+        if (!jsvIsArrayBuffer(source))
+          jswrap_object_addEventListener(source, "close", jswrap_pipe_src_close_listener, JSWAT_THIS_ARG);
+        if (!jsvIsArrayBuffer(dest)) {
+          jswrap_object_addEventListener(dest, "drain", jswrap_pipe_drain_listener, JSWAT_VOID | (JSWAT_JSVAR << (JSWAT_BITS*1)));
+          jswrap_object_addEventListener(dest, "close", jswrap_pipe_dst_close_listener, JSWAT_THIS_ARG);
+        }
+        // can we read/write natively rather than calling JS methods?
+        int sourceType = pipeFindSource(source, readFunc);
+        int destinationType = pipeFindSink(dest, writeFunc);
+        if (sourceType) jsvObjectSetChildAndUnLock(pipe, "sourceType", jsvNewFromInteger(sourceType));
+        if (destinationType) jsvObjectSetChildAndUnLock(pipe, "destinationType", jsvNewFromInteger(destinationType));
         // set up the rest of the pipe
         jsvObjectSetChildAndUnLock(pipe, "chunkSize", jsvNewFromInteger(chunkSize));
         jsvObjectSetChildAndUnLock(pipe, "end", jsvNewFromBool(callEnd));
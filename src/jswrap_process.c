@@ -181,6 +181,10 @@ memory usage.
   Note that this is INCLUDED in the figure for 'free'
 * `gc` : Memory freed during the GC pass
 * `gctime` : Time taken for GC pass (in milliseconds)
+* `gcslices` : (if supported) How many slices the last idle-time (incremental)
+  garbage collection was split into
+* `gcpause` : (if supported) The longest time (in milliseconds) that the last
+  idle-time garbage collection paused execution for
 * `blocksize` : Size of a block (variable) in bytes
 * `stackEndAddress` : (on ARM) the address (that can be used with peek/poke/etc)
   of the END of the stack. The stack grows down, so unless you do a lot of
@@ -227,6 +231,14 @@ JsVar *jswrap_process_memory(JsVar *gc) {
       jsvObjectSetChildAndUnLock(obj, "gc", jsvNewFromInteger((JsVarInt)varsGCd));
       jsvObjectSetChildAndUnLock(obj, "gctime", jsvNewFromFloat(jshGetMillisecondsFromTime(time2-time1)));
     }
+#ifndef ESPR_NO_INCREMENTAL_GC
+    JsvGarbageCollectStats gcStats;
+    jsvGarbageCollectIncrementalStats(&gcStats);
+    if (gcStats.slices) {
+      jsvObjectSetChildAndUnLock(obj, "gcslices", jsvNewFromInteger((JsVarInt)gcStats.slices));
+      jsvObjectSetChildAndUnLock(obj, "gcpause", jsvNewFromFloat(jshGetMillisecondsFromTime(gcStats.maxPause)));
+    }
+#endif
     jsvObjectSetChildAndUnLock(obj, "blocksize", jsvNewFromInteger(sizeof(JsVar)));
 
 #ifdef ARM
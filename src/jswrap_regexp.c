@@ -19,12 +19,6 @@
 #include "jslex.h"
 #include "jsinteractive.h"
 
-/* TODO:
- *
- * Handling of 'global' flag especially
- * lastIndex support?
- */
-
 #define MAX_GROUPS 9
 #define NO_RANGE  256
 
@@ -159,9 +153,8 @@ bool matchcharacter(char *regexp, JsvStringIterator *txtIt, int *length, matchIn
     if (cH=='W') return !(isNumeric(ch) || isAlpha(ch) || ch=='_');
     if (cH=='0') { cH=0; goto haveCode; }
     if (cH>='1' && cH<='9') {
-      jsExceptionHere(JSET_ERROR, "Backreferences not supported");
+      jsExceptionHere(JSET_ERROR, "Backreferences not supported in character sets");
       return false;
-      // we could implement this if needed by matching against info->groupStart/End
     }
     if (cH=='x' && regexp[2] && regexp[3]) {
       *length = 4;
@@ -225,6 +218,24 @@ static JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info)
     if (!jspCheckStackPosition()) return 0;
     return matchhere(regexp+1, txtIt, info);
   }
+  if (regexp[0]=='\\' && regexp[1]>='1' && regexp[1]<='9') { // backreference
+    int group = regexp[1]-'1';
+    if (group<info.groups) {
+      for (size_t i=info.groupStart[group];i<info.groupEnd[group];i++) {
+        char ch = jsvStringIteratorGetChar(txtIt);
+        char groupCh = jsvGetCharInString(info.sourceStr, i);
+        if (info.ignoreCase) {
+          ch = charToLowerCase(ch);
+          groupCh = charToLowerCase(groupCh);
+        }
+        if (!jsvStringIteratorHasChar(txtIt) || ch!=groupCh)
+          return nomatchfound(regexp+2, info);
+        jsvStringIteratorNext(txtIt);
+      }
+    }
+    if (!jspCheckStackPosition()) return 0;
+    return matchhere(regexp+2, txtIt, info);
+  }
   int charLength;
   bool charMatched = matchcharacter(regexp, txtIt, &charLength, &info);
   if (regexp[charLength] == '*' || regexp[charLength] == '+') {
@@ -267,6 +278,688 @@ static JsVar *matchhere(char *regexp, JsvStringIterator *txtIt, matchInfo info)
   return nomatchfound(&regexp[charLength], info);
 }
 
+/* Compiled regular expressions
+
+ new RegExp compiles the pattern once into a small program which is stored
+ in a hidden String on the RegExp object. This is run with a Pike VM - a
+ Thompson NFA where each thread carries its own capture groups - so matching
+ takes time linear in the length of the input and memory that depends only
+ on the pattern. Patterns the compiler can't handle (backreferences) don't
+ get a program and use the recursive matcher above instead - unless they use
+ '{n}' quantifiers, which that doesn't understand, in which case we throw.
+
+ The last few programs compiled are kept in a hidden Object keyed by their
+ source (JS_REGEXP_CACHE_VAR), so a RegExp literal that is evaluated over and
+ over (eg. in a loop or a function) is only compiled once. The cache is
+ freed by jsiFreeMoreMemory if we run low on memory.
+
+ A program starts with a 4 byte header - the number of capture slots, flags
+ (RegexProgramFlags) and (16 bit) the most threads that can be active at
+ once - followed by instructions. Jumps are signed 16 bit offsets from the start
+ of the jump instruction, so code can be moved and copied around freely
+ while compiling. */
+
+#define JS_REGEXP_PROGRAM_NAME JS_HIDDEN_CHAR_STR"rx"
+#define REGEX_HEADER_SIZE 4
+#define REGEX_MAX_PROGRAM 4096 ///< Largest program we'll compile - anything bigger uses the recursive matcher
+#define REGEX_CACHE_SIZE 8 ///< How many compiled programs to keep in JS_REGEXP_CACHE_VAR
+#define REGEX_NOT_SET ((size_t)-1) ///< Capture slot that hasn't been set
+
+/// Flags in byte 1 of a program's header
+typedef enum {
+  RXF_VM_ONLY = 1, ///< The pattern uses things the recursive matcher doesn't handle, so it can't be used instead
+} RegexProgramFlags;
+
+typedef enum {
+  RXOP_CHAR,   ///< [ch] match one character
+  RXOP_ANY,    ///< match any character
+  RXOP_CLASS,  ///< [inverted, count, count*(type,lo,hi)] match a character set
+  RXOP_SPLIT,  ///< [off1(16), off2(16)] continue at both off1 and off2 (off1 is preferred)
+  RXOP_JMP,    ///< [off(16)] continue at off
+  RXOP_SAVE,   ///< [slot] store the current position in a capture slot
+  RXOP_BOL,    ///< start of the String (or line, with the 'm' flag)
+  RXOP_EOL,    ///< end of the String (or line, with the 'm' flag)
+  RXOP_WORDB,  ///< word boundary (\b)
+  RXOP_NWORDB, ///< not a word boundary (\B)
+  RXOP_MATCH,  ///< successful match
+} RegexOp;
+
+/// Types of entries in an RXOP_CLASS character set
+typedef enum {
+  RXCLASS_RANGE, ///< characters lo..hi
+  RXCLASS_DIGIT, ///< \d
+  RXCLASS_NOTDIGIT,
+  RXCLASS_SPACE, ///< \s
+  RXCLASS_NOTSPACE,
+  RXCLASS_WORD,  ///< \w
+  RXCLASS_NOTWORD,
+} RegexClassType;
+
+typedef struct {
+  const char *re;      ///< The pattern left to compile
+  unsigned char *code; ///< Where to write the program, or 0 if we're only working out its size
+  int len;             ///< Length of the program so far
+  int groups;          ///< Number of capturing groups so far
+  int depth;           ///< How many groups we're inside
+  bool failed;         ///< We can't compile this pattern
+  bool vmOnly;         ///< See RXF_VM_ONLY
+  const char *error;   ///< If set, the pattern has a syntax error and we should throw this
+} RegexCompiler;
+
+static void rxEmit(RegexCompiler *c, int b) {
+  if (c->code) c->code[c->len] = (unsigned char)b;
+  c->len++;
+}
+
+static void rxPut16(RegexCompiler *c, int pos, int value) {
+  if (!c->code) return;
+  c->code[pos] = (unsigned char)value;
+  c->code[pos+1] = (unsigned char)(value>>8);
+}
+
+/// Make room for n bytes at 'pos'
+static void rxInsert(RegexCompiler *c, int pos, int n) {
+  if (c->code) memmove(&c->code[pos+n], &c->code[pos], (size_t)(c->len-pos));
+  c->len += n;
+}
+
+/// Insert a SPLIT at 'pos' - one branch goes to the code after it, the other to 'skip' bytes after that
+static void rxInsertSplit(RegexCompiler *c, int pos, int skip, bool lazy) {
+  rxInsert(c, pos, 5);
+  if (c->code) c->code[pos] = RXOP_SPLIT;
+  rxPut16(c, pos+1, lazy ? 5+skip : 5);
+  rxPut16(c, pos+3, lazy ? 5 : 5+skip);
+}
+
+/// Add a SPLIT that jumps back to 'target' or carries on
+static void rxEmitLoop(RegexCompiler *c, int target, bool lazy) {
+  int pos = c->len;
+  rxEmit(c, RXOP_SPLIT);
+  rxEmit(c, 0);rxEmit(c, 0);rxEmit(c, 0);rxEmit(c, 0);
+  rxPut16(c, pos+1, lazy ? 5 : target-pos);
+  rxPut16(c, pos+3, lazy ? target-pos : 5);
+}
+
+/// Append a copy of the code at pos..pos+len
+static void rxEmitCopy(RegexCompiler *c, int pos, int len) {
+  if (c->code) memcpy(&c->code[c->len], &c->code[pos], (size_t)len);
+  c->len += len;
+}
+
+/// Parse the character after a backslash (that isn't a class like \d). Returns -1 if we can't handle it
+static int rxParseEscape(RegexCompiler *c) {
+  char ch = *(c->re++);
+  switch (ch) {
+    case 0: c->re--; return -1; // end of pattern
+    case 'f': return 0x0C;
+    case 'n': return 0x0A;
+    case 'r': return 0x0D;
+    case 't': return 0x09;
+    case 'v': return 0x0B;
+    case '0': return 0;
+    case 'x':
+      if (isHexadecimal(c->re[0]) && isHexadecimal(c->re[1])) {
+        c->re += 2;
+        return hexToByte(c->re[-2], c->re[-1]);
+      }
+      return 'x';
+    default:
+      if (ch>='1' && ch<='9') return -1; // backreference
+      return (unsigned char)ch;
+  }
+}
+
+/// If the backslash at c->re is a class like \d, return its type and skip it
+static int rxParseClassEscape(RegexCompiler *c) {
+  if (c->re[0]!='\\') return -1;
+  int type = -1;
+  switch (c->re[1]) {
+    case 'd': type = RXCLASS_DIGIT; break;
+    case 'D': type = RXCLASS_NOTDIGIT; break;
+    case 's': type = RXCLASS_SPACE; break;
+    case 'S': type = RXCLASS_NOTSPACE; break;
+    case 'w': type = RXCLASS_WORD; break;
+    case 'W': type = RXCLASS_NOTWORD; break;
+  }
+  if (type>=0) c->re += 2;
+  return type;
+}
+
+/// Compile a character set - c->re is just after the '['
+static void rxCompileClass(RegexCompiler *c) {
+  int pos = c->len;
+  bool inverted = c->re[0]=='^';
+  if (inverted) c->re++;
+  rxEmit(c, RXOP_CLASS);
+  rxEmit(c, inverted);
+  rxEmit(c, 0); // count
+  int count = 0;
+  while (*c->re && *c->re!=']') {
+    int type = rxParseClassEscape(c);
+    int lo = 0, hi = 0;
+    if (type<0) {
+      type = RXCLASS_RANGE;
+      if (c->re[0]=='\\' && c->re[1]=='b') { // backspace inside a set
+        c->re += 2;
+        lo = 0x08;
+      } else if (*c->re=='\\') {
+        c->re++;
+        lo = rxParseEscape(c);
+      } else
+        lo = (unsigned char)*(c->re++);
+      hi = lo;
+      if (c->re[0]=='-' && c->re[1] && c->re[1]!=']') { // range
+        c->re++;
+        if (*c->re=='\\') {
+          c->re++;
+          hi = rxParseEscape(c);
+        } else
+          hi = (unsigned char)*(c->re++);
+      }
+      if (lo<0 || hi<0) {
+        c->failed = true;
+        return;
+      }
+    }
+    rxEmit(c, type);
+    rxEmit(c, lo);
+    rxEmit(c, hi);
+    count++;
+  }
+  if (*c->re!=']' || count>255) {
+    c->failed = true;
+    return;
+  }
+  c->re++;
+  if (c->code) c->code[pos+2] = (unsigned char)count;
+}
+
+static void rxCompileAlternation(RegexCompiler *c);
+
+static void rxCompileAtom(RegexCompiler *c) {
+  char ch = *(c->re++);
+  switch (ch) {
+    case '(': {
+      int group = 0;
+      if (c->re[0]=='?') {
+        if (c->re[1]!=':') { // lookahead isn't supported
+          c->failed = true;
+          return;
+        }
+        c->re += 2;
+        c->vmOnly = true;
+      } else {
+        group = ++c->groups;
+        if (group>MAX_GROUPS) {
+          c->failed = true;
+          return;
+        }
+        rxEmit(c, RXOP_SAVE);
+        rxEmit(c, group*2);
+      }
+      c->depth++;
+      rxCompileAlternation(c);
+      c->depth--;
+      if (*c->re!=')') {
+        c->failed = true;
+        return;
+      }
+      c->re++;
+      if (group) {
+        rxEmit(c, RXOP_SAVE);
+        rxEmit(c, group*2+1);
+      }
+    } break;
+    case '[': rxCompileClass(c); break;
+    case '.': rxEmit(c, RXOP_ANY); break;
+    case '^': rxEmit(c, RXOP_BOL); break;
+    case '$': rxEmit(c, RXOP_EOL); break;
+    case '*': case '+': case '?': // nothing to repeat
+      c->failed = true;
+      break;
+    case '\\': {
+      c->re--;
+      int type = rxParseClassEscape(c);
+      if (type>=0) {
+        rxEmit(c, RXOP_CLASS);
+        rxEmit(c, 0);
+        rxEmit(c, 1);
+        rxEmit(c, type);
+        rxEmit(c, 0);
+        rxEmit(c, 0);
+        break;
+      }
+      c->re++;
+      if (*c->re=='b' || *c->re=='B') {
+        c->vmOnly = true;
+        rxEmit(c, (*(c->re++)=='b') ? RXOP_WORDB : RXOP_NWORDB);
+        break;
+      }
+      int code = rxParseEscape(c);
+      if (code<0) {
+        c->failed = true;
+        break;
+      }
+      rxEmit(c, RXOP_CHAR);
+      rxEmit(c, code);
+    } break;
+    default:
+      rxEmit(c, RXOP_CHAR);
+      rxEmit(c, (unsigned char)ch);
+  }
+}
+
+/// Parse '{n}', '{n,}' or '{n,m}'. max is -1 if there's no limit. Returns false (and doesn't move on) if it isn't one
+static bool rxParseCount(RegexCompiler *c, int *min, int *max) {
+  const char *p = c->re+1;
+  if (!isNumeric(*p)) return false;
+  *min = 0;
+  while (isNumeric(*p)) {
+    if (*min<=REGEX_MAX_PROGRAM) *min = (*min)*10 + *p-'0'; // anything bigger fails below anyway
+    p++;
+  }
+  *max = *min;
+  if (*p==',') {
+    p++;
+    *max = -1;
+    if (isNumeric(*p)) {
+      *max = 0;
+      while (isNumeric(*p)) {
+        if (*max<=REGEX_MAX_PROGRAM) *max = (*max)*10 + *p-'0';
+        p++;
+      }
+    }
+  }
+  if (*p!='}') return false;
+  if (*max>=0 && *max<*min) {
+    c->error = "Numbers out of order in {} quantifier";
+    c->failed = true;
+    return false;
+  }
+  if (*min>REGEX_MAX_PROGRAM || *max>REGEX_MAX_PROGRAM) {
+    c->failed = true;
+    return false;
+  }
+  c->re = p+1;
+  return true;
+}
+
+/// Compile an atom followed by an optional quantifier
+static void rxCompileRepeat(RegexCompiler *c) {
+  int start = c->len;
+  bool isGroup = *c->re=='(';
+  rxCompileAtom(c);
+  if (c->failed) return;
+  int len = c->len - start;
+  int min, max;
+  char q = *c->re;
+  if (q=='*') { min=0; max=-1; }
+  else if (q=='+') { min=1; max=-1; }
+  else if (q=='?') { min=0; max=1; }
+  else if (q=='{') {
+    if (!rxParseCount(c, &min, &max)) return; // just a '{' character
+    c->re--; // so the c->re++ below skips the '}'
+  } else return;
+  c->re++;
+  bool lazy = *c->re=='?';
+  if (lazy) c->re++;
+  // the recursive matcher only repeats single characters with '*' and '+'
+  if (q=='?' || q=='{' || lazy || isGroup) c->vmOnly = true;
+  if (min==0 && max==0) { // x{0}
+    c->len = start;
+    return;
+  }
+  if (min==0) { // first copy is optional (or zero or more)
+    rxInsertSplit(c, start, max<0 ? len+3 : len, lazy);
+    if (max<0) { // '*' - loop back to the SPLIT
+      int pos = c->len;
+      rxEmit(c, RXOP_JMP);
+      rxEmit(c, 0);rxEmit(c, 0);
+      rxPut16(c, pos+1, start-pos);
+      return;
+    }
+    start += 5; // the code to copy is after the SPLIT
+    min = 1;
+  } else {
+    for (int i=1;i<min;i++) {
+      if (c->len+len > REGEX_MAX_PROGRAM) { c->failed = true; return; }
+      rxEmitCopy(c, start, len);
+    }
+    if (max<0) { // loop back around the last copy
+      rxEmitLoop(c, c->len-len, lazy);
+      return;
+    }
+  }
+  for (int i=min;i<max;i++) { // optional copies
+    if (c->len+len+5 > REGEX_MAX_PROGRAM) { c->failed = true; return; }
+    int pos = c->len;
+    rxEmitCopy(c, start, len);
+    rxInsertSplit(c, pos, len, lazy);
+  }
+}
+
+static void rxCompileSequence(RegexCompiler *c) {
+  while (*c->re && *c->re!='|' && *c->re!=')' && !c->failed) {
+    rxCompileRepeat(c);
+    if (c->len > REGEX_MAX_PROGRAM) c->failed = true;
+  }
+}
+
+static void rxCompileAlternation(RegexCompiler *c) {
+  int start = c->len;
+  rxCompileSequence(c);
+  while (*c->re=='|' && !c->failed) {
+    c->re++;
+    if (c->depth) c->vmOnly = true; // the recursive matcher only handles '|' at the top level
+    // SPLIT to the code so far, or to what comes after the JMP
+    rxInsertSplit(c, start, c->len-start+3, false);
+    int jmp = c->len;
+    rxEmit(c, RXOP_JMP);
+    rxEmit(c, 0);rxEmit(c, 0);
+    rxCompileSequence(c);
+    rxPut16(c, jmp+1, c->len-jmp);
+  }
+}
+
+/// Get the length of the instruction at pc
+static int rxInstrLength(const unsigned char *prog, int pc) {
+  switch (prog[pc]) {
+    case RXOP_CHAR: case RXOP_SAVE: return 2;
+    case RXOP_CLASS: return 3+3*prog[pc+2];
+    case RXOP_SPLIT: return 5;
+    case RXOP_JMP: return 3;
+    default: return 1;
+  }
+}
+
+/// Does the pattern contain a '{n}', '{n,}' or '{n,m}' quantifier?
+static bool rxHasCount(const char *re) {
+  bool inClass = false;
+  for (;*re;re++) {
+    if (*re=='\\') {
+      if (re[1]) re++;
+    } else if (*re=='[') inClass = true;
+    else if (*re==']') inClass = false;
+    else if (*re=='{' && !inClass && isNumeric(re[1])) {
+      const char *p = re+1;
+      while (isNumeric(*p)) p++;
+      if (*p==',') p++;
+      while (isNumeric(*p)) p++;
+      if (*p=='}') return true;
+    }
+  }
+  return false;
+}
+
+/** Compile a RegExp's source into a program, or return 0 if it can't be
+ compiled (in which case the recursive matcher should be used). If the
+ pattern can't be matched at all, throw an exception and return 0. */
+static JsVar *jswrap_regexp_compile(JsVar *source) {
+  size_t sourceLen = jsvGetStringLength(source);
+  char *sourcePtr = (char *)alloca(sourceLen+1);
+  jsvGetString(source, sourcePtr, sourceLen+1);
+  // Work out how big the program is, then compile it for real
+  RegexCompiler c;
+  c.failed = sourceLen > REGEX_MAX_PROGRAM;
+  c.error = 0;
+  unsigned char *code = 0;
+  for (int pass=0;pass<2 && !c.failed;pass++) {
+    c.re = sourcePtr;
+    c.code = code;
+    c.len = REGEX_HEADER_SIZE;
+    c.groups = 0;
+    c.depth = 0;
+    c.vmOnly = false;
+    rxCompileAlternation(&c);
+    rxEmit(&c, RXOP_MATCH);
+    if (c.failed || *c.re || c.len>REGEX_MAX_PROGRAM) c.failed = true;
+    else if (!pass) code = (unsigned char *)alloca((size_t)c.len);
+  }
+  if (c.failed) {
+    if (c.error)
+      jsExceptionHere(JSET_SYNTAXERROR, "%s", c.error);
+    else if (rxHasCount(sourcePtr)) // the recursive matcher would treat '{n}' as text and give the wrong answer
+      jsExceptionHere(JSET_ERROR, "RegExp with {} quantifier is too complex to compile");
+    return 0;
+  }
+  // Count the instructions that can be on a thread list
+  int threads = 0;
+  for (int pc=REGEX_HEADER_SIZE;pc<c.len;pc+=rxInstrLength(code, pc))
+    if (code[pc]==RXOP_CHAR || code[pc]==RXOP_ANY || code[pc]==RXOP_CLASS || code[pc]==RXOP_MATCH)
+      threads++;
+  code[0] = (unsigned char)((c.groups+1)*2);
+  code[1] = c.vmOnly ? RXF_VM_ONLY : 0;
+  code[2] = (unsigned char)threads;
+  code[3] = (unsigned char)(threads>>8);
+  // flat if we can, so exec can use it without copying it onto the stack
+  JsVar *prog = jsvNewFlatStringOfLength((unsigned int)c.len);
+  if (prog) {
+    memcpy(jsvGetFlatStringPointer(prog), code, (size_t)c.len);
+    return prog;
+  }
+  return jsvNewStringOfLength((unsigned int)c.len, (char*)code);
+}
+
+/** Get the compiled program for source (or null if the recursive matcher
+ should be used), using JS_REGEXP_CACHE_VAR so we only compile it once */
+static JsVar *jswrap_regexp_getProgram(JsVar *source) {
+  JsVar *cache = jsvObjectGetChild(execInfo.hiddenRoot, JS_REGEXP_CACHE_VAR, JSV_OBJECT);
+  if (!cache) return jswrap_regexp_compile(source);
+  JsVar *prog = jsvSkipNameAndUnLock(jsvFindChildFromVar(cache, source, false));
+  if (!prog) {
+    prog = jswrap_regexp_compile(source);
+    if (!prog && !jspHasError()) prog = jsvNewWithFlags(JSV_NULL);
+    if (prog) {
+      if (jsvGetChildren(cache) >= REGEX_CACHE_SIZE) { // remove the oldest
+        JsVar *oldest = jsvLock(jsvGetFirstChild(cache));
+        jsvRemoveChild(cache, oldest);
+        jsvUnLock(oldest);
+      }
+      jsvObjectSetChildVar(cache, source, prog);
+    }
+  }
+  jsvUnLock(cache);
+  return prog;
+}
+
+static bool rxIsWordChar(char ch) {
+  return isNumeric(ch) || isAlpha(ch) || ch=='_';
+}
+
+static bool rxMatchClassEntry(const unsigned char *entry, unsigned char ch) {
+  switch (entry[0]) {
+    case RXCLASS_RANGE: return ch>=entry[1] && ch<=entry[2];
+    case RXCLASS_DIGIT: return isNumeric((char)ch);
+    case RXCLASS_NOTDIGIT: return !isNumeric((char)ch);
+    case RXCLASS_SPACE: return isWhitespace((char)ch);
+    case RXCLASS_NOTSPACE: return !isWhitespace((char)ch);
+    case RXCLASS_WORD: return rxIsWordChar((char)ch);
+    case RXCLASS_NOTWORD: return !rxIsWordChar((char)ch);
+    default: return false;
+  }
+}
+
+static bool rxMatchClass(const unsigned char *prog, int pc, unsigned char ch) {
+  int count = prog[pc+2];
+  for (int i=0;i<count;i++)
+    if (rxMatchClassEntry(&prog[pc+3+i*3], ch))
+      return true;
+  return false;
+}
+
+/// Does the consuming instruction at pc match the character?
+static bool rxMatchChar(const unsigned char *prog, int pc, char ch, bool ignoreCase) {
+  switch (prog[pc]) {
+    case RXOP_ANY: return true;
+    case RXOP_CHAR:
+      if (ignoreCase) return charToLowerCase(ch)==charToLowerCase((char)prog[pc+1]);
+      return (unsigned char)ch==prog[pc+1];
+    case RXOP_CLASS: {
+      bool match = rxMatchClass(prog, pc, (unsigned char)ch);
+      if (!match && ignoreCase)
+        match = rxMatchClass(prog, pc, (unsigned char)charToLowerCase(ch)) ||
+                rxMatchClass(prog, pc, (unsigned char)charToUpperCase(ch));
+      return match != (prog[pc+1]!=0);
+    }
+    default: return false;
+  }
+}
+
+typedef struct {
+  int count;
+  uint16_t *pcs;  ///< Program counter of each thread
+  size_t *caps;   ///< Capture slots for each thread
+} RegexThreadList;
+
+typedef struct {
+  const unsigned char *prog;
+  int slots;             ///< Capture slots per thread
+  bool ignoreCase, multiline;
+  unsigned int *visited; ///< The generation in which each pc was last added to a thread list
+  unsigned int generation;
+  // Where in the String the thread list being built is
+  size_t pos;
+  bool hasPrev, hasCur;
+  char prevCh, curCh;
+} RegexVM;
+
+/// Add a thread at pc, following jumps and assertions until it gets to an instruction that matches a character
+static void rxAddThread(RegexVM *vm, RegexThreadList *list, int pc, size_t *caps) {
+  if (vm->visited[pc]==vm->generation) return; // a higher priority thread is already here
+  vm->visited[pc] = vm->generation;
+  const unsigned char *prog = vm->prog;
+  int next = pc+rxInstrLength(prog, pc);
+  switch (prog[pc]) {
+    case RXOP_JMP:
+      if (!jspCheckStackPosition()) return;
+      rxAddThread(vm, list, pc+(int16_t)(prog[pc+1]|(prog[pc+2]<<8)), caps);
+      break;
+    case RXOP_SPLIT:
+      if (!jspCheckStackPosition()) return;
+      rxAddThread(vm, list, pc+(int16_t)(prog[pc+1]|(prog[pc+2]<<8)), caps);
+      rxAddThread(vm, list, pc+(int16_t)(prog[pc+3]|(prog[pc+4]<<8)), caps);
+      break;
+    case RXOP_SAVE: {
+      if (!jspCheckStackPosition()) return;
+      size_t old = caps[prog[pc+1]];
+      caps[prog[pc+1]] = vm->pos;
+      rxAddThread(vm, list, next, caps);
+      caps[prog[pc+1]] = old;
+    } break;
+    case RXOP_BOL:
+      if (!vm->hasPrev || (vm->multiline && vm->prevCh=='\n'))
+        rxAddThread(vm, list, next, caps);
+      break;
+    case RXOP_EOL:
+      if (!vm->hasCur || (vm->multiline && vm->curCh=='\n'))
+        rxAddThread(vm, list, next, caps);
+      break;
+    case RXOP_WORDB:
+    case RXOP_NWORDB: {
+      bool boundary = (vm->hasPrev && rxIsWordChar(vm->prevCh)) != (vm->hasCur && rxIsWordChar(vm->curCh));
+      if (boundary == (prog[pc]==RXOP_WORDB))
+        rxAddThread(vm, list, next, caps);
+    } break;
+    default: // a character match, or RXOP_MATCH
+      list->pcs[list->count] = (uint16_t)pc;
+      memcpy(&list->caps[list->count*vm->slots], caps, sizeof(size_t)*(size_t)vm->slots);
+      list->count++;
+  }
+}
+
+/// How much stack rxExecute needs for a program - this depends only on the program, not what we're matching
+static size_t rxStackNeeded(const unsigned char *prog, size_t progLen) {
+  size_t slots = prog[0];
+  size_t maxThreads = (size_t)(prog[2] | (prog[3]<<8));
+  size_t listSize = (sizeof(uint16_t) + sizeof(size_t)*slots) * maxThreads;
+  return sizeof(unsigned int)*progLen + listSize*2 + sizeof(size_t)*slots*2 + 256;
+}
+
+/** Run a compiled program on str, starting at startIndex. Returns a result
+ array or 0. The caller must check there's rxStackNeeded bytes of stack free */
+static JsVar *rxExecute(const unsigned char *prog, size_t progLen, JsVar *str, size_t startIndex, bool ignoreCase, bool multiline) {
+  RegexVM vm;
+  vm.prog = prog;
+  vm.slots = prog[0];
+  vm.ignoreCase = ignoreCase;
+  vm.multiline = multiline;
+  int maxThreads = prog[2] | (prog[3]<<8);
+  vm.visited = (unsigned int *)alloca(sizeof(unsigned int)*progLen);
+  memset(vm.visited, 0, sizeof(unsigned int)*progLen);
+  vm.generation = 1;
+  RegexThreadList lists[2];
+  for (int i=0;i<2;i++) {
+    lists[i].count = 0;
+    lists[i].pcs = (uint16_t *)alloca(sizeof(uint16_t)*(size_t)maxThreads);
+    lists[i].caps = (size_t *)alloca(sizeof(size_t)*(size_t)(vm.slots*maxThreads));
+  }
+  RegexThreadList *clist = &lists[0], *nlist = &lists[1];
+  size_t *caps = (size_t *)alloca(sizeof(size_t)*(size_t)vm.slots);
+  size_t *matchCaps = (size_t *)alloca(sizeof(size_t)*(size_t)vm.slots);
+  bool matched = false;
+  // If we must match at the start of the String there's no point starting threads later on
+  bool anchored = prog[REGEX_HEADER_SIZE]==RXOP_BOL && !multiline;
+
+  JsvStringIterator it;
+  jsvStringIteratorNew(&it, str, startIndex);
+  vm.pos = startIndex;
+  vm.hasPrev = startIndex>0;
+  vm.prevCh = vm.hasPrev ? jsvGetCharInString(str, startIndex-1) : 0;
+  vm.hasCur = jsvStringIteratorHasChar(&it);
+  vm.curCh = jsvStringIteratorGetChar(&it);
+  while (true) {
+    if (!matched) { // start a new match here, with a lower priority than the threads already running
+      for (int i=0;i<vm.slots;i++) caps[i] = REGEX_NOT_SET;
+      caps[0] = vm.pos;
+      rxAddThread(&vm, clist, REGEX_HEADER_SIZE, caps);
+    }
+    if ((!clist->count && (matched || anchored)) || jspIsInterrupted()) break;
+    // Move on to the next character
+    char ch = vm.curCh;
+    bool hadChar = vm.hasCur;
+    size_t pos = vm.pos;
+    if (hadChar) jsvStringIteratorNext(&it);
+    vm.pos++;
+    vm.hasPrev = hadChar;
+    vm.prevCh = ch;
+    vm.hasCur = jsvStringIteratorHasChar(&it);
+    vm.curCh = jsvStringIteratorGetChar(&it);
+    vm.generation++;
+    nlist->count = 0;
+    for (int i=0;i<clist->count;i++) {
+      int pc = clist->pcs[i];
+      size_t *threadCaps = &clist->caps[i*vm.slots];
+      if (prog[pc]==RXOP_MATCH) {
+        matched = true;
+        memcpy(matchCaps, threadCaps, sizeof(size_t)*(size_t)vm.slots);
+        matchCaps[1] = pos;
+        break; // threads after this one have a lower priority
+      }
+      if (hadChar && rxMatchChar(prog, pc, ch, ignoreCase))
+        rxAddThread(&vm, nlist, pc+rxInstrLength(prog, pc), threadCaps); // SAVE restores threadCaps afterwards
+    }
+    RegexThreadList *t = clist;
+    clist = nlist;
+    nlist = t;
+    if (!hadChar) break; // end of the String
+  }
+  jsvStringIteratorFree(&it);
+  if (!matched) return 0;
+
+  JsVar *rmatch = jsvNewEmptyArray();
+  if (!rmatch) return 0;
+  for (int i=0;i<vm.slots/2;i++) {
+    size_t start = matchCaps[i*2], end = matchCaps[i*2+1];
+    // groups that didn't take part in the match are undefined
+    JsVar *matchStr = (start!=REGEX_NOT_SET && end!=REGEX_NOT_SET) ? jsvNewFromStringVar(str, start, end-start) : 0;
+    jsvSetArrayItem(rmatch, i, matchStr);
+    jsvUnLock(matchStr);
+  }
+  jsvObjectSetChildAndUnLock(rmatch, "index", jsvNewFromInteger((JsVarInt)matchCaps[0]));
+  jsvObjectSetChild(rmatch, "input", str);
+  return rmatch;
+}
+
 /*JSON{
   "type" : "class",
   "ifndef" : "SAVE_ON_FLASH",
@@ -277,6 +970,10 @@ The built-in class for handling Regular Expressions
 **Note:** Espruino's regular expression parser does not contain all the features
 present in a full ES6 JS engine. However it does contain support for the all the
 basics.
+
+Regular expressions are compiled when they are created, and are matched in a
+time proportional to the length of the String being searched (except for
+those that use backreferences like `\1`).
 */
 
 /*JSON{
@@ -308,6 +1005,13 @@ JsVar *jswrap_regexp_constructor(JsVar *str, JsVar *flags) {
       jsvObjectSetChild(r, "flags", flags);
   }
   jsvObjectSetChildAndUnLock(r, "lastIndex", jsvNewFromInteger(0));
+  JsVar *prog = jswrap_regexp_getProgram(str);
+  if (jsvIsString(prog)) jsvObjectSetChild(r, JS_REGEXP_PROGRAM_NAME, prog);
+  jsvUnLock(prog);
+  if (jspHasError()) { // the pattern was bad
+    jsvUnLock(r);
+    return 0;
+  }
   return r;
 }
 
@@ -355,15 +1059,50 @@ JsVar *jswrap_regexp_exec(JsVar *parent, JsVar *arg) {
     jsvUnLock2(str,regex);
     return 0;
   }
-  size_t regexLen = jsvGetStringLength(regex);
-  char *regexPtr = (char *)alloca(regexLen+1);
-  if (!regexPtr) {
-    jsvUnLock2(str,regex);
-    return 0;
+  bool ignoreCase = jswrap_regexp_hasFlag(parent,'i');
+  JsVar *rmatch;
+  bool multiline = jswrap_regexp_hasFlag(parent,'m');
+  JsVar *prog = jsvObjectGetChild(parent, JS_REGEXP_PROGRAM_NAME, 0);
+  if (jsvIsString(prog)) {
+    size_t progLen = jsvGetStringLength(prog);
+    unsigned char header[REGEX_HEADER_SIZE];
+    jsvGetStringChars(prog, 0, (char*)header, REGEX_HEADER_SIZE);
+    bool isFlat = jsvIsFlatString(prog);
+    size_t stackNeeded = rxStackNeeded(header, progLen) + (isFlat ? 0 : progLen);
+    if (stackNeeded > jsuGetFreeStack()) {
+      // not enough stack to run the program - the recursive matcher may still be able to do it
+      jsvUnLock(prog);
+      prog = 0;
+      if (multiline || (header[1]&RXF_VM_ONLY)) {
+        jsExceptionHere(JSET_ERROR, "Not enough free stack to match RegEx");
+        jsvUnLock2(str,regex);
+        return 0;
+      }
+    }
+  }
+  if (prog) { // compiled - use the Pike VM
+    jsvUnLock(regex);
+    size_t progLen = jsvGetStringLength(prog);
+    unsigned char *progPtr;
+    if (jsvIsFlatString(prog)) {
+      progPtr = (unsigned char *)jsvGetFlatStringPointer(prog);
+    } else {
+      progPtr = (unsigned char *)alloca(progLen);
+      jsvGetStringChars(prog, 0, (char*)progPtr, progLen);
+    }
+    rmatch = rxExecute(progPtr, progLen, str, (size_t)lastIndex, ignoreCase, multiline);
+    jsvUnLock(prog);
+  } else { // use the recursive matcher
+    size_t regexLen = jsvGetStringLength(regex);
+    char *regexPtr = (char *)alloca(regexLen+1);
+    if (!regexPtr) {
+      jsvUnLock2(str,regex);
+      return 0;
+    }
+    jsvGetString(regex, regexPtr, regexLen+1);
+    jsvUnLock(regex);
+    rmatch = match(regexPtr, str, (size_t)lastIndex, ignoreCase);
   }
-  jsvGetString(regex, regexPtr, regexLen+1);
-  jsvUnLock(regex);
-  JsVar *rmatch = match(regexPtr, str, (size_t)lastIndex, jswrap_regexp_hasFlag(parent,'i'));
   jsvUnLock(str);
   if (!rmatch) {
     rmatch = jsvNewWithFlags(JSV_NULL);
@@ -22,6 +22,9 @@
 #include "jsparse.h"
 #include "jsinteractive.h"
 #include "jswrap_json.h"
+#include "jswrap_promise.h"
+
+#define JS_STORAGE_COMPACT_PROMISE "stcmp" // in hiddenRoot, promise for Storage.compact({background:true})
 
 #ifdef DEBUG
 #define DBG(...) jsiConsolePrintf("[Storage] "__VA_ARGS__)
@@ -139,10 +142,10 @@ JsVar *jswrap_storage_read(JsVar *name, int offset, int length) {
   "generate" : "jswrap_storage_readJSON",
   "params" : [
     ["name","JsVar","The filename - max 28 characters (case sensitive)"],
-    ["noExceptions","bool","If true and the JSON is not valid, just return `undefined` - otherwise an `Exception` is thrown"]
+    ["options","JsVar","If `true` and the JSON is not valid, just return `undefined` - otherwise an `Exception` is thrown. Can also be an object (see below)"]
   ],
   "return" : ["JsVar","An object containing parsed JSON from the file, or undefined"],
-  "typescript" : "readJSON(name: string, noExceptions: boolean): any;"
+  "typescript" : "readJSON(name: string, options?: boolean | { noExceptions?: boolean, path?: string | (string | number)[], callback?: (value: any, key: any) => any }): any;"
 }
 Read a file from the flash storage area that has been written with
 `require("Storage").write(...)`, and parse JSON in it into a JavaScript object.
@@ -150,18 +153,56 @@ Read a file from the flash storage area that has been written with
 This is identical to `JSON.parse(require("Storage").read(...))`. It will throw
 an exception if the data in the file is not valid JSON.
 
+To save memory with big files, `options` can be an object containing:
+
+* `noExceptions` - if true and the JSON is not valid, just return `undefined`
+* `path` - only parse (and return) the value at the given path, for instance
+  `"settings.colors.0"` or `["settings","colors",0]`. The rest of the file is
+  skipped over in flash without creating any variables. Returns `undefined`
+  if the path doesn't exist.
+* `callback` - a function called with `(value, key)` for each element of the
+  array or object (at `path` if given). Only one element is in memory at a time,
+  and returning `false` from the callback stops parsing.
+
+```
+var s = require("Storage");
+s.writeJSON("big.json", {name:"x", items:[{a:1},{a:2}]});
+s.readJSON("big.json", {path:"items.1.a"}) // 2
+s.readJSON("big.json", {path:"items", callback:function(item,idx) { print(idx, item.a); }});
+```
+
 **Note:** This function should be used with normal files, and not `StorageFile`s
 created with `require("Storage").open(filename, ...)`
 */
-JsVar *jswrap_storage_readJSON(JsVar *name, bool noExceptions) {
+JsVar *jswrap_storage_readJSON(JsVar *name, JsVar *options) {
+  bool noExceptions;
+  JsVar *path = 0, *callback = 0;
+  if (jsvIsObject(options)) {
+    noExceptions = jsvGetBoolAndUnLock(jsvObjectGetChild(options, "noExceptions", 0));
+#ifndef ESPR_NO_JSON_PATH
+    path = jsvObjectGetChild(options, "path", 0);
+    callback = jsvObjectGetChild(options, "callback", 0);
+#endif
+  } else
+    noExceptions = jsvGetBool(options);
   JsVar *v = jsfReadFile(jsfNameFromVar(name),0,0);
-  if (!v) return 0;
-  JsVar *r = jswrap_json_parse(v);
-  jsvUnLock(v);
-  if (noExceptions) {
-    jsvUnLock(jspGetException());
-    execInfo.execute &= ~EXEC_EXCEPTION;
+  JsVar *r = 0;
+  if (v) {
+#ifndef ESPR_NO_JSON_PATH
+    if (path || callback)
+      r = jsonParsePath(v, path, callback, noExceptions);
+    else
+#endif
+    {
+      r = jswrap_json_parse(v);
+      if (noExceptions) {
+        jsvUnLock(jspGetException());
+        execInfo.execute &= ~EXEC_EXCEPTION;
+      }
+    }
+    jsvUnLock(v);
   }
+  jsvUnLock2(path, callback);
   return r;
 }
 
@@ -322,7 +363,9 @@ require("Storage").list(undefined, {sf:false})
 ```
 
 **Note:** This will output system files (e.g. saved code) as well as files that
-you may have written.
+you may have written. The RAM image written by `save()` is only listed as
+`.varimg`, although it is stored as several files (which are counted in
+`getStats().fileCount`).
  */
 JsVar *jswrap_storage_list(JsVar *regex, JsVar *filter) {
   JsfFileFlags containing = 0;
@@ -378,7 +421,12 @@ JsVarInt jswrap_storage_hash(JsVar *regex) {
   "ifndef" : "SAVE_ON_FLASH",
   "class" : "Storage",
   "name" : "compact",
-  "generate" : "jswrap_storage_compact"
+  "generate" : "jswrap_storage_compact",
+  "params" : [
+    ["options","JsVar","[optional] An object `{ background : bool }` - see below"]
+  ],
+  "return" : ["JsVar","If `background:true` a Promise that resolves when compaction is complete, otherwise `undefined`"],
+  "typescript" : "compact(options?: { background?: boolean }): Promise<void> | void;"
 }
 The Flash Storage system is journaling. To make the most of the limited write
 cycles of Flash memory, Espruino marks deleted/replaced files as garbage and
@@ -393,9 +441,54 @@ that memory (e.g. functions that have their code stored in flash) then they may
 become garbled when compaction happens. To avoid this, call `eraseFiles` before
 uploading data that you intend to reference to ensure that uploaded files are
 right at the start of flash and cannot be compacted further.
+
+If `{background:true}` is passed, compaction is done a little at a time when
+Espruino is idle (so other code, Bluetooth and the console keep working) and a
+Promise is returned that resolves when it is complete. Storage can be read and
+written as normal while this happens. Each step moves about a page of files,
+and first writes the new contents of the pages it changes to a journal in free
+space, so if Espruino is reset (even part way through a step) it finishes that
+step and carries on compacting when it restarts. The Promise is rejected if
+there isn't enough free space for the journal - a normal `compact` will still work.
  */
-void jswrap_storage_compact() {
+JsVar *jswrap_storage_compact(JsVar *options) {
+  if (jsvIsObject(options) && jsvGetBoolAndUnLock(jsvObjectGetChild(options, "background", 0))) {
+    JsVar *promise = jsvObjectGetChild(execInfo.hiddenRoot, JS_STORAGE_COMPACT_PROMISE, 0);
+    if (!promise) {
+      promise = jspromise_create();
+      if (!promise) return 0;
+      jsvObjectSetChild(execInfo.hiddenRoot, JS_STORAGE_COMPACT_PROMISE, promise);
+    }
+    jsfCompactBackgroundStart();
+    return promise;
+  }
   jsfCompact();
+  return 0;
+}
+
+/*JSON{
+  "type" : "idle",
+  "generate" : "jswrap_storage_idle",
+  "ifndef" : "SAVE_ON_FLASH"
+}*/
+bool jswrap_storage_idle() {
+  JsfCompactStatus status = jsfCompactBackgroundIdle();
+  if (status==JSFCS_NONE) return false;
+  if (status!=JSFCS_BUSY) {
+    JsVar *promise = jsvObjectGetChild(execInfo.hiddenRoot, JS_STORAGE_COMPACT_PROMISE, 0);
+    if (promise) {
+      jsvObjectRemoveChild(execInfo.hiddenRoot, JS_STORAGE_COMPACT_PROMISE);
+      if (status==JSFCS_DONE) {
+        jspromise_resolve(promise, 0);
+      } else {
+        JsVar *err = jsvNewFromString("Not enough free space to compact in the background");
+        jspromise_reject(promise, err);
+        jsvUnLock(err);
+      }
+      jsvUnLock(promise);
+    }
+  }
+  return true;
 }
 
 /*JSON{
@@ -470,7 +563,11 @@ JsVar *jswrap_storage_getStats() {
   "generate" : "jswrap_storage_optimise"
 }
 Writes a lookup table for files into Bangle.js's storage. This allows any file
-stored up to that point to be accessed quickly.
+to be accessed quickly.
+
+The table is a hash table that is updated as new files are written, and is
+rebuilt automatically when storage is compacted or when it gets too full, so
+it's not normally needed to call this.
  */
 void jswrap_storage_optimise() {
 #ifdef ESPR_STORAGE_FILENAME_TABLE
@@ -478,6 +575,162 @@ void jswrap_storage_optimise() {
 #endif
 }
 
+/// Header at the start of each page of a log StorageFile (Storage.open with {log:true})
+typedef struct {
+  uint32_t seq;        ///< Sequence number - one more than the page written before it
+  uint32_t eraseCount; ///< How many times this page has been erased and rewritten
+  uint32_t pageCount;  ///< How many pages are in the log
+} StorageLogHeader;
+
+/// Get the filename of one of StorageFile f's chunks (chunks start at 1)
+static JsfFileName storagefile_getChunkName(JsVar *f, int chunk) {
+  JsfFileName fname = jsfNameFromVarAndUnLock(jsvObjectGetChild(f,"name",0));
+  int fnamei = sizeof(fname)-1;
+  while (fnamei && fname.c[fnamei-1]==0) fnamei--;
+  fname.c[fnamei]=(char)chunk;
+  return fname;
+}
+
+/** Get the address of a page of a log StorageFile from the addresses we keep in RAM, checking
+it hasn't been moved by compaction (in which case we look it up again). Returns 0 if it doesn't exist */
+static uint32_t storagelog_getPageAddr(JsVar *f, int page) {
+  JsVar *pageAddrs = jsvObjectGetChild(f,"lpa",0);
+  if (!pageAddrs) return 0;
+  uint32_t addr = (uint32_t)jsvGetIntegerAndUnLock(jsvArrayBufferGet(pageAddrs, (size_t)page));
+  JsfFileName fname = storagefile_getChunkName(f, page+1);
+  JsfFileHeader header;
+  if (addr) {
+    jshFlashRead(&header, addr-(uint32_t)sizeof(JsfFileHeader), sizeof(JsfFileHeader));
+    if (memcmp(&header.name, &fname, sizeof(fname))!=0)
+      addr = 0;
+  }
+  if (!addr) {
+    addr = jsfFindFile(fname, &header);
+    JsVar *v = jsvNewFromInteger(addr);
+    jsvArrayBufferSet(pageAddrs, (size_t)page, v);
+    jsvUnLock(v);
+  }
+  jsvUnLock(pageAddrs);
+  return addr;
+}
+
+/// Find the end of the data in a log page (the first 0xFF - data can't contain 0xFF) with a binary search
+static int storagelog_findEnd(uint32_t addr, int pageSize) {
+  int lo = (int)sizeof(StorageLogHeader), hi = pageSize;
+  while (lo<hi) {
+    int mid = (lo+hi)>>1;
+    unsigned char ch;
+    jshFlashRead(&ch, addr+(uint32_t)mid, 1);
+    if (ch==255) hi = mid;
+    else lo = mid+1;
+  }
+  return lo;
+}
+
+/// Create page 'page' of a log StorageFile and make it the current page
+static bool storagelog_createPage(JsVar *f, int page, int pageSize, StorageLogHeader *logHeader) {
+  JsfFileName fname = storagefile_getChunkName(f, page+1);
+  JsVar *data = jsvNewStringOfLength(sizeof(StorageLogHeader), (char*)logHeader);
+  if (!data) return false;
+  bool ok = jsfWriteFile(fname, data, JSFF_STORAGEFILE|JSFF_LOGFILE, 0, pageSize);
+  jsvUnLock(data);
+  if (!ok) return false;
+  uint32_t addr = jsfFindFile(fname, NULL);
+  JsVar *pageAddrs = jsvObjectGetChild(f,"lpa",0);
+  JsVar *v = jsvNewFromInteger(addr);
+  jsvArrayBufferSet(pageAddrs, (size_t)page, v);
+  jsvUnLock2(v, pageAddrs);
+  jsvObjectSetChildAndUnLock(f,"chunk",jsvNewFromInteger(page+1));
+  jsvObjectSetChildAndUnLock(f,"addr",jsvNewFromInteger(addr));
+  jsvObjectSetChildAndUnLock(f,"offset",jsvNewFromInteger(sizeof(StorageLogHeader)));
+  jsvObjectSetChildAndUnLock(f,"lseq",jsvNewFromInteger(logHeader->seq));
+  return true;
+}
+
+/// Start writing to the next page of a log StorageFile, erasing the oldest page if we've wrapped around
+static bool storagelog_nextPage(JsVar *f) {
+  int pageCount = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"lpages",0));
+  int pageSize = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"len",0));
+  int page = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"chunk",0)) - 1;
+  StorageLogHeader logHeader;
+  logHeader.seq = (uint32_t)jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"lseq",0)) + 1;
+  logHeader.eraseCount = 0;
+  logHeader.pageCount = (uint32_t)pageCount;
+  page = (page+1) % pageCount;
+  uint32_t addr = storagelog_getPageAddr(f, page);
+  if (addr) {
+    StorageLogHeader oldHeader;
+    jshFlashRead(&oldHeader, addr, sizeof(StorageLogHeader));
+    logHeader.eraseCount = oldHeader.eraseCount+1;
+    jsfEraseFile(storagefile_getChunkName(f, page+1));
+  }
+  return storagelog_createPage(f, page, pageSize, &logHeader);
+}
+
+/** Set up StorageFile f to use the existing log whose first page is at addr.
+For reading we start at the oldest page, for appending at the end of the newest. */
+static bool storagelog_open(JsVar *f, uint32_t addr, JsfFileHeader *header, char mode) {
+  StorageLogHeader logHeader;
+  jshFlashRead(&logHeader, addr, sizeof(StorageLogHeader));
+  int pageCount = (int)logHeader.pageCount;
+  int pageSize = (int)jsfGetFileSize(header);
+  if (pageCount<1 || pageCount>255) return false;
+  JsVar *pageAddrs = jsvNewTypedArray(ARRAYBUFFERVIEW_UINT32, pageCount);
+  if (!pageAddrs) return false;
+  jsvObjectSetChildAndUnLock(f,"lpa",pageAddrs);
+  jsvObjectSetChildAndUnLock(f,"lpages",jsvNewFromInteger(pageCount));
+  // Find the oldest and newest pages
+  int oldest = 0, newest = 0;
+  uint32_t oldestSeq = logHeader.seq, newestSeq = logHeader.seq;
+  for (int page=1;page<pageCount;page++) {
+    addr = storagelog_getPageAddr(f, page);
+    if (!addr) continue;
+    jshFlashRead(&logHeader, addr, sizeof(StorageLogHeader));
+    if (logHeader.seq < oldestSeq) { oldest = page; oldestSeq = logHeader.seq; }
+    if (logHeader.seq > newestSeq) { newest = page; newestSeq = logHeader.seq; }
+  }
+  int page = (mode=='r') ? oldest : newest;
+  addr = storagelog_getPageAddr(f, page);
+  jsvObjectSetChildAndUnLock(f,"chunk",jsvNewFromInteger(page+1));
+  jsvObjectSetChildAndUnLock(f,"addr",jsvNewFromInteger(addr));
+  jsvObjectSetChildAndUnLock(f,"len",jsvNewFromInteger(pageSize));
+  jsvObjectSetChildAndUnLock(f,"lseq",jsvNewFromInteger((mode=='r') ? oldestSeq : newestSeq));
+  jsvObjectSetChildAndUnLock(f,"offset",jsvNewFromInteger(
+      (mode=='r') ? (int)sizeof(StorageLogHeader) : storagelog_findEnd(addr, pageSize)));
+  return true;
+}
+
+/// Create a new, empty log StorageFile with 'pageCount' pages of 'pageSize' bytes
+static bool storagelog_create(JsVar *f, int pageCount, int pageSize) {
+  JsVar *pageAddrs = jsvNewTypedArray(ARRAYBUFFERVIEW_UINT32, pageCount);
+  if (!pageAddrs) return false;
+  jsvObjectSetChildAndUnLock(f,"lpa",pageAddrs);
+  jsvObjectSetChildAndUnLock(f,"lpages",jsvNewFromInteger(pageCount));
+  jsvObjectSetChildAndUnLock(f,"len",jsvNewFromInteger(pageSize));
+  StorageLogHeader logHeader;
+  logHeader.seq = 1;
+  logHeader.eraseCount = 0;
+  logHeader.pageCount = (uint32_t)pageCount;
+  return storagelog_createPage(f, 0, pageSize, &logHeader);
+}
+
+/** Move a log StorageFile that's being read on to the next page, as long as it was
+written after the current one. Returns the address of the page or 0 if we're at the end */
+static uint32_t storagelog_readNextPage(JsVar *f) {
+  int pageCount = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"lpages",0));
+  int page = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"chunk",0)) - 1;
+  uint32_t seq = (uint32_t)jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"lseq",0));
+  page = (page+1) % pageCount;
+  uint32_t addr = storagelog_getPageAddr(f, page);
+  if (!addr) return 0;
+  StorageLogHeader logHeader;
+  jshFlashRead(&logHeader, addr, sizeof(StorageLogHeader));
+  if (logHeader.seq != seq+1) return 0; // we've wrapped around to older data
+  jsvObjectSetChildAndUnLock(f,"chunk",jsvNewFromInteger(page+1));
+  jsvObjectSetChildAndUnLock(f,"lseq",jsvNewFromInteger(logHeader.seq));
+  return addr;
+}
+
 /*JSON{
   "type" : "staticmethod",
   "ifndef" : "SAVE_ON_FLASH",
@@ -486,11 +739,12 @@ void jswrap_storage_optimise() {
   "generate" : "jswrap_storage_open",
   "params" : [
     ["name","JsVar","The filename - max **27** characters (case sensitive)"],
-    ["mode","JsVar","The open mode - must be either `'r'` for read,`'w'` for write , or `'a'` for append"]
+    ["mode","JsVar","The open mode - must be either `'r'` for read,`'w'` for write , or `'a'` for append"],
+    ["options","JsVar","[optional] `{log:true, pages:int, pageSize:int}` to create a log file when writing or appending - see below"]
   ],
   "return" : ["JsVar","An object containing {read,write,erase}"],
   "return_object" : "StorageFile",
-  "typescript" : "open(name: string, mode: \"r\" | \"w\" | \"a\"): StorageFile;"
+  "typescript" : "open(name: string, mode: \"r\" | \"w\" | \"a\", options?: { log?: boolean, pages?: number, pageSize?: number }): StorageFile;"
 }
 Open a file in the Storage area. This can be used for appending data
 (normal read/write operations only write the entire file).
@@ -499,8 +753,17 @@ Please see `StorageFile` for more information (and examples).
 
 **Note:** These files write through immediately - they do not need closing.
 
+If `{log:true}` is passed when opening with `'w'` (or `'a'` for a file that
+doesn't exist yet) a log file is created instead. This is a ring of `pages`
+(default 8, max 255) pages of `pageSize` bytes, and when all pages are full the
+oldest page is erased and reused. It's designed for frequent logging: the
+position in the file is kept in RAM so appending doesn't have to search Storage,
+and reading goes straight from one page to the next. Log files are detected
+automatically when opened with `'r'` or `'a'`, and `StorageFile.stat()` returns
+information about the pages.
+
 */
-JsVar *jswrap_storage_open(JsVar *name, JsVar *modeVar) {
+JsVar *jswrap_storage_open(JsVar *name, JsVar *modeVar, JsVar *options) {
   char mode = 0;
   if (jsvIsStringEqual(modeVar,"r")) mode='r';
   else if (jsvIsStringEqual(modeVar,"w")) mode='w';
@@ -526,6 +789,7 @@ JsVar *jswrap_storage_open(JsVar *name, JsVar *modeVar) {
   JsfFileHeader header;
   uint32_t addr = jsfFindFile(fname, &header);
   uint32_t fileLen = jsfGetFileSize(&header);
+  bool isLog = jsvIsObject(options) && jsvGetBoolAndUnLock(jsvObjectGetChild(options,"log",0));
   if (mode=='w') { // write,
     if (addr) { // we had a file - erase it
       jswrap_storagefile_erase(f);
@@ -533,6 +797,36 @@ JsVar *jswrap_storage_open(JsVar *name, JsVar *modeVar) {
       fileLen = 0;
     }
   }
+  if (addr && (jsfGetFileFlags(&header)&JSFF_LOGFILE)) { // existing log file
+    if (!storagelog_open(f, addr, &header, mode)) {
+      jsvUnLock(f);
+      return 0;
+    }
+    jsvObjectSetChildAndUnLock(f,"mode",jsvNewFromInteger(mode));
+    return f;
+  }
+  if (isLog && mode!='r') {
+    if (addr) {
+      jsExceptionHere(JSET_ERROR, "File exists and is not a log");
+      jsvUnLock(f);
+      return 0;
+    }
+    int pages = jsvGetIntegerAndUnLock(jsvObjectGetChild(options,"pages",0));
+    int pageSize = jsvGetIntegerAndUnLock(jsvObjectGetChild(options,"pageSize",0));
+    if (pages<=0) pages = 8;
+    if (pageSize<=0) pageSize = STORAGEFILE_CHUNKSIZE;
+    if (pages>255 || pageSize<=(int)sizeof(StorageLogHeader)) {
+      jsExceptionHere(JSET_ERROR, "Invalid pages or pageSize");
+      jsvUnLock(f);
+      return 0;
+    }
+    if (!storagelog_create(f, pages, pageSize)) {
+      jsvUnLock(f);
+      return 0;
+    }
+    jsvObjectSetChildAndUnLock(f,"mode",jsvNewFromInteger(mode));
+    return f;
+  }
   if (mode=='a') { // append
     // Find the last free page (eg it has 0xFF at the end)
     unsigned char lastCh = 255;
@@ -654,9 +948,23 @@ JsVar *jswrap_storagefile_read_internal(JsVar *f, int len) {
   JsVar *result = 0;
   char buf[32];
   if (isReadLine) len = sizeof(buf);
+  JsVar *pageCount = jsvObjectGetChild(f,"lpages",0);
+  bool isLog = pageCount!=0;
+  jsvUnLock(pageCount);
+  if (isLog) {
+    addr = storagelog_getPageAddr(f, chunk-1); // in case it was moved by compaction
+    if (!addr) return 0;
+  }
   while (len) {
     int remaining = fileLen - offset;
-    if (remaining<=0) { // next page
+    if (remaining<=0 && isLog) { // next page of a log
+      addr = storagelog_readNextPage(f);
+      offset = sizeof(StorageLogHeader);
+      remaining = fileLen - offset;
+      jsvObjectSetChildAndUnLock(f,"addr",jsvNewFromInteger(addr));
+      jsvObjectSetChildAndUnLock(f,"offset",jsvNewFromInteger(offset));
+      if (!addr) return result; // end of file!
+    } else if (remaining<=0) { // next page
       offset = 0;
       if (chunk==255) {
         addr=0;
@@ -761,6 +1069,17 @@ This requires Espruino to read the file from scratch, which is not a fast
 operation.
 */
 int jswrap_storagefile_getLength(JsVar *f) {
+  JsVar *pageCountVar = jsvObjectGetChild(f,"lpages",0);
+  if (pageCountVar) { // log file - add up the data in each page
+    int pageCount = jsvGetIntegerAndUnLock(pageCountVar);
+    int pageSize = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"len",0));
+    int length = 0;
+    for (int page=0;page<pageCount;page++) {
+      uint32_t addr = storagelog_getPageAddr(f, page);
+      if (addr) length += storagelog_findEnd(addr, pageSize) - (int)sizeof(StorageLogHeader);
+    }
+    return length;
+  }
   // Get name and position of name digit
   JsVar *n = jsvObjectGetChild(f,"name",0);
   JsfFileName fname = jsfNameFromVar(n);
@@ -847,6 +1166,36 @@ void jswrap_storagefile_write(JsVar *f, JsVar *_data) {
   fname.c[fnamei]=chunk;
   uint32_t addr = (uint32_t)jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"addr",0));
   DBG("Write Chunk %d Offset %d addr 0x%08x\n",chunk,offset,addr);
+  JsVar *pageCount = jsvObjectGetChild(f,"lpages",0);
+  if (pageCount) { // log file - write straight to the current page, moving on when it's full
+    jsvUnLock(pageCount);
+    size_t dataOffset = 0;
+    while (dataOffset < len) {
+      addr = storagelog_getPageAddr(f, chunk-1);
+      if (!addr) {
+        jsExceptionHere(JSET_ERROR, "File deleted while writing!");
+        break;
+      }
+      int remaining = fileLen - offset;
+      if (remaining<=0) {
+        if (!storagelog_nextPage(f)) break; // there would already have been an exception
+        chunk = jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"chunk",0));
+        offset = (int)sizeof(StorageLogHeader);
+        continue;
+      }
+      size_t l = len-dataOffset;
+      if (l > (size_t)remaining) l = (size_t)remaining;
+      JsVar *part = jsvNewFromStringVar(data,dataOffset,l);
+      jswrap_flash_write(part, addr+(uint32_t)offset);
+      jsvUnLock(part);
+      dataOffset += l;
+      offset += (int)l;
+      jsvObjectSetChildAndUnLock(f,"offset",jsvNewFromInteger(offset));
+    }
+    jsvObjectSetChildAndUnLock(f,"addr",jsvNewFromInteger(addr));
+    jsvUnLock(data);
+    return;
+  }
   int remaining = fileLen - offset;
   if (addr) {
     JsfFileHeader header;
@@ -942,8 +1291,60 @@ void jswrap_storagefile_erase(JsVar *f) {
     chunk++;
   }
   // reset everything
+  jsvObjectRemoveChild(f,"lpa");
+  jsvObjectRemoveChild(f,"lpages");
+  jsvObjectRemoveChild(f,"lseq");
   jsvObjectSetChildAndUnLock(f,"chunk",jsvNewFromInteger(1));
   jsvObjectSetChildAndUnLock(f,"offset",jsvNewFromInteger(0));
   jsvObjectSetChildAndUnLock(f,"addr",jsvNewFromInteger(0));
   jsvObjectSetChildAndUnLock(f,"mode",jsvNewFromInteger(0));
 }
+
+/*JSON{
+  "type" : "method",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "StorageFile",
+  "name" : "stat",
+  "generate" : "jswrap_storagefile_stat",
+  "return" : ["JsVar","An object describing the pages of a log file, or `undefined`"],
+  "typescript" : "stat(): { pages: number, pageSize: number, page: number, seq: number, eraseCounts: number[] } | undefined;"
+}
+For a log file (opened with `{log:true}` - see `Storage.open`), return
+information about its pages:
+
+```
+{
+  pages : 8,           // how many pages are in the log
+  pageSize : 4096,     // the size of each page in bytes
+  page : 2,            // the page currently being read/written
+  seq : 11,            // the sequence number of the current page
+  eraseCounts : [...]  // how many times each page has been erased
+}
+```
+
+Returns `undefined` if this isn't a log file.
+*/
+JsVar *jswrap_storagefile_stat(JsVar *f) {
+  JsVar *pageCountVar = jsvObjectGetChild(f,"lpages",0);
+  if (!pageCountVar) return 0;
+  int pageCount = jsvGetIntegerAndUnLock(pageCountVar);
+  JsVar *o = jsvNewObject();
+  JsVar *eraseCounts = jsvNewEmptyArray();
+  if (!o || !eraseCounts) {
+    jsvUnLock2(o, eraseCounts);
+    return 0;
+  }
+  for (int page=0;page<pageCount;page++) {
+    uint32_t addr = storagelog_getPageAddr(f, page);
+    StorageLogHeader logHeader;
+    logHeader.eraseCount = 0;
+    if (addr) jshFlashRead(&logHeader, addr, sizeof(StorageLogHeader));
+    jsvArrayPushAndUnLock(eraseCounts, jsvNewFromInteger(logHeader.eraseCount));
+  }
+  jsvObjectSetChildAndUnLock(o,"pages",jsvNewFromInteger(pageCount));
+  jsvObjectSetChildAndUnLock(o,"pageSize",jsvObjectGetChild(f,"len",0));
+  jsvObjectSetChildAndUnLock(o,"page",jsvNewFromInteger(jsvGetIntegerAndUnLock(jsvObjectGetChild(f,"chunk",0))-1));
+  jsvObjectSetChildAndUnLock(o,"seq",jsvObjectGetChild(f,"lseq",0));
+  jsvObjectSetChildAndUnLock(o,"eraseCounts",eraseCounts);
+  return o;
+}
@@ -338,9 +338,11 @@ JsVar *jswrap_string_replace(JsVar *parent, JsVar *subStr, JsVar *newSubStr) {
         unsigned int argCount = 0;
         JsVar *args[13];
         args[argCount++] = jsvLockAgain(matchStr);
-        JsVar *v;
-        while ((v = jsvGetArrayItem(match, (JsVarInt)argCount)))
-          args[argCount++] = v;
+        JsVarInt groups = jsvGetArrayLength(match);
+        while ((JsVarInt)argCount<groups && argCount<10) { // groups that didn't match are undefined
+          args[argCount] = jsvGetArrayItem(match, (JsVarInt)argCount);
+          argCount++;
+        }
         args[argCount++] = jsvObjectGetChild(match,"index",0);
         args[argCount++] = jsvObjectGetChild(match,"input",0);
         JsVar *result = jsvAsStringAndUnLock(jspeFunctionCall(replace, 0, 0, false, (JsVarInt)argCount, args));
@@ -0,0 +1,652 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2013 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * This file is designed to be parsed during the build process
+ *
+ * Vectorised maths on typed arrays (E.vmath)
+ * ----------------------------------------------------------------------------
+ */
+#include "jswrap_vmath.h"
+#include "jswrap_modules.h"
+#include "jsvariterator.h"
+#include "jsparse.h"
+
+#define VMATH_CHUNK 32 ///< How many elements we unpack at once
+
+/// An argument to a vmath function - a typed array or a number
+typedef struct {
+  JsVar *arr;        ///< The typed array, or 0 if this is a number
+  char *ptr;         ///< Pointer to the array's data if it's all in one (aligned) block of RAM, or 0 if we must use an iterator
+  int type;          ///< JsVarDataArrayBufferViewType of the elements
+  size_t length;     ///< Number of elements
+  JsVarFloat scalar; ///< The value if this is a number
+} VMathArg;
+
+/// Set up an argument that is a single number (or defaultValue if undefined)
+static void vmathGetScalar(VMathArg *v, JsVar *num, JsVarFloat defaultValue) {
+  v->arr = 0;
+  v->ptr = 0;
+  v->length = (size_t)-1;
+  v->scalar = jsvIsUndefined(num) ? defaultValue : jsvGetFloat(num);
+  v->type = jsvIsInt(num) ? ARRAYBUFFERVIEW_INT32 : ARRAYBUFFERVIEW_FLOAT64;
+}
+
+static bool vmathGetArg(VMathArg *v, JsVar *arr, bool allowScalar) {
+  if (allowScalar && jsvIsNumeric(arr)) {
+    vmathGetScalar(v, arr, 0);
+    return true;
+  }
+  v->ptr = 0;
+  if (!jsvIsArrayBuffer(arr)) {
+    jsExceptionHere(JSET_TYPEERROR, allowScalar ? "Expecting a typed array or number, got %t" : "Expecting a typed array, got %t", arr);
+    return false;
+  }
+  v->arr = arr;
+  v->type = arr->varData.arraybuffer.type;
+  if (v->type == ARRAYBUFFERVIEW_ARRAYBUFFER) v->type = ARRAYBUFFERVIEW_UINT8;
+  v->length = jsvGetArrayBufferLength(arr);
+  size_t size = JSV_ARRAYBUFFER_GET_SIZE(v->type);
+  // We can only access the data directly if it's all in RAM, in one block, and aligned
+  JsVar *backing = jsvGetArrayBufferBackingString(arr, NULL);
+  if (!jsvIsNativeString(backing) && !jsvIsFlashString(backing) &&
+      size!=3 && !(v->type & ARRAYBUFFERVIEW_BIG_ENDIAN)) {
+    size_t len;
+    char *ptr = jsvGetDataPointer(arr, &len);
+    size_t align = size>4 ? 4 : size;
+    if (ptr && ((size_t)ptr & (align-1))==0)
+      v->ptr = ptr;
+  }
+  jsvUnLock(backing);
+  return true;
+}
+
+/// Can we do maths on this argument with 32 bit integers?
+static bool vmathIsInt(VMathArg *v) {
+  return !JSV_ARRAYBUFFER_IS_FLOAT(v->type) && v->type!=ARRAYBUFFERVIEW_UINT32 && v->type!=ARRAYBUFFERVIEW_UINT24;
+}
+
+/// Convert to an integer like ToInt32/ToUint32 - drop the fraction, then wrap modulo 2^32 (NaN and Infinity are 0)
+static uint32_t vmathFloatToInt(JsVarFloat f) {
+  if (!isfinite(f)) return 0;
+  f = (f<0) ? ceil(f) : floor(f);
+  f -= 4294967296.0*floor(f/4294967296.0);
+  return (uint32_t)f;
+}
+
+/// Convert for a Uint8ClampedArray (NaN is 0)
+static uint8_t vmathFloatToClamped(JsVarFloat f) {
+  if (!(f>0)) return 0;
+  if (f>255) return 255;
+  return (uint8_t)f;
+}
+
+#define VMATH_LOAD(T) { const T *p = ((const T*)v->ptr)+idx; for (i=0;i<n;i++) out[i] = p[i]; }
+
+/// Unpack n elements starting at idx as floats
+static void vmathLoadFloat(VMathArg *v, size_t idx, JsVarFloat *out, unsigned int n) {
+  unsigned int i;
+  if (!v->arr) {
+    for (i=0;i<n;i++) out[i] = v->scalar;
+  } else if (v->ptr) {
+    switch (v->type & ~ARRAYBUFFERVIEW_CLAMPED) {
+      case ARRAYBUFFERVIEW_UINT8: VMATH_LOAD(uint8_t); break;
+      case ARRAYBUFFERVIEW_INT8: VMATH_LOAD(int8_t); break;
+      case ARRAYBUFFERVIEW_UINT16: VMATH_LOAD(uint16_t); break;
+      case ARRAYBUFFERVIEW_INT16: VMATH_LOAD(int16_t); break;
+      case ARRAYBUFFERVIEW_UINT32: VMATH_LOAD(uint32_t); break;
+      case ARRAYBUFFERVIEW_INT32: VMATH_LOAD(int32_t); break;
+      case ARRAYBUFFERVIEW_FLOAT32: VMATH_LOAD(float); break;
+      case ARRAYBUFFERVIEW_FLOAT64: VMATH_LOAD(double); break;
+      default: assert(0);
+    }
+  } else {
+    JsvArrayBufferIterator it;
+    jsvArrayBufferIteratorNew(&it, v->arr, idx);
+    for (i=0;i<n;i++) {
+      out[i] = jsvArrayBufferIteratorGetFloatValue(&it);
+      jsvArrayBufferIteratorNext(&it);
+    }
+    jsvArrayBufferIteratorFree(&it);
+  }
+}
+
+/// Unpack n elements starting at idx as integers (only if vmathIsInt)
+static void vmathLoadInt(VMathArg *v, size_t idx, int32_t *out, unsigned int n) {
+  unsigned int i;
+  if (!v->arr) {
+    for (i=0;i<n;i++) out[i] = (int32_t)v->scalar;
+  } else if (v->ptr) {
+    switch (v->type & ~ARRAYBUFFERVIEW_CLAMPED) {
+      case ARRAYBUFFERVIEW_UINT8: VMATH_LOAD(uint8_t); break;
+      case ARRAYBUFFERVIEW_INT8: VMATH_LOAD(int8_t); break;
+      case ARRAYBUFFERVIEW_UINT16: VMATH_LOAD(uint16_t); break;
+      case ARRAYBUFFERVIEW_INT16: VMATH_LOAD(int16_t); break;
+      case ARRAYBUFFERVIEW_INT32: VMATH_LOAD(int32_t); break;
+      default: assert(0);
+    }
+  } else {
+    JsvArrayBufferIterator it;
+    jsvArrayBufferIteratorNew(&it, v->arr, idx);
+    for (i=0;i<n;i++) {
+      out[i] = (int32_t)jsvArrayBufferIteratorGetIntegerValue(&it);
+      jsvArrayBufferIteratorNext(&it);
+    }
+    jsvArrayBufferIteratorFree(&it);
+  }
+}
+
+#define VMATH_STORE(T, CONV) { T *p = ((T*)v->ptr)+idx; for (i=0;i<n;i++) p[i] = (T)CONV(in[i]); }
+#define VMATH_CLAMP(X) ((X)<0 ? 0 : ((X)>255 ? 255 : (X)))
+
+/// Write n floats to the array starting at idx, converting them like a normal typed array assignment
+static void vmathStoreFloat(VMathArg *v, size_t idx, const JsVarFloat *in, unsigned int n) {
+  unsigned int i;
+  if (v->ptr) {
+    switch (v->type) {
+      case ARRAYBUFFERVIEW_UINT8|ARRAYBUFFERVIEW_CLAMPED:
+        for (i=0;i<n;i++) ((uint8_t*)v->ptr)[idx+i] = vmathFloatToClamped(in[i]);
+        break;
+      case ARRAYBUFFERVIEW_UINT8: VMATH_STORE(uint8_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_INT8: VMATH_STORE(int8_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_UINT16: VMATH_STORE(uint16_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_INT16: VMATH_STORE(int16_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_UINT32: VMATH_STORE(uint32_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_INT32: VMATH_STORE(int32_t, vmathFloatToInt); break;
+      case ARRAYBUFFERVIEW_FLOAT32: VMATH_STORE(float, ); break;
+      case ARRAYBUFFERVIEW_FLOAT64: VMATH_STORE(double, ); break;
+      default: assert(0);
+    }
+  } else {
+    JsvArrayBufferIterator it;
+    jsvArrayBufferIteratorNew(&it, v->arr, idx);
+    for (i=0;i<n;i++) {
+      JsVar *f = jsvNewFromFloat(in[i]);
+      jsvArrayBufferIteratorSetValue(&it, f);
+      jsvUnLock(f);
+      jsvArrayBufferIteratorNext(&it);
+    }
+    jsvArrayBufferIteratorFree(&it);
+  }
+}
+
+/// Write n integers to the array starting at idx (only if vmathIsInt)
+static void vmathStoreInt(VMathArg *v, size_t idx, const int32_t *in, unsigned int n) {
+  unsigned int i;
+  if (v->ptr) {
+    switch (v->type) {
+      case ARRAYBUFFERVIEW_UINT8|ARRAYBUFFERVIEW_CLAMPED:
+        for (i=0;i<n;i++) ((uint8_t*)v->ptr)[idx+i] = (uint8_t)VMATH_CLAMP(in[i]);
+        break;
+      case ARRAYBUFFERVIEW_UINT8: VMATH_STORE(uint8_t, ); break;
+      case ARRAYBUFFERVIEW_INT8: VMATH_STORE(int8_t, ); break;
+      case ARRAYBUFFERVIEW_UINT16: VMATH_STORE(uint16_t, ); break;
+      case ARRAYBUFFERVIEW_INT16: VMATH_STORE(int16_t, ); break;
+      case ARRAYBUFFERVIEW_INT32: VMATH_STORE(int32_t, ); break;
+      default: assert(0);
+    }
+  } else {
+    JsvArrayBufferIterator it;
+    jsvArrayBufferIteratorNew(&it, v->arr, idx);
+    for (i=0;i<n;i++) {
+      jsvArrayBufferIteratorSetIntegerValue(&it, in[i]);
+      jsvArrayBufferIteratorNext(&it);
+    }
+    jsvArrayBufferIteratorFree(&it);
+  }
+}
+
+typedef enum {
+  VMOP_ADD,    ///< dst = a + b
+  VMOP_SUB,    ///< dst = a - b
+  VMOP_MUL,    ///< dst = a * b
+  VMOP_SCALE,  ///< dst = a*b + c
+  VMOP_CLIP,   ///< dst = min(max(a,b),c)
+  VMOP_ABS,    ///< dst = abs(a)
+  VMOP_DIFF,   ///< dst[i] = a[i+1] - a[i]
+  VMOP_CUMSUM, ///< dst[i] = a[0] + ... + a[i]
+} VMathOp;
+
+/** Apply an operation to every element of a (and b/c if they're used), writing into dst.
+ Integer arrays are worked on with 32 bit integers (wrapping like storing into the typed
+ array would) and everything else with floats. */
+static JsVar *vmathElementwise(VMathOp op, JsVar *dstVar, JsVar *aVar, JsVar *bVar, JsVar *cVar) {
+  VMathArg dst, a, b, c;
+  bool hasB = op<=VMOP_CLIP, hasC = op==VMOP_SCALE || op==VMOP_CLIP;
+  if (!vmathGetArg(&dst, dstVar, false) ||
+      !vmathGetArg(&a, aVar, false))
+    return 0;
+  if (op<VMOP_SCALE) {
+    if (!vmathGetArg(&b, bVar, true)) return 0;
+  } else if (hasB) {
+    vmathGetScalar(&b, bVar, NAN);
+  }
+  if (hasC) vmathGetScalar(&c, cVar, op==VMOP_SCALE ? 0 : NAN);
+  if (jspHasError()) return 0;
+  size_t length = dst.length;
+  size_t aLength = (op==VMOP_DIFF) ? (a.length ? a.length-1 : 0) : a.length;
+  if (aLength < length) length = aLength;
+  if (hasB && b.length < length) length = b.length;
+  bool useInt = op!=VMOP_SCALE && vmathIsInt(&dst) && vmathIsInt(&a) &&
+                (!hasB || vmathIsInt(&b)) && (!hasC || vmathIsInt(&c));
+
+  size_t idx = 0;
+  if (useInt) {
+    int32_t va[VMATH_CHUNK+1], vb[VMATH_CHUNK], vc = hasC ? (int32_t)c.scalar : 0;
+    uint32_t sum = 0;
+    while (idx<length) {
+      unsigned int i, n = (length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(length-idx);
+      vmathLoadInt(&a, idx, va, (op==VMOP_DIFF) ? n+1 : n);
+      if (hasB) vmathLoadInt(&b, idx, vb, n);
+      // use unsigned maths so overflows wrap, as they would when stored in the typed array
+      switch (op) {
+        case VMOP_ADD: for (i=0;i<n;i++) va[i] = (int32_t)((uint32_t)va[i] + (uint32_t)vb[i]); break;
+        case VMOP_SUB: for (i=0;i<n;i++) va[i] = (int32_t)((uint32_t)va[i] - (uint32_t)vb[i]); break;
+        case VMOP_MUL: for (i=0;i<n;i++) va[i] = (int32_t)((uint32_t)va[i] * (uint32_t)vb[i]); break;
+        case VMOP_CLIP: for (i=0;i<n;i++) va[i] = va[i]<vb[i] ? vb[i] : (va[i]>vc ? vc : va[i]); break;
+        case VMOP_ABS: for (i=0;i<n;i++) if (va[i]<0) va[i] = (int32_t)(0U-(uint32_t)va[i]); break;
+        case VMOP_DIFF: for (i=0;i<n;i++) va[i] = (int32_t)((uint32_t)va[i+1] - (uint32_t)va[i]); break;
+        case VMOP_CUMSUM: for (i=0;i<n;i++) { sum += (uint32_t)va[i]; va[i] = (int32_t)sum; } break;
+        default: break;
+      }
+      vmathStoreInt(&dst, idx, va, n);
+      idx += n;
+    }
+  } else {
+    JsVarFloat va[VMATH_CHUNK+1], vb[VMATH_CHUNK], vc = hasC ? c.scalar : 0;
+    JsVarFloat sum = 0;
+    while (idx<length) {
+      unsigned int i, n = (length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(length-idx);
+      vmathLoadFloat(&a, idx, va, (op==VMOP_DIFF) ? n+1 : n);
+      if (hasB) vmathLoadFloat(&b, idx, vb, n);
+      switch (op) {
+        case VMOP_ADD: for (i=0;i<n;i++) va[i] += vb[i]; break;
+        case VMOP_SUB: for (i=0;i<n;i++) va[i] -= vb[i]; break;
+        case VMOP_MUL: for (i=0;i<n;i++) va[i] *= vb[i]; break;
+        case VMOP_SCALE: for (i=0;i<n;i++) va[i] = va[i]*vb[i] + vc; break;
+        case VMOP_CLIP: for (i=0;i<n;i++) va[i] = va[i]<vb[i] ? vb[i] : (va[i]>vc ? vc : va[i]); break;
+        case VMOP_ABS: for (i=0;i<n;i++) if (va[i]<0) va[i] = -va[i]; break;
+        case VMOP_DIFF: for (i=0;i<n;i++) va[i] = va[i+1] - va[i]; break;
+        case VMOP_CUMSUM: for (i=0;i<n;i++) { sum += va[i]; va[i] = sum; } break;
+      }
+      vmathStoreFloat(&dst, idx, va, n);
+      idx += n;
+    }
+  }
+  return jsvLockAgain(dstVar);
+}
+
+/*JSON{
+  "type" : "library",
+  "class" : "vmath",
+  "ifndef" : "SAVE_ON_FLASH"
+}
+Fast maths on whole typed arrays (`Int8Array`, `Int16Array`, `Float32Array`/etc).
+This is available as `E.vmath` (or `require("vmath")`).
+
+Each function works on the data of the typed arrays directly, which is much
+faster than looping over them in JavaScript:
+
+```
+var a = new Int16Array([1,-2,3,-4]);
+var b = new Int16Array(4);
+E.vmath.abs(b, a);      // b = [1,2,3,4]
+E.vmath.add(b, b, 10);  // b = [11,12,13,14]
+E.vmath.dot(a, b);      // 1*11 - 2*12 + 3*13 - 4*14 = -30
+```
+
+Functions that write to an array write as many elements as are in the smallest
+of the arrays they're given, and the result is converted just as if it had been
+assigned to the array from JavaScript. The array that is written to can be
+one of the arrays that is read from.
+
+Integer arrays (apart from `Uint32Array`) are processed with 32 bit integer
+maths where possible, which is much faster than floating point on devices
+without an FPU.
+*/
+/*JSON{
+  "type" : "staticproperty",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "E",
+  "name" : "vmath",
+  "generate" : "jswrap_vmath_get",
+  "return" : ["JsVar","The `vmath` library"],
+  "return_object" : "vmath"
+}
+Fast maths on typed arrays - see the `vmath` library
+*/
+JsVar *jswrap_vmath_get() {
+  JsVar *name = jsvNewFromString("vmath");
+  JsVar *lib = jswrap_require(name);
+  jsvUnLock(name);
+  return lib;
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "add",
+  "generate" : "jswrap_vmath_add",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"],
+    ["b","JsVar","A typed array, or a number"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "add(dst: ArrayBufferView, a: ArrayBufferView, b: ArrayBufferView | number): ArrayBufferView;"
+}
+`dst[i] = a[i] + b[i]` (or `a[i] + b` if `b` is a number)
+*/
+JsVar *jswrap_vmath_add(JsVar *dst, JsVar *a, JsVar *b) {
+  return vmathElementwise(VMOP_ADD, dst, a, b, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "sub",
+  "generate" : "jswrap_vmath_sub",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"],
+    ["b","JsVar","A typed array, or a number"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "sub(dst: ArrayBufferView, a: ArrayBufferView, b: ArrayBufferView | number): ArrayBufferView;"
+}
+`dst[i] = a[i] - b[i]` (or `a[i] - b` if `b` is a number)
+*/
+JsVar *jswrap_vmath_sub(JsVar *dst, JsVar *a, JsVar *b) {
+  return vmathElementwise(VMOP_SUB, dst, a, b, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "mul",
+  "generate" : "jswrap_vmath_mul",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"],
+    ["b","JsVar","A typed array, or a number"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "mul(dst: ArrayBufferView, a: ArrayBufferView, b: ArrayBufferView | number): ArrayBufferView;"
+}
+`dst[i] = a[i] * b[i]` (or `a[i] * b` if `b` is a number)
+*/
+JsVar *jswrap_vmath_mul(JsVar *dst, JsVar *a, JsVar *b) {
+  return vmathElementwise(VMOP_MUL, dst, a, b, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "scale",
+  "generate" : "jswrap_vmath_scale",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"],
+    ["scale","JsVar","The number to multiply by"],
+    ["offset","JsVar","[optional] The number to add afterwards"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "scale(dst: ArrayBufferView, a: ArrayBufferView, scale: number, offset?: number): ArrayBufferView;"
+}
+`dst[i] = a[i]*scale + offset` - this is always done with floating point maths
+*/
+JsVar *jswrap_vmath_scale(JsVar *dst, JsVar *a, JsVar *scale, JsVar *offset) {
+  return vmathElementwise(VMOP_SCALE, dst, a, scale, offset);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "clip",
+  "generate" : "jswrap_vmath_clip",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"],
+    ["min","JsVar","The minimum value"],
+    ["max","JsVar","The maximum value"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "clip(dst: ArrayBufferView, a: ArrayBufferView, min: number, max: number): ArrayBufferView;"
+}
+`dst[i] = E.clip(a[i], min, max)`
+*/
+JsVar *jswrap_vmath_clip(JsVar *dst, JsVar *a, JsVar *min, JsVar *max) {
+  return vmathElementwise(VMOP_CLIP, dst, a, min, max);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "abs",
+  "generate" : "jswrap_vmath_abs",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "abs(dst: ArrayBufferView, a: ArrayBufferView): ArrayBufferView;"
+}
+`dst[i] = Math.abs(a[i])`
+*/
+JsVar *jswrap_vmath_abs(JsVar *dst, JsVar *a) {
+  return vmathElementwise(VMOP_ABS, dst, a, 0, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "diff",
+  "generate" : "jswrap_vmath_diff",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "diff(dst: ArrayBufferView, a: ArrayBufferView): ArrayBufferView;"
+}
+`dst[i] = a[i+1] - a[i]` - this writes one less element than there are in `a`
+*/
+JsVar *jswrap_vmath_diff(JsVar *dst, JsVar *a) {
+  return vmathElementwise(VMOP_DIFF, dst, a, 0, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "cumsum",
+  "generate" : "jswrap_vmath_cumsum",
+  "params" : [
+    ["dst","JsVar","The typed array to write to"],
+    ["a","JsVar","A typed array"]
+  ],
+  "return" : ["JsVar","`dst`"],
+  "typescript" : "cumsum(dst: ArrayBufferView, a: ArrayBufferView): ArrayBufferView;"
+}
+Cumulative sum - `dst[i] = a[0] + a[1] + ... + a[i]`
+*/
+JsVar *jswrap_vmath_cumsum(JsVar *dst, JsVar *a) {
+  return vmathElementwise(VMOP_CUMSUM, dst, a, 0, 0);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "dot",
+  "generate" : "jswrap_vmath_dot",
+  "params" : [
+    ["a","JsVar","A typed array"],
+    ["b","JsVar","A typed array"]
+  ],
+  "return" : ["float","The dot product of `a` and `b`"],
+  "typescript" : "dot(a: ArrayBufferView, b: ArrayBufferView): number;"
+}
+Return the sum of `a[i]*b[i]`
+*/
+JsVarFloat jswrap_vmath_dot(JsVar *aVar, JsVar *bVar) {
+  VMathArg a, b;
+  if (!vmathGetArg(&a, aVar, false) || !vmathGetArg(&b, bVar, false)) return NAN;
+  size_t length = a.length < b.length ? a.length : b.length;
+  size_t idx = 0;
+  if (vmathIsInt(&a) && vmathIsInt(&b)) {
+    int32_t va[VMATH_CHUNK], vb[VMATH_CHUNK];
+    long long sum = 0;
+    while (idx<length) {
+      unsigned int i, n = (length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(length-idx);
+      vmathLoadInt(&a, idx, va, n);
+      vmathLoadInt(&b, idx, vb, n);
+      for (i=0;i<n;i++) sum += (long long)va[i]*vb[i];
+      idx += n;
+    }
+    return (JsVarFloat)sum;
+  }
+  JsVarFloat va[VMATH_CHUNK], vb[VMATH_CHUNK], sum = 0;
+  while (idx<length) {
+    unsigned int i, n = (length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(length-idx);
+    vmathLoadFloat(&a, idx, va, n);
+    vmathLoadFloat(&b, idx, vb, n);
+    for (i=0;i<n;i++) sum += va[i]*vb[i];
+    idx += n;
+  }
+  return sum;
+}
+
+/// Find the minimum (or maximum) value in an array
+static JsVarFloat vmathMinMax(JsVar *aVar, bool isMax) {
+  VMathArg a;
+  if (!vmathGetArg(&a, aVar, false)) return NAN;
+  if (!a.length) return isMax ? -INFINITY : INFINITY; // like Math.min()
+  size_t idx = 0;
+  if (vmathIsInt(&a)) {
+    int32_t va[VMATH_CHUNK];
+    vmathLoadInt(&a, 0, va, 1);
+    int32_t result = va[0];
+    while (idx<a.length) {
+      unsigned int i, n = (a.length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(a.length-idx);
+      vmathLoadInt(&a, idx, va, n);
+      if (isMax) {
+        for (i=0;i<n;i++) if (va[i]>result) result = va[i];
+      } else {
+        for (i=0;i<n;i++) if (va[i]<result) result = va[i];
+      }
+      idx += n;
+    }
+    return (JsVarFloat)result;
+  }
+  JsVarFloat va[VMATH_CHUNK];
+  vmathLoadFloat(&a, 0, va, 1);
+  JsVarFloat result = va[0];
+  while (idx<a.length) {
+    unsigned int i, n = (a.length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(a.length-idx);
+    vmathLoadFloat(&a, idx, va, n);
+    // like Math.min/max, any NaN makes the result NaN
+    if (isMax) {
+      for (i=0;i<n;i++) if (va[i]>result || isnan(va[i])) result = va[i];
+    } else {
+      for (i=0;i<n;i++) if (va[i]<result || isnan(va[i])) result = va[i];
+    }
+    if (isnan(result)) return result;
+    idx += n;
+  }
+  return result;
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "min",
+  "generate" : "jswrap_vmath_min",
+  "params" : [
+    ["a","JsVar","A typed array"]
+  ],
+  "return" : ["float","The smallest value in `a`"],
+  "typescript" : "min(a: ArrayBufferView): number;"
+}
+Return the smallest value in the array
+*/
+JsVarFloat jswrap_vmath_min(JsVar *a) {
+  return vmathMinMax(a, false);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "max",
+  "generate" : "jswrap_vmath_max",
+  "params" : [
+    ["a","JsVar","A typed array"]
+  ],
+  "return" : ["float","The largest value in `a`"],
+  "typescript" : "max(a: ArrayBufferView): number;"
+}
+Return the largest value in the array
+*/
+JsVarFloat jswrap_vmath_max(JsVar *a) {
+  return vmathMinMax(a, true);
+}
+
+/*JSON{
+  "type" : "staticmethod",
+  "ifndef" : "SAVE_ON_FLASH",
+  "class" : "vmath",
+  "name" : "countAbove",
+  "generate" : "jswrap_vmath_countAbove",
+  "params" : [
+    ["a","JsVar","A typed array"],
+    ["threshold","float","The threshold"]
+  ],
+  "return" : ["int","The number of elements greater than `threshold`"],
+  "typescript" : "countAbove(a: ArrayBufferView, threshold: number): number;"
+}
+Return how many elements in the array are greater than `threshold`
+*/
+JsVarInt jswrap_vmath_countAbove(JsVar *aVar, JsVarFloat threshold) {
+  VMathArg a;
+  if (!vmathGetArg(&a, aVar, false)) return 0;
+  if (isnan(threshold)) return 0;
+  JsVarInt count = 0;
+  size_t idx = 0;
+  if (vmathIsInt(&a)) {
+    // for integers, a > threshold is the same as a > floor(threshold)
+    if (threshold >= 2147483647.0) return 0;
+    if (threshold < -2147483648.0) return (JsVarInt)a.length;
+    int32_t t = (int32_t)floor(threshold);
+    int32_t va[VMATH_CHUNK];
+    while (idx<a.length) {
+      unsigned int i, n = (a.length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(a.length-idx);
+      vmathLoadInt(&a, idx, va, n);
+      for (i=0;i<n;i++) count += va[i]>t;
+      idx += n;
+    }
+    return count;
+  }
+  JsVarFloat va[VMATH_CHUNK];
+  while (idx<a.length) {
+    unsigned int i, n = (a.length-idx > VMATH_CHUNK) ? VMATH_CHUNK : (unsigned int)(a.length-idx);
+    vmathLoadFloat(&a, idx, va, n);
+    for (i=0;i<n;i++) count += va[i]>threshold;
+    idx += n;
+  }
+  return count;
+}
@@ -0,0 +1,28 @@
+/*
+ * This file is part of Espruino, a JavaScript interpreter for Microcontrollers
+ *
+ * Copyright (C) 2013 Gordon Williams <gw@pur3.co.uk>
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * ----------------------------------------------------------------------------
+ * Vectorised maths on typed arrays (E.vmath)
+ * ----------------------------------------------------------------------------
+ */
+#include "jsvar.h"
+
+JsVar *jswrap_vmath_get();
+JsVar *jswrap_vmath_add(JsVar *dst, JsVar *a, JsVar *b);
+JsVar *jswrap_vmath_sub(JsVar *dst, JsVar *a, JsVar *b);
+JsVar *jswrap_vmath_mul(JsVar *dst, JsVar *a, JsVar *b);
+JsVar *jswrap_vmath_scale(JsVar *dst, JsVar *a, JsVar *scale, JsVar *offset);
+JsVar *jswrap_vmath_clip(JsVar *dst, JsVar *a, JsVar *min, JsVar *max);
+JsVar *jswrap_vmath_abs(JsVar *dst, JsVar *a);
+JsVar *jswrap_vmath_diff(JsVar *dst, JsVar *a);
+JsVar *jswrap_vmath_cumsum(JsVar *dst, JsVar *a);
+JsVarFloat jswrap_vmath_dot(JsVar *a, JsVar *b);
+JsVarFloat jswrap_vmath_min(JsVar *a);
+JsVarFloat jswrap_vmath_max(JsVar *a);
+JsVarInt jswrap_vmath_countAbove(JsVar *a, JsVarFloat threshold);
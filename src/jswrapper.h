@@ -92,6 +92,10 @@ JsVar *jswBinarySearch(const JswSymList *symbolsPtr, JsVar *parent, const char *
 /** If 'name' is something that belongs to an internal function, execute it.  */
 JsVar *jswFindBuiltInFunction(JsVar *parent, const char *name);
 
+/** As jswFindBuiltInFunction, but if the function was found in a list of symbols for
+ * 'parent' then foundIn is set to it (so jswBinarySearch can be used to find it again) */
+JsVar *jswFindBuiltIn(JsVar *parent, const char *name, const JswSymList **foundIn);
+
 /// Given an object, return the list of symbols for it
 const JswSymList *jswGetSymbolListForObject(JsVar *parent);
 
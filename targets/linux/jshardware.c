@@ -31,6 +31,9 @@
 #include "jsutils.h"
 #include "jsparse.h"
 #include "jsinteractive.h"
+#ifdef USE_NET
+#include "network_linux.h"
+#endif
 
 #include <pthread.h>
 
@@ -797,8 +800,13 @@ bool jshSleep(JsSysTime timeUntilWake) {
     usecs=1000; // don't sleep much if we have watches - we need to keep polling them
   if (usecs > 50000)
     usecs = 50000; // don't want to sleep too much (user input/HTTP/etc)
-  if (usecs >= 1000)  
-    jshDelayMicroseconds(usecs);
+  if (usecs >= 1000) {
+#ifdef USE_NET
+    // if we have sockets, wake up as soon as one is ready
+    if (!net_linux_wait((int)usecs))
+#endif
+      jshDelayMicroseconds(usecs);
+  }
   return true;
 }
 
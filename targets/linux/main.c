@@ -19,6 +19,9 @@
 #ifdef ESPR_JIT
 #include "jsjit.h"
 #endif
+#ifdef USE_NET
+#include "network_linux.h"
+#endif
 #ifndef JSVAR_CACHE_SIZE
 #define JSVAR_CACHE_SIZE 0
 #endif
@@ -169,6 +172,17 @@ static char *read_file(const char *filename) {
   return buf;
 }
 
+/// Should we keep going around the idle loop? (isBusy is what jsiLoop returned)
+bool keepRunning(bool isBusy) {
+  if (!isRunning) return false;
+  if (jsiHasTimers() || isBusy) return true;
+#ifdef USE_NET
+  // Open sockets don't keep the idle loop busy (we sleep until one is ready), so check for them
+  if (net_linux_hasSockets()) return true;
+#endif
+  return false;
+}
+
 bool run_test(const char *filename) {
   warning("----------------------------------");
   warning("----------------------------- TEST %s", filename);
@@ -191,7 +205,7 @@ bool run_test(const char *filename) {
 
   isRunning = true;
   bool isBusy = true;
-  while (isRunning && (jsiHasTimers() || isBusy))
+  while (keepRunning(isBusy))
     isBusy = jsiLoop();
 
   JsVar *result = jsvObjectGetChild(execInfo.root, "result", 0 /*no create*/);
@@ -295,8 +309,17 @@ bool run_jit_tests() {
 
   JsVar *v = jsjEvaluate("1+2");
   jsiConsolePrintf("RESULT : %j\n", v);
-  jsvUnLock(v);
   bool pass = true;
+#ifdef JSJ_X86_64
+  // We can actually run the code we created
+  JsVar *r = v ? ((JsVar *(*)())(JSJ_CODE_OFFSET + (char*)jsvGetFlatStringPointer(v)))() : 0;
+  jsiConsolePrintf("EXECUTED : %j\n", r);
+  if (jsvGetIntegerAndUnLock(r)!=3) {
+    warning("FAIL because JIT code returned the wrong value.");
+    pass = false;
+  }
+#endif
+  jsvUnLock(v);
 
   warning("BEFORE: %d Memory Records Used", jsvGetMemoryUsage());
   // jsvTrace(execInfo.root, 0);
@@ -425,7 +448,7 @@ int main(int argc, char **argv) {
         int errCode = handleErrors();
         isRunning = !errCode;
         bool isBusy = true;
-        while (isRunning && (jsiHasTimers() || isBusy))
+        while (keepRunning(isBusy))
           isBusy = jsiLoop();
         jsiKill();
         jsvKill();
@@ -511,7 +534,7 @@ int main(int argc, char **argv) {
     free(buffer);
     isRunning = !errCode;
     bool isBusy = true;
-    while (isRunning && (jsiHasTimers() || isBusy))
+    while (keepRunning(isBusy))
       isBusy = jsiLoop();
     jsiKill();
     jsvKill();
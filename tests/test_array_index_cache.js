@@ -0,0 +1,30 @@
+// Array element lookups start from the last element found - check that stays correct
+function sum(a) { var s=0; for (var i=0;i<a.length;i++) s+=a[i]|0; return s; }
+var r = [];
+var a = [];
+for (var i=0;i<100;i++) a.push(i);
+r.push(sum(a)==4950);
+r.push(a[50]==50 && a[51]==51 && a[49]==49);
+a.shift(); // renumbers elements
+r.push(a[50]==51 && a[49]==50 && sum(a)==4950);
+a.unshift(-1);
+r.push(a[0]==-1 && a[1]==1 && a[50]==50);
+a.splice(10,5);
+r.push(a[10]==15 && a[9]==9);
+a.reverse();
+r.push(a[0]==99 && a[a.length-1]==-1);
+a.pop();
+r.push(a[a.length-1]==1 && a[a.length]===undefined);
+// sparse arrays and string keys
+var b = [];
+b[5] = 5; b[100] = 100; b.foo = "bar";
+r.push(b[5]==5 && b[6]===undefined && b[100]==100 && b[101]===undefined && b.foo=="bar");
+delete b[5];
+r.push(b[5]===undefined && b[100]==100);
+// lookups on an array that has been freed and replaced
+for (var j=0;j<3;j++) {
+  var c = [j,j+1,j+2];
+  r.push(c[1]==j+1 && c[2]==j+2);
+  c = undefined;
+}
+result = r.every(x=>x);
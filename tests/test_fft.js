@@ -0,0 +1,75 @@
+// Test E.FFT against a naive DFT
+var ok = true;
+function dft(re, im, inverse) {
+  var n = re.length, or = [], oi = [];
+  for (var k=0;k<n;k++) {
+    var sr = 0, si = 0;
+    for (var t=0;t<n;t++) {
+      var a = (inverse?2:-2)*Math.PI*k*t/n;
+      sr += re[t]*Math.cos(a) - im[t]*Math.sin(a);
+      si += re[t]*Math.sin(a) + im[t]*Math.cos(a);
+    }
+    if (!inverse) { sr /= n; si /= n; }
+    or.push(sr); oi.push(si);
+  }
+  return [or, oi];
+}
+function check(name, got, exp, tol) {
+  for (var i=0;i<exp.length;i++) {
+    if (!(Math.abs(got[i]-exp[i]) <= tol)) {
+      console.log(name+" FAIL at "+i+": got "+got[i]+", expected "+exp[i]);
+      ok = false;
+      return;
+    }
+  }
+}
+function zeros(n) { var a=[]; for (var i=0;i<n;i++) a.push(0); return a; }
+
+[1,2,4,8,16,64,256].forEach(function(n) {
+  var re = [], im = [];
+  for (var i=0;i<n;i++) {
+    re.push(Math.sin(i*0.7)*10 + (i%3));
+    im.push(Math.cos(i*1.3)*5);
+  }
+  var d = dft(re, im, false);
+  var di = dft(re, im, true);
+  var dr = dft(re, zeros(n), false);
+  var dri = dft(re, zeros(n), true);
+  var mag = dr[0].map(function(r,i) { return Math.sqrt(r*r+dr[1][i]*dr[1][i]); });
+  var magi = dri[0].map(function(r,i) { return Math.sqrt(r*r+dri[1][i]*dri[1][i]); });
+  // complex, arrays and in-place Float32Array
+  var a = re.slice(), b = im.slice();
+  E.FFT(a, b);
+  check(n+" complex", a, d[0], 0.001); check(n+" complex im", b, d[1], 0.001);
+  a = new Float32Array(re); b = new Float32Array(im);
+  E.FFT(a, b);
+  check(n+" complex f32", a, d[0], 0.001); check(n+" complex f32 im", b, d[1], 0.001);
+  a = new Float32Array(re); b = new Float32Array(im);
+  E.FFT(a, b, true);
+  check(n+" inverse", a, di[0], 0.01); check(n+" inverse im", b, di[1], 0.01);
+  // real input - magnitude and power
+  a = re.slice();
+  E.FFT(a);
+  check(n+" real", a, mag, 0.001);
+  a = new Float32Array(re);
+  E.FFT(a, undefined, {output:"power"});
+  check(n+" real power", a, mag.map(function(x){return x*x;}), 0.01);
+  a = new Float32Array(re);
+  E.FFT(a, undefined, {inverse:true});
+  check(n+" real inverse", a, magi, 0.01);
+  a = new Int16Array(re.map(function(x){return x*100;}));
+  E.FFT(a);
+  check(n+" real int16", a, mag.map(function(x){return x*100;}), 3);
+});
+// Not a power of 2 - data is zero padded, and only the original length written back
+var a = [1,2,3,4,5], b = [1,2,3,4,5,0,0,0];
+E.FFT(a); E.FFT(b);
+check("pad", a, b.slice(0,5), 0.0001);
+check("pad length", [a.length], [5], 0);
+// the cached tables must still work for a smaller FFT after a bigger one
+var s = new Float32Array([1,0,0,0]);
+E.FFT(s);
+check("small after big", s, [0.25,0.25,0.25,0.25], 0.0001);
+try { E.FFT([1,2], undefined, {output:"foo"}); ok = false; } catch (e) {}
+
+result = ok;
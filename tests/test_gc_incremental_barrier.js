@@ -0,0 +1,43 @@
+// Incremental GC: children that are unlinked while a collection is marking
+// mustn't cause their live siblings to be freed. Uses E.gcStep (debug builds
+// only) to do the collection in single steps, deleting every other element of
+// an object and an array at a different point in the mark each time.
+if (!E.gcStep) {
+  result = 1;
+} else {
+  var bad = 0;
+  while (E.gcStep(1000)!="idle"); // finish any collection in progress
+  for (var round=0;round<20;round++) {
+    var obj = {}, keys = [], arr = [];
+    for (var i=0;i<80;i++) {
+      keys.push("k"+i);
+      obj[keys[i]] = {v:i};
+      arr.push({v:i});
+    }
+    var phase, last = "", markRounds = 0, markSlices = 0, done = false;
+    do {
+      // only step slowly when marking
+      phase = E.gcStep((last=="roots"||last=="mark"||last=="rescan")?1:500);
+      if (phase=="mark" && last!="mark") {
+        markRounds++;
+        markSlices = 0;
+      }
+      /* The mark stack always overflows first time around, and a rescan
+       * would hide missed vars - so do this in a later mark */
+      if (phase=="mark" && markRounds>1 && ++markSlices==round+1 && !done) {
+        for (i=1;i<80;i+=2) delete obj[keys[i]];
+        for (i=1;i<arr.length;i++) arr.splice(i,1);
+        done = true;
+      }
+      last = phase;
+    } while (phase!="idle");
+    for (var j=0;j<80;j++) {
+      var o = obj[keys[j]];
+      if ((j&1) ? o : (!o || o.v!==j)) bad++;
+    }
+    if (arr.length!=40) bad++;
+    arr.forEach(function(a,j) { if (a.v!==j*2) bad++; });
+  }
+  result = bad==0;
+  if (!result) print("bad", bad);
+}
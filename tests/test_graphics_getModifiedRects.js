@@ -0,0 +1,43 @@
+// Test that modified areas are tracked per tile, so widgets in opposite corners don't cause a full redraw
+var g = Graphics.createArrayBuffer(176,176,1);
+var ok = true;
+function check(name, got, exp) {
+  var g = JSON.stringify(got), e = JSON.stringify(exp);
+  if (g!=e) {
+    console.log(name+" FAIL: got "+g+", expected "+e);
+    ok = false;
+  }
+}
+
+check("nothing", g.getModifiedRects(), []);
+g.fillRect(2,3,10,12);
+g.fillRect(160,165,170,172);
+check("bounding box", g.getModified(), {x1:2,y1:3,x2:170,y2:172});
+// rectangles are whole 16x16 tiles, clipped to the modified bounding box
+check("corners", g.getModifiedRects(true), [{x1:2,y1:3,x2:15,y2:15},{x1:160,y1:160,x2:170,y2:172}]);
+check("reset", g.getModifiedRects(), []);
+check("reset bbox", g.getModified(), undefined);
+// side by side in the same row of tiles
+g.setPixel(5,5);
+g.setPixel(100,6);
+check("same row", g.getModifiedRects(true), [{x1:5,y1:5,x2:15,y2:6},{x1:96,y1:5,x2:100,y2:6}]);
+// rows of tiles with the same columns are merged
+g.drawLine(20,20,20,100);
+check("merged", g.getModifiedRects(true), [{x1:20,y1:20,x2:20,y2:100}]);
+// getModified(true) resets the tiles too
+g.fillRect(0,0,175,175);
+g.getModified(true);
+g.setPixel(50,50);
+check("getModified reset", g.getModifiedRects(true), [{x1:50,y1:50,x2:50,y2:50}]);
+// Clipped drawing only marks what was drawn
+g.setClipRect(30,30,40,40);
+g.fillRect(0,0,175,175);
+check("clipped", g.getModifiedRects(true), [{x1:30,y1:30,x2:40,y2:40}]);
+g.reset();
+// Bigger displays use bigger tiles
+g = Graphics.createArrayBuffer(400,300,1);
+g.setPixel(399,299);
+g.setPixel(0,0);
+check("big", g.getModifiedRects(true), [{x1:0,y1:0,x2:31,y2:31},{x1:384,y1:288,x2:399,y2:299}]);
+
+result = ok;
@@ -0,0 +1,62 @@
+// Vector font characters are drawn from a cache of rendered glyphs, and widths are remembered.
+// Check what's drawn/measured is the same as rendering the polygons each time (checksums from before the cache)
+
+var g = Graphics.createArrayBuffer(120,64,1,{msb:true});
+var results = [];
+var text = "Hello World 0123456789 :.!?@#%&*()[]{}<>/\\|\"'~^_=+-,;\xB0\xE9";
+
+// measuring text doesn't create the cache - only drawing does
+g.setFont("Vector",20);
+var lazy = g.getFontHeight()==20 && g.stringWidth("Hi")>0 && global["\xFF"].glyph===undefined;
+g.drawString("Hi");
+lazy = lazy && global["\xFF"].glyph!==undefined;
+
+function test(fn) {
+  g.clear();
+  fn();
+  results.push(E.CRC32(g.buffer));
+}
+
+// draw twice, so the second time comes from the cache
+[1,2].forEach(function() {
+  [6,10,13,17,22,31,40].forEach(function(size) {
+    test(function() { g.setFont("Vector",size).drawString(text, 2, 3); });
+    // offset, so characters go off the edges
+    test(function() { g.setFont("Vector",size).drawString(text, -7, -size/3); });
+    test(function() { g.setFont("Vector",size).drawString(text, 60, 50); });
+  });
+  // different x and y sizes
+  test(function() { g.setFont("Vector:12x20").drawString(text, 1, 1); });
+  test(function() { g.setFont("Vector:20x8").drawString(text, 1, 1); });
+  // solid background, alignment, multiple lines
+  test(function() { g.setFont("Vector",15).setFontAlign(0,0).drawString("Hi\nThere", 60, 32, true); g.setFontAlign(-1,-1); });
+  // clipping
+  test(function() { g.setClipRect(10,10,50,40).setFont("Vector",30).drawString("ABC", 5, 5); g.setClipRect(0,0,119,63); });
+  // rotated text doesn't use the cache, but check it anyway
+  test(function() { g.setFont("Vector",14).setFontAlign(-1,-1,1).drawString("Rot 123", 60, 2); g.setFontAlign(-1,-1,0); });
+  // colours
+  test(function() { g.setColor(0).fillRect(0,0,119,63).setColor(1); g.setColor(0).setFont("Vector",20).drawString("Inv", 3, 3); g.setColor(1); });
+});
+
+// widths for layout
+[8,16,25].forEach(function(size) {
+  g.setFont("Vector",size);
+  results.push(g.stringWidth(text));
+  results.push(g.stringWidth("a\nbcd"));
+  results.push(g.wrapString(text+" "+text, 100).join("|"));
+  for (var c=32;c<256;c+=7) results.push(g.stringWidth(String.fromCharCode(c)));
+});
+
+// custom fonts use remembered widths
+var font = atob("/4H/AAD/AACPmfEAgZH/APAQ/wDxmY8A/5GfAICA/wD/kf8A8ZH/AA==");
+g.setFontCustom(font, "0".charCodeAt(0), 4, 8);
+results.push(g.stringWidth("0123456789"));
+test(function() { g.drawString("0123456789", 1, 1); });
+g.setFontCustom(font, "0".charCodeAt(0), atob("BAQEBAQEBAQEBA=="), 8);
+results.push(g.stringWidth("9876543210"));
+results.push(g.wrapString("01234 56789 01", 30).join("|"));
+test(function() { g.drawString("9876543210", 3, 2); });
+
+var crc = E.CRC32(results.join(","));
+result = crc==985216787 && lazy;
+if (!result) print(crc, lazy, results.join(","));
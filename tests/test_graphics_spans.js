@@ -0,0 +1,71 @@
+// fillRect, drawImage and drawImages on flat ArrayBuffers write whole rows/spans at once.
+// Check the results match what was drawn a pixel at a time (checksums from before the change)
+
+var W = 37, H = 9; // odd width so rows don't start on byte boundaries
+
+function seed(g) {
+  // something other than all 0 underneath, so we can see what was overwritten
+  var b = new Uint8Array(g.buffer);
+  for (var i=0;i<b.length;i++) b[i] = (i*37+11)&255;
+}
+
+var SEED = 1;
+function rnd() { SEED = (SEED*1103515245 + 12345) & 0x7FFFFFFF; return SEED>>8; }
+
+function makeImage(w,h,bpp,opts) {
+  var data = new Uint8Array((w*h*bpp+7)>>3);
+  data.forEach(function(v,i,a) { a[i] = rnd(); });
+  var o = {width:w, height:h, bpp:bpp, buffer:data.buffer};
+  if (opts.transparent!==undefined) o.transparent = opts.transparent;
+  if (opts.palette) o.palette = opts.palette;
+  return o;
+}
+
+var results = {};
+[1,2,4,8,16].forEach(function(bpp) {
+  [true,false].forEach(function(msb) {
+    var crcs = [];
+    var g = Graphics.createArrayBuffer(W,H,bpp,{msb:msb});
+    g.setBgColor(0).setColor(-1);
+    // fillRect - unaligned, single pixel, full width, full screen and off the edge. Includes colors wider than bpp
+    [[3,1,20,4],[5,5,5,5],[0,2,W-1,6],[0,0,W-1,H-1],[30,0,W+10,H+10]].forEach(function(r) {
+      [0xA5C3, 2, 1].forEach(function(col) {
+        seed(g);
+        g.setColor(col).fillRect(r[0],r[1],r[2],r[3]);
+        crcs.push(E.CRC32(g.buffer));
+      });
+    });
+    g.setColor(-1);
+    // drawImage - different source bpp, transparency, palettes, unaligned positions
+    [1,2,3,4,8].forEach(function(ibpp) {
+      var pal;
+      if (ibpp<=3) { // bigger palettes aren't allocated flat
+        pal = [];
+        for (var i=0;i<1<<ibpp;i++) pal.push(rnd()&0xFFFF);
+        pal = new Uint16Array(pal);
+      }
+      [{}, {transparent:1}, {palette:pal}, {palette:pal, transparent:0}].forEach(function(opts, n) {
+        if (opts.palette===undefined && n>=2) return;
+        var im = makeImage(11+ibpp, 5, ibpp, opts);
+        [[0,0],[3,2],[W-11-ibpp,H-5],[-2,-1]].forEach(function(p) {
+          seed(g);
+          g.drawImage(im, p[0], p[1]);
+          crcs.push(E.CRC32(g.buffer));
+        });
+        // rotated/scaled images and drawImages use the row buffer too
+        seed(g);
+        g.drawImage(im, 20, 4, {rotate:0.5});
+        crcs.push(E.CRC32(g.buffer));
+        seed(g);
+        g.drawImages([{x:1,y:1,image:im},{x:9,y:2,image:im,scale:1.5}]);
+        crcs.push(E.CRC32(g.buffer));
+      });
+    });
+    results[bpp+(msb?"msb":"")] = E.CRC32(crcs.join(","));
+  });
+});
+
+var expected = {"1msb":3418210094,"1":2660862896,"2msb":2452150100,"2":1769112698,"4msb":3864070342,"4":2692145002,
+                "8msb":3978919836,"8":2627769484,"16msb":2918415413,"16":2885305506};
+result = JSON.stringify(results)==JSON.stringify(expected);
+if (!result) print(JSON.stringify(results));
@@ -0,0 +1,48 @@
+// HTTP client receiving a chunked response (with extensions and trailers) in small pieces
+
+var http = require("http");
+var net = require("net");
+var alphabet = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ";
+var response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nX-Test: hello\r\nConnection: close\r\n\r\n"+
+               "5;ext=1\r\nHello\r\n"+
+               "34\r\n"+alphabet+"\r\n"+
+               "0\r\nX-Trailer: x\r\n\r\n";
+var results = [];
+
+var server = net.createServer(function(c) {
+  c.on('data', function() {
+    // send the response a few bytes at a time so it's split up
+    var pos = 0;
+    function send() {
+      c.write(response.substr(pos, pieceSize));
+      pos += pieceSize;
+      if (pos < response.length) setTimeout(send, 2);
+      else c.end();
+    }
+    send();
+  });
+});
+server.listen(8081);
+
+var pieceSize;
+var sizes = [1, 2, 3, 7, 1000];
+function next() {
+  if (!sizes.length) {
+    server.close();
+    result = results.every(function(r) { return r; });
+    if (!result) print(results);
+    return;
+  }
+  pieceSize = sizes.shift();
+  http.get("http://localhost:8081/", function(res) {
+    var body = "";
+    res.on('data', function(d) { body += d; });
+    res.on('close', function() {
+      var ok = body == "Hello"+alphabet && res.headers["X-Test"]=="hello";
+      if (!ok) print(pieceSize, JSON.stringify(body), res.headers);
+      results.push(ok);
+      next();
+    });
+  });
+}
+next();
@@ -0,0 +1,55 @@
+// `a.b` lookups that go to prototypes/built-ins are cached - check they notice changes
+function Foo() {}
+Foo.prototype.x = function() { return 1; };
+function get(o) { return o.x; }
+function call(o) { return o.x(); }
+var r = [];
+var f = new Foo();
+r.push(call(f)==1 && call(f)==1);
+Foo.prototype.x = function() { return 2; }; // value changed
+r.push(call(f)==2);
+f.x = function() { return 3; }; // own property
+r.push(call(f)==3 && call(new Foo())==2);
+delete Foo.prototype.x;
+r.push(get(new Foo())===undefined);
+function Bar() {}
+Bar.prototype.x = 5;
+var g = new Foo();
+g.__proto__ = Bar.prototype; // changed prototype
+r.push(get(g)==5);
+Bar.prototype = { x : 6 }; // replaced prototype
+r.push(get(new Bar())==6 && get(g)==5);
+// prototype chains
+var A = { x : 7 }, B = Object.create(A), C = Object.create(B);
+r.push(get(C)==7);
+B.x = 8;
+r.push(get(C)==8);
+// built-ins
+function len(a) { return a.length; }
+function push(a) { return a.push; }
+r.push(len([1,2,3])==3 && len("ab")==2 && len([])==0);
+r.push(push([])===[].push);
+Array.prototype.push = function() { return "mine"; };
+r.push([].push()=="mine");
+delete Array.prototype.push;
+var a=[]; a.push(1);
+r.push(a.length==1);
+function sin(m) { return m.sin(Math.PI/2); }
+r.push(sin(Math)==1 && sin(Math)==1);
+Math.sin = function() { return 42; };
+r.push(sin(Math)==42);
+// replacing a built-in class changes where Strings/Arrays/etc inherit from
+var S = String, S2 = { prototype : { foo : 2 } };
+String.prototype.foo = 1;
+function foo(s) { return s.foo; }
+r.push(foo("ab")==1 && foo("ab")==1);
+String = S2;
+r.push(foo("ab")==2);
+String = S;
+r.push(foo("ab")==1);
+// different code at the same position
+for (var i=0;i<3;i++) {
+  r.push(eval("[1,2].length")==2 && eval("'x'.length")==1);
+  r.push(eval("({__proto__:{y:"+i+"}}).y")==i);
+}
+result = r.every(x=>x);
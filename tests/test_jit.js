@@ -0,0 +1,107 @@
+// Functions marked "jit" are compiled to native code when Espruino is built with USE_JIT=1
+// (otherwise they're just run as normal functions, which should give the same results)
+var r = [];
+function j1() {'jit';return 1+2+3+4+5;}
+r.push(j1()==15);
+function j2() {'jit';return 'Hello';}
+r.push(j2()=="Hello");
+var test = "Hello world";
+function j3() {'jit';return test;}
+r.push(j3()=="Hello world");
+function j4() {'jit';return !123;}
+r.push(j4()===false);
+function j5() {'jit';return ~0;}
+r.push(j5()==-1);
+function j6() {'jit';return -(1);}
+r.push(j6()==-1);
+function t() { return "Hello"; }
+function j7() {'jit'; return t()+" world";}
+r.push(j7()=="Hello world");
+function j8() {'jit';return i++;}
+i=0;r.push(j8()==0 && i==1);
+function j9() {'jit';return ++i;}
+i=0;r.push(j9()==1 && i==1);
+function j10() {"jit";if (i<3) return "T"; else return "X";}
+i=2;r.push(j10()=="T");
+i=5;r.push(j10()=="X");
+function j11() {"jit";s=0;for (i=0;i<5;i++) s=s+i;return s;}
+r.push(j11()==10);
+function j12() {"jit";for (i=0;i<5;i++) if (i==3) return i*10;}
+r.push(j12()==30);
+a = {b:42,c:function(x,y){return this.b+x+y;}};
+function j13() {"jit";return a.b;}
+r.push(j13()==42);
+function j14() {"jit";return a["b"];}
+r.push(j14()==42);
+function j15() {"jit";return a.c(1,2);}
+r.push(j15()==45);
+function j16() {'jit';return 1.5*2;}
+r.push(j16()==3);
+function j17() {'jit';return 0x123456789;}
+r.push(j17()==0x123456789);
+function j18() {'jit';i=42;}
+j18();r.push(i==42);
+// arguments and local variables
+function j19(x,y) {'jit';return x+y;}
+r.push(j19(3,4)==7 && j19("a","b")=="ab");
+function j20(x) {'jit';x=x+1;return x;}
+var q=5;r.push(j20(q)==6 && q==5);
+function j21(n) {'jit';var s=0;for (var i=0;i<n;i++) s=s+i;return s;}
+r.push(j21(10)==45);
+function j22() {'jit';for (var i=0;i<10;i++) if (i==3) return i*10;}
+r.push(j22()==30);
+function j23() {'jit';var i=5;return i<3;}
+r.push(j23()===false);
+function j24() {'jit';var i=0;i++;++i;i--;return i;}
+r.push(j24()===1);
+function j25() {'jit';var i=-5,j=3;return i<j;}
+r.push(j25()===true);
+function j26() {'jit';var y;return y;}
+r.push(j26()===undefined);
+function j27(p) {'jit';var a=p;a.x=1;return a;}
+var o={};r.push(j27(o)===o && o.x==1);
+function j28() {'jit';return 3000000000;}
+r.push(j28()==3000000000);
+function j28b() {'jit';var i=2147483647;i++;var j=-2147483647;--j;--j;return i+j;}
+r.push(j28b()===-1);
+try { throw "x"; var j28c=function() {'jit';return 1;}; } catch(e) { r.push(e=="x"); }
+// calls to built-in functions
+function j29(x) {'jit';return Math.sqrt(x);}
+r.push(j29(16)==4);
+function j30() {'jit';var s=0;for (var i=0;i<5;i++) s=s+Math.abs(-i);return s;}
+r.push(j30()==10);
+function j31(x) {'jit';return parseInt(x)+E.clip(15,0,10)+Math.max(1,5,3);}
+r.push(j31("2")==17);
+function j32(p) {'jit';digitalWrite(p,1);return digitalRead(p);}
+r.push(j32(5)===digitalRead(5));
+function j33() {'jit';return E.toString(getSerial())==getSerial();}
+r.push(j33()===true);
+var Math2 = Math;Math = {sqrt:function(){return 42;}};
+function j34() {'jit';return Math.sqrt(4);}
+r.push(j34()==42);
+Math = Math2;
+// built-ins redefined after compiling are called like any other function
+function j35(x) {'jit';return Math.sqrt(x)+parseInt("3");}
+r.push(j35(4)==5);
+Math.sqrt = function(){return 42;};
+r.push(j35(4)==45);
+delete Math.sqrt;
+r.push(j35(4)==5);
+global.parseInt = function(){return 10;};
+r.push(j35(4)==12);
+delete global.parseInt;
+r.push(j35(4)==5);
+function j36(p) {'jit';digitalWrite(p,digitalRead(p)==0);return digitalRead(p)+analogRead(p,1,2,3,4,5);}
+r.push(j36(5)>=0);
+// falsy arguments, locals and globals used as conditions
+function j37(c) {'jit';if (c) return 1;return 0;}
+r.push(j37(0)===0 && j37("")===0 && j37(undefined)===0 && j37(1)===1 && j37("a")===1);
+function j38(c) {'jit';var l=c;if (l) return 1;return 0;}
+r.push(j38(0)===0 && j38(false)===0 && j38(NaN)===0 && j38(2)===1);
+var g0 = 0;
+function j39() {'jit';if (g0) return 2;if (!g0) return 1;return 0;}
+r.push(j39()===1);
+g0 = "x";r.push(j39()===2);
+function j40(n) {'jit';var s=0;for (var i=n;i;i--) s=s+i;return s;}
+r.push(j40(0)===0 && j40(3)===6);
+result = r.every(x=>x);
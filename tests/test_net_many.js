@@ -0,0 +1,34 @@
+// Lots of sockets open at once, all sending and receiving
+
+var net = require("net");
+var CLIENTS = 50;
+var connected = 0, echoed = 0, closed = 0;
+
+var server = net.createServer(function(c) {
+  connected++;
+  c.on('data', function(data) { c.write(data.toUpperCase()); });
+  c.on('end', function() { c.end(); });
+});
+server.listen(4445);
+
+var clients = [];
+for (var i=0;i<CLIENTS;i++) (function(n) {
+  var body = "";
+  var client = net.connect({port: 4445}, function() {
+    client.write("hello "+n);
+  });
+  client.on('data', function(data) {
+    body += data;
+    if (body=="HELLO "+n) {
+      echoed++;
+      client.end();
+    }
+  });
+  client.on('close', function() {
+    if (++closed == CLIENTS) {
+      server.close();
+      result = connected==CLIENTS && echoed==CLIENTS;
+      if (!result) print(connected, echoed, closed);
+    }
+  });
+})(i);
@@ -0,0 +1,22 @@
+// Objects with lots of keys get a hash index of their children
+var o = {};
+for (var i=0;i<200;i++) o["key"+i] = i;
+var ok = true;
+for (var i=0;i<200;i++) if (o["key"+i]!==i) ok = false;
+// delete and re-add
+for (var i=0;i<200;i+=2) delete o["key"+i];
+for (var i=0;i<200;i++) if (o["key"+i]!==((i&1)?i:undefined)) ok = false;
+for (var i=0;i<200;i+=2) o["key"+i] = -i;
+for (var i=0;i<200;i++) if (o["key"+i]!==((i&1)?i:-i)) ok = false;
+// copying doesn't copy the index
+var c = Object.assign({}, o);
+c.key1 = "copy";
+// keys are still in insertion order and the index is hidden
+var k = Object.keys(o);
+var json = JSON.parse(JSON.stringify(o));
+// lots of globals
+for (var i=0;i<100;i++) global["gkey"+i] = i;
+
+result = ok && k.length==200 && k[0]=="key1" && k[199]=="key198" &&
+         Object.keys(json).length==200 && o.key1==1 && c.key1=="copy" &&
+         c.key198==-198 && gkey50==50 && o.hasOwnProperty("key3") && !o.hasOwnProperty("key300");
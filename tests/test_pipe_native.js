@@ -0,0 +1,60 @@
+// Pipes between built-in streams and ArrayBuffers copy data natively, falling back to JS methods for user-defined streams
+var s = require("Storage");
+s.eraseAll();
+var text = "";
+for (var i=0;i<50;i++) text += "Line "+i+" of the text\n";
+var f = s.open("pipetest","w");
+f.write(text);
+
+var results = {};
+var native = {};
+function check(name, pipe) {
+  native[name] = [pipe.sourceType!==undefined, pipe.destinationType!==undefined];
+}
+
+// StorageFile -> ArrayBuffer
+var ab = new Uint8Array(text.length);
+E.pipe(s.open("pipetest","r"), ab, { chunkSize:100, complete:function(pipe) {
+  check("sf_ab", pipe);
+  results.sf_ab = E.toString(ab)==text;
+  // ArrayBuffer -> StorageFile
+  var out = s.open("pipeout","w");
+  E.pipe(ab, out, { chunkSize:300, complete:function(pipe) {
+    check("ab_sf", pipe);
+    results.ab_sf = s.open("pipeout","r").read(10000)==text;
+  }});
+}});
+
+// ArrayBuffer -> smaller ArrayBuffer (the rest is lost)
+var small = new Uint8Array(10);
+E.pipe(E.toArrayBuffer("Hello World, this is long"), small, { complete:function(pipe) {
+  check("ab_ab", pipe);
+  results.ab_ab = E.toString(small)=="Hello Worl";
+}});
+
+// user-defined stream -> ArrayBuffer
+var src = { data:"0123456789ABCDEF", read:function(n) {
+  if (!this.data.length) return undefined;
+  var d = this.data.substr(0,n);
+  this.data = this.data.substr(n);
+  return d;
+}};
+var dst = new Uint8Array(16);
+E.pipe(src, dst, { chunkSize:3, complete:function(pipe) {
+  check("js_ab", pipe);
+  results.js_ab = E.toString(dst)=="0123456789ABCDEF";
+}});
+
+// ArrayBuffer -> user-defined stream
+var got = "";
+E.pipe(new Uint8Array([65,66,67,68,69]), { write:function(d) { got+=d; } }, { chunkSize:2, complete:function(pipe) {
+  check("ab_js", pipe);
+  results.ab_js = got=="ABCDE";
+}});
+
+setTimeout(function() {
+  result = results.sf_ab && results.ab_sf && results.ab_ab && results.js_ab && results.ab_js &&
+    JSON.stringify(native)=='{"ab_ab":[true,true],"ab_js":[true,false],"js_ab":[false,true],"sf_ab":[true,true],"ab_sf":[true,true]}';
+  if (!result) print(results, native);
+  s.eraseAll();
+}, 200);
@@ -0,0 +1,52 @@
+// Compiled RegExps (Pike VM) - quantifiers, groups, assertions and linear time matching
+tests=0;
+testPass=0;
+
+function test(a, b) {
+  tests++;
+  a = JSON.stringify(a);
+  b = JSON.stringify(b);
+  if (a==b) {
+    return testPass++;
+  }
+  console.log("Test "+tests+" failed - ",a,"vs",b);
+}
+
+test(/a(b)?c/.exec("ac"), ["ac",undefined]);
+test(/(a|ab)(c|bcd)(d*)/.exec("abcd"), ["abcd","a","bcd",""]);
+test(/x{2,3}/.exec("axxxxb")[0], "xxx");
+test(/x{2,}?/.exec("axxxxb")[0], "xx");
+test(/a.*?b/.exec("aXbYb")[0], "aXb");
+test(/colou?r/.exec("color")[0], "color");
+test(/(?:ab)+/.exec("xababab")[0], "ababab");
+test(/(((a)))/.exec("a"), ["a","a","a","a"]);
+test(/a{/.exec("a{")[0], "a{");
+test(/\d{3}-\d{4}/.exec("call 555-1234 now")[0], "555-1234");
+test(/[A-Z]+/i.exec("12abC3")[0], "abC");
+// assertions
+test(/\bfoo\b/.exec("a foo b").index, 2);
+test(/\bfoo\b/.test("afoob"), false);
+test(/^b/m.exec("a\nb").index, 2);
+test(/a$/m.test("a\nb"), true);
+test(/a$/.test("a\nb"), false);
+// backreferences use the recursive matcher
+test(/(a)\1/.exec("xaa")[0], "aa");
+// groups that don't take part are undefined
+test("abc".replace(/(x)?b/, (m,g,i)=>typeof g+i), "aundefined1c");
+// NMEA-style parsing
+test(/^\$GP(\w+),([^,]*),/.exec("$GPGGA,123519,4807.038,N"), ["$GPGGA,123519,","GGA","123519"]);
+// these backtrack exponentially in a recursive matcher
+var s = "";
+for (var i=0;i<30;i++) s+="a";
+test(/(a+)+b/.test(s), false);
+test(/(a|aa)*c/.test(s), false);
+// '{n}' can't be handled by the recursive matcher, so patterns that can't be compiled throw
+function throws(f, type) { try { f(); } catch (e) { return e instanceof type; } return false; }
+test(throws(function() { "a".repeat(200).match(/(a|b){1000}/); }, Error), true);
+test(throws(function() { new RegExp("(a)\\1{2}"); }, Error), true);
+test(throws(function() { new RegExp("a{3,2}"); }, SyntaxError), true);
+// literals are only compiled once
+for (var i=0;i<10;i++) { test(/b(\d)/.exec("ab"+i)[1], ""+i); }
+
+result = tests==testPass;
+console.log(result?"Pass":"Fail",":",tests,"tests total");
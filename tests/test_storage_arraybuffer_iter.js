@@ -0,0 +1,39 @@
+// Typed arrays backed by Flash Strings (Storage.readArrayBuffer) are read a block at a time
+var s = require("Storage");
+s.eraseAll();
+var ok = true;
+function check(cond, msg) { if (!cond) { console.log("FAIL: "+msg); ok = false; } }
+
+var ram = new Uint8Array(1000);
+for (var i=0;i<ram.length;i++) ram[i] = (i*7+(i>>3))&255;
+// odd-sized file first so the data isn't aligned to a block in flash
+s.write("pad", "123");
+s.write("data", ram);
+var buf = s.readArrayBuffer("data");
+check(E.toString(buf)==E.toString(ram), "readArrayBuffer");
+
+// Views with all element sizes and offsets that cross block boundaries
+[[Uint8Array,1,"Uint8"],[Int16Array,2,"Int16"],[Uint32Array,4,"Uint32"],[Float32Array,4,"Float32"],[Float64Array,8,"Float64"]].forEach(function(t) {
+  for (var offs=0;offs<8;offs+=t[1]) {
+    var len = ((1000-offs)/t[1])|0;
+    var fv = new t[0](buf, offs, len);
+    var rv = new t[0](ram.buffer, offs, len);
+    var a = [], b = [];
+    fv.forEach(function(x) { a.push(x); });
+    rv.forEach(function(x) { b.push(x); });
+    check(a.length==len && JSON.stringify(a)==JSON.stringify(b), t[2]+" offset "+offs);
+    var fs = E.sum(fv), rs = E.sum(rv); // random bytes may make NaN floats
+    check(fs===rs || (isNaN(fs) && isNaN(rs)), t[2]+" E.sum");
+    check(fv[len-1]===rv[len-1] || (isNaN(fv[len-1]) && isNaN(rv[len-1])), t[2]+" index");
+  }
+});
+// DataView reads big and little endian values straight from flash
+var dv = new DataView(buf), rdv = new DataView(ram.buffer);
+var same = true;
+for (var i=0;i<990;i+=3)
+  same &= dv.getUint32(i,false)==rdv.getUint32(i,false) && dv.getInt16(i,true)==rdv.getInt16(i,true);
+check(same, "DataView");
+// copying a flash-backed array into RAM
+check(E.toString(new Uint8Array(buf, 5, 900))==E.toString(new Uint8Array(ram.buffer, 5, 900)), "copy");
+
+result = ok;
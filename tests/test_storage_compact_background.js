@@ -0,0 +1,49 @@
+// Storage.compact({background:true}) should compact a bit at a time while Storage stays usable
+var s = require("Storage");
+s.eraseAll();
+var expected = {};
+function fill(name, len, ch) {
+  var d = new Uint8Array(len);
+  d.fill(ch);
+  s.write(name, d);
+  expected[name] = E.toString(d);
+}
+// lots of files, many of them rewritten so there's trash all over storage
+for (var i=0;i<30;i++) fill("f"+i, 1000+i*100, 65+(i%26));
+for (var i=0;i<30;i+=2) fill("f"+i, 500+i*50, 97+(i%26));
+for (var i=0;i<30;i+=3) s.erase("f"+i), delete expected["f"+i];
+// a StorageFile after all the trash (so it gets moved) that we keep appending to
+var log = s.open("log","w"), logged = "";
+function logLine(l) { log.write(l); logged += l; }
+logLine("start\n");
+var before = s.getStats();
+
+function check() {
+  var ok = true;
+  for (var n in expected)
+    if (s.read(n)!==expected[n]) { console.log("Mismatch in "+n); ok = false; }
+  if (s.list(undefined,{sf:false}).length != Object.keys(expected).length) { console.log("Wrong file count"); ok = false; }
+  return ok;
+}
+
+var readsOk = true, ticks = 0;
+var promise = s.compact({background:true});
+// Storage should still be consistent while compaction is in progress
+var interval = setInterval(function() {
+  ticks++;
+  readsOk &= check();
+  if (ticks==2) fill("during", 700, 90); // write while compacting
+  logLine("tick "+ticks+"\n"); // append while compacting
+}, 1);
+
+promise.then(function() {
+  clearInterval(interval);
+  var after = s.getStats();
+  readsOk &= check();
+  var logRead = s.open("log","r").read(100000);
+  if (logRead!==logged) { console.log("StorageFile has "+(logRead?logRead.length:0)+" of "+logged.length+" bytes"); readsOk = false; }
+  result = readsOk && before.trashBytes>0 && after.trashBytes==0 &&
+           after.freeBytes > before.freeBytes;
+  if (!result) console.log(before, after, ticks);
+  s.eraseAll();
+});
@@ -0,0 +1,53 @@
+// Check the hashed FILENAME_TABLE stays in sync as files are added, replaced, erased and compacted
+var tests=0,testsPass=0;
+function test(a,b) {
+  tests++;
+  if (a===b) testsPass++;
+  else console.log("Test "+tests+" failed: "+a+" !== "+b);
+}
+
+var s = require("Storage");
+s.eraseAll();
+for (var i=0;i<40;i++) s.write("f"+i, "file"+i);
+s.optimise(); // create the table
+test(s.list().length, 40);
+test(s.read("f7"), "file7");
+test(s.read("f39"), "file39");
+test(s.read("nothere"), undefined);
+// new files must be added to the table as they're written
+for (var i=40;i<80;i++) s.write("f"+i, "file"+i);
+test(s.list().length, 80);
+test(s.read("f63"), "file63");
+// replaced files must be found at their new address
+for (var i=0;i<80;i+=3) s.write("f"+i, "new"+i);
+test(s.read("f3"), "new3");
+test(s.read("f4"), "file4");
+test(s.list().length, 80);
+test(s.list(/f1.$/).sort().join(","), "f10,f11,f12,f13,f14,f15,f16,f17,f18,f19");
+// erased files must go
+s.erase("f5");
+test(s.read("f5"), undefined);
+test(s.list().length, 79);
+// compaction moves files, so the table must be rebuilt
+s.compact();
+test(s.read("f6"), "new6");
+test(s.read("f79"), "file79");
+test(s.read("f5"), undefined);
+test(s.list().length, 79);
+s.write("after", "compact");
+test(s.read("after"), "compact");
+test(s.list().length, 80);
+// only creating files must still rebuild the table before it gets full
+s.eraseAll();
+for (var i=0;i<40;i++) s.write("f"+i, "file"+i);
+s.optimise(); // table with 128 slots
+for (var i=40;i<140;i++) s.write("f"+i, "file"+i);
+var stats = s.getStats();
+test(stats.trashCount, 1); // the old table
+test(stats.fileCount, 141); // files and the new table
+test(s.read("f139"), "file139");
+test(s.list().length, 140);
+s.eraseAll();
+test(s.list().length, 0);
+
+result = tests==testsPass;
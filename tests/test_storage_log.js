@@ -0,0 +1,49 @@
+// StorageFile log mode - a ring of fixed size pages with the position kept in RAM
+var s = require("Storage");
+s.eraseAll();
+var ok = true;
+function check(cond, msg) { if (!cond) { console.log("FAIL: "+msg); ok = false; } }
+
+var f = s.open("log","w",{log:true, pages:4, pageSize:256});
+var st = f.stat();
+check(st.pages==4 && st.pageSize==256, "stat "+JSON.stringify(st));
+check(s.open("plain","w").stat()===undefined, "stat of normal file");
+
+// Write less than one ring's worth and read it back
+var lines = [];
+for (var i=0;i<20;i++) { var l = "Line "+i+"\n"; lines.push(l); f.write(l); }
+check(f.getLength()==lines.join("").length, "length "+f.getLength());
+var r = s.open("log","r");
+check(r.stat()!==undefined, "log detected when reading");
+var txt = "", l;
+while ((l=r.readLine())!==undefined) txt += l;
+check(txt==lines.join(""), "read back");
+
+// Reopen for append, and write enough to wrap around the ring a few times
+f = s.open("log","a");
+for (var i=20;i<300;i++) { var l = "Line "+i+"\n"; lines.push(l); f.write(l); }
+st = f.stat();
+check(st.eraseCounts.every(c=>c>0), "all pages erased "+JSON.stringify(st.eraseCounts));
+check(st.seq>4, "seq "+st.seq);
+// reading gives a contiguous tail of what was written, ending with the last line
+r = s.open("log","r");
+txt = r.read(100000);
+var all = lines.join("");
+check(txt.length>3*(256-12) && txt.length<=4*(256-12), "log length "+txt.length);
+check(all.endsWith(txt), "tail of data");
+check(f.getLength()==txt.length, "getLength "+f.getLength());
+
+// Compaction moves pages around - make sure the cached addresses are refreshed
+s.write("junk","x".repeat(2000));
+s.erase("junk");
+s.compact();
+f.write("After compact\n");
+r = s.open("log","r");
+txt = r.read(100000);
+check(txt.endsWith("Line 299\nAfter compact\n"), "write after compact");
+
+f.erase();
+check(s.list(/log/).length==0, "erased "+s.list());
+check(s.open("log","r").read(10)===undefined, "empty after erase");
+
+result = ok;
@@ -0,0 +1,67 @@
+// Storage.readJSON with 'path' and 'callback' options
+var tests=0,testsPass=0;
+function test(a,b) {
+  tests++;
+  if (a===b) testsPass++;
+  else console.log("Test "+tests+" failed: "+JSON.stringify(a)+" vs "+JSON.stringify(b));
+}
+
+var s = require("Storage");
+s.eraseAll();
+s.writeJSON("a.json", {name:"x", "a.b":1, items:[{a:1},{a:2,s:"}]\"x"},[3,[4]]], n:{m:{o:-5.5}}, t:true});
+test(s.readJSON("a.json", {path:"items.1.a"}), 2);
+test(s.readJSON("a.json", {path:["items",1,"s"]}), "}]\"x");
+test(s.readJSON("a.json", {path:"items.2.1.0"}), 4);
+test(JSON.stringify(s.readJSON("a.json", {path:"n.m"})), '{"o":-5.5}');
+test(s.readJSON("a.json", {path:["a.b"]}), 1);
+test(s.readJSON("a.json", {path:"t"}), true);
+test(s.readJSON("a.json", {path:"nope"}), undefined);
+test(s.readJSON("a.json", {path:"items.5"}), undefined);
+test(s.readJSON("a.json", {path:"name.x"}), undefined);
+test(s.readJSON("a.json", {path:""}).name, "x");
+test(s.readJSON("a.json", true).name, "x");
+var items = [];
+s.readJSON("a.json", {path:"items", callback:function(item,idx) { items.push(idx+":"+JSON.stringify(item)); }});
+test(items.join(","), '0:{"a":1},1:{"a":2,"s":"}]\\"x"},2:[3,[4]]');
+var keys = [];
+s.readJSON("a.json", {callback:function(v,k) { keys.push(k); return k!="items"; }});
+test(keys.join(","), "name,a.b,items");
+
+// invalid JSON
+s.write("bad.json", '{"a":[1,2,"x}');
+var err;
+try { s.readJSON("bad.json", {path:"b"}); } catch (e) { err = e; }
+test(err instanceof SyntaxError, true);
+test(s.readJSON("bad.json", {path:"b",noExceptions:true}), undefined);
+test(s.readJSON("bad.json", {callback:function(){},noExceptions:true}), undefined);
+// ...but exceptions from the callback are still thrown
+err = undefined;
+try { s.readJSON("a.json", {callback:function() { throw "Oops"; },noExceptions:true}); } catch (e) { err = e; }
+test(err, "Oops");
+
+// long keys are compared in full
+var long = "k".repeat(70), o = {};
+o[long+"x"] = 1;
+o[long] = 2;
+s.writeJSON("long.json", o);
+test(s.readJSON("long.json", {path:long}), 2);
+test(s.readJSON("long.json", {path:[long+"x"]}), 1);
+test(s.readJSON("long.json", {path:long+"y"}), undefined);
+
+// only one item is in memory at a time
+var arr = [];
+for (var i=0;i<100;i++) arr.push({i:i,str:"Hello World "+i});
+s.writeJSON("big.json", arr);
+arr = undefined;
+var maxUsage = 0, sum = 0;
+var usage = process.memory().usage;
+s.readJSON("big.json", {callback:function(item) {
+  sum += item.i;
+  maxUsage = Math.max(maxUsage, process.memory().usage-usage);
+}});
+test(sum, 4950);
+test(maxUsage < 50, true);
+test(s.readJSON("big.json", {path:"99.str"}), "Hello World 99");
+s.eraseAll();
+
+result = tests==testsPass;
@@ -0,0 +1,33 @@
+// Lots of timers, checking they fire in the order they're due, even when cleared/changed/time is set
+
+var order = [];
+var ids = [];
+for (var i=0;i<40;i++)
+  ids.push(setTimeout(function(n) { order.push(n); }, 10+(40-i)*2, i));
+// clear some of them
+for (i=0;i<40;i+=5) clearTimeout(ids[i]);
+var expectedOrder = [];
+for (i=39;i>=0;i--) if (i%5) expectedOrder.push(i);
+
+// intervals
+var count = 0;
+var iv = setInterval(function() { if (++count==5) clearInterval(iv); }, 7);
+var changed = 0;
+var iv2 = setInterval(function() { changed++; clearInterval(iv2); }, 100000);
+changeInterval(iv2, 5);
+
+// timers due at the same time run in the order they were added
+var same = "";
+setTimeout(function() { same+="x"; }, 150);
+// changing the time shouldn't change when timers fire
+setTime(getTime()+10000);
+setTimeout(function() { same+="a"; }, 100);
+setTimeout(function() { same+="b"; }, 100);
+setTime(getTime()-20000);
+setTimeout(function() { same+="c"; }, 100);
+
+setTimeout(function() {
+  result = order.join(",")==expectedOrder.join(",") &&
+           count==5 && changed==1 && same=="abcx";
+  if (!result) print(order, count, changed, same);
+}, 200);
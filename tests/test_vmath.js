@@ -0,0 +1,81 @@
+// Test E.vmath typed array kernels against plain JS loops
+var ok = true;
+function check(name, got, exp) {
+  var g = JSON.stringify(got), e = JSON.stringify(exp);
+  if (g!=e) {
+    console.log(name+" FAIL: got "+g+", expected "+e);
+    ok = false;
+  }
+}
+function arr(a) { return [].slice.call(a); }
+function loop(T, a, fn) {
+  var d = new T(a.length);
+  for (var i=0;i<a.length;i++) d[i] = fn(i);
+  return arr(d);
+}
+
+var src = [5, -3, 100, -128, 127, 0, 42, -7, 300, -1000, 12345, 3];
+for (var i=0;i<70;i++) src.push((i*37)%91 - 45); // more than one chunk
+var types = { Int8Array:Int8Array, Uint8Array:Uint8Array, Uint8ClampedArray:Uint8ClampedArray,
+              Int16Array:Int16Array, Uint16Array:Uint16Array, Int32Array:Int32Array,
+              Uint32Array:Uint32Array, Float32Array:Float32Array, Float64Array:Float64Array };
+
+Object.keys(types).forEach(function(tn) {
+  var T = types[tn];
+  var a = new T(src), b = new T(src.length);
+  for (var i=0;i<b.length;i++) b[i] = (i*13)%7 - 3;
+  var d = new T(a.length);
+  check(tn+" add", arr(E.vmath.add(d,a,b)), loop(T,a,function(i){return a[i]+b[i];}));
+  check(tn+" add scalar", arr(E.vmath.add(d,a,10)), loop(T,a,function(i){return a[i]+10;}));
+  check(tn+" sub", arr(E.vmath.sub(d,a,b)), loop(T,a,function(i){return a[i]-b[i];}));
+  check(tn+" mul", arr(E.vmath.mul(d,a,b)), loop(T,a,function(i){return a[i]*b[i];}));
+  check(tn+" mul scalar", arr(E.vmath.mul(d,a,300)), loop(T,a,function(i){return a[i]*300;}));
+  check(tn+" scale", arr(E.vmath.scale(d,a,0.5,3)), loop(T,a,function(i){return a[i]*0.5+3;}));
+  check(tn+" scale no offset", arr(E.vmath.scale(d,a,2)), loop(T,a,function(i){return a[i]*2;}));
+  check(tn+" clip", arr(E.vmath.clip(d,a,-5,50)), loop(T,a,function(i){return E.clip(a[i],-5,50);}));
+  check(tn+" abs", arr(E.vmath.abs(d,a)), loop(T,a,function(i){return Math.abs(a[i]);}));
+  var dd = new T(a.length-1);
+  check(tn+" diff", arr(E.vmath.diff(dd,a)), loop(T,dd,function(i){return a[i+1]-a[i];}));
+  var s = 0;
+  check(tn+" cumsum", arr(E.vmath.cumsum(d,a)), loop(T,a,function(i){s+=a[i];return s;}));
+  var dot = 0, mn = Infinity, mx = -Infinity, cnt = 0;
+  for (var i=0;i<a.length;i++) {
+    dot += a[i]*b[i];
+    mn = Math.min(mn,a[i]);
+    mx = Math.max(mx,a[i]);
+    if (a[i]>2.5) cnt++;
+  }
+  check(tn+" dot", E.vmath.dot(a,b), dot);
+  check(tn+" min", E.vmath.min(a), mn);
+  check(tn+" max", E.vmath.max(a), mx);
+  check(tn+" countAbove", E.vmath.countAbove(a,2.5), cnt);
+  // in place
+  var c = new T(src);
+  E.vmath.add(c,c,1);
+  check(tn+" in place", arr(c), loop(T,a,function(i){return a[i]+1;}));
+});
+
+// Mixed types, lengths, views on an offset ArrayBuffer and big endian data
+var f = new Float32Array([1.5,2.5,-3.5]);
+var i16 = new Int16Array([10,20,30,40]);
+var o = new Float64Array(3);
+check("mixed", arr(E.vmath.add(o,f,i16)), [11.5,22.5,26.5]);
+var buf = new ArrayBuffer(11);
+var view = new Int16Array(buf, 1, 5); // unaligned
+view.set([1,2,3,4,5]);
+check("unaligned", arr(E.vmath.mul(view,view,view)), [1,4,9,16,25]);
+check("unaligned dot", E.vmath.dot(view,view), 1+16+81+256+625);
+var u24 = new Uint24Array([1,0xFFFFFF,3]);
+check("uint24", arr(E.vmath.add(u24,u24,1)), [2,0,4]);
+check("empty min", E.vmath.min(new Int8Array(0)), Infinity);
+check("empty max", E.vmath.max(new Float32Array(0)), -Infinity);
+check("NaN min", isNaN(E.vmath.min(new Float64Array([1,NaN,3]))), true);
+check("NaN max", isNaN(E.vmath.max(new Float32Array([NaN,1]))), true);
+var s = new Float64Array([4294967296+5, -1.5, 3e10, 2147483648]);
+check("wrap int32", arr(E.vmath.add(new Int32Array(4),s,0)), [5,-1,-64771072,-2147483648]);
+check("wrap uint8", arr(E.vmath.add(new Uint8Array(3),new Float64Array([-1,256.7,1e20]),0)), [255,0,0]);
+check("clamped", arr(E.vmath.add(new Uint8ClampedArray(4),new Float64Array([NaN,-3,300,7.9]),0)), [0,0,255,7]);
+check("require", require("vmath")===E.vmath, true);
+try { E.vmath.add(new Int8Array(2), [1,2], 3); ok = false; } catch (e) { }
+
+result = ok;